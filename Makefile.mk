@@ -8,33 +8,52 @@ OBJ_DIR = obj
 BIN_DIR = bin
 INC_DIR = include # プロジェクト自身のインクルードディレクトリ
 
-# --- 外部ライブラリパス ---
-# コマンドで指定された特定のパスを使用
-NAVIGATOR_LIB_PATH = /home/pi/navigator-lib/target/debug
-
-# --- GStreamer API のためのフラグとライブラリ ---
-# pkg-config を使用して GStreamer のコンパイルフラグとリンクライブラリを取得
-GSTREAMER_CFLAGS = $(shell pkg-config --cflags gstreamer-1.0)
-GSTREAMER_LIBS = $(shell pkg-config --libs gstreamer-1.0)
-CXXFLAGS += $(GSTREAMER_CFLAGS) # GStreamer のコンパイルフラグを追加
-
-# pkg-configが成功したかチェック
-ifeq ($(GSTREAMER_CFLAGS),)
-    $(error "pkg-config could not find gstreamer-1.0. Make sure it is installed and PKG_CONFIG_PATH is set.")
+# --- ビルド構成 ---
+# HAL_NAVIGATOR=1: navigator-lib をリンクし、実機 (navigator) バックエンドを既定にする
+# HAL_NAVIGATOR=0: navigator-lib なしでビルドする (開発機用。sim / replay バックエンドのみ)
+# WITH_GSTREAMER=0: GStreamer なしでビルドする (カメラ配信は行わない)
+# 例: make -f Makefile.mk HAL_NAVIGATOR=0 WITH_GSTREAMER=0
+HAL_NAVIGATOR ?= 1
+WITH_GSTREAMER ?= 1
+
+# --- インクルードディレクトリ・ライブラリ ---
+# プロジェクトのインクルードディレクトリ (外部ライブラリは以下の構成ごとに追加)
+INCLUDES = -I$(INC_DIR)
+LDFLAGS =
+LIBS = -lpthread -lm
+
+ifeq ($(HAL_NAVIGATOR),1)
+    # --- 外部ライブラリパス ---
+    # コマンドで指定された特定のパスを使用
+    NAVIGATOR_LIB_PATH = /home/pi/navigator-lib/target/debug
+    CXXFLAGS += -DHAL_NAVIGATOR
+    INCLUDES += -I$(NAVIGATOR_LIB_PATH)
+    LDFLAGS += -L$(NAVIGATOR_LIB_PATH) \
+               -Wl,-rpath=$(NAVIGATOR_LIB_PATH) # 実行時リンクのためのrpathを設定
+    LIBS += -lbluerobotics_navigator
+
+    # --- navigator-lib の機能 ---
+    # 1: 変更のあった PWM チャンネルを set_pwm_channels_duty_cycle_values で1回のバス転送にまとめる
+    # 0: チャンネルごとに set_pwm_channel_duty_cycle を呼ぶ (複数チャンネル API のない古い navigator-lib 用)
+    NAVIGATOR_MULTI_CHANNEL_PWM ?= 1
+    ifeq ($(NAVIGATOR_MULTI_CHANNEL_PWM),1)
+        CXXFLAGS += -DNAVIGATOR_HAS_MULTI_CHANNEL_PWM
+    endif
 endif
 
-# --- インクルードディレクトリ ---
-# プロジェクトのインクルードディレクトリと外部ライブラリのインクルードディレクトリを追加
-INCLUDES = -I$(INC_DIR) -I$(NAVIGATOR_LIB_PATH)
-
-# --- ライブラリディレクトリ ---
-LDFLAGS = -L$(NAVIGATOR_LIB_PATH) \
-          -Wl,-rpath=$(NAVIGATOR_LIB_PATH) # 実行時リンクのためのrpathを設定
-
-# --- リンクするライブラリ ---
-# コマンドで指定された特定のライブラリ名を使用
-LIBS = -lbluerobotics_navigator -lpthread -lm
-LIBS += $(GSTREAMER_LIBS) # GStreamer のリンクライブラリを追加
+ifeq ($(WITH_GSTREAMER),1)
+    # --- GStreamer API のためのフラグとライブラリ ---
+    # pkg-config を使用して GStreamer のコンパイルフラグとリンクライブラリを取得
+    GSTREAMER_CFLAGS = $(shell pkg-config --cflags gstreamer-1.0)
+    GSTREAMER_LIBS = $(shell pkg-config --libs gstreamer-1.0)
+
+    # pkg-configが成功したかチェック
+    ifeq ($(GSTREAMER_CFLAGS),)
+        $(error "pkg-config could not find gstreamer-1.0. Make sure it is installed and PKG_CONFIG_PATH is set. (Use WITH_GSTREAMER=0 to build without video)")
+    endif
+    CXXFLAGS += $(GSTREAMER_CFLAGS) -DWITH_GSTREAMER # GStreamer のコンパイルフラグを追加
+    LIBS += $(GSTREAMER_LIBS) # GStreamer のリンクライブラリを追加
+endif
 
 # --- ターゲット実行ファイル ---
 TARGET_NAME = navigator_control
@@ -54,6 +73,70 @@ $(TARGET): $(OBJS) | $(BIN_DIR) # リンク前に BIN_DIR が存在すること
 	$(CXX) $(LDFLAGS) $^ -o $@ $(LIBS)
 	@echo "Build complete: $(TARGET)"
 
+# --- ベンチマーク (制御の処理経路の ns/op と確保回数を計測する) ---
+# bench/ 以下の全ファイルと main.o 以外の全モジュールを1つの実行ファイルにリンクする。
+# ハードウェアは HAL の sim バックエンドで置き換えるため、実機でも開発機でも実行できる。
+#   make -f Makefile.mk bench                                  # ビルドのみ
+#   make -f Makefile.mk bench-run                              # 実行して $(BENCH_RESULTS) に保存
+#   make -f Makefile.mk bench-run BENCH_BASELINE=前回の結果.csv  # 前回と比較 (悪化があれば失敗)
+BENCH_DIR = bench
+BENCH_SRCS = $(wildcard $(BENCH_DIR)/*.cpp)
+BENCH_TARGET = $(BIN_DIR)/bench
+BENCH_RESULTS ?= $(BIN_DIR)/bench_results.csv
+BENCH_THRESHOLD ?= 10
+
+bench: $(BENCH_TARGET)
+
+$(BENCH_TARGET): $(BENCH_SRCS) $(BENCH_DIR)/bench.h $(filter-out $(OBJ_DIR)/main.o,$(OBJS)) | $(BIN_DIR)
+	$(CXX) $(CXXFLAGS) -I$(BENCH_DIR) $(INCLUDES) $(LDFLAGS) $(filter %.cpp %.o,$^) -o $@ $(LIBS)
+
+bench-run: $(BENCH_TARGET)
+	$(BENCH_TARGET) --out $(BENCH_RESULTS) $(if $(BENCH_BASELINE),--baseline $(BENCH_BASELINE) --threshold $(BENCH_THRESHOLD))
+
+# --- 閉ループの車両シミュレータ (制御コードを6自由度の運動モデルにつないで評価する) ---
+# sim/ 以下の全ファイルと main.o 以外の全モジュールを1つの実行ファイルにリンクする。
+#   make -f Makefile.mk sim                                   # ビルドのみ
+#   ./bin/rov_sim --scenario yaw_step --sweep yaw_gain=1:4:0.5 --out sweep.csv
+SIM_DIR = sim
+SIM_SRCS = $(wildcard $(SIM_DIR)/*.cpp)
+SIM_TARGET = $(BIN_DIR)/rov_sim
+
+sim: $(SIM_TARGET)
+
+$(SIM_TARGET): $(SIM_SRCS) $(filter-out $(OBJ_DIR)/main.o,$(OBJS)) | $(BIN_DIR)
+	$(CXX) $(CXXFLAGS) $(INCLUDES) $(LDFLAGS) $(filter %.cpp %.o,$^) -o $@ $(LIBS)
+
+# --- セッション再生による回帰テスト (記録した入力を thruster_update に流して出力 PWM を比較する) ---
+# regress/ 以下の全ファイルと main.o 以外の全モジュールを1つの実行ファイルにリンクする。
+#   make -f Makefile.mk regress                                          # ビルドのみ
+#   make -f Makefile.mk regress-run REGRESS_SESSION=blackbox.bin          # 記録時の出力と比較
+#   make -f Makefile.mk regress-run REGRESS_SESSION=s.bin REGRESS_GOLDEN=golden.csv
+REGRESS_DIR = regress
+REGRESS_SRCS = $(wildcard $(REGRESS_DIR)/*.cpp)
+REGRESS_TARGET = $(BIN_DIR)/session_replay
+REGRESS_SESSION ?= blackbox.bin
+REGRESS_TOLERANCE ?= 0.5
+
+regress: $(REGRESS_TARGET)
+
+$(REGRESS_TARGET): $(REGRESS_SRCS) $(filter-out $(OBJ_DIR)/main.o,$(OBJS)) | $(BIN_DIR)
+	$(CXX) $(CXXFLAGS) $(INCLUDES) $(LDFLAGS) $(filter %.cpp %.o,$^) -o $@ $(LIBS)
+
+regress-run: $(REGRESS_TARGET)
+	$(REGRESS_TARGET) $(REGRESS_SESSION) --tolerance $(REGRESS_TOLERANCE) $(if $(REGRESS_GOLDEN),--golden $(REGRESS_GOLDEN))
+
+# --- オフラインツール (機体上では動かさない解析用のプログラム) ---
+#   make -f Makefile.mk tools
+#   ./bin/blackbox_decode blackbox.bin --csv blackbox.csv      # フライトレコーダーを CSV へ
+#   ./bin/blackbox_decode blackbox.bin --columns blackbox_cols # 列ごとのバイナリ配列へ
+TOOLS_DIR = tools
+TOOLS_TARGETS = $(patsubst $(TOOLS_DIR)/%.cpp,$(BIN_DIR)/%,$(wildcard $(TOOLS_DIR)/*.cpp))
+
+tools: $(TOOLS_TARGETS)
+
+$(TOOLS_TARGETS): $(BIN_DIR)/%: $(TOOLS_DIR)/%.cpp $(wildcard $(strip $(INC_DIR))/*.h) | $(BIN_DIR)
+	$(CXX) $(CXXFLAGS) $(INCLUDES) $(LDFLAGS) $< -o $@
+
 # --- ソースファイルをオブジェクトファイルにコンパイルするルール ---
 # SRC_DIR の .cpp ファイルを OBJ_DIR の .o ファイルにコンパイル
 $(OBJ_DIR)/%.o: $(SRC_DIR)/%.cpp | $(OBJ_DIR) # コンパイル前に OBJ_DIR が存在することを確認
@@ -75,7 +158,7 @@ clean:
 	@echo "Cleaned."
 
 # --- Phony ターゲット (ファイルを表さないターゲット) ---
-.PHONY: all clean $(OBJ_DIR) $(BIN_DIR)
+.PHONY: all bench bench-run sim regress regress-run tools clean $(OBJ_DIR) $(BIN_DIR)
 
 # --- 中間ファイルが削除されるのを防ぐ ---
 .SECONDARY: $(OBJS)
\ No newline at end of file
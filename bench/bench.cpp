@@ -0,0 +1,261 @@
+// マイクロベンチマークの計測ハーネスと main (bench.h)
+//   make bench && ./bin/bench
+#include "bench.h"
+#include "time_utils.h" // monotonic_now_ns
+#include <stdio.h>
+#include <stdlib.h>     // atoi, atof, strtod
+#include <string.h>     // strstr, strcmp, strncpy
+#include <atomic>
+#include <algorithm>    // std::sort
+
+// --- ヒープ確保の計数 ---
+// glibc の malloc を差し替えて回数とバイト数を数える (operator new も malloc を経由するため含まれる)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static std::atomic<unsigned long long> alloc_count(0);
+static std::atomic<unsigned long long> alloc_bytes(0);
+
+extern "C" void *malloc(size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(count * size, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+// --- ケースの登録 ---
+static BenchCase cases[BENCH_MAX_CASES];
+static size_t case_count = 0;
+
+void bench_register(const char *name, BenchFunction function, void *context)
+{
+    if (case_count >= BENCH_MAX_CASES)
+    {
+        fprintf(stderr, "bench: ケースが多すぎます (最大 %d): %s\n", BENCH_MAX_CASES, name);
+        return;
+    }
+    cases[case_count].name = name;
+    cases[case_count].function = function;
+    cases[case_count].context = context;
+    case_count++;
+}
+
+typedef struct
+{
+    const char *filter;
+    int64_t min_time_ns;
+    int repeat;
+    const char *out_path;
+    const char *baseline_path;
+    double threshold_percent;
+} BenchOptions;
+
+// ヘルパー関数: iterations 回の所要時間 [ns]
+static int64_t time_iterations(const BenchCase &c, uint64_t iterations)
+{
+    int64_t start_ns = monotonic_now_ns();
+    c.function(c.context, iterations);
+    return monotonic_now_ns() - start_ns;
+}
+
+// 1ケースを較正・計測する
+static void run_case(const BenchCase &c, const BenchOptions &opt, BenchResult *result)
+{
+    // 較正: 1回の計測が min_time_ns を超える回数まで増やす
+    uint64_t iterations = 1;
+    for (;;)
+    {
+        int64_t elapsed_ns = time_iterations(c, iterations);
+        if (elapsed_ns >= opt.min_time_ns || iterations >= (1ULL << 40))
+            break;
+        double scale = elapsed_ns > 0 ? 1.2 * static_cast<double>(opt.min_time_ns) / static_cast<double>(elapsed_ns) : 100.0;
+        if (scale < 2.0)
+            scale = 2.0;
+        if (scale > 100.0)
+            scale = 100.0;
+        iterations = static_cast<uint64_t>(static_cast<double>(iterations) * scale);
+    }
+
+    double samples[64];
+    int repeat = opt.repeat < 1 ? 1 : (opt.repeat > 64 ? 64 : opt.repeat);
+    unsigned long long count_before = alloc_count.load(std::memory_order_relaxed);
+    unsigned long long bytes_before = alloc_bytes.load(std::memory_order_relaxed);
+    for (int r = 0; r < repeat; ++r)
+    {
+        samples[r] = static_cast<double>(time_iterations(c, iterations)) / static_cast<double>(iterations);
+    }
+    double total_ops = static_cast<double>(iterations) * repeat;
+    result->allocs_per_op = static_cast<double>(alloc_count.load(std::memory_order_relaxed) - count_before) / total_ops;
+    result->bytes_per_op = static_cast<double>(alloc_bytes.load(std::memory_order_relaxed) - bytes_before) / total_ops;
+
+    std::sort(samples, samples + repeat);
+    strncpy(result->name, c.name, BENCH_NAME_LEN - 1);
+    result->name[BENCH_NAME_LEN - 1] = '\0';
+    result->iterations = iterations;
+    result->ns_per_op = samples[repeat / 2];
+    result->ns_per_op_min = samples[0];
+}
+
+// ヘルパー関数: 結果を CSV に書き出す (1行目はヘッダー)
+static bool write_results(const char *path, const BenchResult *results, size_t count)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "bench: '%s' を書き込み用に開けません\n", path);
+        return false;
+    }
+    fprintf(fp, "name,iterations,ns_per_op,ns_per_op_min,allocs_per_op,bytes_per_op\n");
+    for (size_t i = 0; i < count; ++i)
+    {
+        const BenchResult &r = results[i];
+        fprintf(fp, "%s,%llu,%.3f,%.3f,%.4f,%.2f\n", r.name, static_cast<unsigned long long>(r.iterations),
+                r.ns_per_op, r.ns_per_op_min, r.allocs_per_op, r.bytes_per_op);
+    }
+    fclose(fp);
+    return true;
+}
+
+// ヘルパー関数: 前回の CSV と比較し、悪化したケースの数を返す (読み込めない場合は -1)
+static int compare_with_baseline(const char *path, const BenchResult *results, size_t count, double threshold_percent)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "bench: ベースライン '%s' を開けません\n", path);
+        return -1;
+    }
+
+    printf("\n%-36s %12s %12s %9s %10s\n", "baseline comparison", "base ns/op", "ns/op", "change", "allocs/op");
+    int regressions = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp))
+    {
+        char name[BENCH_NAME_LEN];
+        unsigned long long iterations;
+        double ns_per_op, ns_per_op_min, allocs_per_op, bytes_per_op;
+        if (sscanf(line, "%63[^,],%llu,%lf,%lf,%lf,%lf", name, &iterations, &ns_per_op, &ns_per_op_min,
+                   &allocs_per_op, &bytes_per_op) != 6)
+            continue; // ヘッダー行
+        for (size_t i = 0; i < count; ++i)
+        {
+            const BenchResult &r = results[i];
+            if (strcmp(r.name, name) != 0)
+                continue;
+            double change = ns_per_op > 0.0 ? (r.ns_per_op - ns_per_op) / ns_per_op * 100.0 : 0.0;
+            bool slower = change > threshold_percent;
+            bool more_allocs = r.allocs_per_op > allocs_per_op + 1e-6;
+            if (slower || more_allocs)
+                regressions++;
+            printf("%-36s %12.1f %12.1f %+8.1f%% %4.2f->%-4.2f%s\n", name, ns_per_op, r.ns_per_op, change,
+                   allocs_per_op, r.allocs_per_op, slower ? "  SLOWER" : (more_allocs ? "  MORE ALLOCS" : ""));
+        }
+    }
+    fclose(fp);
+    return regressions;
+}
+
+static void print_usage(const char *program)
+{
+    printf("usage: %s [--filter STR] [--min-time-ms N] [--repeat N] [--out FILE.csv]\n"
+           "          [--baseline FILE.csv] [--threshold PERCENT]\n",
+           program);
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions opt;
+    opt.filter = NULL;
+    opt.min_time_ns = 200 * NSEC_PER_MSEC;
+    opt.repeat = 5;
+    opt.out_path = NULL;
+    opt.baseline_path = NULL;
+    opt.threshold_percent = 10.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (!value)
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (strcmp(arg, "--filter") == 0)
+            opt.filter = value;
+        else if (strcmp(arg, "--min-time-ms") == 0)
+            opt.min_time_ns = static_cast<int64_t>(atoi(value)) * NSEC_PER_MSEC;
+        else if (strcmp(arg, "--repeat") == 0)
+            opt.repeat = atoi(value);
+        else if (strcmp(arg, "--out") == 0)
+            opt.out_path = value;
+        else if (strcmp(arg, "--baseline") == 0)
+            opt.baseline_path = value;
+        else if (strcmp(arg, "--threshold") == 0)
+            opt.threshold_percent = atof(value);
+        else
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+        ++i;
+    }
+
+    bench_ahrs_register();
+    bench_control_register();
+
+    static BenchResult results[BENCH_MAX_CASES];
+    size_t result_count = 0;
+    printf("%-36s %14s %12s %12s %10s %10s\n", "benchmark", "iterations", "ns/op", "min ns/op", "allocs/op", "bytes/op");
+    for (size_t i = 0; i < case_count; ++i)
+    {
+        if (opt.filter && !strstr(cases[i].name, opt.filter))
+            continue;
+        BenchResult &r = results[result_count++];
+        run_case(cases[i], opt, &r);
+        printf("%-36s %14llu %12.1f %12.1f %10.2f %10.1f\n", r.name, static_cast<unsigned long long>(r.iterations),
+               r.ns_per_op, r.ns_per_op_min, r.allocs_per_op, r.bytes_per_op);
+        fflush(stdout);
+    }
+
+    if (opt.out_path && !write_results(opt.out_path, results, result_count))
+        return 2;
+    if (opt.baseline_path)
+    {
+        int regressions = compare_with_baseline(opt.baseline_path, results, result_count, opt.threshold_percent);
+        if (regressions < 0)
+            return 2;
+        if (regressions > 0)
+        {
+            printf("%d 件のケースが悪化しました (許容 %.1f%%)\n", regressions, opt.threshold_percent);
+            return 1;
+        }
+        printf("悪化したケースはありません (許容 %.1f%%)\n", opt.threshold_percent);
+    }
+    return 0;
+}
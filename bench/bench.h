@@ -0,0 +1,53 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+// --- マイクロベンチマークの計測ハーネス ---
+// 各ケースは「iterations 回の処理を行う関数」として登録する。ハーネスは min_time_ms を超えるまで
+// 回数を増やして較正し、同じ回数で repeat 回計測して ns/op の中央値と最小値を求める。
+// 計測中の malloc / calloc / realloc (operator new を含む) の回数とバイト数も数え、1回あたりで報告する。
+//
+//   ./bin/bench [--filter 文字列] [--min-time-ms N] [--repeat N] [--out 結果.csv]
+//               [--baseline 前回.csv] [--threshold 許容する悪化率%]
+// --baseline を指定すると同名ケースの ns/op (中央値) と allocs/op を比較し、
+// threshold を超えて遅くなったか、確保回数が増えたケースがあれば終了コード 1 を返す。
+
+#define BENCH_MAX_CASES 64
+#define BENCH_NAME_LEN 64
+
+// iterations 回の処理を行う関数 (context はケース登録時に渡したもの)
+typedef void (*BenchFunction)(void *context, uint64_t iterations);
+
+typedef struct
+{
+    const char *name;
+    BenchFunction function;
+    void *context;
+} BenchCase;
+
+typedef struct
+{
+    char name[BENCH_NAME_LEN];
+    uint64_t iterations;   // 1回の計測での処理回数
+    double ns_per_op;      // repeat 回の中央値
+    double ns_per_op_min;  // repeat 回の最小値
+    double allocs_per_op;  // 1回あたりのヒープ確保回数
+    double bytes_per_op;   // 1回あたりのヒープ確保バイト数
+} BenchResult;
+
+// ケースを登録する (各ベンチマークファイルの bench_*_register から呼ぶ)
+void bench_register(const char *name, BenchFunction function, void *context);
+
+// 各ベンチマークファイルの登録関数 (bench.cpp の main から順に呼ばれる)
+void bench_ahrs_register();
+void bench_control_register();
+
+// 計測対象の計算結果をコンパイラの最適化で消されないようにする
+static inline void bench_do_not_optimize(const void *p)
+{
+    __asm__ __volatile__("" : : "g"(p) : "memory");
+}
+
+#endif // BENCH_H
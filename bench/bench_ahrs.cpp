@@ -0,0 +1,57 @@
+// 姿勢推定 (ahrs_update) の1回あたりの処理時間
+// ハードウェアにはアクセスしないため、Raspberry Pi (ARM) 上でも開発 PC 上でも実行できる
+#include "bench.h"
+#include "ahrs.h"
+#include <stddef.h> // NULL
+#include <math.h>   // sinf, cosf
+
+#define AHRS_PATTERN 256 // 合成データの長さ (2のべき乗)
+
+static const float AHRS_DT_S = 1.0f / 200.0f; // GYRO_RATE_HZ の既定値
+
+typedef struct
+{
+    int mode; // 0: ジャイロのみ, 1: +加速度, 2: +磁力
+    AhrsState ahrs;
+} AhrsBenchContext;
+
+// 静止状態に小さな揺れとバイアスを加えた合成データ (定数だけだと分岐予測が理想的になりすぎるため)
+static AxisData gyro[AHRS_PATTERN], accel[AHRS_PATTERN], mag[AHRS_PATTERN];
+static AhrsBenchContext contexts[3];
+
+static void bench_ahrs_update(void *context, uint64_t iterations)
+{
+    AhrsBenchContext *ctx = static_cast<AhrsBenchContext *>(context);
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        int i = static_cast<int>(n & (AHRS_PATTERN - 1));
+        ahrs_update(&ctx->ahrs, gyro[i], ctx->mode >= 1 ? &accel[i] : NULL, ctx->mode >= 2 ? &mag[i] : NULL, AHRS_DT_S);
+    }
+    bench_do_not_optimize(&ctx->ahrs);
+}
+
+void bench_ahrs_register()
+{
+    for (int i = 0; i < AHRS_PATTERN; ++i)
+    {
+        float t = static_cast<float>(i) * AHRS_DT_S;
+        gyro[i].x = 3.0f * sinf(t * 7.0f);
+        gyro[i].y = 2.0f * cosf(t * 5.0f);
+        gyro[i].z = 0.8f + sinf(t * 3.0f);
+        accel[i].x = 0.3f * sinf(t * 11.0f);
+        accel[i].y = 0.2f * cosf(t * 13.0f);
+        accel[i].z = 9.8f;
+        mag[i].x = 0.25f;
+        mag[i].y = 0.05f * sinf(t);
+        mag[i].z = 0.4f;
+    }
+
+    static const char *const names[3] = {"ahrs/update_gyro", "ahrs/update_gyro_accel", "ahrs/update_gyro_accel_mag"};
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        contexts[mode].mode = mode;
+        ahrs_init(&contexts[mode].ahrs, 1.0f, 0.05f);
+        ahrs_update(&contexts[mode].ahrs, gyro[0], &accel[0], &mag[0], AHRS_DT_S); // 初期化を計測から除く
+        bench_register(names[mode], bench_ahrs_update, &contexts[mode]);
+    }
+}
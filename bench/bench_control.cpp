@@ -0,0 +1,241 @@
+// 制御の処理経路 (受信パケットのデコード → スラスター更新 → テレメトリ生成・送信) のベンチマーク
+// ハードウェアは HAL の sim バックエンド (ノイズ・I2C 遅延なし) で置き換える
+#include "bench.h"
+#include "config.h"           // g_config
+#include "hal.h"              // hal_select, hal_init
+#include "logger.h"           // g_log_min_level
+#include "gamepad.h"          // parseGamepadData, encodeGamepadPacket
+#include "thruster_control.h" // thruster_init, thruster_update
+#include "thrust_allocation.h"
+#include "thrust_curve.h"
+#include "controller.h"       // lowpass_update, slew_update
+#include "sensor_data.h"      // format_sensor_data_text, read_and_format_sensor_data
+#include "telemetry.h"        // telemetry_encode_frame
+#include "network.h"          // network_send
+#include <stdio.h>
+#include <string.h>     // memset
+#include <arpa/inet.h>  // inet_pton
+#include <sys/socket.h>
+
+#define CONTROL_PATTERN 64 // 入力パターンの長さ (2のべき乗)
+
+static const float CONTROL_DT_S = 0.01f; // LOOP_DELAY_US の既定値
+
+// スティックを動かし続ける入力列 (毎回同じ値だと PWM の書き込みスキップで実際の処理が省かれるため)
+static GamepadData gamepad_inputs[CONTROL_PATTERN];
+static AxisData gyro_inputs[CONTROL_PATTERN];
+static char binary_packets[CONTROL_PATTERN][GAMEPAD_PACKET_SIZE];
+static char csv_packets[CONTROL_PATTERN][64];
+static size_t csv_lengths[CONTROL_PATTERN];
+static SensorReadings sensor_readings;
+static NetworkContext net_ctx; // 受信リングを含むため静的領域に確保
+static int sink_socket = -1;
+
+static void bench_parse_binary(void *, uint64_t iterations)
+{
+    GamepadData out;
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        parseGamepadData(binary_packets[n & (CONTROL_PATTERN - 1)], GAMEPAD_PACKET_SIZE, out);
+        bench_do_not_optimize(&out);
+    }
+}
+
+static void bench_parse_csv(void *, uint64_t iterations)
+{
+    GamepadData out;
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        size_t i = n & (CONTROL_PATTERN - 1);
+        parseGamepadData(csv_packets[i], csv_lengths[i], out);
+        bench_do_not_optimize(&out);
+    }
+}
+
+// 推力配分からPWM出力 (sim バックエンド) までを含む制御周期1回分
+static void bench_thruster_update(void *, uint64_t iterations)
+{
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        size_t i = n & (CONTROL_PATTERN - 1);
+        thruster_update(gamepad_inputs[i], gyro_inputs[i], CONTROL_DT_S);
+    }
+}
+
+static void bench_thrust_allocate(void *context, uint64_t iterations)
+{
+    ThrustAllocator *alloc = static_cast<ThrustAllocator *>(context);
+    float output[ALLOC_MAX_THRUSTERS];
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        const GamepadData &g = gamepad_inputs[n & (CONTROL_PATTERN - 1)];
+        float wrench[WRENCH_DOF] = {g.rightThumbY * 1e-3f, g.rightThumbX * 1e-3f, 0.0f, 0.0f, 0.0f, g.leftThumbX * 1e-3f};
+        thrust_allocate(alloc, wrench, output);
+        bench_do_not_optimize(output);
+    }
+}
+
+static void bench_thrust_curve(void *context, uint64_t iterations)
+{
+    const ThrustCurveLut *lut = static_cast<const ThrustCurveLut *>(context);
+    float pwm = 0.0f;
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        pwm += thrust_curve_pwm(lut, static_cast<float>(n & 1023) * 0.05f - 25.0f);
+    }
+    bench_do_not_optimize(&pwm);
+}
+
+// 出力の平滑化 (一次遅れ + 変化率制限) を全スラスター分
+static void bench_output_smoothing(void *, uint64_t iterations)
+{
+    LowPassFilter filters[ALLOC_MAX_THRUSTERS];
+    SlewLimiter limiters[ALLOC_MAX_THRUSTERS];
+    for (int t = 0; t < ALLOC_MAX_THRUSTERS; ++t)
+    {
+        lowpass_init(&filters[t], g_config.smoothing_tau_horizontal_s, 1100.0f);
+        slew_init(&limiters[t], g_config.slew_rate_pwm_per_s, 1100.0f);
+    }
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        float target = 1100.0f + static_cast<float>(n & 511);
+        for (int t = 0; t < ALLOC_MAX_THRUSTERS; ++t)
+        {
+            slew_update(&limiters[t], lowpass_update(&filters[t], target, CONTROL_DT_S), CONTROL_DT_S);
+        }
+    }
+    bench_do_not_optimize(limiters);
+}
+
+static void bench_format_text(void *, uint64_t iterations)
+{
+    char buffer[SENSOR_BUFFER_SIZE];
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        format_sensor_data_text(sensor_readings, buffer, sizeof(buffer));
+        bench_do_not_optimize(buffer);
+    }
+}
+
+static void bench_read_and_format(void *, uint64_t iterations)
+{
+    char buffer[SENSOR_BUFFER_SIZE];
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        read_and_format_sensor_data(buffer, sizeof(buffer));
+        bench_do_not_optimize(buffer);
+    }
+}
+
+static void bench_encode_binary(void *context, uint64_t iterations)
+{
+    TelemetryEncoder *enc = static_cast<TelemetryEncoder *>(context);
+    uint8_t frame[TELEMETRY_MAX_FRAME_SIZE];
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        float values[TELEMETRY_MAX_FIELDS] = {0.0f};
+        uint32_t available = telemetry_fill_values(sensor_readings, values);
+        telemetry_encode_frame(enc, values, available, n, frame, sizeof(frame));
+        bench_do_not_optimize(frame);
+    }
+}
+
+static void bench_network_send(void *, uint64_t iterations)
+{
+    char frame[64];
+    memset(frame, 0x5A, sizeof(frame));
+    for (uint64_t n = 0; n < iterations; ++n)
+    {
+        network_send(&net_ctx, frame, sizeof(frame));
+    }
+}
+
+// ヘルパー関数: ループバックの受け側ソケットを送信先にした NetworkContext を用意する
+// (受け側は読まないため、バッファが埋まった後のデータグラムはカーネルが捨てる)
+static bool setup_loopback_network()
+{
+    memset(&net_ctx, 0, sizeof(net_ctx));
+    net_ctx.recv_socket = -1;
+    sink_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    net_ctx.send_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sink_socket < 0 || net_ctx.send_socket < 0)
+        return false;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0; // 空いているポート
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(sink_socket, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        getsockname(sink_socket, reinterpret_cast<struct sockaddr *>(&addr), &addr_len) < 0)
+        return false;
+    net_ctx.client_addr_send = addr;
+    net_ctx.client_addr_known = true;
+    return true;
+}
+
+void bench_control_register()
+{
+    // ハードウェアは sim バックエンドで置き換え、ノイズと I2C 遅延はなしにする
+    g_log_min_level = LOG_LEVEL_WARN; // 初期化時のログを抑える
+    g_config.hal_sim_i2c_latency_us = 0.0f;
+    g_config.hal_sim_i2c_jitter_us = 0.0f;
+    g_config.hal_sim_gyro_noise_dps = 0.0f;
+    g_config.hal_sim_accel_noise = 0.0f;
+    g_config.hal_sim_mag_noise = 0.0f;
+    if (!hal_select("sim") || !hal_init() || !thruster_init())
+    {
+        fprintf(stderr, "bench: sim バックエンドでのスラスター初期化に失敗しました\n");
+        return;
+    }
+
+    for (int i = 0; i < CONTROL_PATTERN; ++i)
+    {
+        GamepadData &g = gamepad_inputs[i];
+        g.leftThumbX = (i * 1031) % 65536 - 32768;
+        g.leftThumbY = (i * 2053) % 65536 - 32768;
+        g.rightThumbX = (i * 4099) % 65536 - 32768;
+        g.rightThumbY = (i * 8209) % 65536 - 32768;
+        g.LT = (i * 17) % 1024;
+        g.RT = (i * 29) % 1024;
+        g.buttons = static_cast<uint16_t>((i & 8) ? RightShoulder : None);
+        gyro_inputs[i].x = static_cast<float>(i % 7) - 3.0f;
+        gyro_inputs[i].y = 0.0f;
+        gyro_inputs[i].z = static_cast<float>(i % 11) - 5.0f;
+        encodeGamepadPacket(g, static_cast<uint32_t>(i), static_cast<uint64_t>(i) * 10000, binary_packets[i], GAMEPAD_PACKET_SIZE);
+        int len = snprintf(csv_packets[i], sizeof(csv_packets[i]), "%d,%d,%d,%d,%d,%d,%u",
+                           g.leftThumbX, g.leftThumbY, g.rightThumbX, g.rightThumbY, g.LT, g.RT, static_cast<unsigned>(g.buttons));
+        csv_lengths[i] = len > 0 ? static_cast<size_t>(len) : 0;
+    }
+    read_sensor_data(&sensor_readings);
+
+    static ThrustAllocator allocator;
+    float force_min[ALLOC_MAX_THRUSTERS], force_max[ALLOC_MAX_THRUSTERS];
+    for (int t = 0; t < ALLOC_MAX_THRUSTERS; ++t)
+    {
+        force_min[t] = -40.0f; // 双方向スラスターとして配分する
+        force_max[t] = 40.0f;
+    }
+    thrust_allocator_init(&allocator, g_config.alloc_thruster_count, g_config.alloc_matrix, g_config.alloc_channels,
+                          force_min, force_max);
+    static ThrustCurveLut lut;
+    if (!thrust_curve_load_builtin(&lut, "t200_16v"))
+        thrust_curve_build_linear(&lut, 1100.0f, 1500.0f, 1900.0f, 40.0f, true);
+    static TelemetryEncoder encoder;
+    telemetry_encoder_init(&encoder, TELEMETRY_ENCODING_FLOAT16, TELEMETRY_ALL_FIELDS);
+
+    bench_register("gamepad/parse_binary", bench_parse_binary, NULL);
+    bench_register("gamepad/parse_csv", bench_parse_csv, NULL);
+    bench_register("thruster/update", bench_thruster_update, NULL);
+    bench_register("thruster/allocate", bench_thrust_allocate, &allocator);
+    bench_register("thruster/curve_lookup", bench_thrust_curve, &lut);
+    bench_register("thruster/output_smoothing", bench_output_smoothing, NULL);
+    bench_register("telemetry/format_text", bench_format_text, NULL);
+    bench_register("telemetry/read_and_format", bench_read_and_format, NULL);
+    bench_register("telemetry/encode_binary_f16", bench_encode_binary, &encoder);
+    if (setup_loopback_network())
+        bench_register("network/send", bench_network_send, NULL);
+    else
+        fprintf(stderr, "bench: ループバックソケットを用意できないため network/send を省略します\n");
+}
@@ -0,0 +1,42 @@
+#ifndef AHRS_H
+#define AHRS_H
+
+#include "hal.h" // AxisData
+
+// --- 姿勢推定 (Mahony 相補フィルタ) ---
+// ジャイロを積分した姿勢クォータニオンを、加速度 (重力方向) と磁力 (磁北方向) との誤差で補正する。
+// 誤差の積分項がジャイロのバイアス推定値となり、補正後の角速度を制御ループへ渡せる。
+// 状態は固定サイズで動的確保は行わない。ジャイロの読み取りごと (IMU レート) に ahrs_update を呼ぶこと。
+// 角速度の単位は deg/s (既存のジャイロ補正と同じ)、加速度・磁力は単位を問わない (正規化して使う)。
+
+// 推定器の状態
+typedef struct
+{
+    float q0, q1, q2, q3;     // 姿勢クォータニオン (機体座標 -> 基準座標)
+    float bias_x, bias_y, bias_z; // 誤差積分項 = ジャイロバイアスの符号反転 [rad/s]
+    float kp;                 // 比例ゲイン (加速度・磁力への追従の速さ)
+    float ki;                 // 積分ゲイン (バイアス推定の速さ、0 で推定しない)
+    float gravity_norm;       // 初期化時の加速度の大きさ (運動加速度が大きいときの補正を止める判定に使う)
+    float rate_x, rate_y, rate_z; // 直近のバイアス補正後の角速度 [rad/s]
+    bool initialized;         // 初回の加速度・磁力で姿勢を初期化済みか
+    unsigned long long updates;     // ahrs_update の呼び出し回数
+    unsigned long long accel_rejected; // 加速度の大きさが重力と大きく異なり補正に使わなかった回数
+} AhrsState;
+
+// 制御ループ・テレメトリへ公開する推定結果
+typedef struct
+{
+    float roll_deg;      // ロール角 [deg] (-180〜180)
+    float pitch_deg;     // ピッチ角 [deg] (-90〜90)
+    float heading_deg;   // 方位 [deg] (0〜360、磁力を使わない場合は起動時を 0 とした相対値)
+    AxisData rate_dps;   // バイアス補正後の角速度 [deg/s]
+    AxisData bias_dps;   // 推定したジャイロバイアス [deg/s]
+} AttitudeEstimate;
+
+// 関数のプロトタイプ宣言
+void ahrs_init(AhrsState *ahrs, float kp, float ki);
+// 1サンプル分更新する。accel / mag が NULL、または大きさが 0 の場合はその補正を行わない
+void ahrs_update(AhrsState *ahrs, const AxisData &gyro_dps, const AxisData *accel, const AxisData *mag, float dt_s);
+void ahrs_get_estimate(const AhrsState *ahrs, AttitudeEstimate *estimate);
+
+#endif // AHRS_H
@@ -0,0 +1,112 @@
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include <stdint.h>
+#include "gamepad.h"       // GamepadData
+#include "sensor_thread.h" // SensorSnapshot
+
+// --- フライトレコーダー (ブラックボックス) ---
+// 制御周期ごとに、デコード済みのゲームパッド入力・センサースナップショット・目標 PWM・平滑化後の PWM を
+// 固定長のバイナリレコードとして、起動時に確保したリングファイル (mmap) へ上書きしながら書き込む。
+//  - 書き込みは mmap 領域へのコピーだけで、ループ中に malloc もシステムコールも行わない
+//  - プロセスが異常終了しても、書き込み済みのページはカーネルのページキャッシュに残りファイルへ書き出される
+//    (電源断の場合はカーネルの書き戻し間隔 (通常 5〜30 秒) より前の分まで)
+//  - 各レコードは書き込み開始時に sequence を 0 にし、書き終えてから番号を入れる。
+//    書き込み途中で止まったレコードは sequence が 0 のまま残り、デコーダーが読み飛ばす
+//  - 起動時に既存のファイルは "<ファイル名>.prev" へ退避する (前回の記録を上書きしない)
+// ファイルは posix_fallocate で先に確保するため、書き込み中にディスクが満杯になっても SIGBUS にならない。
+// ページの書き戻し中に同じページへ書くと、ファイルシステムによっては書き戻しの完了を待つことがある。
+// 完全に I/O から切り離す場合は FILE を tmpfs (/dev/shm など) に置く。
+//
+// ファイル形式 (ホストのバイトオーダー、リトルエンディアンを想定):
+//   [BlackboxHeader (BLACKBOX_HEADER_SIZE バイト)] [BlackboxRecord x capacity]
+// sequence が n (1 始まり) のレコードは (n - 1) % capacity 番目のスロットに入る。
+// オフラインのデコーダー: make -f Makefile.mk tools && ./bin/blackbox_decode blackbox.bin
+
+#define BLACKBOX_MAGIC "WS3BBOX"
+#define BLACKBOX_VERSION 1
+#define BLACKBOX_HEADER_SIZE 4096 // レコード領域をページ境界から始める
+#define BLACKBOX_MAX_THRUSTERS 8  // ALLOC_MAX_THRUSTERS と同じ (ファイル形式の一部のため固定)
+
+// レコードを書いたきっかけ
+enum BlackboxEvent
+{
+    BLACKBOX_EVENT_COMMAND = 1, // コマンド受信で即座に出力を更新した
+    BLACKBOX_EVENT_CONTROL,     // 制御周期タイマー
+    BLACKBOX_EVENT_FAILSAFE,    // フェイルセーフで全スラスターを停止した
+    BLACKBOX_EVENT_REARM        // ウォッチドッグの解除で出力 (平滑化の状態) を停止出力に揃えた
+};
+
+typedef struct
+{
+    char magic[8];              // BLACKBOX_MAGIC
+    uint32_t version;           // BLACKBOX_VERSION
+    uint32_t header_size;       // BLACKBOX_HEADER_SIZE
+    uint32_t record_size;       // sizeof(BlackboxRecord)
+    uint32_t capacity;          // レコード数
+    int64_t start_monotonic_ns; // 記録開始時の CLOCK_MONOTONIC
+    int64_t start_realtime_ns;  // 同時刻の CLOCK_REALTIME (レコードの時刻を実時刻に換算する)
+    uint64_t next_sequence;     // 次に書くレコードの番号 (目安。正しい順序はレコードの sequence で決まる)
+    uint32_t loop_delay_us;     // 制御周期の設定値
+    uint32_t thruster_count;    // 記録したスラスター数
+    int32_t thruster_channels[BLACKBOX_MAX_THRUSTERS]; // スラスターごとの PWM チャンネル
+} BlackboxHeader;
+
+// 1制御周期分のレコード (184 バイト固定)
+typedef struct
+{
+    uint64_t sequence;        // 1 始まりの通し番号 (0 は未使用・書き込み途中)
+    int64_t time_ns;          // CLOCK_MONOTONIC
+    // --- コマンド (デコード済みのゲームパッド入力) ---
+    int16_t stick[4];         // LX, LY, RX, RY
+    uint16_t trigger[2];      // LT, RT
+    uint16_t buttons;
+    uint8_t gamepad_flags;    // GAMEPAD_FLAG_*
+    uint8_t event;            // BlackboxEvent
+    uint32_t gamepad_sequence; // 送信側のシーケンス番号 (CSV 形式では 0)
+    float dt_s;               // thruster_update に渡した経過時間
+    // --- センサースナップショット ---
+    float temperature;
+    float pressure;
+    float adc[4];
+    float accel[3];
+    float gyro[3];            // 生のジャイロ [deg/s]
+    float mag[3];
+    float roll_deg;           // 姿勢推定 (attitude_valid の場合のみ有効)
+    float pitch_deg;
+    float heading_deg;
+    float control_rate_dps[3]; // 制御に使った角速度 (姿勢推定の補正後、または生のジャイロ)
+    uint8_t leak;
+    uint8_t attitude_valid;
+    uint8_t thruster_count;
+    uint8_t saturated;        // 推力配分が飽和したか
+    uint32_t snapshot_count;  // センサースナップショットの公開回数 (同じ値なら更新されていない)
+    // --- 出力 ---
+    float target_pwm[BLACKBOX_MAX_THRUSTERS];     // 目標 PWM (平滑化前) [us]
+    uint16_t smoothed_pwm[BLACKBOX_MAX_THRUSTERS]; // 出力した PWM [us]
+    uint32_t reserved;
+} BlackboxRecord;
+
+static_assert(sizeof(BlackboxRecord) == 184, "BlackboxRecord のサイズはファイル形式の一部です");
+static_assert(sizeof(BlackboxHeader) <= BLACKBOX_HEADER_SIZE, "BlackboxHeader がヘッダー領域に収まりません");
+
+// 書き込み統計
+typedef struct
+{
+    unsigned long long records; // 書き込んだレコード数
+    uint32_t capacity;
+    int64_t max_record_ns;      // 1レコードの書き込みにかかった最大時間
+} BlackboxStats;
+
+// 関数のプロトタイプ宣言
+// リングファイルを作成して mmap する (既存のファイルは .prev へ退避)。失敗時は false (記録せずに続行できる)
+bool blackbox_open(const char *path, uint32_t capacity);
+// 制御周期1回分を記録する (制御スレッドから呼ぶこと。未オープンなら何もしない)
+// snapshot が NULL の場合はセンサー値を 0 として記録する
+void blackbox_record_tick(BlackboxEvent event, const GamepadData &gamepad, const SensorSnapshot *snapshot,
+                          const AxisData &control_rate_dps, float dt_s);
+void blackbox_close(); // msync してから解放する
+void blackbox_get_stats(BlackboxStats *stats);
+void blackbox_print_stats();
+
+#endif // BLACKBOX_H
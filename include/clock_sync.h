@@ -0,0 +1,98 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>  // int64_t, uint32_t
+#include <stddef.h>  // size_t
+#include "network.h" // NetworkContext
+#include "gamepad.h" // GamepadData
+
+// --- 地上局との時刻同期とコマンドの片道遅延 ---
+// 既存の UDP ポートで NTP と同じ4つの時刻の交換を行い、地上局の時計 (ゲームパッドパケットの sender_time_us と
+// 同じ時計) と機体の CLOCK_REALTIME の差 (オフセット) と往復時間 (RTT) を求める。
+//   機体 -> 地上局 (送信ポート): REQUEST  t1 = 機体の送信時刻
+//   地上局 -> 機体 (受信ポート): RESPONSE t1 をそのまま返し、t2 = 地上局の受信時刻、t3 = 地上局の送信時刻
+//   機体の受信時刻 t4 はカーネル受信タイムスタンプ (SO_TIMESTAMPNS)、なければ受信処理時の時刻
+//   offset = ((t2 - t1) + (t3 - t4)) / 2   (地上局の時計 - 機体の時計)
+//   rtt    = (t4 - t1) - (t3 - t2)
+// 直近 CLOCK_SYNC_SAMPLES 回のうち RTT が最小の交換のオフセットを採用する (キューイング遅延の影響を受けにくい)。
+// 地上局から REQUEST が届いた場合は RESPONSE を返す (地上局側でも同じ計算ができる)。
+// オフセットが求まった後は、採用したバイナリコマンドごとに
+//   片道遅延 = PWM 書き込み完了時刻 (機体) - (sender_time_us - offset)
+// を記録し、直近 CLOCK_SYNC_LATENCY_WINDOW 件の p50/p99 をテレメトリに載せる。
+// CSV 形式のコマンドは送信時刻を持たないため対象外。制御スレッド (メインループ) からのみ呼び出すこと。
+
+// --- 時刻同期パケット (バージョン1) ---
+// 固定長 34 バイト、リトルエンディアン、パディングなし
+//  offset size 内容
+//   0     2    マジック 'S','Y'
+//   2     1    バージョン (CLOCK_SYNC_PACKET_VERSION)
+//   3     1    種別 (ClockSyncPacketType)
+//   4     4    シーケンス番号 (uint32、REQUEST ごとに+1。RESPONSE は REQUEST の値を返す)
+//   8     8    t1: REQUEST の送信時刻 (uint64、要求側の時計のマイクロ秒。RESPONSE はそのまま返す)
+//  16     8    t2: REQUEST の受信時刻 (uint64、応答側の時計のマイクロ秒。REQUEST では 0)
+//  24     8    t3: RESPONSE の送信時刻 (uint64、応答側の時計のマイクロ秒。REQUEST では 0)
+//  32     2    CRC-16/CCITT-FALSE (offset 0〜31)
+#define CLOCK_SYNC_MAGIC0 'S'
+#define CLOCK_SYNC_MAGIC1 'Y'
+#define CLOCK_SYNC_PACKET_VERSION 1
+#define CLOCK_SYNC_PACKET_SIZE 34
+
+#define CLOCK_SYNC_SAMPLES 8           // RTT 最小のオフセットを選ぶ交換の数
+#define CLOCK_SYNC_LATENCY_WINDOW 256  // p50/p99 を求める片道遅延のサンプル数
+
+enum ClockSyncPacketType
+{
+    CLOCK_SYNC_REQUEST = 0,
+    CLOCK_SYNC_RESPONSE = 1
+};
+
+typedef struct
+{
+    NetworkContext *net;        // REQUEST / RESPONSE の送信に使う
+    uint32_t next_sequence;     // 次の REQUEST のシーケンス番号
+    uint32_t pending_sequence;  // 応答待ちの REQUEST (最新の1つだけを受け付ける)
+    int64_t pending_t1_us;      // 0: 応答待ちなし
+    int64_t next_request_ns;    // 次に REQUEST を送る時刻 (CLOCK_MONOTONIC)
+
+    // RTT 最小フィルタ
+    int64_t sample_offset_us[CLOCK_SYNC_SAMPLES];
+    int64_t sample_rtt_us[CLOCK_SYNC_SAMPLES];
+    unsigned int sample_index;
+    unsigned int sample_count;
+    bool synced;                // オフセットが求まっているか
+    int64_t offset_us;          // 採用中のオフセット (地上局 - 機体)
+    int64_t rtt_us;             // 採用中の交換の RTT
+    int64_t last_rtt_us;        // 直近の交換の RTT
+
+    // コマンドの片道遅延 (ナノ秒のリングバッファ)
+    int64_t latency_ns[CLOCK_SYNC_LATENCY_WINDOW];
+    unsigned int latency_index;
+    unsigned int latency_count;
+    int64_t latency_max_ns;
+
+    // 統計
+    unsigned long long requests_sent;
+    unsigned long long responses;       // 受け付けた RESPONSE
+    unsigned long long stale_responses; // 古い・不一致の RESPONSE
+    unsigned long long replies_sent;    // 地上局の REQUEST への応答
+    unsigned long long bad_packets;     // 長さ・バージョン・CRC の不正
+    unsigned long long commands_timed;  // 片道遅延を記録したコマンド数
+    unsigned long long commands_untimed; // 送信時刻なし、または同期前で記録しなかったコマンド数
+} ClockSync;
+
+// 関数のプロトタイプ宣言
+void clock_sync_init(ClockSync *sync, NetworkContext *net);
+// 受信したデータグラムが時刻同期パケットなら処理して true を返す (受信ポートの制御パケットとして振り分ける)
+bool clock_sync_packet_handler(ClockSync *sync, const char *data, size_t len, int64_t rx_realtime_ns);
+// 周期的に呼び出し、INTERVAL_MS ごとに REQUEST を送る (送信先クライアントが決まってから)
+void clock_sync_poll(ClockSync *sync, int64_t now_ns);
+// 受信したコマンドを PWM に反映した直後に呼び、片道遅延を記録する (applied_realtime_ns は CLOCK_REALTIME)
+void clock_sync_record_command(ClockSync *sync, const GamepadData &command, int64_t applied_realtime_ns);
+// 直近の片道遅延の p50/p99 [ms]。サンプルがなければ false
+bool clock_sync_latency_percentiles(const ClockSync *sync, float *p50_ms, float *p99_ms);
+// 時刻同期パケットを組み立てる (地上局の実装・テスト用)。書き込んだバイト数を返す (バッファ不足時は 0)
+size_t clock_sync_encode_packet(uint8_t type, uint32_t sequence, uint64_t t1_us, uint64_t t2_us, uint64_t t3_us,
+                                char *buffer, size_t buffer_size);
+void clock_sync_print_stats(const ClockSync *sync);
+
+#endif // CLOCK_SYNC_H
@@ -0,0 +1,75 @@
+#ifndef COMMAND_HOLD_H
+#define COMMAND_HOLD_H
+
+#include <stdint.h>   // int64_t
+#include "gamepad.h"  // GamepadData
+
+// --- 短いパケット欠落時のコマンド保持と減衰 ---
+// 受信 (network_receive_latest) と制御周期の thruster_update の間に入り、最後に採用したコマンドを
+//   経過時間 <= 保持時間                : そのまま保持 (1.0 倍)
+//   保持時間 < 経過時間 <= +DECAY_MS     : 減衰曲線に沿って 0 へ近づける
+//   それ以降                              : 0 (スティックは中立。接続タイムアウトで FAILSAFE_HOLD へ)
+// として出力する。保持時間はパケット到着間隔の統計から周期ごとに求め直す:
+//   保持時間 = 平均間隔 x (1 + max(1, 典型的な連続欠落数)) + JITTER_K x 間隔の標準偏差   ([HOLD_MIN_MS, HOLD_MAX_MS] に制限)
+// 保持時間 + DECAY_MS は CONNECTION_TIMEOUT_SECONDS を超えないように制限するため、出力はタイムアウト
+// より前に必ず 0 になり、フェイルセーフの条件 (タイムアウトで停止出力) は変わらない。
+// 減衰はスティックのデッドゾーンの外側の量に掛ける (デッドゾーンの境界で出力 0 になる)。ボタンは変更しない
+// (Y ボタンのような立ち上がり検出が減衰中に誤動作しないように)。
+// 制御スレッド (メインループ) からのみ呼び出すこと。
+
+// 減衰曲線 (t: 減衰開始からの経過時間 / DECAY_MS、0〜1)
+enum CommandDecayCurve
+{
+    COMMAND_DECAY_LINEAR = 0, // 1 - t
+    COMMAND_DECAY_COSINE,     // (1 + cos(pi t)) / 2  始めと終わりがなめらか
+    COMMAND_DECAY_QUADRATIC,  // (1 - t)^2            始めに大きく落とす
+    COMMAND_DECAY_CURVE_COUNT
+};
+
+// 制御周期ごとの区分
+enum CommandHoldPhase
+{
+    COMMAND_HOLD_FRESH = 0, // 次のパケットが届くはずの時間内 (欠落なし)
+    COMMAND_HOLD_HOLDING,   // 欠落中。最後のコマンドを保持
+    COMMAND_HOLD_DECAYING,  // 欠落中。減衰中
+    COMMAND_HOLD_EXPIRED,   // 欠落中。0 まで減衰した
+    COMMAND_HOLD_PHASE_COUNT
+};
+
+typedef struct
+{
+    int64_t last_command_ns;     // 最後にコマンドを採用した時刻 (0: なし)
+    double mean_interval_ns;     // 欠落のない到着間隔の平均 (指数移動平均)
+    double var_interval_ns2;     // 同じく分散
+    double burst_len_avg;        // 連続欠落数の平均 (欠落があった場合のみ更新)
+    unsigned int interval_samples;
+    int64_t hold_window_ns;      // 現在の保持時間
+    int64_t hold_max_ns;         // 保持時間の上限 (CONNECTION_TIMEOUT_SECONDS - DECAY_MS で制限済み)
+    int64_t decay_ns;
+    CommandHoldPhase phase;
+    float scale;                 // 直近の周期で掛けた倍率
+
+    // 統計
+    unsigned long long phase_ticks[COMMAND_HOLD_PHASE_COUNT]; // 区分ごとの制御周期数
+    unsigned long long bursts;             // 欠落の発生回数 (連続した欠落は1回)
+    unsigned long long lost_packets;       // 欠落したと推定されるパケット数
+    unsigned long long max_burst;          // 最大の連続欠落数
+    unsigned long long recovered_holding;  // 保持中に次のコマンドが届いた回数
+    unsigned long long recovered_decaying; // 減衰中に次のコマンドが届いた回数
+    unsigned long long expired;            // 0 まで減衰した回数
+    int64_t max_gap_ns;                    // 接続タイムアウト未満で回復した最大の到着間隔
+    int64_t min_window_ns;                 // 保持時間の最小値・最大値 (統計が揃ってから)
+    int64_t max_window_ns;
+} CommandHold;
+
+// 関数のプロトタイプ宣言
+void command_hold_init(CommandHold *hold);
+// コマンドを採用したときに呼ぶ (到着間隔と欠落の統計を更新し、保持時間を求め直す)
+void command_hold_command_received(CommandHold *hold, int64_t now_ns);
+// 制御周期ごとに、保持・減衰を適用したコマンドを output へ書き出し、掛けた倍率を返す
+float command_hold_apply(CommandHold *hold, int64_t now_ns, const GamepadData &command, GamepadData *output);
+// 接続タイムアウト (FAILSAFE_HOLD) のときに呼ぶ (停止中の間隔を統計に含めない)
+void command_hold_link_lost(CommandHold *hold);
+void command_hold_print_stats(const CommandHold *hold);
+
+#endif // COMMAND_HOLD_H
@@ -3,7 +3,7 @@
 
 #include <string>
 #include <map>
-#include <iostream>
+#include "thrust_allocation.h" // ALLOC_MAX_THRUSTERS, WRENCH_DOF
 
 // 設定値を保持する構造体
 struct AppConfig {
@@ -22,22 +22,133 @@ struct AppConfig {
     int led_pwm_on;
     int led_pwm_off;
 
-    // スラスター制御設定 (平滑化、ジャイロ補正)
-    float smoothing_factor_horizontal;
-    float smoothing_factor_vertical;
-    float kp_roll;
-    float kp_yaw;
-    float yaw_threshold_dps;
-    float yaw_gain;
+    // スラスター制御設定 (平滑化、ジャイロ補正)。いずれも制御周期に依存しない物理単位
+    float smoothing_tau_horizontal_s; // 水平スラスター出力の一次遅れ時定数 [s]
+    float smoothing_tau_vertical_s;   // それ以外のスラスター出力の一次遅れ時定数 [s]
+    float slew_rate_pwm_per_s;        // スラスター出力の最大変化率 [us/s] (0 で制限なし)
+    float kp_roll;                    // ロールレート PID [N/(deg/s)]
+    float ki_roll;
+    float kd_roll;
+    float kp_yaw;                     // 平行移動中にヨー保持の比例ゲインへ上乗せする値
+    float yaw_threshold_dps;          // ヨー保持の不感帯 [deg/s]
+    float yaw_gain;                   // ヨー保持 PID の比例ゲイン [N/(deg/s)]
+    float ki_yaw;
+    float kd_yaw;
+    float d_filter_tau_s;             // PID 微分項フィルタの時定数 [s]
+    float stabilization_limit_n;      // 安定化補正の最大値 [N]
+
+    // 推力配分設定 (thrust_allocation.h)
+    int alloc_thruster_count;                            // 配分するスラスター数
+    int alloc_channels[ALLOC_MAX_THRUSTERS];             // スラスターごとの PWM チャンネル
+    float alloc_matrix[ALLOC_MAX_THRUSTERS][WRENCH_DOF]; // スラスターごとの係数 (surge, sway, heave, roll, pitch, yaw)
+    bool alloc_bidirectional;                            // true: 双方向 ESC (PWM_NEUTRAL が停止), false: 単方向 (PWM_MIN が停止)
+    float alloc_gain_surge;                              // スティック全開時の目標レンチ [N]
+    float alloc_gain_sway;
+    float alloc_gain_heave;
+    float alloc_gain_yaw;
+
+    // 推力曲線設定 (thrust_curve.h)。"linear"、組み込みプロファイル名、または CSV ファイルのパス
+    std::string thrust_curve_profile;                        // 全スラスター共通のプロファイル
+    std::string thrust_curve_overrides[ALLOC_MAX_THRUSTERS]; // スラスターごとの上書き (空なら共通)
+    float thrust_curve_linear_max_n;                         // "linear" の PWM_BOOST_MAX での推力 [N]
 
     // ネットワーク設定
     int network_recv_port;
     int network_send_port;
     double connection_timeout_seconds;
+    double degraded_timeout_seconds; // 最後のコマンドからこの時間を超えたら DEGRADED (警告のみ。制御は継続)
+    unsigned int stale_packet_ms; // カーネル受信からこの時間以上経過したコマンドは破棄する (0で無効)
 
     // アプリケーション設定
     unsigned int sensor_send_interval;
-    unsigned int loop_delay_us; // usleep の引数
+    unsigned int loop_delay_us;           // 制御周期 (us)。絶対デッドラインで周期実行する
+    unsigned int stats_report_interval_s; // ループ周期統計の定期表示間隔 (秒、0で無効。SIGUSR1 で随時表示)
+    bool latency_measure;                 // パケット到着からPWM出力までの遅延を計測・表示するか
+    bool stage_profiling;                 // 処理段階ごとのレイテンシヒストグラムを記録するか
+    int log_level;                        // 出力する最低ログレベル (LogLevel)
+
+    // テレメトリ設定
+    bool telemetry_binary;          // true: バイナリフレーム (telemetry_protocol.h), false: 従来のテキスト形式
+    int telemetry_encoding;         // バイナリフレームの値エンコーディング (TelemetryEncoding)
+    unsigned int telemetry_field_mask; // バイナリフレームに含めるフィールドのビットマップ
+    bool telemetry_subscriptions;      // 購読パケットによる追加の送信先を受け付けるか (telemetry_fanout.h)
+    unsigned int telemetry_subscriber_lease_s; // 購読パケットで期限を指定しなかった場合の有効期限 [s]
+
+    // センサー取得スレッド設定 (デバイスごとの読み取り周波数 [Hz]、0で読み取らない)
+    float sensor_gyro_rate_hz;
+    float sensor_accel_rate_hz;
+    float sensor_mag_rate_hz;
+    float sensor_env_rate_hz;  // 温度・圧力
+    float sensor_leak_rate_hz;
+    float sensor_adc_rate_hz;
+
+    // 姿勢推定設定 (ahrs.h、センサー取得スレッドでジャイロの読み取りごとに更新)
+    bool ahrs_enabled;  // 姿勢推定を行うか (false の場合、制御ループは生のジャイロ値を使う)
+    float ahrs_kp;      // 加速度・磁力への追従ゲイン
+    float ahrs_ki;      // ジャイロバイアス推定ゲイン (0 で推定しない)
+    bool ahrs_use_mag;  // 磁力で方位を補正するか (false の場合、方位は起動時からの相対値)
+
+    // ハードウェア抽象化層の設定 (hal.h)
+    std::string hal_backend;        // "navigator" / "sim" / "replay" (空ならビルド時の既定値)
+    unsigned long long hal_sim_seed; // sim: 擬似乱数のシード (同じシードなら同じノイズ列)
+    float hal_sim_gyro_noise_dps;   // sim: ジャイロノイズの標準偏差 [deg/s]
+    float hal_sim_gyro_bias_dps[3]; // sim: ジャイロバイアス (X, Y, Z) [deg/s]
+    float hal_sim_accel_noise;      // sim: 加速度ノイズの標準偏差 [m/s^2]
+    float hal_sim_mag_noise;        // sim: 磁力ノイズの標準偏差 [uT]
+    float hal_sim_i2c_latency_us;   // sim: I2C 転送1回の平均所要時間 [us]
+    float hal_sim_i2c_jitter_us;    // sim: 所要時間のばらつき (± 一様分布) [us]
+    std::string hal_replay_file;    // replay: 再生するセンサー記録 (CSV)
+    float hal_replay_speed;         // replay: 再生速度 (1.0 で記録どおり)
+    bool hal_replay_loop;           // replay: 終端に達したら先頭から繰り返すか
+
+    // 車両シミュレータ設定 (vehicle_sim.h、bin/rov_sim でのみ使用)。機体座標は x 前方, y 右舷, z 下向き
+    float sim_mass_kg;                                   // 機体質量 [kg] (中性浮力とする)
+    float sim_inertia[3];                                // 慣性モーメント Ixx, Iyy, Izz [kg m^2]
+    float sim_added_mass[6];                             // 付加質量 (surge, sway, heave [kg], roll, pitch, yaw [kg m^2])
+    float sim_linear_drag[6];                            // 線形抗力係数 [N/(m/s)], [Nm/(rad/s)]
+    float sim_quadratic_drag[6];                         // 二次抗力係数 [N/(m/s)^2], [Nm/(rad/s)^2]
+    float sim_bg_m;                                      // 重心から浮心までの高さ (復元モーメント) [m]
+    float sim_motor_tau_s;                               // スラスター推力の一次遅れ時定数 [s]
+    float sim_physics_dt_s;                              // 運動方程式の積分刻み [s]
+    float sim_thruster_geometry[ALLOC_MAX_THRUSTERS][6]; // スラスターごとの取り付け位置 x,y,z [m] と推力の向き dx,dy,dz
+    std::string sim_plant_curve;                         // 機体側の推力曲線 (空なら [THRUST_CURVE] と同じ)
+
+    // フライトレコーダー設定 (blackbox.h)
+    bool blackbox_enabled;          // 制御周期ごとの記録を行うか
+    std::string blackbox_file;      // 記録ファイル (mmap するリングファイル。前回分は .prev へ退避)
+    unsigned int blackbox_records;  // リングのレコード数 (1レコード 184 バイト)
+
+    // 短いパケット欠落時のコマンド保持と減衰 (command_hold.h)
+    bool command_hold_enabled;           // false なら従来どおり接続タイムアウトまで最後のコマンドを使う (統計のみ)
+    unsigned int command_hold_min_ms;    // 保持時間の下限 (統計が揃うまではこの値)
+    unsigned int command_hold_max_ms;    // 保持時間の上限 (CONNECTION_TIMEOUT_SECONDS - DECAY_MS で制限)
+    float command_hold_jitter_k;         // 保持時間に加える到着間隔の標準偏差の倍数
+    unsigned int command_hold_decay_ms;  // 保持の後、0 まで減衰させる時間
+    int command_hold_decay_curve;        // 減衰曲線 (CommandDecayCurve)
+
+    // 地上局との時刻同期とコマンドの片道遅延 (clock_sync.h)
+    bool clock_sync_enabled;            // 時刻同期パケットの交換と片道遅延の計測を行うか
+    unsigned int clock_sync_interval_ms; // 機体から REQUEST を送る間隔
+
+    // 高レートの IMU ストリーム (imu_stream.h)
+    bool imu_stream_enabled;                     // ジャイロ・加速度を高レートでまとめて送るか
+    float imu_stream_rate_hz;                    // サンプリング周波数 (GYRO_RATE_HZ とは独立)
+    unsigned int imu_stream_samples_per_datagram; // 1データグラムの最大サンプル数
+    unsigned int imu_stream_flush_ms;            // 溜まったサンプルを送る間隔 (サンプルの最大の滞留時間)
+
+    // ウォッチドッグ設定 (watchdog.h)
+    bool watchdog_enabled;             // 独立スレッドでの監視を行うか
+    unsigned int watchdog_timeout_ms;  // 制御ループが止まってから PWM_MIN を書き込むまでの上限 [ms]
+
+    // リアルタイム実行設定 (realtime.h)
+    bool rt_enabled;            // リアルタイムプロファイルを適用するか
+    int rt_control_cpu;         // 制御スレッドを固定する CPU 番号 (-1 で固定しない)
+    int rt_control_priority;    // 制御スレッドの SCHED_FIFO 優先度 (1-99、0 で変更しない)
+    int rt_sensor_priority;     // センサー取得スレッドの SCHED_FIFO 優先度 (0 で変更しない)
+    int rt_watchdog_priority;   // ウォッチドッグスレッドの SCHED_FIFO 優先度 (制御スレッドより高くする。0 で変更しない)
+    bool rt_lock_memory;        // mlockall でメモリをロックするか
+    unsigned int rt_prefault_stack_kb; // 起動時にプリフォールトするスタックサイズ (KB)
+    bool rt_isolate_gstreamer;  // GStreamer のスレッドを制御用コア以外へ閉じ込めるか
 
     // GStreamer カメラ1設定
     std::string gst1_device;
@@ -0,0 +1,53 @@
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+// --- 時間刻みに依存しない制御要素 ---
+// いずれも呼び出しごとに実測の経過時間 dt [s] を受け取り、パラメータは時定数・変化率などの物理単位で持つ。
+// そのため制御周期 (LOOP_DELAY_US) を変えたりジッタがあっても、応答は同じになる。
+
+#define CONTROLLER_MAX_DT_S 0.1f // これより長い dt は一時停止などとみなして打ち切る (積分の暴走防止)
+
+// 一次遅れフィルタ: y += (x - y) * (1 - exp(-dt / tau))
+typedef struct
+{
+    float time_constant_s; // 時定数 [s] (0 以下でフィルタなし)
+    float value;           // 現在の出力
+} LowPassFilter;
+
+// 変化率リミッタ: 出力の変化を rate_per_s * dt 以内に制限する
+typedef struct
+{
+    float rate_per_s; // 最大変化率 [単位/s] (0 以下で制限なし)
+    float value;      // 現在の出力
+} SlewLimiter;
+
+// PID 制御器 (微分は測定値に対して行い、一次遅れでフィルタする)
+typedef struct
+{
+    float kp;               // 比例ゲイン
+    float ki;               // 積分ゲイン [1/s]
+    float kd;               // 微分ゲイン [s]
+    float d_filter_tau_s;   // 微分項フィルタの時定数 [s]
+    float output_min;       // 出力の下限
+    float output_max;       // 出力の上限
+    float integral;         // 積分項 (ki を掛けた後の値)
+    float derivative;       // フィルタ後の微分項
+    float prev_measurement; // 前回の測定値
+    bool has_prev;          // prev_measurement が有効か
+} PidController;
+
+// 関数のプロトタイプ宣言
+float controller_clamp_dt(float dt_s); // dt を 0〜CONTROLLER_MAX_DT_S に制限する
+
+void lowpass_init(LowPassFilter *filter, float time_constant_s, float initial_value);
+float lowpass_update(LowPassFilter *filter, float input, float dt_s);
+
+void slew_init(SlewLimiter *limiter, float rate_per_s, float initial_value);
+float slew_update(SlewLimiter *limiter, float target, float dt_s);
+
+void pid_init(PidController *pid, float kp, float ki, float kd, float d_filter_tau_s, float output_min, float output_max);
+// 目標値と測定値から出力を計算する。出力が飽和している間は飽和を深める方向への積分を止める (アンチワインドアップ)
+float pid_update(PidController *pid, float setpoint, float measurement, float dt_s);
+void pid_reset(PidController *pid); // 積分と微分の状態を破棄する (ゲインと出力範囲は保持)
+
+#endif // CONTROLLER_H
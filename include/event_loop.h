@@ -0,0 +1,33 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h> // int64_t, uint64_t
+#include <stdbool.h>
+
+// event_loop_wait が返すイベントのビットフラグ
+#define EVENT_NETWORK_READABLE 0x01 // 受信ソケットにデータあり
+#define EVENT_CONTROL_TIMER 0x02    // 制御周期タイマー満了
+#define EVENT_TELEMETRY_TIMER 0x04  // テレメトリ送信タイマー満了
+#define EVENT_IMU_FLUSH_TIMER 0x08  // IMU ストリームのフラッシュタイマー満了
+
+// epoll で受信ソケットと timerfd (制御・テレメトリ・IMU ストリーム) を待ち受けるイベントループの状態
+typedef struct
+{
+    int epoll_fd;           // epoll インスタンス
+    int recv_socket;        // 監視する受信ソケット (所有しない)
+    int control_timer_fd;   // 制御周期用 timerfd (CLOCK_MONOTONIC)
+    int telemetry_timer_fd; // テレメトリ送信用 timerfd (CLOCK_MONOTONIC)
+    int imu_flush_timer_fd; // IMU ストリームのフラッシュ用 timerfd (無効なら -1)
+} EventLoop;
+
+// 関数のプロトタイプ宣言
+// 受信ソケットを登録し、制御タイマーを first_deadline_ns (絶対時刻) から control_period_us 周期、
+// テレメトリタイマーを telemetry_period_us 周期、IMU ストリームのフラッシュタイマーを imu_flush_period_us 周期 (0 なら作らない) で起動する
+bool event_loop_init(EventLoop *loop, int recv_socket, int64_t first_deadline_ns,
+                     unsigned int control_period_us, unsigned int telemetry_period_us, unsigned int imu_flush_period_us);
+// いずれかのイベントが発生するまで待機し、発生したイベントのビットマスクを返す (シグナル割り込み時は 0)
+// タイマーイベントの場合は満了回数を *_expirations に格納する (2以上なら周期を取りこぼしている)
+unsigned int event_loop_wait(EventLoop *loop, int timeout_ms, uint64_t *control_expirations, uint64_t *telemetry_expirations);
+void event_loop_close(EventLoop *loop); // timerfd と epoll インスタンスを解放する
+
+#endif // EVENT_LOOP_H
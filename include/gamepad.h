@@ -2,8 +2,7 @@
 #define GAMEPAD_H
 
 #include <stdint.h> // 固定幅整数型 (uint16_t など) を使用するため
-#include <string>   // std::string を使用するため
-#include <vector>   // 将来的な使用や代替のパース方法のために含める (現在は未使用)
+#include <stddef.h> // size_t 型を使用するため
 
 // ゲームパッドからの受信データを格納する構造体
 struct GamepadData
@@ -15,6 +14,12 @@ struct GamepadData
     int LT = 0;           // 左トリガー (0 ~ 1023?)
     int RT = 0;           // 右トリガー (0 ~ 1023?)
     uint16_t buttons = 0; // ボタンの状態 (ビットフラグ)
+
+    // バイナリプロトコルでのみ有効なメタデータ (CSV形式では has_sequence = false)
+    bool has_sequence = false;   // sequence / sender_time_us が有効か
+    uint32_t sequence = 0;       // 送信側のシーケンス番号
+    uint64_t sender_time_us = 0; // 送信側の時計での送信時刻 (マイクロ秒)
+    uint8_t flags = 0;           // パケットのフラグ (GAMEPAD_FLAG_*)
 };
 
 // ゲームパッドのボタンを表すビットフラグの定義
@@ -35,8 +40,67 @@ enum GamepadButton : uint32_t // 基底型を明示的に指定
     Y = 0x8000              // Y ボタン (標準的な値 0x8000)
 };
 
+// --- バイナリ・ゲームパッドパケット (バージョン1) ---
+// 固定長 32 バイト、リトルエンディアン、パディングなし
+//  offset size 内容
+//   0     2    マジック 'G','P'
+//   2     1    バージョン (GAMEPAD_PACKET_VERSION)
+//   3     1    フラグ (GAMEPAD_FLAG_*、未定義のビットは 0)
+//   4     4    シーケンス番号 (uint32、送信ごとに+1)
+//   8     8    送信時刻 (uint64、送信側の時計でのマイクロ秒)
+//  16     2x4  leftThumbX, leftThumbY, rightThumbX, rightThumbY (int16)
+//  24     2x2  LT, RT (uint16)
+//  28     2    buttons (uint16)
+//  30     2    CRC-16/CCITT-FALSE (offset 0〜29)
+// 先頭がマジックでないパケットは従来の CSV 形式 "LX,LY,RX,RY,LT,RT,Buttons" として解釈する
+#define GAMEPAD_PACKET_MAGIC0 'G'
+#define GAMEPAD_PACKET_MAGIC1 'P'
+#define GAMEPAD_PACKET_VERSION 1
+#define GAMEPAD_PACKET_SIZE 32
+
+// フラグ (offset 3)
+#define GAMEPAD_FLAG_DUMP_STATS 0x01 // 立ち上がりで機体側の統計 (ループ・受信・処理段階レイテンシ) を表示する
+
+// 送信側の再起動とみなすシーケンス番号の巻き戻り幅 (これ未満の巻き戻りは順序逆転として破棄)
+#define GAMEPAD_SEQUENCE_RESTART_WINDOW 1000
+
+// シーケンス番号による重複・順序逆転パケットの除外状態
+typedef struct
+{
+    bool initialized;        // 最初のシーケンス付きパケットを受け付けたか
+    uint32_t last_sequence;  // 最後に採用したシーケンス番号
+    unsigned long long duplicates;    // 重複として破棄した数
+    unsigned long long out_of_order;  // 順序逆転として破棄した数
+    unsigned long long restarts;      // 送信側の再起動を検出した数
+    unsigned long long decode_errors; // マジック/バージョン/長さ/CRC/CSV の不正で破棄した数
+} GamepadSequenceFilter;
+
+// network_receive_latest の検証関数に渡す受信状態 (有効な最新候補を保持する)
+typedef struct
+{
+    GamepadSequenceFilter *filter; // 採用済みシーケンスの状態
+    GamepadData candidate;         // 検証を通過した最新のコマンド
+    bool has_candidate;            // candidate が有効か
+} GamepadReceiveState;
+
 // 関数のプロトタイプ宣言
-// 受信した文字列データを GamepadData 構造体にパースする関数
-GamepadData parseGamepadData(const std::string &data);
+// 受信データ (バイナリまたは CSV) を GamepadData 構造体にデコードする。動的確保・例外なし
+bool parseGamepadData(const char *data, size_t len, GamepadData &out);
+// バイナリパケットを受信バッファ上で直接デコードする (マジック、バージョン、長さ、CRC を検証)
+bool decodeGamepadPacket(const char *data, size_t len, GamepadData &out);
+// CSV 形式をパースする (従来形式の互換経路)
+bool parseGamepadCsv(const char *data, size_t len, GamepadData &out);
+// GamepadData をバイナリパケットにエンコードする (送信側・試験用)。書き込んだバイト数を返す (失敗時 0)
+size_t encodeGamepadPacket(const GamepadData &data, uint32_t sequence, uint64_t sender_time_us, char *buffer, size_t buffer_size);
+
+// シーケンス番号フィルタ
+void resetGamepadSequence(GamepadSequenceFilter *filter);
+bool isGamepadSequenceFresh(GamepadSequenceFilter *filter, const GamepadData &data); // 採用可能か判定する (破棄した場合は統計のみ更新)
+void commitGamepadSequence(GamepadSequenceFilter *filter, const GamepadData &data);  // 採用したコマンドのシーケンスを記録する
+void printGamepadStats(const GamepadSequenceFilter *filter);
+
+// network_receive_latest 用の検証関数 (user は GamepadReceiveState*)
+void beginGamepadReceive(GamepadReceiveState *state, GamepadSequenceFilter *filter);
+bool gamepadPacketValidator(const char *data, size_t len, void *user);
 
 #endif // GAMEPAD_H
@@ -1,9 +1,7 @@
 #ifndef GST_PIPELINE_H
 #define GST_PIPELINE_H
 
-#include <gst/gst.h>
-#include <thread>
-
+// WITH_GSTREAMER が定義されていない場合 (開発機向けビルド) はカメラ配信を行わない空実装になる
 bool start_gstreamer_pipelines();
 void stop_gstreamer_pipelines();
 
@@ -0,0 +1,79 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uintptr_t
+
+// --- ハードウェア抽象化層 (HAL) ---
+// センサー読み取りと PWM 出力はすべて g_hal が指すバックエンドを経由する。
+//  - navigator: navigator-lib (bindings.h) を呼ぶ実機用 (HAL_NAVIGATOR 定義時のみ組み込まれる)
+//  - sim:       決定的な擬似乱数でノイズを加えた静止状態のセンサー値と、I2C 遅延を模擬する
+//  - replay:    記録したセンサー値の CSV を時刻どおりに再生する
+// バックエンドはビルド時の既定値 (hal_default_backend_name) を config.ini の [HAL] BACKEND で上書きできる。
+// センサー読み取りはセンサー取得スレッドから、PWM 出力は制御スレッドから呼ぶ前提 (バックエンドはロックしない)。
+
+#ifdef HAL_NAVIGATOR
+#include "bindings.h" // AxisData (navigator-lib の型をそのまま使う)
+#else
+// navigator-lib なしでビルドする場合の同じレイアウトの定義
+typedef struct AxisData
+{
+    float x;
+    float y;
+    float z;
+} AxisData;
+#endif
+
+// バックエンドの関数テーブル
+typedef struct
+{
+    const char *name;           // config.ini の BACKEND に指定する名前
+    const char *pwm_write_mode; // PWM 書き込み方式 (統計表示用)
+    bool (*init)();             // ハードウェア (または模擬環境) の初期化。失敗時は false
+    AxisData (*read_gyro)();    // [deg/s]
+    AxisData (*read_accel)();
+    AxisData (*read_mag)();
+    float (*read_temp)();
+    float (*read_pressure)();
+    bool (*read_leak)();
+    void (*read_adc_all)(float *adc, size_t count);
+    void (*set_pwm_enable)(bool enabled);
+    void (*set_pwm_freq_hz)(float frequency_hz);
+    // 複数チャンネルのデューティ比をまとめて書き込み、発生したバス転送の回数を返す
+    unsigned int (*set_pwm_duty_cycles)(const uintptr_t *channels, const float *duty_cycles, size_t count);
+} HalBackend;
+
+extern const HalBackend *g_hal; // 現在のバックエンド (hal_select 前はビルド時の既定値)
+
+#ifdef HAL_NAVIGATOR
+extern const HalBackend hal_navigator_backend;
+#endif
+extern const HalBackend hal_sim_backend;
+extern const HalBackend hal_replay_backend;
+
+const char *hal_default_backend_name();  // ビルド時の既定バックエンド名
+bool hal_select(const char *name);       // 名前でバックエンドを選ぶ (空文字列は既定値)。未知の名前なら false
+bool hal_init();                         // 選択中のバックエンドを初期化する
+
+// --- sim バックエンド専用 (車両シミュレータ vehicle_sim.h との接続) ---
+// センサーが返す真値 (ノイズ・バイアスを加える前) を設定する。呼ぶまでは静止・水平・北向きの値
+void hal_sim_set_motion(const AxisData &gyro_dps, const AxisData &accel, const AxisData &mag);
+// チャンネルに最後に書き込まれたパルス幅 [us] (PWM 無効時・未書き込みは 0)
+float hal_sim_pwm_us(int channel);
+
+// --- 呼び出し側が使うラッパー ---
+static inline AxisData hal_read_gyro() { return g_hal->read_gyro(); }
+static inline AxisData hal_read_accel() { return g_hal->read_accel(); }
+static inline AxisData hal_read_mag() { return g_hal->read_mag(); }
+static inline float hal_read_temp() { return g_hal->read_temp(); }
+static inline float hal_read_pressure() { return g_hal->read_pressure(); }
+static inline bool hal_read_leak() { return g_hal->read_leak(); }
+static inline void hal_read_adc_all(float *adc, size_t count) { g_hal->read_adc_all(adc, count); }
+static inline void hal_set_pwm_enable(bool enabled) { g_hal->set_pwm_enable(enabled); }
+static inline void hal_set_pwm_freq_hz(float frequency_hz) { g_hal->set_pwm_freq_hz(frequency_hz); }
+static inline unsigned int hal_set_pwm_duty_cycles(const uintptr_t *channels, const float *duty_cycles, size_t count)
+{
+    return g_hal->set_pwm_duty_cycles(channels, duty_cycles, count);
+}
+
+#endif // HAL_H
@@ -0,0 +1,75 @@
+#ifndef IMU_STREAM_H
+#define IMU_STREAM_H
+
+#include <stdint.h>  // int64_t, uint32_t
+#include <stddef.h>  // size_t
+#include "hal.h"     // AxisData
+#include "network.h" // NetworkContext
+
+// --- 高レートの IMU ストリーム (振動解析用) ---
+// センサー取得スレッドが [IMU_STREAM] RATE_HZ でジャイロと加速度を読み取り、時刻付きのサンプルを
+// 起動時に確保したリングバッファへ積む (imu_stream_push、ロックなしの単一書き込み・単一読み取り)。
+// メインループは FLUSH_MS ごとのタイマーでリングを空にし、最大 SAMPLES_PER_DATAGRAM 個を1つの
+// データグラムに詰めて操縦者の送信ポートへ送る (1サンプル1パケットのヘッダーと送信システムコールを避ける)。
+// 制御ループが使うジャイロ (スナップショット) と姿勢推定は GYRO_RATE_HZ / ACCEL_RATE_HZ の読み取りのまま変わらない。
+// ストリーム用の読み取りと同じ起床でジャイロ・加速度を読んだ場合は、I2C を読み直さずにその値を使う。
+// リングが満杯の場合は新しいサンプルを捨て、捨てた数をパケットに載せる (地上局で欠落を検出できる)。
+
+// --- IMU ストリームパケット (バージョン1、送信ポートへ送る) ---
+// リトルエンディアン、パディングなし、長さ = 20 + 28 x サンプル数 + 2
+//  offset size 内容
+//   0     2    マジック 'I','M'
+//   2     1    バージョン (IMU_STREAM_PACKET_VERSION)
+//   3     1    サンプル数 (1〜IMU_STREAM_MAX_SAMPLES)
+//   4     4    シーケンス番号 (uint32、データグラムごとに+1)
+//   8     4    リング満杯で捨てたサンプルの累計 (uint32)
+//  12     8    基準時刻 (uint64、先頭サンプルの取得時刻。機体側 CLOCK_MONOTONIC のマイクロ秒、テレメトリと同じ時計)
+//  20     28   サンプル x サンプル数:
+//               +0  4  基準時刻からの経過 (uint32、マイクロ秒)
+//               +4  12 ジャイロ x, y, z (float32、deg/s)
+//               +16 12 加速度 x, y, z (float32、m/s^2)
+//  末尾   2    CRC-16/CCITT-FALSE (offset 0 から CRC の直前まで)
+#define IMU_STREAM_MAGIC0 'I'
+#define IMU_STREAM_MAGIC1 'M'
+#define IMU_STREAM_PACKET_VERSION 1
+#define IMU_STREAM_HEADER_SIZE 20
+#define IMU_STREAM_SAMPLE_SIZE 28
+#define IMU_STREAM_MAX_SAMPLES 48 // 1データグラムのサンプル数の上限 (1370 バイト。イーサネットの MTU に収まる)
+#define IMU_STREAM_MAX_PACKET_SIZE (IMU_STREAM_HEADER_SIZE + IMU_STREAM_SAMPLE_SIZE * IMU_STREAM_MAX_SAMPLES + 2)
+#define IMU_STREAM_RING_SIZE 1024 // リングバッファのサンプル数 (2のべき乗。2000Hz でも 0.5 秒分)
+
+typedef struct
+{
+    int64_t time_ns; // 取得時刻 (CLOCK_MONOTONIC)
+    AxisData gyro;   // [deg/s]
+    AxisData accel;  // [m/s^2]
+} ImuSample;
+
+// IMU ストリームの統計
+typedef struct
+{
+    unsigned long long samples;     // リングへ積んだサンプル数
+    unsigned long long dropped;     // リング満杯で捨てたサンプル数
+    unsigned long long sent;        // データグラムで送ったサンプル数
+    unsigned long long discarded;   // 送信先 (操縦者) が未定のため捨てたサンプル数
+    unsigned long long datagrams;   // 送信したデータグラム数
+    unsigned long long send_errors;
+    unsigned long long flushes;     // フラッシュタイマーの処理回数
+    unsigned int max_backlog;       // フラッシュ時にリングに溜まっていた最大サンプル数
+} ImuStreamStats;
+
+// 関数のプロトタイプ宣言
+void imu_stream_init();        // config の [IMU_STREAM] を検証してリングを空にする (センサー取得スレッドの起動前に呼ぶ)
+bool imu_stream_enabled();
+unsigned int imu_stream_flush_period_us(); // フラッシュタイマーの周期 (無効なら 0)
+// センサー取得スレッドから呼ぶ: サンプルを1つ積む (ブロックしない。満杯なら捨てて false)
+bool imu_stream_push(const AxisData &gyro, const AxisData &accel, int64_t time_ns);
+// メインループのフラッシュタイマーから呼ぶ: 溜まったサンプルをデータグラムに詰めて送る。送信したデータグラム数を返す
+int imu_stream_flush(NetworkContext *net);
+// サンプル列をパケットに詰める (地上局の実装・テスト用)。書き込んだバイト数を返す (バッファ不足・サンプル数不正時は 0)
+size_t imu_stream_encode_packet(uint32_t sequence, uint32_t dropped, const ImuSample *samples, unsigned int count,
+                                uint8_t *buffer, size_t buffer_size);
+void imu_stream_get_stats(ImuStreamStats *stats);
+void imu_stream_print_stats();
+
+#endif // IMU_STREAM_H
@@ -0,0 +1,116 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h> // uint64_t
+#include <stddef.h> // size_t
+#include <atomic>   // std::atomic
+#include "time_utils.h" // monotonic_now_ns
+
+// --- 処理段階ごとのレイテンシヒストグラム ---
+// 2のべき乗ごとに LATENCY_HIST_SUB_BUCKETS 個に分割した固定長の対数バケット (相対誤差 約12.5%)。
+// 記録は配列のインクリメントのみで、動的確保・ロックを行わない。
+// 各段階の記録は1つのスレッドだけが行う (単一書き込み)。表示は別スレッドから読み取ってもよい。
+
+#define LATENCY_HIST_SUB_BITS 3                             // 2のべき乗あたりの分割ビット数
+#define LATENCY_HIST_SUB_BUCKETS (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_EXPONENT 40                        // 2^40 ns (約18分) 以上は最上位バケットに入れる
+#define LATENCY_HIST_BUCKETS ((LATENCY_HIST_MAX_EXPONENT - LATENCY_HIST_SUB_BITS + 2) * LATENCY_HIST_SUB_BUCKETS)
+
+// 計測する処理段階 (表示順)
+enum LatencyStage
+{
+    LAT_STAGE_NET_RECV = 0,      // recvmmsg 1回
+    LAT_STAGE_GAMEPAD_PARSE,     // ゲームパッドパケットのデコードとシーケンス確認
+    LAT_STAGE_COMMAND_APPLY,     // 受信したコマンドの PWM への反映
+    LAT_STAGE_CONTROL_TICK,      // 制御タイマー1回分の処理
+    LAT_STAGE_SENSOR_SNAPSHOT,   // センサースナップショットの読み取り
+    LAT_STAGE_THRUSTER_UPDATE,   // thruster_update 全体
+    LAT_STAGE_MIXER,             // 水平スラスターの目標値計算
+    LAT_STAGE_PWM_WRITE,         // PWM 出力の flush (変更チャンネルの一括書き込み)
+    LAT_STAGE_TELEMETRY_ENCODE,  // バイナリテレメトリのエンコード
+    LAT_STAGE_TELEMETRY_FORMAT,  // テキストテレメトリのフォーマット (snprintf)
+    LAT_STAGE_NET_SEND,          // sendto
+    LAT_STAGE_BLACKBOX,          // ブラックボックスへの1レコードの書き込み
+    LAT_STAGE_SENSOR_READ_ALL,   // read_sensor_data (全センサーの一括読み取り)
+    LAT_STAGE_I2C_GYRO,          // センサー取得スレッド: 各デバイスの読み取り
+    LAT_STAGE_I2C_ACCEL,
+    LAT_STAGE_I2C_MAG,
+    LAT_STAGE_I2C_ENV,
+    LAT_STAGE_I2C_LEAK,
+    LAT_STAGE_I2C_ADC,
+    LAT_STAGE_AHRS,              // センサー取得スレッド: 姿勢推定の更新1回
+    LAT_STAGE_IMU_STREAM,        // IMU ストリーム: 1データグラムの組み立て
+    LAT_STAGE_COUNT
+};
+
+// 1段階分のヒストグラム (単位: ナノ秒)
+typedef struct
+{
+    std::atomic<uint32_t> buckets[LATENCY_HIST_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> min_ns;
+    std::atomic<uint64_t> max_ns;
+} LatencyHistogram;
+
+// 表示用の集計結果 (単位: ナノ秒)
+typedef struct
+{
+    uint64_t count;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    double mean_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+} LatencySummary;
+
+extern bool g_latency_profiling_enabled; // false の場合は計測しない (config.ini の STAGE_PROFILING)
+
+// 関数のプロトタイプ宣言
+void latency_record(LatencyStage stage, int64_t elapsed_ns);             // 経過時間を1件記録する
+void latency_summarize(LatencyStage stage, LatencySummary *summary);     // 集計する (制御経路外で呼ぶこと)
+const char *latency_stage_name(LatencyStage stage);
+void latency_reset_all();                                                // すべての段階のヒストグラムを0に戻す
+void latency_print_all();                                                // 記録のある段階を標準出力に表示する
+
+// スコープの開始から終了までを記録するタイマー
+class LatencyScope
+{
+public:
+    explicit LatencyScope(LatencyStage stage)
+        : stage_(stage), start_ns_(g_latency_profiling_enabled ? monotonic_now_ns() : 0) {}
+    ~LatencyScope()
+    {
+        if (start_ns_ != 0)
+            latency_record(stage_, monotonic_now_ns() - start_ns_);
+    }
+
+private:
+    LatencyStage stage_;
+    int64_t start_ns_;
+
+    LatencyScope(const LatencyScope &);            // コピー禁止
+    LatencyScope &operator=(const LatencyScope &); // コピー禁止
+};
+
+#define LATENCY_CONCAT_INNER(a, b) a##b
+#define LATENCY_CONCAT(a, b) LATENCY_CONCAT_INNER(a, b)
+// 現在のスコープを指定した段階として計測する
+#define LATENCY_SCOPE(stage) LatencyScope LATENCY_CONCAT(latency_scope_, __LINE__)(stage)
+
+// 計測開始時刻を取得する (計測無効時は 0)。スコープに収まらない区間は latency_stop と組にして使う
+static inline int64_t latency_start()
+{
+    return g_latency_profiling_enabled ? monotonic_now_ns() : 0;
+}
+
+// latency_start からの経過時間を記録する
+static inline void latency_stop(LatencyStage stage, int64_t start_ns)
+{
+    if (start_ns != 0)
+        latency_record(stage, monotonic_now_ns() - start_ns);
+}
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,63 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <stdint.h> // int64_t
+
+// --- 接続状態の管理 (通信断でプロセスを終了せず、スラスターだけを止めて再接続を待つ) ---
+//   WAITING ──コマンド──> CONNECTED ──DEGRADED_TIMEOUT_SECONDS──> DEGRADED ──CONNECTION_TIMEOUT_SECONDS──> FAILSAFE_HOLD
+//                            ^                                        │                                        │
+//                            └────────────コマンド─────────────────────┘                                  データグラム
+//                            ^                                                                                  v
+//                            └───────────────────────────コマンド (最初の新しい有効パケット)──────────── RECONNECTED
+//  - DEGRADED: 最後のコマンドのまま制御を続ける (警告のみ)
+//  - FAILSAFE_HOLD: 全スラスターを推力曲線の停止出力に。センサー・映像・ソケット・テレメトリはそのまま動かし続ける
+//  - RECONNECTED: 停止中に何らかのデータグラムが届いた (重複・古いシーケンスなどで未採用の場合を含む)。
+//    採用できるコマンドが CONNECTION_TIMEOUT_SECONDS 以内に来なければ FAILSAFE_HOLD へ戻る
+// 再接続 (最初のデータグラム) から最初のコマンドを出力に反映するまでの時間と、停止時間を計測する。
+// 制御スレッド (メインループ) からのみ呼び出すこと。
+
+enum LinkState
+{
+    LINK_WAITING = 0,    // 起動後、最初のコマンドを待っている
+    LINK_CONNECTED,
+    LINK_DEGRADED,       // コマンドが途切れ始めた
+    LINK_FAILSAFE_HOLD,  // タイムアウトによりスラスターを停止して待機中
+    LINK_RECONNECTED,    // 停止中にデータグラムを受信し、最初のコマンドを待っている
+    LINK_STATE_COUNT
+};
+
+typedef struct
+{
+    LinkState state;
+    int64_t state_since_ns;          // 現在の状態に入った時刻
+    int64_t hold_start_ns;           // FAILSAFE_HOLD に入った時刻
+    int64_t reconnect_ns;            // 停止後に最初のデータグラムを受信した時刻
+    unsigned long long rx_at_hold;   // FAILSAFE_HOLD に入った時点の受信データグラム数 (増えたら再接続とみなす)
+
+    // 統計
+    unsigned long long entries[LINK_STATE_COUNT]; // 状態ごとの遷移回数
+    unsigned long long resumes;                   // 停止から制御を再開した回数
+    int64_t last_outage_ns;                       // 直近の停止時間 (FAILSAFE_HOLD 開始から制御再開まで)
+    int64_t max_outage_ns;
+    int64_t last_resume_ns;                       // 直近の 再接続 -> 最初のコマンド反映 の時間
+    int64_t max_resume_ns;
+    double sum_resume_ns;
+} LinkMonitor;
+
+// 関数のプロトタイプ宣言
+void link_monitor_init(LinkMonitor *link, int64_t now_ns);
+const char *link_state_name(LinkState state);
+// 制御を行う状態か (CONNECTED / DEGRADED)
+bool link_monitor_control_enabled(const LinkMonitor *link);
+// 制御周期ごとに、最後にコマンドを採用してからの経過時間で状態を進める。FAILSAFE_HOLD に入った場合は true
+// (呼び出し側でスラスターを停止する)
+bool link_monitor_check_timeout(LinkMonitor *link, int64_t now_ns, double since_last_command_s);
+// 受信処理のたびに受信データグラムの累計を渡す (停止中に増えたら RECONNECTED へ)
+void link_monitor_datagram_seen(LinkMonitor *link, int64_t now_ns, unsigned long long rx_total);
+// コマンドを採用する直前に呼ぶ。停止・待機中からの再開なら true (呼び出し側で出力状態を初期化する)
+bool link_monitor_command_received(LinkMonitor *link, int64_t now_ns);
+// 再開後の最初のコマンドを出力へ反映した後に呼ぶ (再接続 -> 反映の時間を記録する)
+void link_monitor_command_applied(LinkMonitor *link, int64_t now_ns);
+void link_monitor_print_stats(const LinkMonitor *link);
+
+#endif // LINK_MONITOR_H
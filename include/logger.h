@@ -0,0 +1,149 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h> // int64_t, uint8_t
+#include <stddef.h> // size_t
+#include <string.h> // strlen
+
+// --- 非同期ロガー ---
+// 呼び出し側は書式文字列のポインタと引数をバイナリのまま自スレッド専用の SPSC リングへ積むだけで、
+// 文字列への変換と stdout/stderr への書き込みはバックグラウンドスレッドが行う。
+// そのため遅いコンソール (SSH・シリアル) でも制御ループが書き込みでブロックしない。
+//
+// 使い方: LOG_INFO("制御周期: %u us", period_us);
+//  - 書式は printf と同じ (コンパイル時に -Wformat で検査される)。書式文字列は文字列リテラルであること
+//  - %s の文字列は記録時にコピーする (LOG_MAX_STRING_LEN バイトまで)
+//  - リングが満杯の場合は記録を捨てて破棄数を数える (呼び出し側は決してブロックしない)
+//  - logger_start() 前と logger_stop() 後は呼び出しスレッドで同期的に書き込む
+
+enum LogLevel
+{
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,  // WARN 以上は stderr へ出力する
+    LOG_LEVEL_ERROR
+};
+
+#define LOG_RING_SIZE 65536       // スレッドごとのリングバッファのバイト数 (2のべき乗)
+#define LOG_MAX_THREADS 16        // 同時にログを書くスレッドの最大数
+#define LOG_MAX_RECORD_SIZE 512   // 1レコードの最大バイト数 (ヘッダーと引数を含む)
+#define LOG_MAX_STRING_LEN 400    // %s 引数としてコピーする最大バイト数
+#define LOG_MAX_ARGS 24           // 1レコードの最大引数数
+
+// 呼び出し箇所ごとのレート制限状態 (LOG_*_EVERY マクロが静的変数として持つ)
+typedef struct
+{
+    int64_t last_ns;          // 最後に出力した時刻 (0 は未出力)
+    unsigned long suppressed; // 前回の出力以降に抑制した回数
+} LogRateLimiter;
+
+// --- 引数のバイナリエンコード ---
+enum LogArgType
+{
+    LOG_ARG_INT = 1,   // 符号付き整数 (long long に拡張)
+    LOG_ARG_UINT,      // 符号なし整数 (unsigned long long に拡張)
+    LOG_ARG_DOUBLE,    // float / double
+    LOG_ARG_STRING,    // 文字列 (長さ + 内容をコピー)
+    LOG_ARG_POINTER    // ポインタ値 (%p)
+};
+
+// レコードを組み立てるための一時バッファ (呼び出し側のスタック上に確保する)
+typedef struct
+{
+    uint8_t data[LOG_MAX_RECORD_SIZE];
+    size_t used;
+    uint8_t arg_count;
+    bool overflow; // 引数が入りきらなかった
+} LogRecordBuilder;
+
+void log_builder_put(LogRecordBuilder *b, uint8_t type, const void *value, size_t size);
+void log_builder_put_string(LogRecordBuilder *b, const char *s);
+
+static inline void log_encode_arg(LogRecordBuilder *b, long long v) { log_builder_put(b, LOG_ARG_INT, &v, sizeof(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, unsigned long long v) { log_builder_put(b, LOG_ARG_UINT, &v, sizeof(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, int v) { log_encode_arg(b, static_cast<long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, long v) { log_encode_arg(b, static_cast<long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, short v) { log_encode_arg(b, static_cast<long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, signed char v) { log_encode_arg(b, static_cast<long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, char v) { log_encode_arg(b, static_cast<long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, bool v) { log_encode_arg(b, static_cast<long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, unsigned int v) { log_encode_arg(b, static_cast<unsigned long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, unsigned long v) { log_encode_arg(b, static_cast<unsigned long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, unsigned short v) { log_encode_arg(b, static_cast<unsigned long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, unsigned char v) { log_encode_arg(b, static_cast<unsigned long long>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, double v) { log_builder_put(b, LOG_ARG_DOUBLE, &v, sizeof(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, float v) { log_encode_arg(b, static_cast<double>(v)); }
+static inline void log_encode_arg(LogRecordBuilder *b, const char *s) { log_builder_put_string(b, s); }
+static inline void log_encode_arg(LogRecordBuilder *b, char *s) { log_builder_put_string(b, s); }
+static inline void log_encode_arg(LogRecordBuilder *b, const void *p) { log_builder_put(b, LOG_ARG_POINTER, &p, sizeof(p)); }
+static inline void log_encode_arg(LogRecordBuilder *b, void *p) { log_encode_arg(b, static_cast<const void *>(p)); }
+
+static inline void log_encode_args(LogRecordBuilder *) {}
+
+template <typename T, typename... Rest>
+static inline void log_encode_args(LogRecordBuilder *b, const T &first, const Rest &...rest)
+{
+    log_encode_arg(b, first);
+    log_encode_args(b, rest...);
+}
+
+// --- ロガー本体 ---
+extern int g_log_min_level; // これ未満のレベルは記録しない (config.ini の LOG_LEVEL)
+
+bool logger_start();                     // バックグラウンド書き込みスレッドを起動する
+void logger_stop();                      // 残りのレコードをすべて書き出してからスレッドを停止する
+unsigned long long logger_dropped_count(); // リング満杯で破棄したレコード数
+bool log_parse_level(const char *name, int *level); // "debug"/"info"/"warn"/"error" をレベルに変換する
+
+void log_builder_begin(LogRecordBuilder *b, int level, const char *fmt);
+void log_builder_commit(LogRecordBuilder *b); // 自スレッドのリングへ積む (未起動時は同期書き込み)
+bool log_rate_allow(LogRateLimiter *limiter, int level, unsigned int interval_ms);
+
+// 書式検査用 (呼び出されない)
+static inline void log_format_check(const char *, ...) __attribute__((format(printf, 1, 2)));
+static inline void log_format_check(const char *, ...) {}
+
+template <typename... Args>
+static inline void log_write(int level, const char *fmt, const Args &...args)
+{
+    LogRecordBuilder b;
+    log_builder_begin(&b, level, fmt);
+    log_encode_args(&b, args...);
+    log_builder_commit(&b);
+}
+
+#define LOG_AT(level, ...)                          \
+    do                                              \
+    {                                               \
+        if ((level) >= g_log_min_level)             \
+        {                                           \
+            if (0)                                  \
+                log_format_check(__VA_ARGS__);      \
+            log_write((level), __VA_ARGS__);        \
+        }                                           \
+    } while (0)
+
+// 同じ呼び出し箇所からの出力を interval_ms に1回までに制限する (抑制した件数は次の出力の前に表示)
+#define LOG_AT_EVERY(level, interval_ms, ...)                                          \
+    do                                                                                 \
+    {                                                                                  \
+        static LogRateLimiter log_rate_limiter_ = {0, 0};                              \
+        if ((level) >= g_log_min_level && log_rate_allow(&log_rate_limiter_, (level), (interval_ms))) \
+        {                                                                              \
+            if (0)                                                                     \
+                log_format_check(__VA_ARGS__);                                         \
+            log_write((level), __VA_ARGS__);                                           \
+        }                                                                              \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#define LOG_DEBUG_EVERY(interval_ms, ...) LOG_AT_EVERY(LOG_LEVEL_DEBUG, interval_ms, __VA_ARGS__)
+#define LOG_INFO_EVERY(interval_ms, ...) LOG_AT_EVERY(LOG_LEVEL_INFO, interval_ms, __VA_ARGS__)
+#define LOG_WARN_EVERY(interval_ms, ...) LOG_AT_EVERY(LOG_LEVEL_WARN, interval_ms, __VA_ARGS__)
+#define LOG_ERROR_EVERY(interval_ms, ...) LOG_AT_EVERY(LOG_LEVEL_ERROR, interval_ms, __VA_ARGS__)
+
+#endif // LOGGER_H
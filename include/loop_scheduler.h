@@ -0,0 +1,63 @@
+#ifndef LOOP_SCHEDULER_H
+#define LOOP_SCHEDULER_H
+
+#include <stdint.h> // int64_t, uint64_t
+#include <stddef.h> // size_t
+
+#define LOOP_SCHED_SAMPLE_WINDOW 1024 // p99 計算に使用する直近サンプル数 (固定長、動的確保なし)
+
+// 周期とジッタの統計値 (単位はすべてナノ秒)
+// period: 連続する起床時刻の間隔, jitter: 起床時刻とデッドラインのずれ (遅れ)
+typedef struct
+{
+    uint64_t ticks;          // 計測したループ回数
+    uint64_t overruns;       // 処理がデッドラインを超過した回数
+    uint64_t missed_periods; // オーバーランにより飛ばした周期の総数
+    int64_t period_min_ns;
+    int64_t period_max_ns;
+    double period_mean_ns;
+    int64_t period_p99_ns;   // 直近 LOOP_SCHED_SAMPLE_WINDOW 回の99パーセンタイル
+    int64_t jitter_min_ns;
+    int64_t jitter_max_ns;
+    double jitter_mean_ns;
+    int64_t jitter_p99_ns;   // 直近 LOOP_SCHED_SAMPLE_WINDOW 回の99パーセンタイル
+} LoopSchedulerStats;
+
+// 絶対デッドライン (CLOCK_MONOTONIC) で周期実行するスケジューラの状態
+// 待機そのものは event_loop の制御タイマー (timerfd) が行い、ここではデッドラインと起床時刻の統計だけを持つ
+typedef struct
+{
+    int64_t period_ns;        // 制御周期
+    int64_t next_deadline_ns; // 次の起床予定時刻 (絶対時刻)
+    int64_t last_wakeup_ns;   // 前回の起床時刻 (0 の場合は未起床)
+
+    // 累積統計
+    uint64_t ticks;
+    uint64_t overruns;
+    uint64_t missed_periods;
+    int64_t period_min_ns;
+    int64_t period_max_ns;
+    double period_sum_ns;
+    uint64_t period_count;
+    int64_t jitter_min_ns;
+    int64_t jitter_max_ns;
+    double jitter_sum_ns;
+
+    // パーセンタイル計算用のリングバッファ
+    int64_t period_samples[LOOP_SCHED_SAMPLE_WINDOW];
+    int64_t jitter_samples[LOOP_SCHED_SAMPLE_WINDOW];
+    size_t period_sample_index;
+    size_t period_sample_count;
+    size_t jitter_sample_index;
+    size_t jitter_sample_count;
+} LoopScheduler;
+
+// 関数のプロトタイプ宣言
+void loop_scheduler_init(LoopScheduler *sched, unsigned int period_us);          // 周期を設定し、最初のデッドラインを現在時刻+1周期に設定する
+void loop_scheduler_record_wakeup(LoopScheduler *sched, int64_t wakeup_ns);      // 起床時刻を記録して統計を更新し、次のデッドラインへ進める
+void loop_scheduler_record_timer_tick(LoopScheduler *sched, int64_t wakeup_ns, uint64_t expirations); // timerfd の満了を記録する (満了回数2以上はオーバーラン)
+void loop_scheduler_get_stats(const LoopScheduler *sched, LoopSchedulerStats *stats); // 現在の統計値を取得する (p99 計算を含むため制御経路外で呼ぶこと)
+void loop_scheduler_reset_stats(LoopScheduler *sched);                           // 統計値をリセットする (デッドラインは維持)
+void loop_scheduler_print_stats(const LoopScheduler *sched);                     // 統計値を標準出力に表示する
+
+#endif // LOOP_SCHEDULER_H
@@ -2,13 +2,35 @@
 #define NETWORK_H
 
 #include <netinet/in.h> // sockaddr_in 構造体やインターネット関連関数を使用するため
-#include <sys/time.h>   // struct timeval を使用するため
+#include <sys/socket.h> // struct mmsghdr (recvmmsg) を使用するため
+#include <time.h>       // struct timespec を使用するため
 #include <stdbool.h>    // bool 型を使用するため
 #include <stddef.h>     // size_t 型を使用するため
+#include <stdint.h>     // int64_t 型を使用するため
 
 #define DEFAULT_RECV_PORT 12345 // デフォルトの受信UDPポート番号
 #define DEFAULT_SEND_PORT 12346 // デフォルトの送信UDPポート番号
 #define NET_BUFFER_SIZE 1024    // ネットワーク送受信バッファのサイズ (バイト単位)
+#define NET_RECV_BATCH 16       // recvmmsg で一度に取り出すデータグラム数 (受信リングの段数)
+#define NET_CMSG_SIZE 64        // 1データグラムあたりの補助データ領域 (SCM_TIMESTAMPNS 用)
+
+// 受信経路の統計カウンター
+typedef struct
+{
+    unsigned long long received;   // 受信したデータグラムの総数
+    unsigned long long accepted;   // 制御に採用したデータグラム数
+    unsigned long long superseded; // より新しい有効パケットが同時に届いていたため読み捨てた数
+    unsigned long long late;       // カーネル受信から stale_packet_ms 以上経過していたため破棄した数
+    unsigned long long dropped;    // 空・切り詰め・検証失敗などで破棄した数
+    unsigned long long control;    // 制御コマンド以外 (時刻同期など) として処理した数
+    unsigned long long batches;    // recvmmsg の呼び出し回数
+} NetworkRxStats;
+
+// 受信データグラムの検証関数 (true を返したものだけが採用候補になる)
+typedef bool (*NetworkPacketValidator)(const char *data, size_t len, void *user);
+// 制御コマンド以外のデータグラム (時刻同期・テレメトリ購読など) の処理関数。true を返したものは処理済みとして採用候補から外す
+// from は送信元アドレス、rx_realtime_ns はカーネル受信時刻 (CLOCK_REALTIME)。取得できない場合は受信処理時の時刻
+typedef bool (*NetworkControlHandler)(const char *data, size_t len, const struct sockaddr_in *from, int64_t rx_realtime_ns, void *user);
 
 // ネットワーク通信の状態を保持する構造体
 typedef struct
@@ -20,13 +42,30 @@ typedef struct
     struct sockaddr_in client_addr_send; // データの送信先となるクライアントのアドレス情報
     socklen_t client_addr_len;           // client_addr_recv のサイズを格納する変数
     bool client_addr_known;              // 送信先クライアントアドレスが設定されているかを示すフラグ
-    struct timeval last_successful_recv_time; // 最後にデータパケットを正常に受信した時刻
+    struct timespec last_successful_recv_time; // 最後にデータパケットを正常に受信した時刻 (CLOCK_MONOTONIC)
+    int64_t last_rx_kernel_ns;                 // 最後のパケットのカーネル受信時刻 (SO_TIMESTAMPNS, CLOCK_REALTIME)。取得できない場合は 0
+
+    // recvmmsg 用の事前確保済み受信リング (ループ中の動的確保なし)
+    char rx_ring[NET_RECV_BATCH][NET_BUFFER_SIZE];
+    char rx_control[NET_RECV_BATCH][NET_CMSG_SIZE];
+    struct sockaddr_in rx_addr[NET_RECV_BATCH];
+    struct iovec rx_iov[NET_RECV_BATCH];
+    struct mmsghdr rx_msgs[NET_RECV_BATCH];
+    char latest_packet[NET_BUFFER_SIZE]; // 採用した最新パケットのコピー (次のバッチでリングが上書きされても保持)
+    NetworkRxStats rx_stats;
+
+    NetworkControlHandler control_handler; // NULL なら全データグラムを制御コマンドとして扱う
+    void *control_user;
 } NetworkContext;
 
 // 関数のプロトタイプ宣言
 bool network_init(NetworkContext *ctx);                                         // ネットワークコンテキストを初期化し、ソケットを作成・バインドする
 void network_close(NetworkContext *ctx);                                        // ネットワーク関連のリソース（ソケット）を解放する
-ssize_t network_receive(NetworkContext *ctx, char *buffer, size_t buffer_size); // UDPデータを受信する (ノンブロッキング)
+// 受信キューのデータグラムを recvmmsg ですべて取り出し、有効な最新の1つだけを *data に返す (古いものは破棄)
+// 戻り値: 採用したデータグラムの長さ、該当なしは 0、エラー時は -1。validator が NULL の場合は長さのみ検証する
+ssize_t network_receive_latest(NetworkContext *ctx, const char **data, NetworkPacketValidator validator, void *user);
+void network_set_control_handler(NetworkContext *ctx, NetworkControlHandler handler, void *user); // network_init の後に呼ぶ
+void network_print_stats(const NetworkContext *ctx);                            // 受信統計を表示する
 bool network_send(NetworkContext *ctx, const char *data, size_t data_len);      // UDPデータを送信する
 bool network_update_send_address(NetworkContext *ctx);                          // 最後に受信したクライアントのアドレスを送信先として設定するヘルパー関数
 
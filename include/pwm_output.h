@@ -0,0 +1,36 @@
+#ifndef PWM_OUTPUT_H
+#define PWM_OUTPUT_H
+
+#include <stdint.h>
+
+// --- PWM 出力段 (書き込みスキップと一括更新) ---
+// チャンネルごとに最後に書き込んだパルス幅 (us) のシャドウコピーを持ち、
+// pwm_output_set_us() で値が変わったチャンネルだけを pwm_output_flush() でまとめて書き込む。
+// 書き込みは HAL (hal.h) へまとめて渡す。navigator バックエンドは NAVIGATOR_HAS_MULTI_CHANNEL_PWM が
+// 定義されている場合に1回のバス転送にまとめ、未定義の場合はチャンネルごとに書き込む。
+// 制御スレッド (メインループ) からのみ呼び出すこと。
+// ウォッチドッグ (watchdog.h) の発動中は書き込まず、シャドウを破棄して解除後にすべて書き直す。
+
+#define PWM_OUTPUT_MAX_CHANNELS 16 // PWM コントローラ (PCA9685) のチャンネル数
+
+// 書き込み統計
+typedef struct
+{
+    unsigned long long flushes;          // pwm_output_flush の呼び出し回数 (制御周期)
+    unsigned long long channel_writes;   // 実際に書き込んだチャンネル数の累計
+    unsigned long long skipped_writes;   // 値が変わらず書き込みを省いたチャンネル数の累計
+    unsigned long long bus_transactions; // PWM コントローラへの書き込み呼び出し回数の累計
+    unsigned long long blocked_flushes;  // ウォッチドッグの発動中で書き込まなかった flush の回数
+    unsigned int last_flush_writes;      // 直近の flush で書き込んだチャンネル数
+    unsigned int max_flush_writes;       // 1回の flush で書き込んだチャンネル数の最大値
+} PwmOutputStats;
+
+// 関数のプロトタイプ宣言
+void pwm_output_init(float frequency_hz);             // シャドウを未書き込み状態にし、デューティ計算用の周波数を設定する
+void pwm_output_set_us(int channel, int pulse_width_us); // 出力値を予約する (値が変わった場合のみ次の flush で書き込む)
+int pwm_output_flush();                               // 予約された変更をまとめて書き込み、書き込んだチャンネル数を返す
+void pwm_output_invalidate();                         // シャドウを破棄し、次の flush で全予約チャンネルを書き直す
+void pwm_output_get_stats(PwmOutputStats *stats);
+void pwm_output_print_stats();
+
+#endif // PWM_OUTPUT_H
@@ -0,0 +1,40 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+// --- リアルタイム実行プロファイル ---
+// config.ini の [REALTIME] ENABLED=true の場合のみ適用する (既定は無効)。
+// 適用順序:
+//   1. realtime_apply_process_profile()   : メモリロックとスタックのプリフォールト (起動直後、スレッド生成前)
+//   2. realtime_configure_sensor_thread() : センサー取得スレッド自身から呼ぶ
+//   3. realtime_confine_current_thread()  : GStreamer のスレッド自身から呼ぶ (制御用コア以外に閉じ込める)
+//      realtime_configure_watchdog_thread(): ウォッチドッグスレッド自身から呼ぶ (制御より高い優先度、制御用コア以外)
+//   4. realtime_apply_control_thread()    : メインループ開始直前に呼ぶ (以降に生成されるスレッドへ継承させないため最後)
+// 権限不足などで適用できなかった項目は警告を表示して続行し、realtime_print_report() でまとめて表示する。
+// 2. と 3. の結果は生成されたスレッドから起動側へ返し (起動時のハンドシェイク)、起動側が
+// realtime_record_*_thread() で記録する。結果の表はメインスレッドだけが読み書きする。
+
+// 適用結果 (起動時の表示用)
+enum RealtimeItemState
+{
+    RT_NOT_REQUESTED = 0,
+    RT_APPLIED,
+    RT_FAILED
+};
+
+// センサー・ウォッチドッグスレッドの設定結果 (RealtimeItemState)
+typedef struct
+{
+    int fifo;     // SCHED_FIFO
+    int confined; // 制御用コア以外へ移動
+} RealtimeThreadResult;
+
+void realtime_apply_process_profile();                     // mlockall とスタックのプリフォールト
+RealtimeThreadResult realtime_configure_sensor_thread();   // 呼び出しスレッドをセンサー用の優先度・コアに設定する
+RealtimeThreadResult realtime_configure_watchdog_thread(); // 呼び出しスレッドをウォッチドッグ用の優先度・コアに設定する
+void realtime_record_sensor_thread(const RealtimeThreadResult &result);   // 起動側で結果を記録する
+void realtime_record_watchdog_thread(const RealtimeThreadResult &result);
+bool realtime_confine_current_thread(const char *name);    // 呼び出しスレッドを制御用コア以外へ移し、通常優先度にする
+void realtime_apply_control_thread();                      // 呼び出しスレッドを SCHED_FIFO にして制御用コアへ固定する
+void realtime_print_report();                              // 適用結果を表示する
+
+#endif // REALTIME_H
@@ -1,13 +1,29 @@
 #ifndef SENSOR_DATA_H // インクルードガード: ヘッダーファイルが複数回インクルードされるのを防ぐ
 #define SENSOR_DATA_H // インクルードガード
 
-#include <string>   // std::string を使用するため (現在は直接使用していないが、将来的に使う可能性あり)
-#include <vector>   // ADCデータなどの配列データを扱うために含める (現在は直接使用していない)
-#include <stddef.h> // size_t 型を使用するため
+#include <stddef.h>   // size_t 型を使用するため
+#include "hal.h"      // AxisData 構造体を使用するため
 
 #define SENSOR_BUFFER_SIZE 512 // センサーデータを格納する文字列バッファの推奨サイズ
 
+// 1回分のセンサー読み取り結果
+typedef struct
+{
+    float temperature; // 温度
+    float pressure;    // 圧力
+    bool leak;         // リーク検出 (true: 漏れあり)
+    float adc[4];      // ADC 4チャンネル
+    AxisData accel;    // 加速度 (X, Y, Z軸)
+    AxisData gyro;     // ジャイロ (X, Y, Z軸)
+    AxisData mag;      // 磁力 (X, Y, Z軸)
+} SensorReadings;
+
 // 関数のプロトタイプ宣言
+// 関連するすべてのセンサーを読み取る
+bool read_sensor_data(SensorReadings *readings);
+// 読み取り結果を従来のテキスト形式 "TEMP:...,PRESSURE:...,..." にフォーマットする
+// 書き込んだ文字数 (終端を除く) を返す。失敗時は 0
+size_t format_sensor_data_text(const SensorReadings &readings, char *buffer, size_t buffer_size);
 // 関連するすべてのセンサーを読み取り、指定されたバッファに文字列としてフォーマットする
 // 成功した場合は true、失敗した場合は false を返す。出力文字列は buffer に格納される。
 bool read_and_format_sensor_data(char *buffer, size_t buffer_size); // バッファとそのサイズを引数にとる
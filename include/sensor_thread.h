@@ -0,0 +1,44 @@
+#ifndef SENSOR_THREAD_H
+#define SENSOR_THREAD_H
+
+#include <stdint.h>
+#include "sensor_data.h" // SensorReadings
+#include "ahrs.h"        // AttitudeEstimate
+
+// センサー取得スレッドが公開する最新のスナップショット
+// 各デバイスは個別の周期で読み取られるため、デバイスごとの取得時刻を持つ
+typedef struct
+{
+    SensorReadings readings; // 各デバイスの最新値
+    AttitudeEstimate attitude; // 姿勢推定の結果 (attitude_valid が true の場合のみ有効)
+    bool attitude_valid;     // 姿勢推定が有効で、初期化済みか
+    int64_t timestamp_ns;    // スナップショットを公開した時刻 (CLOCK_MONOTONIC)
+    int64_t gyro_time_ns;    // ジャイロを読み取った時刻
+    int64_t accel_time_ns;   // 加速度を読み取った時刻
+    int64_t mag_time_ns;     // 磁力を読み取った時刻
+    int64_t env_time_ns;     // 温度・圧力を読み取った時刻
+    int64_t leak_time_ns;    // リークを読み取った時刻
+    int64_t adc_time_ns;     // ADC を読み取った時刻
+    uint32_t gyro_samples;   // ジャイロの累積読み取り回数
+    uint32_t publish_count;  // スナップショットの累積公開回数
+} SensorSnapshot;
+
+// センサー取得スレッドの統計
+typedef struct
+{
+    unsigned long long cycles;        // 起床回数
+    unsigned long long late_cycles;   // 予定時刻から1周期以上遅れて起床した回数
+    unsigned long long read_failures; // スナップショット読み取りが書き込みと衝突し続けて失敗した回数
+    int64_t max_read_ns;              // 1回の起床で行ったデバイス読み取りの最大所要時間
+    unsigned long long ahrs_updates;  // 姿勢推定の更新回数
+    unsigned long long ahrs_accel_rejected; // 運動加速度が大きく姿勢補正に加速度を使わなかった回数
+} SensorThreadStats;
+
+// 関数のプロトタイプ宣言
+bool sensor_thread_start();                           // config の各デバイス周期でセンサー取得スレッドを起動する
+void sensor_thread_stop();                            // スレッドを停止して合流する
+bool sensor_snapshot_read(SensorSnapshot *snapshot);  // 最新スナップショットをブロックせずに取得する (未公開なら false)
+void sensor_thread_get_stats(SensorThreadStats *stats);
+void sensor_thread_print_stats();
+
+#endif // SENSOR_THREAD_H
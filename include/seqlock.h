@@ -0,0 +1,72 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>      // std::atomic, std::atomic_thread_fence
+#include <stdint.h>    // uint32_t
+#include <string.h>    // memcpy
+
+// --- 単一書き込みスレッド用シーケンスロック ---
+// 書き込み側は決してブロックせず、読み取り側も書き込み中に当たった場合だけ再試行する (ロックなし)。
+// データ本体は 32bit ワード単位の relaxed アトミックで保持するため、読み取り中に書き込まれても
+// データ競合 (未定義動作) にはならず、シーケンス番号の不一致で検出して読み直す。
+template <typename T>
+class SeqLock
+{
+public:
+    SeqLock() : sequence_(0)
+    {
+        for (size_t i = 0; i < WORDS; ++i)
+            words_[i].store(0, std::memory_order_relaxed);
+    }
+
+    // 値を公開する (書き込みスレッドは1つだけであること)
+    void store(const T &value)
+    {
+        uint32_t buffer[WORDS] = {0};
+        memcpy(buffer, &value, sizeof(T));
+
+        uint32_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed); // 奇数: 書き込み中
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i)
+            words_[i].store(buffer[i], std::memory_order_relaxed);
+        sequence_.store(seq + 2, std::memory_order_release); // 偶数: 書き込み完了
+    }
+
+    // 最新の値を読み取る。書き込み中に当たり続けて max_retries 回失敗した場合は false (out は変更しない)
+    bool load(T *out, int max_retries = 16) const
+    {
+        uint32_t buffer[WORDS];
+        for (int attempt = 0; attempt < max_retries; ++attempt)
+        {
+            uint32_t seq_before = sequence_.load(std::memory_order_acquire);
+            if (seq_before & 1)
+                continue; // 書き込み中
+            for (size_t i = 0; i < WORDS; ++i)
+                buffer[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == seq_before)
+            {
+                memcpy(out, buffer, sizeof(T));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // これまでに公開された回数
+    uint32_t version() const
+    {
+        return sequence_.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static const size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    std::atomic<uint32_t> sequence_;
+    std::atomic<uint32_t> words_[WORDS];
+
+    SeqLock(const SeqLock &);            // コピー禁止
+    SeqLock &operator=(const SeqLock &); // コピー禁止
+};
+
+#endif // SEQLOCK_H
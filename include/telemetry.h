@@ -0,0 +1,33 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry_protocol.h" // ワイヤーフォーマット定義 (地上局と共有)
+#include "sensor_data.h"        // SensorReadings
+#include "ahrs.h"               // AttitudeEstimate
+
+// バイナリテレメトリのエンコーダ状態
+typedef struct
+{
+    uint32_t sequence;   // 次に送信するフレームのシーケンス番号
+    uint8_t encoding;    // TelemetryEncoding
+    uint32_t field_mask; // 送信するフィールドのビットマップ
+} TelemetryEncoder;
+
+// 関数のプロトタイプ宣言
+void telemetry_encoder_init(TelemetryEncoder *enc, uint8_t encoding, uint32_t field_mask);
+// センサー読み取り結果をフィールド番号で索引した値配列に展開する (値が得られたフィールドのビットマップを返す)
+uint32_t telemetry_fill_values(const SensorReadings &readings, float values[TELEMETRY_MAX_FIELDS]);
+// 姿勢推定の結果を値配列に展開する (ROLL/PITCH/HEADING のビットマップを返す)
+uint32_t telemetry_fill_attitude(const AttitudeEstimate &attitude, float values[TELEMETRY_MAX_FIELDS]);
+// コマンドの片道遅延と往復時間 [ms] を値配列に展開する (CMD_LATENCY_P50/P99/LINK_RTT のビットマップを返す)
+uint32_t telemetry_fill_link(float latency_p50_ms, float latency_p99_ms, float rtt_ms, float values[TELEMETRY_MAX_FIELDS]);
+// 値配列をフレームにエンコードする。available_mask と encoder の field_mask の両方に含まれるフィールドだけを書き込む
+// 書き込んだバイト数を返す (バッファ不足時は 0)。成功するとシーケンス番号を進める
+size_t telemetry_encode_frame(TelemetryEncoder *enc, const float values[TELEMETRY_MAX_FIELDS], uint32_t available_mask,
+                              uint64_t timestamp_us, uint8_t *buffer, size_t buffer_size);
+// 単精度を半精度 (IEEE754 binary16、最近接偶数丸め) に変換する
+uint16_t telemetry_float_to_half(float value);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,111 @@
+#ifndef TELEMETRY_FANOUT_H
+#define TELEMETRY_FANOUT_H
+
+#include <stdint.h>     // uint32_t, int64_t
+#include <stddef.h>     // size_t
+#include <netinet/in.h> // sockaddr_in
+#include <sys/socket.h> // struct mmsghdr (sendmmsg)
+#include "network.h"    // NetworkContext
+#include "telemetry.h"  // TelemetryEncoder, TELEMETRY_MAX_FRAME_SIZE
+
+// --- テレメトリの複数購読者への配信 ---
+// 従来はゲームパッドを送ってきたクライアント (操縦者) だけに送っていたテレメトリを、購読パケットで登録した
+// クライアント (記録用 PC、2台目の表示器など) にも送る。購読者ごとに
+//  - 間引き (テレメトリ周期の何回に1回送るか)
+//  - フィールドのビットマップ (機体の [TELEMETRY] FIELD_MASK との積)
+//  - 有効期限 (購読パケットを送り直すと延長。送らなければ期限切れで解除)
+// を持つ。操縦者は従来どおり FIELD_MASK・毎周期・期限なしの購読者として扱う (同じアドレス・ポートの購読があればそちらを優先)。
+// フレームは周期ごとに「その周期に送る購読者のフィールドの組み合わせ」ごとに1回だけエンコードし、
+// 全購読者分を1回の sendmmsg でまとめて送る (購読者が増えてもエンコードと送信システムコールは増えない)。
+// フレームのシーケンス番号はテレメトリ周期の番号で、全購読者で共通 (間引き分は番号が飛ぶ)。
+// 宛先・バッファは起動時に確保した固定長の配列のみを使う。制御スレッド (メインループ) からのみ呼び出すこと。
+
+// --- 購読パケット (バージョン1、受信ポートへ送る) ---
+// 固定長 16 バイト、リトルエンディアン、パディングなし
+//  offset size 内容
+//   0     2    マジック 'S','B'
+//   2     1    バージョン (TELEMETRY_SUBSCRIBE_VERSION)
+//   3     1    種別 (TelemetrySubscribeType)
+//   4     2    テレメトリの受信ポート (uint16、0 なら購読パケットの送信元ポート)
+//   6     2    間引き (uint16、テレメトリ周期の何回に1回送るか。0 は 1 とみなす)
+//   8     4    フィールドのビットマップ (uint32、0 なら機体の FIELD_MASK)
+//  12     2    有効期限 (uint16、秒。0 なら [TELEMETRY] SUBSCRIBER_LEASE_S)
+//  14     2    CRC-16/CCITT-FALSE (offset 0〜13)
+// 機体は受け付けた設定を同じ形式の ACK (満杯・無効時は NACK) で購読者のテレメトリ受信ポートへ返す。
+#define TELEMETRY_SUBSCRIBE_MAGIC0 'S'
+#define TELEMETRY_SUBSCRIBE_MAGIC1 'B'
+#define TELEMETRY_SUBSCRIBE_VERSION 1
+#define TELEMETRY_SUBSCRIBE_SIZE 16
+
+#define TELEMETRY_MAX_SUBSCRIBERS 8                                // 購読パケットで登録できる数
+#define TELEMETRY_MAX_DESTINATIONS (TELEMETRY_MAX_SUBSCRIBERS + 1) // 操縦者を含む送信先の最大数
+#define TELEMETRY_MAX_LEASE_S 3600                                 // 有効期限の上限 (秒)
+
+enum TelemetrySubscribeType
+{
+    TELEMETRY_SUBSCRIBE = 0,   // 登録・更新 (同じアドレス・ポートなら設定と期限を更新)
+    TELEMETRY_UNSUBSCRIBE = 1, // 解除
+    TELEMETRY_SUBSCRIBE_ACK = 2,
+    TELEMETRY_SUBSCRIBE_NACK = 3
+};
+
+// 1購読者
+typedef struct
+{
+    bool active;
+    struct sockaddr_in addr;   // テレメトリの送信先
+    uint16_t divider;          // 間引き
+    uint32_t field_mask;       // 機体の FIELD_MASK との積
+    uint32_t phase;            // 登録時のテレメトリ周期の番号 (登録直後の周期から送る)
+    int64_t expiry_ns;         // 有効期限 (CLOCK_MONOTONIC)
+    unsigned long long frames_sent;
+    unsigned long long send_errors;
+} TelemetrySubscriber;
+
+typedef struct
+{
+    NetworkContext *net;        // 送信ソケットと操縦者のアドレス
+    TelemetrySubscriber subscribers[TELEMETRY_MAX_SUBSCRIBERS];
+    unsigned int subscriber_count;
+    uint32_t tick;              // テレメトリ周期の番号 (フレームのシーケンス番号)
+
+    // 周期ごとの送信に使う事前確保済みの領域
+    uint8_t frames[TELEMETRY_MAX_DESTINATIONS][TELEMETRY_MAX_FRAME_SIZE]; // フィールドの組み合わせごとのフレーム
+    uint32_t frame_masks[TELEMETRY_MAX_DESTINATIONS];
+    size_t frame_lengths[TELEMETRY_MAX_DESTINATIONS];
+    struct sockaddr_in tx_addr[TELEMETRY_MAX_DESTINATIONS];
+    struct iovec tx_iov[TELEMETRY_MAX_DESTINATIONS];
+    struct mmsghdr tx_msgs[TELEMETRY_MAX_DESTINATIONS];
+    int tx_subscriber[TELEMETRY_MAX_DESTINATIONS]; // 送信先に対応する購読者の番号 (操縦者は -1)
+
+    // 統計
+    unsigned long long frames_encoded; // エンコードしたフレーム数
+    unsigned long long datagrams_sent; // 送信したデータグラム数 (全送信先の合計)
+    unsigned long long batches;        // sendmmsg の呼び出し回数
+    unsigned long long send_errors;
+    unsigned long long subscribes;     // 新規登録
+    unsigned long long renewals;       // 期限の延長・設定の更新
+    unsigned long long unsubscribes;
+    unsigned long long expired;
+    unsigned long long rejected;       // 満杯・不正なパケット
+} TelemetryFanout;
+
+// 関数のプロトタイプ宣言
+void telemetry_fanout_init(TelemetryFanout *fanout, NetworkContext *net);
+// 受信したデータグラムが購読パケットなら処理して true を返す (受信ポートの制御パケットとして振り分ける)
+bool telemetry_fanout_packet_handler(TelemetryFanout *fanout, const char *data, size_t len, const struct sockaddr_in *from,
+                                     int64_t now_ns);
+// 送信先 (操縦者または購読者) があるか
+bool telemetry_fanout_has_destinations(const TelemetryFanout *fanout);
+// バイナリフレーム: 今回の周期に送る購読者のフィールドの組み合わせごとに1回エンコードし、sendmmsg でまとめて送る
+// 送信したデータグラム数を返す。encoder の field_mask は機体の FIELD_MASK、sequence は使わない
+int telemetry_fanout_send_frames(TelemetryFanout *fanout, const TelemetryEncoder *encoder, const float values[TELEMETRY_MAX_FIELDS],
+                                 uint32_t available_mask, uint64_t timestamp_us, int64_t now_ns);
+// テキスト形式: 同じバイト列を今回の周期に送る全員へ送る (フィールドの選択は行わない)
+int telemetry_fanout_send_text(TelemetryFanout *fanout, const char *text, size_t text_len, int64_t now_ns);
+// 購読パケットを組み立てる (購読側の実装・テスト用)。書き込んだバイト数を返す (バッファ不足時は 0)
+size_t telemetry_encode_subscribe(uint8_t type, uint16_t port, uint16_t divider, uint32_t field_mask, uint16_t lease_s,
+                                  char *buffer, size_t buffer_size);
+void telemetry_fanout_print_stats(const TelemetryFanout *fanout);
+
+#endif // TELEMETRY_FANOUT_H
@@ -0,0 +1,207 @@
+#ifndef TELEMETRY_PROTOCOL_H
+#define TELEMETRY_PROTOCOL_H
+
+/*
+ * バイナリテレメトリフレームのワイヤーフォーマット定義とデコーダ
+ *
+ * 地上局ソフトウェアがそのまま取り込めるよう、このヘッダーは他のプロジェクトヘッダーに依存せず、
+ * C / C++ のどちらからでもインクルードできる。
+ *
+ * フレーム (バージョン1、リトルエンディアン、パディングなし)
+ *  offset size 内容
+ *   0     2    マジック 'T','M'
+ *   2     1    バージョン (TELEMETRY_PROTOCOL_VERSION)
+ *   3     1    エンコーディング (TelemetryEncoding)
+ *   4     4    シーケンス番号 (uint32、テレメトリ周期ごとに+1。間引きして購読した場合は番号が飛ぶ)
+ *   8     8    タイムスタンプ (uint64、機体側 CLOCK_MONOTONIC のマイクロ秒)
+ *  16     4    フィールド存在ビットマップ (bit i = TelemetryField i が含まれる。未知のビットのフィールドも
+ *              値のサイズは同じなので、古いデコーダでも読み飛ばせる)
+ *  20     ...  ビットの若い順に値を並べる
+ *              FLOAT32: 4バイト IEEE754 / FLOAT16: 2バイト IEEE754 半精度 /
+ *              FIXED16: 2バイト int16 (値 = 生値 * telemetry_fixed16_scale[i])
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define TELEMETRY_MAGIC0 'T'
+#define TELEMETRY_MAGIC1 'M'
+#define TELEMETRY_PROTOCOL_VERSION 1
+#define TELEMETRY_HEADER_SIZE 20
+#define TELEMETRY_MAX_FIELDS 32
+#define TELEMETRY_MAX_FRAME_SIZE (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_FIELDS * 4)
+
+/* 値のエンコーディング */
+enum TelemetryEncoding
+{
+    TELEMETRY_ENCODING_FLOAT32 = 0,
+    TELEMETRY_ENCODING_FLOAT16 = 1,
+    TELEMETRY_ENCODING_FIXED16 = 2
+};
+
+/* フィールド番号 (ビットマップのビット位置)。追加は末尾のみ、既存番号は変更しない */
+enum TelemetryField
+{
+    TELEMETRY_FIELD_TEMP = 0,
+    TELEMETRY_FIELD_PRESSURE,
+    TELEMETRY_FIELD_LEAK,
+    TELEMETRY_FIELD_ADC0,
+    TELEMETRY_FIELD_ADC1,
+    TELEMETRY_FIELD_ADC2,
+    TELEMETRY_FIELD_ADC3,
+    TELEMETRY_FIELD_ACCX,
+    TELEMETRY_FIELD_ACCY,
+    TELEMETRY_FIELD_ACCZ,
+    TELEMETRY_FIELD_GYROX,
+    TELEMETRY_FIELD_GYROY,
+    TELEMETRY_FIELD_GYROZ,
+    TELEMETRY_FIELD_MAGX,
+    TELEMETRY_FIELD_MAGY,
+    TELEMETRY_FIELD_MAGZ,
+    TELEMETRY_FIELD_ROLL,    /* 姿勢推定 [deg] */
+    TELEMETRY_FIELD_PITCH,
+    TELEMETRY_FIELD_HEADING, /* 0〜360 [deg] */
+    TELEMETRY_FIELD_CMD_LATENCY_P50, /* コマンドの片道遅延 (送信 -> PWM 書き込み) の中央値 [ms] */
+    TELEMETRY_FIELD_CMD_LATENCY_P99, /* 同 99 パーセンタイル [ms] */
+    TELEMETRY_FIELD_LINK_RTT,        /* 時刻同期で採用した交換の往復時間 [ms] */
+    TELEMETRY_FIELD_COUNT
+};
+
+#define TELEMETRY_ALL_FIELDS ((uint32_t)((1ULL << TELEMETRY_FIELD_COUNT) - 1))
+
+/* フィールド名 (テキスト形式のラベルと同じ) */
+static const char *const telemetry_field_names[TELEMETRY_FIELD_COUNT] = {
+    "TEMP", "PRESSURE", "LEAK",
+    "ADC0", "ADC1", "ADC2", "ADC3",
+    "ACCX", "ACCY", "ACCZ",
+    "GYROX", "GYROY", "GYROZ",
+    "MAGX", "MAGY", "MAGZ",
+    "ROLL", "PITCH", "HEADING",
+    "CMD_LAT_P50", "CMD_LAT_P99", "LINK_RTT"};
+
+/* FIXED16 の量子化ステップ (1 LSB あたりの値)。範囲は ±32767 * scale */
+static const float telemetry_fixed16_scale[TELEMETRY_FIELD_COUNT] = {
+    0.01f, 0.1f, 1.0f,            /* TEMP [0.01], PRESSURE [0.1], LEAK [0/1] */
+    0.001f, 0.001f, 0.001f, 0.001f, /* ADC [mV 相当] */
+    0.01f, 0.01f, 0.01f,          /* ACC */
+    0.1f, 0.1f, 0.1f,             /* GYRO */
+    0.1f, 0.1f, 0.1f,             /* MAG */
+    0.01f, 0.01f, 0.02f,          /* ROLL, PITCH [0.01deg], HEADING [0.02deg] */
+    0.01f, 0.01f, 0.01f};         /* CMD_LAT_P50, CMD_LAT_P99, LINK_RTT [0.01ms] */
+
+/* デコード結果 */
+typedef struct
+{
+    uint8_t version;
+    uint8_t encoding;
+    uint32_t sequence;
+    uint64_t timestamp_us;
+    uint32_t field_mask;
+    float values[TELEMETRY_MAX_FIELDS]; /* フィールド番号で索引。存在しないフィールドは 0 */
+} TelemetryFrameView;
+
+/* ヘルパー: リトルエンディアン読み取り */
+static inline uint32_t telemetry_read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* 半精度 (IEEE754 binary16) を単精度に変換する */
+static inline float telemetry_half_to_float(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x03FF;
+    uint32_t bits;
+    float f;
+
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign; /* ±0 */
+        }
+        else
+        {
+            /* 非正規化数を正規化する */
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x0400) == 0)
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            mantissa &= 0x03FF;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }
+    else if (exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13); /* Inf / NaN */
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/* フィールド数と値のサイズからフレーム長を求める */
+static inline size_t telemetry_frame_size(uint32_t field_mask, uint8_t encoding)
+{
+    size_t count = 0;
+    size_t value_size = (encoding == TELEMETRY_ENCODING_FLOAT32) ? 4 : 2;
+    for (int i = 0; i < TELEMETRY_MAX_FIELDS; ++i)
+    {
+        if (field_mask & ((uint32_t)1 << i))
+            count++;
+    }
+    return TELEMETRY_HEADER_SIZE + count * value_size;
+}
+
+/* フレームをデコードする。成功時 1、形式不正時 0 を返す */
+static inline int telemetry_decode_frame(const uint8_t *data, size_t len, TelemetryFrameView *out)
+{
+    const uint8_t *p;
+    int i;
+
+    if (!data || !out || len < TELEMETRY_HEADER_SIZE)
+        return 0;
+    if (data[0] != TELEMETRY_MAGIC0 || data[1] != TELEMETRY_MAGIC1 || data[2] != TELEMETRY_PROTOCOL_VERSION)
+        return 0;
+
+    memset(out, 0, sizeof(*out));
+    out->version = data[2];
+    out->encoding = data[3];
+    out->sequence = telemetry_read_le32(data + 4);
+    out->timestamp_us = (uint64_t)telemetry_read_le32(data + 8) | ((uint64_t)telemetry_read_le32(data + 12) << 32);
+    out->field_mask = telemetry_read_le32(data + 16);
+    if (out->encoding > TELEMETRY_ENCODING_FIXED16 || len < telemetry_frame_size(out->field_mask, out->encoding))
+        return 0;
+
+    p = data + TELEMETRY_HEADER_SIZE;
+    for (i = 0; i < TELEMETRY_MAX_FIELDS; ++i)
+    {
+        if (!(out->field_mask & ((uint32_t)1 << i)))
+            continue;
+        if (out->encoding == TELEMETRY_ENCODING_FLOAT32)
+        {
+            uint32_t bits = telemetry_read_le32(p);
+            memcpy(&out->values[i], &bits, sizeof(float));
+            p += 4;
+        }
+        else
+        {
+            uint16_t raw = (uint16_t)(p[0] | (p[1] << 8));
+            if (out->encoding == TELEMETRY_ENCODING_FLOAT16)
+                out->values[i] = telemetry_half_to_float(raw);
+            else
+                out->values[i] = (float)(int16_t)raw * (i < TELEMETRY_FIELD_COUNT ? telemetry_fixed16_scale[i] : 1.0f);
+            p += 2;
+        }
+    }
+    return 1;
+}
+
+#endif /* TELEMETRY_PROTOCOL_H */
@@ -0,0 +1,49 @@
+#ifndef THRUST_ALLOCATION_H
+#define THRUST_ALLOCATION_H
+
+#include <stdint.h>
+
+// --- 推力配分 (スラスターミキサー) ---
+// 目標レンチ w = (surge, sway, heave, roll, pitch, yaw) を配分行列 B で各スラスターの出力 u = B・w に変換する。
+// 行列は自由度ごとに ALLOC_MAX_THRUSTERS 個の係数を連続して持つ (列優先) ため、
+// 内側のループは固定長・分岐なしの積和となり、コンパイラの自動ベクトル化が効く。
+// レンチと出力は推力 [N] (モーメントは行列の係数に腕の長さを含める) で、出力の範囲はスラスターごとに
+// 推力曲線 (thrust_curve.h) が出せる最小・最大推力で与える。単方向スラスターの最小推力は 0。
+
+#define ALLOC_MAX_THRUSTERS 8 // 配分できるスラスターの最大数 (SIMD 幅の倍数)
+
+// レンチの自由度
+enum WrenchAxis
+{
+    WRENCH_SURGE = 0, // 前後
+    WRENCH_SWAY,      // 左右
+    WRENCH_HEAVE,     // 上下
+    WRENCH_ROLL,
+    WRENCH_PITCH,
+    WRENCH_YAW,
+    WRENCH_DOF
+};
+
+// 配分器の状態
+typedef struct
+{
+    alignas(16) float matrix[WRENCH_DOF][ALLOC_MAX_THRUSTERS]; // matrix[自由度][スラスター] (未使用のスラスターは 0)
+    int channels[ALLOC_MAX_THRUSTERS];                         // 各スラスターの PWM チャンネル
+    int thruster_count;                                        // 使用するスラスター数
+    float output_min[ALLOC_MAX_THRUSTERS];                     // スラスターごとの推力の下限 [N] (単方向: 0)
+    float output_max[ALLOC_MAX_THRUSTERS];                     // スラスターごとの推力の上限 [N]
+    unsigned long long saturations;                            // 飽和して全体を縮小した回数
+} ThrustAllocator;
+
+// 関数のプロトタイプ宣言
+// 配分器を初期化する (matrix は thruster_count 行 x WRENCH_DOF 列、行優先で与える)
+// force_min / force_max はスラスターごとの推力の範囲 [N]
+bool thrust_allocator_init(ThrustAllocator *alloc, int thruster_count, const float matrix[][WRENCH_DOF],
+                           const int channels[], const float force_min[], const float force_max[]);
+// レンチを各スラスターの出力へ配分する。いずれかの出力が範囲を超える場合は全体を同じ比率で縮小し、
+// 推力の方向 (各自由度の比) を保つ。飽和した場合は true を返す
+bool thrust_allocate(ThrustAllocator *alloc, const float wrench[WRENCH_DOF], float output[ALLOC_MAX_THRUSTERS]);
+// 配分行列を表示する
+void thrust_allocator_print(const ThrustAllocator *alloc);
+
+#endif // THRUST_ALLOCATION_H
@@ -0,0 +1,75 @@
+#ifndef THRUST_CURVE_H
+#define THRUST_CURVE_H
+
+// --- 推力曲線 (推力 [N] -> PWM [us] の線形化) ---
+// スラスターの推力は PWM に対して強い非線形で、前進と後退でも非対称になる。
+// 起動時に推力曲線 (PWM と推力の測定点) から推力を等間隔に区切った逆引き表を作り、
+// 制御周期中は表の隣接2点の線形補間だけで (O(1)) 推力を PWM に変換する。
+// 双方向スラスターは推力 0 の前後で不感帯を飛び越えるため、表は後退側と前進側に分けて持つ。
+
+#define THRUST_CURVE_MAX_POINTS 64 // 推力曲線の測定点の最大数
+#define THRUST_CURVE_LUT_SIZE 129  // 逆引き表の片側の点数 (区間数 + 1)
+
+// 推力曲線の測定点 (PWM の昇順に並べ、推力は単調非減少であること)
+typedef struct
+{
+    float pwm_us;  // パルス幅 [us]
+    float force_n; // 推力 [N] (後退は負)
+} ThrustCurvePoint;
+
+// 推力 -> PWM の逆引き表
+typedef struct
+{
+    float force_min_n;   // 出せる最小推力 [N] (単方向スラスターは 0)
+    float force_max_n;   // 出せる最大推力 [N]
+    // 停止出力: 推力 0 のパルス幅。先頭の測定点の推力が 0 以上なら先頭点の PWM (PWM_MIN とは限らない)、
+    // 後退側がある曲線では推力 0 の区間 (不感帯) の中央。起動時・フェイルセーフ・ウォッチドッグはこの値で止める
+    float zero_pwm_us;
+    float inv_step_reverse; // 1 / (後退側の表の1区間あたりの推力 [N])
+    float inv_step_forward; // 1 / (前進側の表の1区間あたりの推力 [N])
+    float reverse_lut[THRUST_CURVE_LUT_SIZE]; // force_min_n〜0 の PWM (後退側。単方向スラスターでは未使用)
+    float forward_lut[THRUST_CURVE_LUT_SIZE]; // 0〜force_max_n の PWM (前進側)
+} ThrustCurveLut;
+
+// 関数のプロトタイプ宣言
+// 測定点から逆引き表を作る (点が足りない・単調でない場合は false)
+bool thrust_curve_build_lut(ThrustCurveLut *lut, const ThrustCurvePoint *points, int count);
+// 組み込みプロファイル ("t200_16v", "t200_16v_forward") から逆引き表を作る (未知の名前は false)
+bool thrust_curve_load_builtin(ThrustCurveLut *lut, const char *name);
+// PWM に比例する推力の直線プロファイルを作る (bidirectional: neutral_us で 0、min_us で -max_force_n)
+bool thrust_curve_build_linear(ThrustCurveLut *lut, float min_us, float neutral_us, float max_us, float max_force_n, bool bidirectional);
+// CSV ファイル ("pwm_us,force_n" の行、'#' 以降はコメント) から逆引き表を作る
+bool thrust_curve_load_csv(ThrustCurveLut *lut, const char *path);
+// パルス幅 [us] から推力 [N] を求める (thrust_curve_pwm の逆変換、表の二分探索。シミュレータの推力モデル用)
+// 不感帯の中は 0、表の範囲外は端の推力に飽和する
+float thrust_curve_force(const ThrustCurveLut *lut, float pwm_us);
+
+// 推力 [N] をパルス幅 [us] に変換する。範囲外の推力は端の値に飽和する
+static inline float thrust_curve_pwm(const ThrustCurveLut *lut, float force_n)
+{
+    const float *table;
+    float position;
+    if (force_n > 0.0f)
+    {
+        table = lut->forward_lut;
+        position = force_n * lut->inv_step_forward;
+    }
+    else if (force_n < 0.0f && lut->force_min_n < 0.0f)
+    {
+        table = lut->reverse_lut;
+        position = (force_n - lut->force_min_n) * lut->inv_step_reverse;
+    }
+    else
+    {
+        return lut->zero_pwm_us; // 停止 (単方向スラスターへの負の推力も停止)
+    }
+    const float last = static_cast<float>(THRUST_CURVE_LUT_SIZE - 1);
+    position = position < 0.0f ? 0.0f : (position > last ? last : position);
+    int index = static_cast<int>(position);
+    if (index >= THRUST_CURVE_LUT_SIZE - 1)
+        index = THRUST_CURVE_LUT_SIZE - 2;
+    float frac = position - static_cast<float>(index);
+    return table[index] + (table[index + 1] - table[index]) * frac;
+}
+
+#endif // THRUST_CURVE_H
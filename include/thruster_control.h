@@ -2,26 +2,40 @@
 #define THRUSTER_CONTROL_H // インクルードガード
 
 #include "gamepad.h"   // GamepadData 構造体の定義が必要なためインクルード
-#include "bindings.h"  // AxisData 構造体を使用するため (read_gyro() の戻り値型)
+#include "hal.h"       // AxisData 構造体を使用するため (hal_read_gyro() の戻り値型)
 #include "config.h"    // グローバル設定オブジェクト g_config を使用するため
 
 // --- 定数定義 ---
-// NUM_THRUSTERS はハードウェア固定値なので、ここでは定数として残す
+// 実際に駆動するスラスター数とチャンネルは config.ini の [ALLOCATION] で設定する (thrust_allocation.h)
 
-#define NUM_THRUSTERS 6        // 制御対象のスラスター総数 (Ch0-3 水平, Ch4-5 前進/後退)
+#define NUM_THRUSTERS 6        // 既定の配分行列のスラスター数 (Ch0-3 水平, Ch4-5 前進/後退)
 
 // --- LED制御用定数 ---
 // LED_PWM_CHANNEL, LED_PWM_ON, LED_PWM_OFF は config.h/cpp に移動
 
+// 直近の出力 (thruster_update / thruster_set_all_stop の結果。ブラックボックスの記録用)
+typedef struct
+{
+    int thruster_count;
+    float target_pwm[ALLOC_MAX_THRUSTERS]; // 推力曲線で変換した目標 PWM [us] (平滑化前)
+    int smoothed_pwm[ALLOC_MAX_THRUSTERS]; // 平滑化後に実際に出力した PWM [us]
+    bool saturated;                        // 推力配分が飽和して縮小したか
+} ThrusterOutputState;
+
 // --- 関数のプロトタイプ宣言 ---
-// スラスター制御モジュールを初期化する (PWM設定など)
+// スラスター制御モジュールを初期化する (配分行列の構築、PWM設定など)。配分設定が不正な場合は false
 bool thruster_init();
 // スラスター制御を無効化する (PWM停止など)
 void thruster_disable();
 // ゲームパッドデータとジャイロデータに基づいてすべてのスラスターのPWM出力を更新する
-void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data);
-// 全てのスラスターを指定されたPWM値に設定し、LEDをオフにする (フェイルセーフ用)
-void thruster_set_all_pwm(int pwm_value);
+// dt_s は前回の呼び出しからの実測経過時間 [s] (平滑化と PID の積分に使う)
+void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data, float dt_s);
+// 全てのスラスターを推力曲線の停止出力 (thruster_get_stop_pwm_us) にし、平滑化の状態も揃えて LED をオフにする
+void thruster_set_all_stop();
+// スラスター (配分行列の列番号) の推力曲線の停止出力 [us] (ThrustCurveLut::zero_pwm_us)。thruster_init の後に呼ぶ
+float thruster_get_stop_pwm_us(int thruster);
+// 直近の出力をコピーする (制御スレッドから呼ぶこと)
+void thruster_get_output_state(ThrusterOutputState *state);
 // ヘルパー関数（他の場所で必要ない場合は .cpp 内部に保持できます）
 // float map_value(float x, float in_min, float in_max, float out_min, float out_max);
 
@@ -0,0 +1,38 @@
+#ifndef TIME_UTILS_H
+#define TIME_UTILS_H
+
+#include <time.h>   // clock_gettime, struct timespec
+#include <stdint.h> // int64_t
+
+// --- 時刻ユーティリティ ---
+// 制御ループやフェイルセーフの時間計測はすべて CLOCK_MONOTONIC を使用する。
+// (gettimeofday は NTP による時刻補正で前後にジャンプするため使用しない)
+
+#define NSEC_PER_SEC 1000000000LL // 1秒あたりのナノ秒数
+#define NSEC_PER_MSEC 1000000LL   // 1ミリ秒あたりのナノ秒数
+#define NSEC_PER_USEC 1000LL      // 1マイクロ秒あたりのナノ秒数
+
+// timespec をナノ秒に変換する
+static inline int64_t timespec_to_ns(const struct timespec &ts)
+{
+    return static_cast<int64_t>(ts.tv_sec) * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+// ナノ秒を timespec に変換する
+static inline struct timespec ns_to_timespec(int64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(ns / NSEC_PER_SEC);
+    ts.tv_nsec = static_cast<long>(ns % NSEC_PER_SEC);
+    return ts;
+}
+
+// 現在の単調増加時刻をナノ秒で取得する
+static inline int64_t monotonic_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return timespec_to_ns(ts);
+}
+
+#endif // TIME_UTILS_H
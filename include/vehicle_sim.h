@@ -0,0 +1,53 @@
+#ifndef VEHICLE_SIM_H
+#define VEHICLE_SIM_H
+
+#include "hal.h"               // AxisData
+#include "thrust_allocation.h" // ALLOC_MAX_THRUSTERS, WRENCH_DOF
+
+// --- 6自由度の車両運動モデル (閉ループシミュレーション用) ---
+// 機体座標は x 前方, y 右舷, z 下向き、位置は NED (北, 東, 下) の慣性座標。
+// 剛体 + 付加質量 (対角)、線形・二次の抗力、重心と浮心のずれによる復元モーメント、
+// スラスター推力の一次遅れを持つ。中性浮力とし、付加質量によるコリオリ力は無視する。
+// スラスターの取り付け位置と向きは config.ini の [VEHICLE_SIM] T0〜T7 (既定は [ALLOCATION] の既定配置と同じ向き)。
+// 実時間とは無関係に vehicle_step で時間を進めるため、実時間より何倍も速く実行できる。
+
+// 車両のパラメータ (vehicle_params_from_config で g_config から作る)
+typedef struct
+{
+    float mass[WRENCH_DOF];           // 剛体 + 付加質量 (surge, sway, heave [kg], roll, pitch, yaw [kg m^2])
+    float rigid_mass_kg;              // 剛体の質量 (コリオリ力と復元モーメントに使う)
+    float inertia[3];                 // 剛体の慣性モーメント [kg m^2]
+    float linear_drag[WRENCH_DOF];
+    float quadratic_drag[WRENCH_DOF];
+    float bg_m;                       // 重心から浮心までの高さ [m]
+    float motor_tau_s;                // 推力の一次遅れ時定数 [s]
+    int thruster_count;
+    float thruster_position[ALLOC_MAX_THRUSTERS][3];  // 取り付け位置 [m]
+    float thruster_direction[ALLOC_MAX_THRUSTERS][3]; // 推力の向き (単位ベクトル)
+} VehicleParams;
+
+// 車両の状態
+typedef struct
+{
+    float position[3];              // NED 位置 [m]
+    float q0, q1, q2, q3;           // 姿勢クォータニオン (機体座標 -> NED)
+    float velocity[WRENCH_DOF];     // 機体座標の速度 u, v, w [m/s] と角速度 p, q, r [rad/s]
+    float acceleration[3];          // 直近の並進加速度 (機体座標の速度の時間微分) [m/s^2]
+    float thrust_n[ALLOC_MAX_THRUSTERS]; // 一次遅れ後の実推力 [N]
+    double time_s;                  // シミュレーション時刻 [s]
+} VehicleState;
+
+// 関数のプロトタイプ宣言
+void vehicle_params_from_config(VehicleParams *params);
+void vehicle_reset(VehicleState *state); // 原点・水平・北向きで静止
+// dt_s だけ時間を進める。thrust_command_n はスラスターごとの指令推力 [N]、
+// disturbance は機体座標の外乱 (surge, sway, heave [N], roll, pitch, yaw [Nm]、NULL で外乱なし)
+void vehicle_step(const VehicleParams *params, VehicleState *state, const float *thrust_command_n,
+                  const float *disturbance, float dt_s);
+// オイラー角 [deg] (ロール・ピッチは -180〜180 / -90〜90、方位は -180〜180)
+void vehicle_euler_deg(const VehicleState *state, float *roll_deg, float *pitch_deg, float *yaw_deg);
+// 状態に対応する IMU の真値 (hal_sim_set_motion に渡す)。ジャイロ [deg/s]、
+// 加速度は静止時に +Z へ 1G (sim バックエンドの静止値と同じ向き)、磁力は静止値を機体の姿勢で回したもの
+void vehicle_imu(const VehicleState *state, AxisData *gyro_dps, AxisData *accel, AxisData *mag);
+
+#endif // VEHICLE_SIM_H
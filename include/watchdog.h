@@ -0,0 +1,67 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+
+// --- 独立したウォッチドッグスレッド ---
+// メインループのフェイルセーフは同じループ内で判定されるため、ループが止まる (I2C の読み書きが固まるなど) と
+// スラスターは最後の PWM のまま回り続ける。ウォッチドッグは別スレッド (リアルタイムモード時は制御スレッドより
+// 高い SCHED_FIFO 優先度、制御用コア以外) で次の2つを監視する。
+//  - ハートビート: 制御周期タイマーごとに watchdog_heartbeat() が呼ばれているか
+//  - 最終コマンド: 最後に採用したコマンドからの経過時間 (CONNECTION_TIMEOUT_SECONDS + TIMEOUT_MS を超えたら。
+//    メインループ自身のフェイルセーフが先に働くはずで、これは働かなかった場合の保険)
+// 停止したハートビートは [WATCHDOG] TIMEOUT_MS 以内 (最後のハートビートから数えて) に検出し、
+// 起動時に組み立てておいた停止出力 (スラスターごとの推力曲線の停止出力、thruster_get_stop_pwm_us) の
+// チャンネル・デューティ比の配列をそのまま HAL へ書き込む (確保・計算なし)。
+// 発動するとラッチし、解除 (watchdog_rearm) までは pwm_output_flush() の書き込みを止めて制御側の値で上書きさせない。
+// 制御スレッドが書き込みの途中で固まっていた場合に備え、ハートビートが止まっている間は毎周期書き直す。
+// 発動ごとに時刻・理由・検出までの時間を記録し、ログと統計に出す。
+//
+// PWM の書き込みは通常は制御スレッドだけが行うが、ウォッチドッグの発動時のみこのスレッドからも書き込む
+// (navigator-lib は内部でロックする。sim / replay バックエンドは値を保持するだけ)。
+
+#define WATCHDOG_MAX_TRIP_LOG 16 // 統計に残す直近の発動記録の数
+
+// 発動の理由
+enum WatchdogReason
+{
+    WATCHDOG_REASON_HEARTBEAT = 0, // 制御ループのハートビートが止まった
+    WATCHDOG_REASON_COMMAND,       // 最後のコマンドから時間が経ちすぎた
+    WATCHDOG_REASON_COUNT
+};
+
+// 1回の発動記録
+typedef struct
+{
+    int64_t time_ns;          // 発動した時刻 (CLOCK_MONOTONIC)
+    int64_t realtime_ns;      // 同時刻の CLOCK_REALTIME (ログとの照合用)
+    int64_t stale_ns;         // 検出時点の、最後のハートビート (またはコマンド) からの経過時間
+    int64_t write_ns;         // 停止出力の書き込みにかかった時間
+    int reason;               // WatchdogReason
+} WatchdogTrip;
+
+// ウォッチドッグの統計
+typedef struct
+{
+    unsigned long long checks;                       // 監視周期の回数
+    unsigned long long trips[WATCHDOG_REASON_COUNT]; // 理由ごとの発動回数
+    unsigned long long rewrites;                     // 発動中に停止出力を書き直した回数
+    unsigned long long rearms;                       // 解除した回数
+    int64_t max_detect_ns;                           // 最後のハートビートから停止出力の書き込み完了までの最大時間 (TIMEOUT_MS 以内のはず)
+    int64_t max_check_late_ns;                       // 監視周期の起床遅れの最大値
+    unsigned int trip_log_count;                     // trip_log の有効数
+    WatchdogTrip trip_log[WATCHDOG_MAX_TRIP_LOG];    // 直近の発動記録 (古い順)
+} WatchdogStats;
+
+// 関数のプロトタイプ宣言
+bool watchdog_start();                    // 停止出力の書き込み内容を用意して監視スレッドを起動する (thruster_init の後)
+void watchdog_stop();                     // スレッドを停止し、ラッチを解除する (thruster_disable の前に呼ぶ)
+void watchdog_heartbeat(int64_t now_ns);  // 制御周期タイマーごとに制御スレッドから呼ぶ
+void watchdog_command_received(int64_t now_ns); // コマンドを採用したときに呼ぶ (コマンド監視を開始する)
+void watchdog_command_idle();             // メインループ自身がフェイルセーフへ移ったときに呼ぶ (次のコマンドまでコマンド監視を止める)
+bool watchdog_tripped();                  // 発動中 (ラッチ中) か
+bool watchdog_rearm(int64_t now_ns);      // ハートビートが戻っていればラッチを解除する。解除できたら true
+void watchdog_get_stats(WatchdogStats *stats);
+void watchdog_print_stats();
+
+#endif // WATCHDOG_H
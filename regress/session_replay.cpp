@@ -0,0 +1,468 @@
+// セッション再生による回帰テスト: 記録したゲームパッド入力と角速度を実際の制御コード (thruster_update) に
+// 記録どおりの順序・dt で流し込み、出力 PWM を基準 (記録時の出力、または基準ファイル) と比較する。
+// 配分・平滑化・PID を変更したときに、同じ入力から同じ PWM が出ることを確認するために使う。
+// 入力はフライトレコーダーのファイル (blackbox.bin) か、それを blackbox_decode で CSV にしたもの。
+//   make -f Makefile.mk regress
+//   ./bin/session_replay blackbox.bin                              # 記録時の出力と比較
+//   ./bin/session_replay blackbox.bin --write-golden golden.csv     # 現在の出力を基準ファイルとして保存
+//   ./bin/session_replay blackbox.bin --golden golden.csv --tolerance 1 --diff diff.csv
+//   ./bin/session_replay blackbox.bin --speed 1                     # 記録どおりの時間間隔で再生
+// 終了コード: 0 = 全周期が許容差内、1 = 差分あり、2 = 引数・ファイルのエラー
+#include "blackbox.h"         // BlackboxHeader, BlackboxRecord
+#include "config.h"           // g_config, loadConfig
+#include "hal.h"              // hal_select, hal_init
+#include "logger.h"           // g_log_min_level
+#include "gamepad.h"          // GamepadData
+#include "thruster_control.h" // thruster_init, thruster_update, thruster_get_output_state
+#include "time_utils.h"       // monotonic_now_ns, ns_to_timespec
+#include <stdio.h>
+#include <stdlib.h>           // strtof, strtoul, strtoll
+#include <string.h>           // strcmp, memcmp, strtok
+#include <math.h>             // fabsf
+#include <time.h>             // clock_nanosleep
+#include <errno.h>
+#include <algorithm>          // std::sort
+#include <string>
+#include <vector>
+
+#define REPLAY_DEFAULT_TOLERANCE_US 0.5f // 既定の許容差 (出力 PWM は整数のため 1us の差から検出する)
+#define REPLAY_LINE_LEN 4096
+
+// 1周期分の入力と基準の出力
+typedef struct
+{
+    uint64_t sequence;
+    int64_t time_ns;
+    uint8_t event; // BlackboxEvent
+    GamepadData gamepad;
+    AxisData rate_dps;
+    float dt_s;
+    float expected_target[ALLOC_MAX_THRUSTERS];
+    int expected_pwm[ALLOC_MAX_THRUSTERS];
+} ReplayTick;
+
+// チャンネルごとの比較結果
+typedef struct
+{
+    float max_target_diff;
+    int max_pwm_diff;
+    double sum_pwm_diff;
+    unsigned long mismatches; // 許容差を超えた周期数
+    uint64_t first_mismatch;  // 最初に許容差を超えた周期の sequence (0 はなし)
+} ChannelDiff;
+
+// ヘルパー関数: フライトレコーダーのレコードを再生用の周期へ変換する
+static void tick_from_record(const BlackboxRecord &r, ReplayTick *t)
+{
+    *t = ReplayTick();
+    t->sequence = r.sequence;
+    t->time_ns = r.time_ns;
+    t->event = r.event;
+    t->gamepad.leftThumbX = r.stick[0];
+    t->gamepad.leftThumbY = r.stick[1];
+    t->gamepad.rightThumbX = r.stick[2];
+    t->gamepad.rightThumbY = r.stick[3];
+    t->gamepad.LT = r.trigger[0];
+    t->gamepad.RT = r.trigger[1];
+    t->gamepad.buttons = r.buttons;
+    t->gamepad.flags = r.gamepad_flags;
+    t->gamepad.sequence = r.gamepad_sequence;
+    t->rate_dps.x = r.control_rate_dps[0];
+    t->rate_dps.y = r.control_rate_dps[1];
+    t->rate_dps.z = r.control_rate_dps[2];
+    t->dt_s = r.dt_s;
+    for (int i = 0; i < BLACKBOX_MAX_THRUSTERS && i < ALLOC_MAX_THRUSTERS; ++i)
+    {
+        t->expected_target[i] = r.target_pwm[i];
+        t->expected_pwm[i] = r.smoothed_pwm[i];
+    }
+}
+
+// フライトレコーダーのファイルを読み、書き込み途中のスロットを除いて sequence 順に並べる
+static bool load_blackbox(FILE *in, const char *path, std::vector<ReplayTick> *ticks, int *thruster_count)
+{
+    BlackboxHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || header.version != BLACKBOX_VERSION ||
+        header.record_size != sizeof(BlackboxRecord) || header.header_size != BLACKBOX_HEADER_SIZE)
+    {
+        fprintf(stderr, "session_replay: '%s' は未対応の形式です\n", path);
+        return false;
+    }
+    std::vector<BlackboxRecord> slots(header.capacity);
+    size_t count = 0;
+    if (header.capacity > 0 && fseek(in, BLACKBOX_HEADER_SIZE, SEEK_SET) == 0)
+        count = fread(&slots[0], sizeof(BlackboxRecord), header.capacity, in);
+
+    std::vector<const BlackboxRecord *> ordered;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (slots[i].sequence != 0 && (slots[i].sequence - 1) % header.capacity == i)
+            ordered.push_back(&slots[i]);
+    }
+    std::sort(ordered.begin(), ordered.end(),
+              [](const BlackboxRecord *a, const BlackboxRecord *b) { return a->sequence < b->sequence; });
+    ticks->resize(ordered.size());
+    for (size_t i = 0; i < ordered.size(); ++i)
+        tick_from_record(*ordered[i], &(*ticks)[i]);
+    *thruster_count = static_cast<int>(header.thruster_count);
+    return true;
+}
+
+// blackbox_decode の CSV (手で切り出し・編集したものを含む) を列名で読む
+static bool load_csv(FILE *in, const char *path, std::vector<ReplayTick> *ticks, int *thruster_count)
+{
+    static char line[REPLAY_LINE_LEN];
+    if (!fgets(line, sizeof(line), in))
+    {
+        fprintf(stderr, "session_replay: '%s' が空です\n", path);
+        return false;
+    }
+    // 列名 -> 列番号
+    std::vector<std::string> names;
+    for (char *tok = strtok(line, ",\r\n"); tok; tok = strtok(NULL, ",\r\n"))
+        names.push_back(tok);
+    const char *required[] = {"sequence", "event", "stick0", "stick1", "stick2", "stick3", "dt_s",
+                              "control_rate_dps0", "control_rate_dps1", "control_rate_dps2"};
+    for (size_t k = 0; k < sizeof(required) / sizeof(required[0]); ++k)
+    {
+        if (std::find(names.begin(), names.end(), required[k]) == names.end())
+        {
+            fprintf(stderr, "session_replay: '%s' に列 %s がありません\n", path, required[k]);
+            return false;
+        }
+    }
+    *thruster_count = 0;
+    while (*thruster_count < ALLOC_MAX_THRUSTERS &&
+           std::find(names.begin(), names.end(), "smoothed_pwm" + std::to_string(*thruster_count)) != names.end())
+        (*thruster_count)++;
+
+    std::vector<double> values(names.size());
+    while (fgets(line, sizeof(line), in))
+    {
+        size_t column = 0;
+        char *p = line;
+        while (column < values.size())
+        {
+            char *next = NULL;
+            values[column++] = strtod(p, &next);
+            p = strchr(next, ',');
+            if (!p)
+                break;
+            ++p;
+        }
+        if (column < values.size())
+            continue; // 途中で切れた行は読み飛ばす
+        ReplayTick t = ReplayTick();
+        for (size_t c = 0; c < names.size(); ++c)
+        {
+            const std::string &n = names[c];
+            double v = values[c];
+            if (n == "sequence") t.sequence = static_cast<uint64_t>(v);
+            else if (n == "time_ns") t.time_ns = static_cast<int64_t>(v);
+            else if (n == "event") t.event = static_cast<uint8_t>(v);
+            else if (n == "stick0") t.gamepad.leftThumbX = static_cast<int>(v);
+            else if (n == "stick1") t.gamepad.leftThumbY = static_cast<int>(v);
+            else if (n == "stick2") t.gamepad.rightThumbX = static_cast<int>(v);
+            else if (n == "stick3") t.gamepad.rightThumbY = static_cast<int>(v);
+            else if (n == "trigger0") t.gamepad.LT = static_cast<int>(v);
+            else if (n == "trigger1") t.gamepad.RT = static_cast<int>(v);
+            else if (n == "buttons") t.gamepad.buttons = static_cast<uint16_t>(v);
+            else if (n == "gamepad_flags") t.gamepad.flags = static_cast<uint8_t>(v);
+            else if (n == "gamepad_sequence") t.gamepad.sequence = static_cast<uint32_t>(v);
+            else if (n == "dt_s") t.dt_s = static_cast<float>(v);
+            else if (n == "control_rate_dps0") t.rate_dps.x = static_cast<float>(v);
+            else if (n == "control_rate_dps1") t.rate_dps.y = static_cast<float>(v);
+            else if (n == "control_rate_dps2") t.rate_dps.z = static_cast<float>(v);
+            else if (n.compare(0, 10, "target_pwm") == 0 || n.compare(0, 12, "smoothed_pwm") == 0)
+            {
+                bool target = n[0] == 't';
+                int ch = atoi(n.c_str() + (target ? 10 : 12));
+                if (ch >= 0 && ch < ALLOC_MAX_THRUSTERS)
+                {
+                    if (target)
+                        t.expected_target[ch] = static_cast<float>(v);
+                    else
+                        t.expected_pwm[ch] = static_cast<int>(v);
+                }
+            }
+        }
+        ticks->push_back(t);
+    }
+    return true;
+}
+
+static bool load_session(const char *path, std::vector<ReplayTick> *ticks, int *thruster_count)
+{
+    FILE *in = fopen(path, "rb");
+    if (!in)
+    {
+        fprintf(stderr, "session_replay: '%s' を開けません: %s\n", path, strerror(errno));
+        return false;
+    }
+    char magic[8] = {0};
+    bool binary = fread(magic, 1, sizeof(magic), in) == sizeof(magic) && memcmp(magic, BLACKBOX_MAGIC, sizeof(BLACKBOX_MAGIC)) == 0;
+    rewind(in);
+    bool ok = binary ? load_blackbox(in, path, ticks, thruster_count) : load_csv(in, path, ticks, thruster_count);
+    fclose(in);
+    return ok;
+}
+
+// 基準ファイル (--write-golden の出力): sequence,target0..,pwm0..
+static bool load_golden(const char *path, std::vector<ReplayTick> *ticks, int thruster_count)
+{
+    FILE *in = fopen(path, "r");
+    if (!in)
+    {
+        fprintf(stderr, "session_replay: 基準ファイル '%s' を開けません: %s\n", path, strerror(errno));
+        return false;
+    }
+    static char line[REPLAY_LINE_LEN];
+    size_t index = 0;
+    bool ok = fgets(line, sizeof(line), in) != NULL; // 見出し行
+    while (ok && fgets(line, sizeof(line), in))
+    {
+        char *p = line;
+        uint64_t sequence = strtoull(p, &p, 10);
+        // 再生側と同じ sequence の周期へ割り当てる (切り出した入力に対応する行だけを使う)
+        while (index < ticks->size() && (*ticks)[index].sequence < sequence)
+            index++;
+        if (index >= ticks->size() || (*ticks)[index].sequence != sequence)
+            continue;
+        ReplayTick &t = (*ticks)[index];
+        for (int ch = 0; ch < thruster_count; ++ch)
+            t.expected_target[ch] = strtof(p + 1, &p);
+        for (int ch = 0; ch < thruster_count; ++ch)
+            t.expected_pwm[ch] = static_cast<int>(strtol(p + 1, &p, 10));
+    }
+    fclose(in);
+    if (!ok)
+        fprintf(stderr, "session_replay: 基準ファイル '%s' が空です\n", path);
+    return ok;
+}
+
+static void print_usage(const char *program)
+{
+    printf("usage: %s SESSION(blackbox.bin|.csv) [--config FILE] [--golden FILE] [--write-golden FILE]\n"
+           "          [--tolerance US] [--speed X] [--skip N] [--diff FILE.csv]\n"
+           "  --speed 0 (既定) は最速、1 は記録どおりの時間間隔で再生する\n"
+           "  --skip N は先頭 N 周期を比較しない (リングが一周して記録の途中から始まる場合など)\n",
+           program);
+}
+
+int main(int argc, char **argv)
+{
+    const char *session_path = NULL;
+    const char *config_path = "config.ini";
+    const char *golden_path = NULL;
+    const char *write_golden_path = NULL;
+    const char *diff_path = NULL;
+    float tolerance = REPLAY_DEFAULT_TOLERANCE_US;
+    float speed = 0.0f;
+    unsigned long skip = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (arg[0] != '-')
+        {
+            session_path = arg;
+            continue;
+        }
+        const char *value = (i + 1 < argc) ? argv[++i] : NULL;
+        if (!value)
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (strcmp(arg, "--config") == 0)
+            config_path = value;
+        else if (strcmp(arg, "--golden") == 0)
+            golden_path = value;
+        else if (strcmp(arg, "--write-golden") == 0)
+            write_golden_path = value;
+        else if (strcmp(arg, "--diff") == 0)
+            diff_path = value;
+        else if (strcmp(arg, "--tolerance") == 0)
+            tolerance = strtof(value, NULL);
+        else if (strcmp(arg, "--speed") == 0)
+            speed = strtof(value, NULL);
+        else if (strcmp(arg, "--skip") == 0)
+            skip = strtoul(value, NULL, 10);
+        else
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!session_path)
+    {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    // 設定を読み込み、ハードウェアは sim バックエンド (I2C 遅延なし) にする
+    g_log_min_level = LOG_LEVEL_WARN; // 初期化時のログを抑える
+    loadConfig(config_path);
+    g_log_min_level = LOG_LEVEL_WARN;
+    g_config.hal_sim_i2c_latency_us = 0.0f;
+    g_config.hal_sim_i2c_jitter_us = 0.0f;
+    if (!hal_select("sim") || !hal_init() || !thruster_init())
+        return 2;
+
+    std::vector<ReplayTick> ticks;
+    int recorded_thrusters = 0;
+    if (!load_session(session_path, &ticks, &recorded_thrusters))
+        return 2;
+    if (ticks.empty())
+    {
+        fprintf(stderr, "session_replay: '%s' に再生できる周期がありません\n", session_path);
+        return 2;
+    }
+    const int thruster_count = g_config.alloc_thruster_count;
+    if (recorded_thrusters != thruster_count)
+    {
+        fprintf(stderr, "session_replay: 記録のスラスター数 (%d) と設定 (%d) が異なります\n", recorded_thrusters, thruster_count);
+        return 2;
+    }
+    if (golden_path && !load_golden(golden_path, &ticks, thruster_count))
+        return 2;
+    if (ticks.front().sequence != 1 && skip == 0)
+    {
+        fprintf(stderr, "session_replay: 記録が seq %llu から始まっています (リングが一周した)。"
+                        "平滑化の初期状態が異なるため --skip で先頭を除外してください\n",
+                static_cast<unsigned long long>(ticks.front().sequence));
+    }
+
+    FILE *golden_out = NULL;
+    if (write_golden_path)
+    {
+        golden_out = fopen(write_golden_path, "w");
+        if (!golden_out)
+        {
+            fprintf(stderr, "session_replay: '%s' を書き込み用に開けません\n", write_golden_path);
+            return 2;
+        }
+        fprintf(golden_out, "sequence");
+        for (int ch = 0; ch < thruster_count; ++ch)
+            fprintf(golden_out, ",target%d", ch);
+        for (int ch = 0; ch < thruster_count; ++ch)
+            fprintf(golden_out, ",pwm%d", ch);
+        fputc('\n', golden_out);
+    }
+    FILE *diff_out = NULL;
+    if (diff_path)
+    {
+        diff_out = fopen(diff_path, "w");
+        if (!diff_out)
+        {
+            fprintf(stderr, "session_replay: '%s' を書き込み用に開けません\n", diff_path);
+            return 2;
+        }
+        fprintf(diff_out, "sequence,time_s");
+        for (int ch = 0; ch < thruster_count; ++ch)
+            fprintf(diff_out, ",expected%d,actual%d", ch, ch);
+        fputc('\n', diff_out);
+    }
+
+    // --- 再生: メインループと同じく開始時に全スラスターを停止値に揃えてから、記録どおりの順序で出力を更新する ---
+    thruster_set_all_stop();
+    ThrusterOutputState out;
+    ChannelDiff diffs[ALLOC_MAX_THRUSTERS];
+    memset(diffs, 0, sizeof(diffs));
+    unsigned long compared = 0, mismatched_ticks = 0;
+    int64_t replay_ns = 0; // thruster_update にかかった時間の合計 (待ち時間とファイル出力を除く)
+    const int64_t wall_start_ns = monotonic_now_ns();
+    const int64_t record_start_ns = ticks.front().time_ns;
+
+    for (size_t i = 0; i < ticks.size(); ++i)
+    {
+        const ReplayTick &t = ticks[i];
+        if (speed > 0.0f)
+        {
+            struct timespec deadline = ns_to_timespec(wall_start_ns + static_cast<int64_t>((t.time_ns - record_start_ns) / speed));
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+            {
+            }
+        }
+
+        int64_t start_ns = monotonic_now_ns();
+        // フェイルセーフとウォッチドッグの解除は、メインループと同じくスラスターごとの停止値へリセットする
+        if (t.event == BLACKBOX_EVENT_FAILSAFE || t.event == BLACKBOX_EVENT_REARM)
+            thruster_set_all_stop();
+        else
+            thruster_update(t.gamepad, t.rate_dps, t.dt_s);
+        thruster_get_output_state(&out);
+        replay_ns += monotonic_now_ns() - start_ns;
+
+        if (golden_out)
+        {
+            fprintf(golden_out, "%llu", static_cast<unsigned long long>(t.sequence));
+            for (int ch = 0; ch < thruster_count; ++ch)
+                fprintf(golden_out, ",%.3f", out.target_pwm[ch]);
+            for (int ch = 0; ch < thruster_count; ++ch)
+                fprintf(golden_out, ",%d", out.smoothed_pwm[ch]);
+            fputc('\n', golden_out);
+        }
+        if (diff_out)
+        {
+            fprintf(diff_out, "%llu,%.6f", static_cast<unsigned long long>(t.sequence), (t.time_ns - record_start_ns) / 1e9);
+            for (int ch = 0; ch < thruster_count; ++ch)
+                fprintf(diff_out, ",%d,%d", t.expected_pwm[ch], out.smoothed_pwm[ch]);
+            fputc('\n', diff_out);
+        }
+        if (i < skip)
+            continue;
+
+        compared++;
+        bool tick_mismatch = false;
+        for (int ch = 0; ch < thruster_count; ++ch)
+        {
+            ChannelDiff &d = diffs[ch];
+            float target_diff = fabsf(out.target_pwm[ch] - t.expected_target[ch]);
+            int pwm_diff = abs(out.smoothed_pwm[ch] - t.expected_pwm[ch]);
+            d.max_target_diff = target_diff > d.max_target_diff ? target_diff : d.max_target_diff;
+            d.max_pwm_diff = pwm_diff > d.max_pwm_diff ? pwm_diff : d.max_pwm_diff;
+            d.sum_pwm_diff += pwm_diff;
+            if (target_diff > tolerance || pwm_diff > tolerance)
+            {
+                if (d.mismatches++ == 0)
+                    d.first_mismatch = t.sequence;
+                tick_mismatch = true;
+            }
+        }
+        if (tick_mismatch)
+            mismatched_ticks++;
+    }
+    const double wall_s = (monotonic_now_ns() - wall_start_ns) / 1e9;
+    if (golden_out)
+        fclose(golden_out);
+    if (diff_out)
+        fclose(diff_out);
+
+    // --- 結果 ---
+    const double recorded_s = (ticks.back().time_ns - record_start_ns) / 1e9;
+    printf("session: %s (%zu ticks, seq %llu-%llu, %.1f s recorded)\n", session_path, ticks.size(),
+           static_cast<unsigned long long>(ticks.front().sequence), static_cast<unsigned long long>(ticks.back().sequence),
+           recorded_s);
+    printf("reference: %s, tolerance %.2f us, compared %lu ticks (skipped %lu)\n",
+           golden_path ? golden_path : "recorded outputs", tolerance, compared, skip < ticks.size() ? skip : ticks.size());
+    printf("%-4s %14s %12s %14s %12s %10s\n", "ch", "max_dtarget_us", "max_dpwm_us", "mean_dpwm_us", "mismatches", "first_seq");
+    for (int ch = 0; ch < thruster_count; ++ch)
+    {
+        const ChannelDiff &d = diffs[ch];
+        printf("T%-3d %14.3f %12d %14.3f %12lu %10llu\n", ch, d.max_target_diff, d.max_pwm_diff,
+               compared > 0 ? d.sum_pwm_diff / compared : 0.0, d.mismatches, static_cast<unsigned long long>(d.first_mismatch));
+    }
+    printf("throughput: %.0f ticks/s in thruster_update (%.2f us/tick), wall %.3f s (speed %s)\n",
+           replay_ns > 0 ? ticks.size() / (replay_ns / 1e9) : 0.0, replay_ns / 1e3 / ticks.size(), wall_s,
+           speed > 0.0f ? "recorded timing" : "max");
+    printf("result: %s (%lu / %lu ticks outside tolerance)\n", mismatched_ticks == 0 ? "PASS" : "FAIL", mismatched_ticks,
+           compared);
+    thruster_disable();
+    return mismatched_ticks == 0 ? 0 : 1;
+}
@@ -0,0 +1,684 @@
+// 閉ループの車両シミュレータ: 実際の制御コード (thruster_update) を6自由度の運動モデル (vehicle_sim.h) につなぎ、
+// 台本どおりのゲームパッド入力に対する応答を実時間より速く計算して評価指標を出す。
+// センサーは HAL の sim バックエンドが運動モデルの真値にノイズを加えて返し (I2C 遅延はなし)、
+// 姿勢推定・制御周期・推力曲線は config.ini の設定どおりに動かす。
+//   make -f Makefile.mk sim && ./bin/rov_sim [--scenario 名前|ファイル]... [--set KEY=値]...
+//       [--sweep KEY=開始:終了:刻み]... [--config config.ini] [--out 結果.csv] [--trace 時系列.csv]
+#include "config.h"           // g_config, loadConfig
+#include "hal.h"              // hal_select, hal_init, hal_sim_*
+#include "logger.h"           // g_log_min_level
+#include "gamepad.h"          // GamepadData
+#include "thruster_control.h" // thruster_init, thruster_update
+#include "thrust_curve.h"     // thrust_curve_force
+#include "vehicle_sim.h"
+#include "ahrs.h"
+#include "time_utils.h"       // monotonic_now_ns
+#include <stdio.h>
+#include <stdlib.h>           // strtof, strtol
+#include <string.h>           // strcmp, strchr, strncpy
+#include <math.h>             // fabsf
+#include <vector>
+
+#define SIM_MAX_SEGMENTS 64
+#define SIM_MAX_SCENARIOS 16
+#define SIM_MAX_SETS 16
+#define SIM_MAX_SWEEPS 3
+#define SIM_NAME_LEN 64
+#define SIM_DEFAULT_SETTLE_MARGIN_DPS 1.0f // 整定判定の帯 = YAW_THRESHOLD_DPS + この値
+
+// 台本の1区間: この間ゲームパッド入力と外乱を一定に保つ
+typedef struct
+{
+    float duration_s;
+    int lx, ly, rx, ry;       // スティック (-32768〜32767)
+    float disturbance_yaw_nm; // 機体にかかるヨーモーメントの外乱 [Nm]
+    float disturbance_sway_n; // 横方向の外乱 [N] (潮流など)
+} ScenarioSegment;
+
+typedef struct
+{
+    char name[SIM_NAME_LEN];
+    int segment_count;
+    ScenarioSegment segments[SIM_MAX_SEGMENTS];
+} Scenario;
+
+// 1回の実行の評価指標
+typedef struct
+{
+    float yaw_overshoot_pct;    // 旋回操作中のヨーレートの行き過ぎ量 (定常値比 %、区間の最大)
+    float yaw_settling_s;       // 旋回をやめてから |ヨーレート| が帯に収まるまでの時間 (区間の最大、収まらない場合は -1)
+    float heading_drift_deg;    // 旋回操作をしていない区間の、整定後の方位の変化 (区間の最大)
+    float max_roll_deg;         // ロール角の最大値
+    float pwm_effort;           // 平均出力 (停止出力からの PWM の差の合計 / (PWM_BOOST_MAX - PWM_MIN))
+    float pwm_activity_us_per_s; // PWM の変化量の合計 / 時間 (出力のばたつき)
+    float ahrs_heading_error_deg; // 姿勢推定の方位と真値の差の最大値
+    float final_heading_deg;
+    float distance_m;           // 終了時の水平移動距離
+    double realtime_factor;     // シミュレーション時間 / 計算にかかった時間
+} ScenarioMetrics;
+
+// --set / --sweep で変更できる設定値
+typedef struct
+{
+    const char *name;
+    float *value;
+} Tunable;
+
+static const Tunable TUNABLES[] = {
+    {"kp_roll", &g_config.kp_roll},
+    {"ki_roll", &g_config.ki_roll},
+    {"kd_roll", &g_config.kd_roll},
+    {"kp_yaw", &g_config.kp_yaw},
+    {"yaw_gain", &g_config.yaw_gain},
+    {"ki_yaw", &g_config.ki_yaw},
+    {"kd_yaw", &g_config.kd_yaw},
+    {"yaw_threshold_dps", &g_config.yaw_threshold_dps},
+    {"d_filter_tau_s", &g_config.d_filter_tau_s},
+    {"stabilization_limit_n", &g_config.stabilization_limit_n},
+    {"smoothing_tau_horizontal_s", &g_config.smoothing_tau_horizontal_s},
+    {"smoothing_tau_vertical_s", &g_config.smoothing_tau_vertical_s},
+    {"slew_rate_pwm_per_s", &g_config.slew_rate_pwm_per_s},
+    {"gain_surge", &g_config.alloc_gain_surge},
+    {"gain_sway", &g_config.alloc_gain_sway},
+    {"gain_yaw", &g_config.alloc_gain_yaw},
+    {"motor_tau_s", &g_config.sim_motor_tau_s},
+    {"bg_m", &g_config.sim_bg_m},
+};
+
+typedef struct
+{
+    const Tunable *tunable;
+    float start, stop, step;
+} Sweep;
+
+// --- 組み込みの台本 ---
+static const int FULL = 32767;
+
+static const ScenarioSegment YAW_STEP[] = {
+    {1.0f, 0, 0, 0, 0, 0.0f, 0.0f},
+    {4.0f, FULL, 0, 0, 0, 0.0f, 0.0f}, // 右旋回
+    {6.0f, 0, 0, 0, 0, 0.0f, 0.0f},    // 停止してヨー保持
+};
+static const ScenarioSegment SURGE_HOLD[] = {
+    {1.0f, 0, 0, 0, 0, 0.0f, 0.0f},
+    {10.0f, 0, 0, 0, FULL, 0.5f, 0.0f}, // 前進中にヨーの外乱
+    {4.0f, 0, 0, 0, 0, 0.0f, 0.0f},
+};
+static const ScenarioSegment SWAY_HOLD[] = {
+    {1.0f, 0, 0, 0, 0, 0.0f, 0.0f},
+    {8.0f, 0, 0, FULL, 0, 0.0f, 0.0f}, // 右へ平行移動
+    {4.0f, 0, 0, 0, 0, 0.0f, 0.0f},
+};
+static const ScenarioSegment DISTURBANCE[] = {
+    {2.0f, 0, 0, 0, 0, 0.0f, 0.0f},
+    {4.0f, 0, 0, 0, 0, 1.0f, 5.0f}, // 静止中にヨーと横方向の外乱
+    {6.0f, 0, 0, 0, 0, 0.0f, 0.0f},
+};
+
+typedef struct
+{
+    const char *name;
+    const ScenarioSegment *segments;
+    int count;
+} BuiltinScenario;
+
+static const BuiltinScenario BUILTIN_SCENARIOS[] = {
+    {"yaw_step", YAW_STEP, static_cast<int>(sizeof(YAW_STEP) / sizeof(YAW_STEP[0]))},
+    {"surge_hold", SURGE_HOLD, static_cast<int>(sizeof(SURGE_HOLD) / sizeof(SURGE_HOLD[0]))},
+    {"sway_hold", SWAY_HOLD, static_cast<int>(sizeof(SWAY_HOLD) / sizeof(SWAY_HOLD[0]))},
+    {"disturbance", DISTURBANCE, static_cast<int>(sizeof(DISTURBANCE) / sizeof(DISTURBANCE[0]))},
+};
+static const int BUILTIN_COUNT = static_cast<int>(sizeof(BUILTIN_SCENARIOS) / sizeof(BUILTIN_SCENARIOS[0]));
+
+// ヘルパー関数: 組み込みの台本を名前で探す
+static bool load_builtin_scenario(Scenario *sc, const char *name)
+{
+    for (int i = 0; i < BUILTIN_COUNT; ++i)
+    {
+        if (strcmp(BUILTIN_SCENARIOS[i].name, name) != 0)
+            continue;
+        strncpy(sc->name, name, SIM_NAME_LEN - 1);
+        sc->name[SIM_NAME_LEN - 1] = '\0';
+        sc->segment_count = BUILTIN_SCENARIOS[i].count;
+        for (int s = 0; s < sc->segment_count; ++s)
+            sc->segments[s] = BUILTIN_SCENARIOS[i].segments[s];
+        return true;
+    }
+    return false;
+}
+
+// ヘルパー関数: 台本ファイルを読む。1行1区間で
+//   秒数 LX LY RX RY [ヨー外乱 Nm] [横外乱 N]
+// を空白区切りで書く ('#' 以降はコメント)
+static bool load_scenario_file(Scenario *sc, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "rov_sim: 台本 '%s' を開けません (組み込みの台本でもありません)\n", path);
+        return false;
+    }
+    const char *base = strrchr(path, '/');
+    strncpy(sc->name, base ? base + 1 : path, SIM_NAME_LEN - 1);
+    sc->name[SIM_NAME_LEN - 1] = '\0';
+    sc->segment_count = 0;
+
+    char line[256];
+    int line_num = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), fp))
+    {
+        line_num++;
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+        ScenarioSegment seg = {0.0f, 0, 0, 0, 0, 0.0f, 0.0f};
+        int n = sscanf(line, "%f %d %d %d %d %f %f", &seg.duration_s, &seg.lx, &seg.ly, &seg.rx, &seg.ry,
+                       &seg.disturbance_yaw_nm, &seg.disturbance_sway_n);
+        if (n <= 0)
+            continue; // 空行
+        if (n < 5 || seg.duration_s <= 0.0f)
+        {
+            fprintf(stderr, "rov_sim: %s の %d 行目: \"秒数 LX LY RX RY [ヨー外乱] [横外乱]\" の形式ではありません\n", path, line_num);
+            ok = false;
+            break;
+        }
+        if (sc->segment_count >= SIM_MAX_SEGMENTS)
+        {
+            fprintf(stderr, "rov_sim: %s の区間が多すぎます (最大 %d)\n", path, SIM_MAX_SEGMENTS);
+            ok = false;
+            break;
+        }
+        sc->segments[sc->segment_count++] = seg;
+    }
+    fclose(fp);
+    if (ok && sc->segment_count == 0)
+    {
+        fprintf(stderr, "rov_sim: %s に区間がありません\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+// ヘルパー関数: 機体側の推力曲線を読み込む (thruster_control.cpp の load_thrust_curve と同じ解釈)
+static bool load_plant_curve(ThrustCurveLut *lut, int thruster)
+{
+    std::string profile = g_config.sim_plant_curve;
+    if (profile.empty())
+        profile = g_config.thrust_curve_overrides[thruster].empty() ? g_config.thrust_curve_profile
+                                                                   : g_config.thrust_curve_overrides[thruster];
+    if (profile == "linear")
+        return thrust_curve_build_linear(lut, g_config.pwm_min, g_config.pwm_neutral, g_config.pwm_boost_max,
+                                         g_config.thrust_curve_linear_max_n, g_config.alloc_bidirectional);
+    return thrust_curve_load_builtin(lut, profile.c_str()) || thrust_curve_load_csv(lut, profile.c_str());
+}
+
+// ヘルパー関数: 角度の差を -180〜180 に折り返す
+static float wrap_deg(float deg)
+{
+    while (deg > 180.0f)
+        deg -= 360.0f;
+    while (deg < -180.0f)
+        deg += 360.0f;
+    return deg;
+}
+
+// 制御周期ごとの記録 (評価指標の計算用)
+typedef struct
+{
+    float time_s;
+    int segment;
+    float yaw_rate_dps; // 真値
+    float yaw_deg;      // 真値 (連続になるよう折り返しを解いた値)
+} ControlSample;
+
+// ヘルパー関数: 記録から区間ごとの指標を求める
+static void compute_segment_metrics(const Scenario &sc, const std::vector<ControlSample> &samples, float settle_band_dps,
+                                    ScenarioMetrics *m)
+{
+    m->yaw_overshoot_pct = 0.0f;
+    m->yaw_settling_s = 0.0f;
+    m->heading_drift_deg = 0.0f;
+    size_t begin = 0;
+    for (int s = 0; s < sc.segment_count; ++s)
+    {
+        size_t end = begin;
+        while (end < samples.size() && samples[end].segment == s)
+            end++;
+        if (end - begin < 2)
+        {
+            begin = end;
+            continue;
+        }
+        const ScenarioSegment &seg = sc.segments[s];
+        const float start_s = samples[begin].time_s;
+        if (seg.lx != 0)
+        {
+            // 旋回操作中: 区間の最後の 20% の平均を定常値とし、同じ向きの最大値との差を行き過ぎ量とする
+            size_t tail = begin + (end - begin) * 4 / 5;
+            float steady = 0.0f;
+            for (size_t i = tail; i < end; ++i)
+                steady += samples[i].yaw_rate_dps;
+            steady /= static_cast<float>(end - tail);
+            if (fabsf(steady) > 1.0f)
+            {
+                float peak = 0.0f;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    float v = steady > 0.0f ? samples[i].yaw_rate_dps : -samples[i].yaw_rate_dps;
+                    peak = v > peak ? v : peak;
+                }
+                float overshoot = (peak - fabsf(steady)) / fabsf(steady) * 100.0f;
+                m->yaw_overshoot_pct = overshoot > m->yaw_overshoot_pct ? overshoot : m->yaw_overshoot_pct;
+            }
+        }
+        else
+        {
+            // ヨー保持中: 帯を最後に外れた時刻までを整定時間とし、それ以降の方位の変化をドリフトとする
+            size_t last_outside = end;
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (fabsf(samples[i].yaw_rate_dps) > settle_band_dps)
+                    last_outside = i;
+            }
+            size_t settled = (last_outside == end) ? begin : last_outside + 1;
+            if (settled >= end)
+            {
+                m->yaw_settling_s = -1.0f; // 区間の終わりまで収まらなかった
+                settled = begin;
+            }
+            else if (m->yaw_settling_s >= 0.0f)
+            {
+                float settling = samples[settled].time_s - start_s;
+                m->yaw_settling_s = settling > m->yaw_settling_s ? settling : m->yaw_settling_s;
+            }
+            float drift = fabsf(samples[end - 1].yaw_deg - samples[settled].yaw_deg);
+            m->heading_drift_deg = drift > m->heading_drift_deg ? drift : m->heading_drift_deg;
+        }
+        begin = end;
+    }
+}
+
+typedef struct
+{
+    float settle_band_margin_dps;
+    FILE *trace;
+    int run_index;
+} RunOptions;
+
+// 台本を1回実行して評価指標を求める
+static bool run_scenario(const Scenario &sc, const RunOptions &opt, ScenarioMetrics *m)
+{
+    if (!hal_init() || !thruster_init())
+        return false;
+    VehicleParams params;
+    vehicle_params_from_config(&params);
+    ThrustCurveLut plant[ALLOC_MAX_THRUSTERS];
+    for (int i = 0; i < params.thruster_count; ++i)
+    {
+        if (!load_plant_curve(&plant[i], i))
+        {
+            fprintf(stderr, "rov_sim: T%d の機体側推力曲線を読み込めません\n", i);
+            return false;
+        }
+    }
+    VehicleState state;
+    vehicle_reset(&state);
+    AhrsState ahrs;
+    ahrs_init(&ahrs, g_config.ahrs_kp, g_config.ahrs_ki);
+    AttitudeEstimate attitude;
+
+    // 時刻はすべて物理刻みの整数倍で扱う (浮動小数点の累積誤差で周期がずれないように)
+    const float dt_s = g_config.sim_physics_dt_s > 0.0f ? g_config.sim_physics_dt_s : 0.001f;
+    const int64_t dt_ns = static_cast<int64_t>(dt_s * 1e9f);
+    const int64_t control_period_ns = static_cast<int64_t>(g_config.loop_delay_us) * NSEC_PER_USEC;
+    const float control_dt_s = static_cast<float>(control_period_ns) / 1e9f;
+    const float rates_hz[3] = {g_config.sensor_gyro_rate_hz, g_config.sensor_accel_rate_hz, g_config.sensor_mag_rate_hz};
+    int64_t sensor_period_ns[3], next_sensor_ns[3] = {0, 0, 0};
+    for (int k = 0; k < 3; ++k)
+        sensor_period_ns[k] = rates_hz[k] > 0.0f ? static_cast<int64_t>(1e9f / rates_hz[k]) : -1;
+
+    float total_s = 0.0f;
+    for (int s = 0; s < sc.segment_count; ++s)
+        total_s += sc.segments[s].duration_s;
+    const int64_t total_ns = static_cast<int64_t>(static_cast<double>(total_s) * 1e9);
+
+    std::vector<ControlSample> samples;
+    samples.reserve(static_cast<size_t>(total_ns / (control_period_ns > 0 ? control_period_ns : 1)) + 2);
+    AxisData gyro = {0.0f, 0.0f, 0.0f}, accel = {0.0f, 0.0f, 0.0f}, mag = {0.0f, 0.0f, 0.0f};
+    bool accel_valid = false, mag_valid = false;
+    int64_t prev_gyro_ns = -1, next_control_ns = 0;
+    float thrust_command[ALLOC_MAX_THRUSTERS] = {0.0f};
+    float disturbance[WRENCH_DOF] = {0.0f};
+    float prev_pwm[ALLOC_MAX_THRUSTERS] = {0.0f};
+    double effort_sum = 0.0, activity_sum = 0.0;
+    float yaw_unwrapped = 0.0f, prev_yaw = 0.0f;
+    const float pwm_span = static_cast<float>(g_config.pwm_boost_max - g_config.pwm_min);
+    m->max_roll_deg = 0.0f;
+    m->ahrs_heading_error_deg = 0.0f;
+
+    int segment = 0;
+    int64_t segment_end_ns = static_cast<int64_t>(static_cast<double>(sc.segments[0].duration_s) * 1e9);
+    const int64_t wall_start_ns = monotonic_now_ns();
+    for (int64_t t_ns = 0; t_ns < total_ns; t_ns += dt_ns)
+    {
+        while (t_ns >= segment_end_ns && segment + 1 < sc.segment_count)
+        {
+            segment++;
+            segment_end_ns += static_cast<int64_t>(static_cast<double>(sc.segments[segment].duration_s) * 1e9);
+        }
+        const ScenarioSegment &seg = sc.segments[segment];
+
+        // --- センサー (センサー取得スレッドと同じく、デバイスごとの周期で読み、ジャイロごとに姿勢推定) ---
+        AxisData true_gyro, true_accel, true_mag;
+        vehicle_imu(&state, &true_gyro, &true_accel, &true_mag);
+        hal_sim_set_motion(true_gyro, true_accel, true_mag);
+        bool gyro_updated = false;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (sensor_period_ns[k] < 0 || t_ns < next_sensor_ns[k])
+                continue;
+            next_sensor_ns[k] += sensor_period_ns[k];
+            if (k == 0)
+            {
+                gyro = hal_read_gyro();
+                gyro_updated = true;
+            }
+            else if (k == 1)
+            {
+                accel = hal_read_accel();
+                accel_valid = true;
+            }
+            else
+            {
+                mag = hal_read_mag();
+                mag_valid = true;
+            }
+        }
+        if (gyro_updated && g_config.ahrs_enabled)
+        {
+            float gyro_dt_s = prev_gyro_ns >= 0 ? static_cast<float>(t_ns - prev_gyro_ns) / 1e9f : 0.0f;
+            prev_gyro_ns = t_ns;
+            ahrs_update(&ahrs, gyro, accel_valid ? &accel : NULL, (g_config.ahrs_use_mag && mag_valid) ? &mag : NULL, gyro_dt_s);
+        }
+
+        // --- 制御周期: main と同じく姿勢推定の補正後角速度 (未初期化なら生のジャイロ) で thruster_update ---
+        if (t_ns >= next_control_ns)
+        {
+            next_control_ns += control_period_ns;
+            GamepadData gamepad;
+            gamepad.leftThumbX = seg.lx;
+            gamepad.leftThumbY = seg.ly;
+            gamepad.rightThumbX = seg.rx;
+            gamepad.rightThumbY = seg.ry;
+            bool attitude_valid = g_config.ahrs_enabled && ahrs.initialized;
+            if (attitude_valid)
+                ahrs_get_estimate(&ahrs, &attitude);
+            thruster_update(gamepad, attitude_valid ? attitude.rate_dps : gyro, control_dt_s);
+
+            float effort = 0.0f, activity = 0.0f;
+            float pwm[ALLOC_MAX_THRUSTERS];
+            for (int i = 0; i < params.thruster_count; ++i)
+            {
+                pwm[i] = hal_sim_pwm_us(g_config.alloc_channels[i]);
+                thrust_command[i] = thrust_curve_force(&plant[i], pwm[i]);
+                effort += fabsf(pwm[i] - plant[i].zero_pwm_us);
+                if (!samples.empty())
+                    activity += fabsf(pwm[i] - prev_pwm[i]);
+                prev_pwm[i] = pwm[i];
+            }
+            effort_sum += effort / pwm_span;
+            activity_sum += activity;
+
+            float roll, pitch, yaw;
+            vehicle_euler_deg(&state, &roll, &pitch, &yaw);
+            yaw_unwrapped += samples.empty() ? yaw : wrap_deg(yaw - prev_yaw);
+            prev_yaw = yaw;
+            m->max_roll_deg = fabsf(roll) > m->max_roll_deg ? fabsf(roll) : m->max_roll_deg;
+            if (attitude_valid && g_config.ahrs_use_mag)
+            {
+                float error = fabsf(wrap_deg(attitude.heading_deg - yaw));
+                m->ahrs_heading_error_deg = error > m->ahrs_heading_error_deg ? error : m->ahrs_heading_error_deg;
+            }
+            ControlSample sample;
+            sample.time_s = static_cast<float>(t_ns) / 1e9f;
+            sample.segment = segment;
+            sample.yaw_rate_dps = true_gyro.z;
+            sample.yaw_deg = yaw_unwrapped;
+            samples.push_back(sample);
+
+            if (opt.trace)
+            {
+                fprintf(opt.trace, "%d,%s,%.3f,%d,%d,%d,%.3f,%.3f,%.3f,%.2f,%.3f,%.3f", opt.run_index, sc.name,
+                        sample.time_s, seg.lx, seg.rx, seg.ry, true_gyro.z, roll, yaw,
+                        attitude_valid ? attitude.heading_deg : 0.0f, state.position[0], state.position[1]);
+                for (int i = 0; i < params.thruster_count; ++i)
+                    fprintf(opt.trace, ",%.0f", pwm[i]);
+                fputc('\n', opt.trace);
+            }
+        }
+
+        disturbance[WRENCH_SWAY] = seg.disturbance_sway_n;
+        disturbance[WRENCH_YAW] = seg.disturbance_yaw_nm;
+        vehicle_step(&params, &state, thrust_command, disturbance, dt_s);
+    }
+    const int64_t wall_ns = monotonic_now_ns() - wall_start_ns;
+
+    compute_segment_metrics(sc, samples, g_config.yaw_threshold_dps + opt.settle_band_margin_dps, m);
+    float roll, pitch, yaw;
+    vehicle_euler_deg(&state, &roll, &pitch, &yaw);
+    const size_t ticks = samples.empty() ? 1 : samples.size();
+    m->pwm_effort = static_cast<float>(effort_sum / static_cast<double>(ticks));
+    m->pwm_activity_us_per_s = total_s > 0.0f ? static_cast<float>(activity_sum / total_s) : 0.0f;
+    m->final_heading_deg = yaw;
+    m->distance_m = sqrtf(state.position[0] * state.position[0] + state.position[1] * state.position[1]);
+    m->realtime_factor = wall_ns > 0 ? static_cast<double>(total_ns) / static_cast<double>(wall_ns) : 0.0;
+    return true;
+}
+
+// ヘルパー関数: 名前で変更可能な設定値を探す
+static const Tunable *find_tunable(const char *name, size_t length)
+{
+    for (size_t i = 0; i < sizeof(TUNABLES) / sizeof(TUNABLES[0]); ++i)
+    {
+        if (strlen(TUNABLES[i].name) == length && strncmp(TUNABLES[i].name, name, length) == 0)
+            return &TUNABLES[i];
+    }
+    return NULL;
+}
+
+static void print_usage(const char *program)
+{
+    printf("usage: %s [--scenario NAME|FILE]... [--set KEY=VALUE]... [--sweep KEY=START:STOP:STEP]...\n"
+           "          [--config FILE] [--out FILE.csv] [--trace FILE.csv] [--settle-margin DPS]\n"
+           "scenarios:", program);
+    for (int i = 0; i < BUILTIN_COUNT; ++i)
+        printf(" %s", BUILTIN_SCENARIOS[i].name);
+    printf("\nkeys:");
+    for (size_t i = 0; i < sizeof(TUNABLES) / sizeof(TUNABLES[0]); ++i)
+        printf(" %s", TUNABLES[i].name);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *config_path = "config.ini";
+    const char *out_path = NULL;
+    const char *trace_path = NULL;
+    const char *scenario_args[SIM_MAX_SCENARIOS];
+    int scenario_arg_count = 0;
+    const char *set_args[SIM_MAX_SETS];
+    int set_count = 0;
+    Sweep sweeps[SIM_MAX_SWEEPS];
+    int sweep_count = 0;
+    RunOptions opt;
+    opt.settle_band_margin_dps = SIM_DEFAULT_SETTLE_MARGIN_DPS;
+    opt.trace = NULL;
+    opt.run_index = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (!value)
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (strcmp(arg, "--scenario") == 0 && scenario_arg_count < SIM_MAX_SCENARIOS)
+            scenario_args[scenario_arg_count++] = value;
+        else if (strcmp(arg, "--set") == 0 && set_count < SIM_MAX_SETS)
+            set_args[set_count++] = value;
+        else if (strcmp(arg, "--sweep") == 0 && sweep_count < SIM_MAX_SWEEPS)
+        {
+            const char *eq = strchr(value, '=');
+            Sweep &sw = sweeps[sweep_count];
+            sw.tunable = eq ? find_tunable(value, static_cast<size_t>(eq - value)) : NULL;
+            if (!sw.tunable || sscanf(eq + 1, "%f:%f:%f", &sw.start, &sw.stop, &sw.step) != 3 || sw.step <= 0.0f ||
+                sw.stop < sw.start)
+            {
+                fprintf(stderr, "rov_sim: --sweep は KEY=開始:終了:刻み (刻み > 0) で指定してください: %s\n", value);
+                return 2;
+            }
+            sweep_count++;
+        }
+        else if (strcmp(arg, "--config") == 0)
+            config_path = value;
+        else if (strcmp(arg, "--out") == 0)
+            out_path = value;
+        else if (strcmp(arg, "--trace") == 0)
+            trace_path = value;
+        else if (strcmp(arg, "--settle-margin") == 0)
+            opt.settle_band_margin_dps = strtof(value, NULL);
+        else
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+        ++i;
+    }
+
+    // 設定を読み込み、ハードウェアは sim バックエンド (I2C 遅延なし) にする。ノイズは [HAL] の設定どおり
+    g_log_min_level = LOG_LEVEL_WARN; // 初期化時のログを抑える
+    loadConfig(config_path);
+    g_log_min_level = LOG_LEVEL_WARN;
+    g_config.hal_sim_i2c_latency_us = 0.0f;
+    g_config.hal_sim_i2c_jitter_us = 0.0f;
+    if (!hal_select("sim"))
+        return 2;
+    for (int i = 0; i < set_count; ++i)
+    {
+        const char *eq = strchr(set_args[i], '=');
+        const Tunable *t = eq ? find_tunable(set_args[i], static_cast<size_t>(eq - set_args[i])) : NULL;
+        if (!t)
+        {
+            fprintf(stderr, "rov_sim: --set の KEY が不明です: %s\n", set_args[i]);
+            return 2;
+        }
+        *t->value = strtof(eq + 1, NULL);
+    }
+
+    static Scenario scenarios[SIM_MAX_SCENARIOS];
+    int scenario_count = 0;
+    if (scenario_arg_count == 0)
+    {
+        for (int i = 0; i < BUILTIN_COUNT; ++i)
+            load_builtin_scenario(&scenarios[scenario_count++], BUILTIN_SCENARIOS[i].name);
+    }
+    for (int i = 0; i < scenario_arg_count; ++i)
+    {
+        if (!load_builtin_scenario(&scenarios[scenario_count], scenario_args[i]) &&
+            !load_scenario_file(&scenarios[scenario_count], scenario_args[i]))
+            return 2;
+        scenario_count++;
+    }
+
+    FILE *out = NULL;
+    if (out_path)
+    {
+        out = fopen(out_path, "w");
+        if (!out)
+        {
+            fprintf(stderr, "rov_sim: '%s' を書き込み用に開けません\n", out_path);
+            return 2;
+        }
+        fprintf(out, "scenario");
+        for (int k = 0; k < sweep_count; ++k)
+            fprintf(out, ",%s", sweeps[k].tunable->name);
+        fprintf(out, ",yaw_overshoot_pct,yaw_settling_s,heading_drift_deg,max_roll_deg,pwm_effort,"
+                     "pwm_activity_us_per_s,ahrs_heading_error_deg,final_heading_deg,distance_m,realtime_factor\n");
+    }
+    if (trace_path)
+    {
+        opt.trace = fopen(trace_path, "w");
+        if (!opt.trace)
+        {
+            fprintf(stderr, "rov_sim: '%s' を書き込み用に開けません\n", trace_path);
+            return 2;
+        }
+        fprintf(opt.trace, "run,scenario,time_s,lx,rx,ry,yaw_rate_dps,roll_deg,yaw_deg,ahrs_heading_deg,north_m,east_m");
+        for (int i = 0; i < g_config.alloc_thruster_count; ++i)
+            fprintf(opt.trace, ",pwm%d", i);
+        fputc('\n', opt.trace);
+    }
+
+    // --- スイープ: 全組み合わせ (各軸 start から step 刻みで stop まで) × 全台本 ---
+    int steps[SIM_MAX_SWEEPS];
+    int combinations = 1;
+    for (int k = 0; k < sweep_count; ++k)
+    {
+        steps[k] = static_cast<int>((sweeps[k].stop - sweeps[k].start) / sweeps[k].step + 1e-4f) + 1;
+        combinations *= steps[k];
+    }
+    printf("%-14s", "scenario");
+    for (int k = 0; k < sweep_count; ++k)
+        printf(" %12.12s", sweeps[k].tunable->name);
+    printf(" %9s %9s %9s %8s %7s %10s %8s\n", "overshoot", "settle_s", "drift_deg", "roll_deg", "effort", "activity", "x_rt");
+
+    int failures = 0;
+    for (int c = 0; c < combinations; ++c)
+    {
+        float values[SIM_MAX_SWEEPS];
+        int index = c;
+        for (int k = sweep_count - 1; k >= 0; --k)
+        {
+            values[k] = sweeps[k].start + sweeps[k].step * static_cast<float>(index % steps[k]);
+            index /= steps[k];
+            *sweeps[k].tunable->value = values[k];
+        }
+        for (int s = 0; s < scenario_count; ++s)
+        {
+            ScenarioMetrics m;
+            if (!run_scenario(scenarios[s], opt, &m))
+            {
+                failures++;
+                continue;
+            }
+            opt.run_index++;
+            printf("%-14s", scenarios[s].name);
+            for (int k = 0; k < sweep_count; ++k)
+                printf(" %12.4g", values[k]);
+            printf(" %8.1f%% %9.2f %9.2f %8.2f %7.3f %10.0f %8.0f\n", m.yaw_overshoot_pct, m.yaw_settling_s,
+                   m.heading_drift_deg, m.max_roll_deg, m.pwm_effort, m.pwm_activity_us_per_s, m.realtime_factor);
+            if (out)
+            {
+                fprintf(out, "%s", scenarios[s].name);
+                for (int k = 0; k < sweep_count; ++k)
+                    fprintf(out, ",%g", values[k]);
+                fprintf(out, ",%.2f,%.3f,%.3f,%.3f,%.4f,%.1f,%.2f,%.2f,%.3f,%.1f\n", m.yaw_overshoot_pct, m.yaw_settling_s,
+                        m.heading_drift_deg, m.max_roll_deg, m.pwm_effort, m.pwm_activity_us_per_s,
+                        m.ahrs_heading_error_deg, m.final_heading_deg, m.distance_m, m.realtime_factor);
+            }
+        }
+    }
+    if (out)
+        fclose(out);
+    if (opt.trace)
+        fclose(opt.trace);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+#include "ahrs.h"
+#include <math.h>   // sqrtf, atan2f, asinf
+#include <string.h> // memset
+
+#define AHRS_DEG_TO_RAD 0.017453292519943295f
+#define AHRS_RAD_TO_DEG 57.29577951308232f
+#define AHRS_ACCEL_TOLERANCE 0.2f // 加速度の大きさが重力から ±20% を超えたら補正に使わない
+
+// ヘルパー関数: ベクトルを正規化する (大きさ 0 の場合は false)
+static bool normalize3(float *x, float *y, float *z)
+{
+    float norm_sq = *x * *x + *y * *y + *z * *z;
+    if (!(norm_sq > 0.0f))
+        return false;
+    float inv = 1.0f / sqrtf(norm_sq);
+    *x *= inv;
+    *y *= inv;
+    *z *= inv;
+    return true;
+}
+
+// ヘルパー関数: 加速度 (と磁力) から姿勢を直接求めてクォータニオンを初期化する
+static void initialize_from_vectors(AhrsState *ahrs, float ax, float ay, float az, const AxisData *mag)
+{
+    float roll = atan2f(ay, az);
+    float pitch = atan2f(-ax, sqrtf(ay * ay + az * az));
+    float yaw = 0.0f;
+    if (mag)
+    {
+        float mx = mag->x, my = mag->y, mz = mag->z;
+        if (normalize3(&mx, &my, &mz))
+        {
+            // 傾きを補正した磁力の水平成分から方位を求める
+            float sr = sinf(roll), cr = cosf(roll), sp = sinf(pitch), cp = cosf(pitch);
+            float bx = mx * cp + my * sr * sp + mz * cr * sp;
+            float by = my * cr - mz * sr;
+            yaw = atan2f(-by, bx);
+        }
+    }
+    float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+    float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+    float cy = cosf(yaw * 0.5f), sy = sinf(yaw * 0.5f);
+    ahrs->q0 = cr * cp * cy + sr * sp * sy;
+    ahrs->q1 = sr * cp * cy - cr * sp * sy;
+    ahrs->q2 = cr * sp * cy + sr * cp * sy;
+    ahrs->q3 = cr * cp * sy - sr * sp * cy;
+    ahrs->initialized = true;
+}
+
+void ahrs_init(AhrsState *ahrs, float kp, float ki)
+{
+    if (!ahrs)
+        return;
+    memset(ahrs, 0, sizeof(AhrsState));
+    ahrs->q0 = 1.0f;
+    ahrs->kp = kp;
+    ahrs->ki = ki;
+}
+
+void ahrs_update(AhrsState *ahrs, const AxisData &gyro_dps, const AxisData *accel, const AxisData *mag, float dt_s)
+{
+    ahrs->updates++;
+    float gx = gyro_dps.x * AHRS_DEG_TO_RAD;
+    float gy = gyro_dps.y * AHRS_DEG_TO_RAD;
+    float gz = gyro_dps.z * AHRS_DEG_TO_RAD;
+
+    // 加速度: 重力方向の観測として使えるか判定する
+    float ax = 0.0f, ay = 0.0f, az = 0.0f;
+    bool use_accel = false;
+    if (accel)
+    {
+        ax = accel->x;
+        ay = accel->y;
+        az = accel->z;
+        float norm = sqrtf(ax * ax + ay * ay + az * az);
+        if (norm > 0.0f)
+        {
+            if (!ahrs->initialized)
+            {
+                ahrs->gravity_norm = norm;
+                normalize3(&ax, &ay, &az);
+                initialize_from_vectors(ahrs, ax, ay, az, mag);
+                ahrs->rate_x = gx;
+                ahrs->rate_y = gy;
+                ahrs->rate_z = gz;
+                return;
+            }
+            use_accel = fabsf(norm - ahrs->gravity_norm) <= AHRS_ACCEL_TOLERANCE * ahrs->gravity_norm;
+            if (use_accel)
+                normalize3(&ax, &ay, &az);
+            else
+                ahrs->accel_rejected++;
+        }
+    }
+
+    float q0 = ahrs->q0, q1 = ahrs->q1, q2 = ahrs->q2, q3 = ahrs->q3;
+    float ex = 0.0f, ey = 0.0f, ez = 0.0f; // 観測と推定の誤差 (機体座標の回転軸)
+
+    if (use_accel)
+    {
+        // 推定した重力方向 (機体座標) と測定値の外積
+        float vx = 2.0f * (q1 * q3 - q0 * q2);
+        float vy = 2.0f * (q0 * q1 + q2 * q3);
+        float vz = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+        ex += ay * vz - az * vy;
+        ey += az * vx - ax * vz;
+        ez += ax * vy - ay * vx;
+
+        float mx = 0.0f, my = 0.0f, mz = 0.0f;
+        if (mag)
+        {
+            mx = mag->x;
+            my = mag->y;
+            mz = mag->z;
+        }
+        if (mag && normalize3(&mx, &my, &mz))
+        {
+            // 磁力を基準座標に回し、水平成分を北 (x) に揃えた参照方向と比べる (伏角の影響を受けない)
+            float hx = 2.0f * (mx * (0.5f - q2 * q2 - q3 * q3) + my * (q1 * q2 - q0 * q3) + mz * (q1 * q3 + q0 * q2));
+            float hy = 2.0f * (mx * (q1 * q2 + q0 * q3) + my * (0.5f - q1 * q1 - q3 * q3) + mz * (q2 * q3 - q0 * q1));
+            float hz = 2.0f * (mx * (q1 * q3 - q0 * q2) + my * (q2 * q3 + q0 * q1) + mz * (0.5f - q1 * q1 - q2 * q2));
+            float bx = sqrtf(hx * hx + hy * hy);
+            float bz = hz;
+            float wx = 2.0f * (bx * (0.5f - q2 * q2 - q3 * q3) + bz * (q1 * q3 - q0 * q2));
+            float wy = 2.0f * (bx * (q1 * q2 - q0 * q3) + bz * (q0 * q1 + q2 * q3));
+            float wz = 2.0f * (bx * (q0 * q2 + q1 * q3) + bz * (0.5f - q1 * q1 - q2 * q2));
+            ex += my * wz - mz * wy;
+            ey += mz * wx - mx * wz;
+            ez += mx * wy - my * wx;
+        }
+
+        // 積分項 (バイアス推定) と比例項でジャイロを補正する
+        if (ahrs->ki > 0.0f)
+        {
+            ahrs->bias_x += ahrs->ki * ex * dt_s;
+            ahrs->bias_y += ahrs->ki * ey * dt_s;
+            ahrs->bias_z += ahrs->ki * ez * dt_s;
+        }
+    }
+
+    // バイアス補正後の角速度 (比例項は姿勢の補正用で、公開する角速度には含めない)
+    gx += ahrs->bias_x;
+    gy += ahrs->bias_y;
+    gz += ahrs->bias_z;
+    ahrs->rate_x = gx;
+    ahrs->rate_y = gy;
+    ahrs->rate_z = gz;
+    gx += ahrs->kp * ex;
+    gy += ahrs->kp * ey;
+    gz += ahrs->kp * ez;
+
+    // クォータニオンの積分: q' = 0.5 * q ⊗ ω
+    float half_dt = 0.5f * dt_s;
+    ahrs->q0 = q0 + (-q1 * gx - q2 * gy - q3 * gz) * half_dt;
+    ahrs->q1 = q1 + (q0 * gx + q2 * gz - q3 * gy) * half_dt;
+    ahrs->q2 = q2 + (q0 * gy - q1 * gz + q3 * gx) * half_dt;
+    ahrs->q3 = q3 + (q0 * gz + q1 * gy - q2 * gx) * half_dt;
+
+    float norm_sq = ahrs->q0 * ahrs->q0 + ahrs->q1 * ahrs->q1 + ahrs->q2 * ahrs->q2 + ahrs->q3 * ahrs->q3;
+    float inv = 1.0f / sqrtf(norm_sq);
+    ahrs->q0 *= inv;
+    ahrs->q1 *= inv;
+    ahrs->q2 *= inv;
+    ahrs->q3 *= inv;
+}
+
+void ahrs_get_estimate(const AhrsState *ahrs, AttitudeEstimate *estimate)
+{
+    if (!ahrs || !estimate)
+        return;
+    float q0 = ahrs->q0, q1 = ahrs->q1, q2 = ahrs->q2, q3 = ahrs->q3;
+    float sin_pitch = 2.0f * (q0 * q2 - q3 * q1);
+    sin_pitch = sin_pitch > 1.0f ? 1.0f : (sin_pitch < -1.0f ? -1.0f : sin_pitch);
+
+    estimate->roll_deg = atan2f(2.0f * (q0 * q1 + q2 * q3), 1.0f - 2.0f * (q1 * q1 + q2 * q2)) * AHRS_RAD_TO_DEG;
+    estimate->pitch_deg = asinf(sin_pitch) * AHRS_RAD_TO_DEG;
+    float heading = atan2f(2.0f * (q0 * q3 + q1 * q2), 1.0f - 2.0f * (q2 * q2 + q3 * q3)) * AHRS_RAD_TO_DEG;
+    estimate->heading_deg = heading < 0.0f ? heading + 360.0f : heading;
+    estimate->rate_dps.x = ahrs->rate_x * AHRS_RAD_TO_DEG;
+    estimate->rate_dps.y = ahrs->rate_y * AHRS_RAD_TO_DEG;
+    estimate->rate_dps.z = ahrs->rate_z * AHRS_RAD_TO_DEG;
+    estimate->bias_dps.x = -ahrs->bias_x * AHRS_RAD_TO_DEG;
+    estimate->bias_dps.y = -ahrs->bias_y * AHRS_RAD_TO_DEG;
+    estimate->bias_dps.z = -ahrs->bias_z * AHRS_RAD_TO_DEG;
+}
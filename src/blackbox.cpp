@@ -0,0 +1,194 @@
+#include "blackbox.h"
+#include "thruster_control.h"  // thruster_get_output_state
+#include "config.h"            // g_config (制御周期・チャンネル)
+#include "latency_histogram.h" // LAT_STAGE_BLACKBOX
+#include "time_utils.h"        // monotonic_now_ns
+#include "logger.h"            // LOG_*
+#include <stdio.h>             // rename, snprintf
+#include <string.h>            // memset, memcpy, strerror
+#include <errno.h>
+#include <fcntl.h>             // open, posix_fallocate
+#include <unistd.h>            // ftruncate, close
+#include <sys/mman.h>          // mmap, msync, munmap
+
+// --- 書き込み側の状態 (制御スレッドだけが触る) ---
+static BlackboxHeader *header = NULL;
+static BlackboxRecord *records = NULL;
+static size_t mapped_size = 0;
+static uint32_t capacity = 0;
+static uint64_t next_sequence = 1;
+static BlackboxStats stats;
+
+bool blackbox_open(const char *path, uint32_t record_capacity)
+{
+    if (records)
+        blackbox_close();
+    if (record_capacity == 0)
+    {
+        LOG_ERROR("[BLACKBOX] レコード数が 0 です。");
+        return false;
+    }
+
+    // 前回の記録 (異常終了の調査対象) を上書きしないよう退避する
+    char previous_path[512];
+    snprintf(previous_path, sizeof(previous_path), "%s.prev", path);
+    if (rename(path, previous_path) == 0)
+        LOG_INFO("[BLACKBOX] 前回の記録を '%s' に退避しました。", previous_path);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        LOG_ERROR("[BLACKBOX] '%s' を作成できません: %s", path, strerror(errno));
+        return false;
+    }
+    size_t size = BLACKBOX_HEADER_SIZE + static_cast<size_t>(record_capacity) * sizeof(BlackboxRecord);
+    // ブロックを先に確保しておく (書き込み中の容量不足で SIGBUS にならないように)
+    int err = posix_fallocate(fd, 0, static_cast<off_t>(size));
+    if (err != 0)
+    {
+        LOG_ERROR("[BLACKBOX] '%s' に %zu バイトを確保できません: %s", path, size, strerror(err));
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // マッピングはファイルディスクリプタを閉じても有効
+    if (map == MAP_FAILED)
+    {
+        LOG_ERROR("[BLACKBOX] mmap に失敗しました: %s", strerror(errno));
+        return false;
+    }
+
+    // 全ページに触れてプリフォールトし、全スロットを未使用 (sequence = 0) にする
+    memset(map, 0, size);
+    header = static_cast<BlackboxHeader *>(map);
+    records = reinterpret_cast<BlackboxRecord *>(static_cast<char *>(map) + BLACKBOX_HEADER_SIZE);
+    mapped_size = size;
+    capacity = record_capacity;
+    next_sequence = 1;
+    memset(&stats, 0, sizeof(stats));
+    stats.capacity = capacity;
+
+    struct timespec realtime;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    memcpy(header->magic, BLACKBOX_MAGIC, sizeof(BLACKBOX_MAGIC));
+    header->version = BLACKBOX_VERSION;
+    header->header_size = BLACKBOX_HEADER_SIZE;
+    header->record_size = sizeof(BlackboxRecord);
+    header->capacity = capacity;
+    header->start_monotonic_ns = monotonic_now_ns();
+    header->start_realtime_ns = timespec_to_ns(realtime);
+    header->next_sequence = next_sequence;
+    header->loop_delay_us = g_config.loop_delay_us;
+    header->thruster_count = static_cast<uint32_t>(g_config.alloc_thruster_count);
+    for (int i = 0; i < BLACKBOX_MAX_THRUSTERS; ++i)
+        header->thruster_channels[i] = i < g_config.alloc_thruster_count ? g_config.alloc_channels[i] : -1;
+    msync(map, BLACKBOX_HEADER_SIZE, MS_SYNC); // ヘッダーだけは確実に書き出しておく
+
+    LOG_INFO("[BLACKBOX] '%s' に %u レコード (%.1f MB、制御周期で約 %.0f 秒分) を記録します。", path, capacity,
+             size / 1048576.0, capacity * (g_config.loop_delay_us / 1e6));
+    return true;
+}
+
+void blackbox_record_tick(BlackboxEvent event, const GamepadData &gamepad, const SensorSnapshot *snapshot,
+                          const AxisData &control_rate_dps, float dt_s)
+{
+    if (!records)
+        return;
+    const int64_t start_ns = monotonic_now_ns();
+
+    // スタック上で組み立ててからコピーする (mmap 領域への書き込みを最小限にする)
+    BlackboxRecord r;
+    memset(&r, 0, sizeof(r));
+    r.time_ns = start_ns;
+    r.stick[0] = static_cast<int16_t>(gamepad.leftThumbX);
+    r.stick[1] = static_cast<int16_t>(gamepad.leftThumbY);
+    r.stick[2] = static_cast<int16_t>(gamepad.rightThumbX);
+    r.stick[3] = static_cast<int16_t>(gamepad.rightThumbY);
+    r.trigger[0] = static_cast<uint16_t>(gamepad.LT);
+    r.trigger[1] = static_cast<uint16_t>(gamepad.RT);
+    r.buttons = gamepad.buttons;
+    r.gamepad_flags = gamepad.flags;
+    r.event = static_cast<uint8_t>(event);
+    r.gamepad_sequence = gamepad.sequence;
+    r.dt_s = dt_s;
+    if (snapshot)
+    {
+        const SensorReadings &s = snapshot->readings;
+        r.temperature = s.temperature;
+        r.pressure = s.pressure;
+        for (int i = 0; i < 4; ++i)
+            r.adc[i] = s.adc[i];
+        const AxisData *vectors[3] = {&s.accel, &s.gyro, &s.mag};
+        float *targets[3] = {r.accel, r.gyro, r.mag};
+        for (int v = 0; v < 3; ++v)
+        {
+            targets[v][0] = vectors[v]->x;
+            targets[v][1] = vectors[v]->y;
+            targets[v][2] = vectors[v]->z;
+        }
+        r.leak = s.leak ? 1 : 0;
+        r.attitude_valid = snapshot->attitude_valid ? 1 : 0;
+        if (snapshot->attitude_valid)
+        {
+            r.roll_deg = snapshot->attitude.roll_deg;
+            r.pitch_deg = snapshot->attitude.pitch_deg;
+            r.heading_deg = snapshot->attitude.heading_deg;
+        }
+        r.snapshot_count = snapshot->publish_count;
+    }
+    r.control_rate_dps[0] = control_rate_dps.x;
+    r.control_rate_dps[1] = control_rate_dps.y;
+    r.control_rate_dps[2] = control_rate_dps.z;
+
+    ThrusterOutputState output;
+    thruster_get_output_state(&output);
+    int count = output.thruster_count < BLACKBOX_MAX_THRUSTERS ? output.thruster_count : BLACKBOX_MAX_THRUSTERS;
+    r.thruster_count = static_cast<uint8_t>(count);
+    r.saturated = output.saturated ? 1 : 0;
+    for (int i = 0; i < count; ++i)
+    {
+        r.target_pwm[i] = output.target_pwm[i];
+        r.smoothed_pwm[i] = static_cast<uint16_t>(output.smoothed_pwm[i]);
+    }
+
+    // sequence を 0 にしてから本体を書き、最後に番号を入れる (途中で止まったレコードを区別するため)
+    BlackboxRecord *slot = &records[(next_sequence - 1) % capacity];
+    __atomic_store_n(&slot->sequence, 0ULL, __ATOMIC_RELEASE);
+    memcpy(reinterpret_cast<char *>(slot) + sizeof(r.sequence), reinterpret_cast<const char *>(&r) + sizeof(r.sequence),
+           sizeof(r) - sizeof(r.sequence));
+    __atomic_store_n(&slot->sequence, static_cast<unsigned long long>(next_sequence), __ATOMIC_RELEASE);
+    next_sequence++;
+    __atomic_store_n(&header->next_sequence, static_cast<unsigned long long>(next_sequence), __ATOMIC_RELEASE);
+
+    stats.records++;
+    int64_t elapsed_ns = monotonic_now_ns() - start_ns;
+    if (elapsed_ns > stats.max_record_ns)
+        stats.max_record_ns = elapsed_ns;
+    if (g_latency_profiling_enabled)
+        latency_record(LAT_STAGE_BLACKBOX, elapsed_ns);
+}
+
+void blackbox_close()
+{
+    if (!records)
+        return;
+    void *map = header;
+    msync(map, mapped_size, MS_SYNC);
+    munmap(map, mapped_size);
+    header = NULL;
+    records = NULL;
+    mapped_size = 0;
+}
+
+void blackbox_get_stats(BlackboxStats *out)
+{
+    *out = stats;
+}
+
+void blackbox_print_stats()
+{
+    if (stats.capacity == 0)
+        return;
+    LOG_INFO("[BLACKBOX STATS] records=%llu capacity=%u wrapped=%s max_write=%.1fus", stats.records, stats.capacity,
+             stats.records > stats.capacity ? "yes" : "no", stats.max_record_ns / 1000.0);
+}
@@ -0,0 +1,215 @@
+#include "clock_sync.h"
+#include "byte_order.h" // リトルエンディアン読み書きと CRC
+#include "config.h"     // g_config
+#include "time_utils.h" // timespec_to_ns, NSEC_PER_USEC, NSEC_PER_MSEC
+#include "logger.h"     // LOG_INFO
+#include <string.h>     // memset, memcpy
+#include <time.h>       // clock_gettime
+#include <algorithm>    // std::nth_element
+
+// ヘルパー関数: 機体の CLOCK_REALTIME (マイクロ秒)
+static int64_t realtime_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return timespec_to_ns(ts) / NSEC_PER_USEC;
+}
+
+// ヘルパー関数: サンプル列の指定パーセンタイルを求める (元のバッファは変更しない)
+static int64_t percentile(const int64_t *samples, unsigned int count, unsigned int pct)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    int64_t work[CLOCK_SYNC_LATENCY_WINDOW];
+    memcpy(work, samples, count * sizeof(int64_t));
+    unsigned int rank = (count * pct) / 100;
+    if (rank >= count)
+    {
+        rank = count - 1;
+    }
+    std::nth_element(work, work + rank, work + count);
+    return work[rank];
+}
+
+// ヘルパー関数: 1回分の交換結果を追加し、RTT が最小の交換のオフセットを採用する
+static void add_sample(ClockSync *sync, int64_t offset_us, int64_t rtt_us)
+{
+    sync->sample_offset_us[sync->sample_index] = offset_us;
+    sync->sample_rtt_us[sync->sample_index] = rtt_us;
+    sync->sample_index = (sync->sample_index + 1) % CLOCK_SYNC_SAMPLES;
+    if (sync->sample_count < CLOCK_SYNC_SAMPLES)
+    {
+        sync->sample_count++;
+    }
+
+    unsigned int best = 0;
+    for (unsigned int i = 1; i < sync->sample_count; ++i)
+    {
+        if (sync->sample_rtt_us[i] < sync->sample_rtt_us[best])
+            best = i;
+    }
+    if (!sync->synced)
+    {
+        LOG_INFO("[CLOCK SYNC] 地上局との時刻同期を開始しました (offset=%lld us, rtt=%lld us)。",
+                 static_cast<long long>(offset_us), static_cast<long long>(rtt_us));
+    }
+    sync->synced = true;
+    sync->offset_us = sync->sample_offset_us[best];
+    sync->rtt_us = sync->sample_rtt_us[best];
+    sync->last_rtt_us = rtt_us;
+}
+
+void clock_sync_init(ClockSync *sync, NetworkContext *net)
+{
+    if (!sync)
+        return;
+
+    memset(sync, 0, sizeof(ClockSync));
+    sync->net = net;
+    sync->next_sequence = 1;
+}
+
+size_t clock_sync_encode_packet(uint8_t type, uint32_t sequence, uint64_t t1_us, uint64_t t2_us, uint64_t t3_us,
+                                char *buffer, size_t buffer_size)
+{
+    if (!buffer || buffer_size < CLOCK_SYNC_PACKET_SIZE)
+        return 0;
+
+    unsigned char *p = reinterpret_cast<unsigned char *>(buffer);
+    p[0] = CLOCK_SYNC_MAGIC0;
+    p[1] = CLOCK_SYNC_MAGIC1;
+    p[2] = CLOCK_SYNC_PACKET_VERSION;
+    p[3] = type;
+    write_le32(p + 4, sequence);
+    write_le64(p + 8, t1_us);
+    write_le64(p + 16, t2_us);
+    write_le64(p + 24, t3_us);
+    write_le16(p + 32, crc16_ccitt(p, 32));
+    return CLOCK_SYNC_PACKET_SIZE;
+}
+
+bool clock_sync_packet_handler(ClockSync *sync, const char *data, size_t len, int64_t rx_realtime_ns)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    if (!sync || len < 2 || p[0] != CLOCK_SYNC_MAGIC0 || p[1] != CLOCK_SYNC_MAGIC1)
+        return false; // 時刻同期パケットではない (ゲームパッドの検証へ回す)
+
+    if (len != CLOCK_SYNC_PACKET_SIZE || p[2] != CLOCK_SYNC_PACKET_VERSION || read_le16(p + 32) != crc16_ccitt(p, 32))
+    {
+        sync->bad_packets++;
+        return true;
+    }
+    const uint8_t type = p[3];
+    const uint32_t sequence = read_le32(p + 4);
+    const int64_t t1_us = static_cast<int64_t>(read_le64(p + 8));
+    const int64_t rx_us = rx_realtime_ns / NSEC_PER_USEC;
+
+    if (type == CLOCK_SYNC_REQUEST)
+    {
+        // 地上局からの要求: 受信時刻と送信時刻を入れて送信ポートへ返す
+        char reply[CLOCK_SYNC_PACKET_SIZE];
+        clock_sync_encode_packet(CLOCK_SYNC_RESPONSE, sequence, static_cast<uint64_t>(t1_us), static_cast<uint64_t>(rx_us),
+                                 static_cast<uint64_t>(realtime_now_us()), reply, sizeof(reply));
+        if (network_send(sync->net, reply, sizeof(reply)))
+            sync->replies_sent++;
+        return true;
+    }
+    if (type != CLOCK_SYNC_RESPONSE)
+    {
+        sync->bad_packets++;
+        return true;
+    }
+
+    // 自分の最新の要求への応答だけを使う (重複・遅れて届いた応答は RTT が不正確)
+    if (sync->pending_t1_us == 0 || sequence != sync->pending_sequence || t1_us != sync->pending_t1_us)
+    {
+        sync->stale_responses++;
+        return true;
+    }
+    sync->pending_t1_us = 0;
+    const int64_t t2_us = static_cast<int64_t>(read_le64(p + 16));
+    const int64_t t3_us = static_cast<int64_t>(read_le64(p + 24));
+    const int64_t t4_us = rx_us;
+    int64_t rtt_us = (t4_us - t1_us) - (t3_us - t2_us);
+    if (rtt_us < 0)
+        rtt_us = 0; // 地上局の処理時間の丸めなど
+    int64_t offset_us = ((t2_us - t1_us) + (t3_us - t4_us)) / 2;
+    sync->responses++;
+    add_sample(sync, offset_us, rtt_us);
+    return true;
+}
+
+void clock_sync_poll(ClockSync *sync, int64_t now_ns)
+{
+    if (!sync || !g_config.clock_sync_enabled || !sync->net || !sync->net->client_addr_known)
+        return;
+    if (now_ns < sync->next_request_ns)
+        return;
+
+    sync->next_request_ns = now_ns + static_cast<int64_t>(g_config.clock_sync_interval_ms) * NSEC_PER_MSEC;
+    char request[CLOCK_SYNC_PACKET_SIZE];
+    int64_t t1_us = realtime_now_us();
+    clock_sync_encode_packet(CLOCK_SYNC_REQUEST, sync->next_sequence, static_cast<uint64_t>(t1_us), 0, 0,
+                             request, sizeof(request));
+    if (network_send(sync->net, request, sizeof(request)))
+    {
+        // 応答のない要求は次の要求で置き換える (応答待ちは常に1つ)
+        sync->pending_sequence = sync->next_sequence;
+        sync->pending_t1_us = t1_us;
+        sync->requests_sent++;
+    }
+    sync->next_sequence++;
+}
+
+void clock_sync_record_command(ClockSync *sync, const GamepadData &command, int64_t applied_realtime_ns)
+{
+    if (!sync)
+        return;
+    if (!sync->synced || !command.has_sequence || command.sender_time_us == 0)
+    {
+        sync->commands_untimed++;
+        return;
+    }
+
+    // 送信時刻を機体の時計に直して、PWM 書き込み完了までの時間を求める
+    int64_t sent_vehicle_ns = (static_cast<int64_t>(command.sender_time_us) - sync->offset_us) * NSEC_PER_USEC;
+    int64_t latency_ns = applied_realtime_ns - sent_vehicle_ns;
+    sync->latency_ns[sync->latency_index] = latency_ns;
+    sync->latency_index = (sync->latency_index + 1) % CLOCK_SYNC_LATENCY_WINDOW;
+    if (sync->latency_count < CLOCK_SYNC_LATENCY_WINDOW)
+    {
+        sync->latency_count++;
+    }
+    if (latency_ns > sync->latency_max_ns)
+        sync->latency_max_ns = latency_ns;
+    sync->commands_timed++;
+}
+
+bool clock_sync_latency_percentiles(const ClockSync *sync, float *p50_ms, float *p99_ms)
+{
+    if (!sync || sync->latency_count == 0)
+        return false;
+
+    *p50_ms = static_cast<float>(percentile(sync->latency_ns, sync->latency_count, 50)) / NSEC_PER_MSEC;
+    *p99_ms = static_cast<float>(percentile(sync->latency_ns, sync->latency_count, 99)) / NSEC_PER_MSEC;
+    return true;
+}
+
+void clock_sync_print_stats(const ClockSync *sync)
+{
+    if (!sync)
+        return;
+
+    float p50_ms = 0.0f, p99_ms = 0.0f;
+    clock_sync_latency_percentiles(sync, &p50_ms, &p99_ms);
+    LOG_INFO("[CLOCK SYNC] synced=%s offset=%lldus rtt(best/last)=%lld/%lldus requests=%llu responses=%llu stale=%llu "
+             "replies=%llu bad=%llu",
+             sync->synced ? "yes" : "no", static_cast<long long>(sync->offset_us), static_cast<long long>(sync->rtt_us),
+             static_cast<long long>(sync->last_rtt_us), sync->requests_sent, sync->responses, sync->stale_responses,
+             sync->replies_sent, sync->bad_packets);
+    LOG_INFO("[CLOCK SYNC] command one-way latency (sender -> PWM) p50=%.2fms p99=%.2fms max=%.2fms timed=%llu untimed=%llu",
+             p50_ms, p99_ms, static_cast<double>(sync->latency_max_ns) / NSEC_PER_MSEC, sync->commands_timed,
+             sync->commands_untimed);
+}
@@ -0,0 +1,241 @@
+#include "command_hold.h"
+#include "config.h"     // g_config
+#include "time_utils.h" // NSEC_PER_MSEC, NSEC_PER_SEC
+#include "logger.h"     // LOG_INFO, LOG_WARN
+#include <string.h>     // memset
+#include <math.h>       // sqrt, cos, lround
+#include <stdlib.h>     // abs
+
+#define COMMAND_HOLD_MIN_SAMPLES 8         // これだけの間隔が集まるまでは HOLD_MIN_MS を使う
+#define COMMAND_HOLD_INTERVAL_ALPHA 0.0625 // 到着間隔の指数移動平均の係数 (約16パケット)
+#define COMMAND_HOLD_BURST_ALPHA 0.125     // 連続欠落数の指数移動平均の係数 (約8回の欠落)
+#define COMMAND_HOLD_GAP_FACTOR 1.5        // 平均間隔のこの倍を超えたら欠落とみなす
+
+static const char *const DECAY_CURVE_NAMES[COMMAND_DECAY_CURVE_COUNT] = {"linear", "cosine", "quadratic"};
+
+// ヘルパー関数: 統計が揃っているか
+static bool stats_ready(const CommandHold *hold)
+{
+    return hold->interval_samples >= COMMAND_HOLD_MIN_SAMPLES && hold->mean_interval_ns > 0.0;
+}
+
+// ヘルパー関数: この時間を超えて次のコマンドが届かなければ欠落とみなす
+static int64_t gap_threshold_ns(const CommandHold *hold)
+{
+    if (!stats_ready(hold))
+        return hold->hold_window_ns;
+    double by_ratio = hold->mean_interval_ns * COMMAND_HOLD_GAP_FACTOR;
+    double by_jitter = hold->mean_interval_ns + 3.0 * sqrt(hold->var_interval_ns2);
+    return static_cast<int64_t>(by_ratio > by_jitter ? by_ratio : by_jitter);
+}
+
+// ヘルパー関数: 到着間隔の統計から保持時間を求め直す
+static void update_window(CommandHold *hold)
+{
+    int64_t min_ns = static_cast<int64_t>(g_config.command_hold_min_ms) * NSEC_PER_MSEC;
+    if (!stats_ready(hold))
+    {
+        hold->hold_window_ns = min_ns < hold->hold_max_ns ? min_ns : hold->hold_max_ns;
+        return;
+    }
+    // 少なくとも1パケットの欠落は保持のまま乗り切る
+    double burst = hold->burst_len_avg > 1.0 ? hold->burst_len_avg : 1.0;
+    double window = hold->mean_interval_ns * (1.0 + burst) + g_config.command_hold_jitter_k * sqrt(hold->var_interval_ns2);
+    int64_t window_ns = static_cast<int64_t>(window);
+    int64_t threshold_ns = gap_threshold_ns(hold);
+    if (window_ns < threshold_ns)
+        window_ns = threshold_ns;
+    if (window_ns < min_ns)
+        window_ns = min_ns;
+    if (window_ns > hold->hold_max_ns)
+        window_ns = hold->hold_max_ns;
+    hold->hold_window_ns = window_ns;
+
+    if (hold->min_window_ns == 0 || window_ns < hold->min_window_ns)
+        hold->min_window_ns = window_ns;
+    if (window_ns > hold->max_window_ns)
+        hold->max_window_ns = window_ns;
+}
+
+// ヘルパー関数: 減衰曲線 (t: 0〜1) の倍率
+static float decay_scale(float t)
+{
+    if (t <= 0.0f)
+        return 1.0f;
+    if (t >= 1.0f)
+        return 0.0f;
+    switch (g_config.command_hold_decay_curve)
+    {
+    case COMMAND_DECAY_COSINE:
+        return 0.5f * (1.0f + static_cast<float>(cos(M_PI * t)));
+    case COMMAND_DECAY_QUADRATIC:
+        return (1.0f - t) * (1.0f - t);
+    default:
+        return 1.0f - t;
+    }
+}
+
+// ヘルパー関数: スティック値のデッドゾーンの外側の量に倍率を掛ける (倍率 0 でデッドゾーンの境界 = 出力 0)
+static int scale_stick(int value, float scale)
+{
+    const int deadzone = g_config.joystick_deadzone;
+    const int magnitude = abs(value);
+    if (magnitude <= deadzone)
+        return value;
+    int scaled = deadzone + static_cast<int>(lround((magnitude - deadzone) * scale));
+    return value < 0 ? -scaled : scaled;
+}
+
+void command_hold_init(CommandHold *hold)
+{
+    if (!hold)
+        return;
+
+    memset(hold, 0, sizeof(CommandHold));
+    hold->decay_ns = static_cast<int64_t>(g_config.command_hold_decay_ms) * NSEC_PER_MSEC;
+    hold->hold_max_ns = static_cast<int64_t>(g_config.command_hold_max_ms) * NSEC_PER_MSEC;
+    // 保持 + 減衰が接続タイムアウトに収まるように制限する (タイムアウト時点で出力は必ず 0)
+    int64_t timeout_ns = static_cast<int64_t>(g_config.connection_timeout_seconds * NSEC_PER_SEC);
+    int64_t limit_ns = timeout_ns - hold->decay_ns;
+    if (limit_ns < 0)
+    {
+        hold->decay_ns = timeout_ns;
+        limit_ns = 0;
+    }
+    if (hold->hold_max_ns > limit_ns)
+    {
+        LOG_WARN("[COMMAND_HOLD] HOLD_MAX_MS を %lld ms に制限します (CONNECTION_TIMEOUT_SECONDS - DECAY_MS)。",
+                 static_cast<long long>(limit_ns / NSEC_PER_MSEC));
+        hold->hold_max_ns = limit_ns;
+    }
+    hold->phase = COMMAND_HOLD_FRESH;
+    hold->scale = 1.0f;
+    update_window(hold);
+
+    int curve = g_config.command_hold_decay_curve;
+    LOG_INFO("コマンド保持: %s 保持 %u〜%lld ms (JITTER_K=%.1f) 減衰 %lld ms (%s)",
+             g_config.command_hold_enabled ? "有効" : "無効 (統計のみ)", g_config.command_hold_min_ms,
+             static_cast<long long>(hold->hold_max_ns / NSEC_PER_MSEC), g_config.command_hold_jitter_k,
+             static_cast<long long>(hold->decay_ns / NSEC_PER_MSEC),
+             DECAY_CURVE_NAMES[curve >= 0 && curve < COMMAND_DECAY_CURVE_COUNT ? curve : 0]);
+}
+
+void command_hold_command_received(CommandHold *hold, int64_t now_ns)
+{
+    if (!hold)
+        return;
+
+    int64_t interval_ns = hold->last_command_ns != 0 ? now_ns - hold->last_command_ns : 0;
+    hold->last_command_ns = now_ns;
+    hold->phase = COMMAND_HOLD_FRESH;
+    hold->scale = 1.0f;
+    if (interval_ns <= 0)
+        return;
+
+    if (stats_ready(hold) && interval_ns > gap_threshold_ns(hold))
+    {
+        // 欠落: 到着間隔から連続欠落数を推定する (平均の統計には含めない)
+        long lost = lround(interval_ns / hold->mean_interval_ns) - 1;
+        if (lost < 1)
+            lost = 1;
+        hold->bursts++;
+        hold->lost_packets += static_cast<unsigned long long>(lost);
+        if (static_cast<unsigned long long>(lost) > hold->max_burst)
+            hold->max_burst = static_cast<unsigned long long>(lost);
+        hold->burst_len_avg += COMMAND_HOLD_BURST_ALPHA * (lost - hold->burst_len_avg);
+        if (interval_ns > hold->max_gap_ns)
+            hold->max_gap_ns = interval_ns;
+        if (interval_ns <= hold->hold_window_ns)
+            hold->recovered_holding++;
+        else if (interval_ns <= hold->hold_window_ns + hold->decay_ns)
+            hold->recovered_decaying++;
+    }
+    else if (hold->interval_samples == 0)
+    {
+        hold->mean_interval_ns = static_cast<double>(interval_ns);
+        hold->interval_samples = 1;
+    }
+    else
+    {
+        // 欠落のない間隔で平均とばらつきを更新する (指数移動平均・分散)
+        double delta = static_cast<double>(interval_ns) - hold->mean_interval_ns;
+        hold->mean_interval_ns += COMMAND_HOLD_INTERVAL_ALPHA * delta;
+        hold->var_interval_ns2 = (1.0 - COMMAND_HOLD_INTERVAL_ALPHA) *
+                                 (hold->var_interval_ns2 + COMMAND_HOLD_INTERVAL_ALPHA * delta * delta);
+        hold->interval_samples++;
+    }
+    update_window(hold);
+}
+
+float command_hold_apply(CommandHold *hold, int64_t now_ns, const GamepadData &command, GamepadData *output)
+{
+    *output = command;
+    if (!hold || hold->last_command_ns == 0)
+        return 1.0f;
+
+    int64_t age_ns = now_ns - hold->last_command_ns;
+    CommandHoldPhase phase;
+    float scale = 1.0f;
+    if (age_ns <= gap_threshold_ns(hold))
+    {
+        phase = COMMAND_HOLD_FRESH;
+    }
+    else if (age_ns <= hold->hold_window_ns)
+    {
+        phase = COMMAND_HOLD_HOLDING;
+    }
+    else if (age_ns < hold->hold_window_ns + hold->decay_ns)
+    {
+        phase = COMMAND_HOLD_DECAYING;
+        scale = decay_scale(static_cast<float>(age_ns - hold->hold_window_ns) / static_cast<float>(hold->decay_ns));
+    }
+    else
+    {
+        phase = COMMAND_HOLD_EXPIRED;
+        scale = 0.0f;
+        if (hold->phase != COMMAND_HOLD_EXPIRED)
+            hold->expired++;
+    }
+    hold->phase = phase;
+    hold->phase_ticks[phase]++;
+
+    if (!g_config.command_hold_enabled)
+        scale = 1.0f; // 従来どおり接続タイムアウトまで最後のコマンドを使う
+    hold->scale = scale;
+    if (scale < 1.0f)
+    {
+        output->leftThumbX = scale_stick(command.leftThumbX, scale);
+        output->leftThumbY = scale_stick(command.leftThumbY, scale);
+        output->rightThumbX = scale_stick(command.rightThumbX, scale);
+        output->rightThumbY = scale_stick(command.rightThumbY, scale);
+        output->LT = static_cast<int>(lround(command.LT * scale));
+        output->RT = static_cast<int>(lround(command.RT * scale));
+    }
+    return scale;
+}
+
+void command_hold_link_lost(CommandHold *hold)
+{
+    if (!hold)
+        return;
+
+    hold->last_command_ns = 0;
+    hold->phase = COMMAND_HOLD_FRESH;
+    hold->scale = 1.0f;
+}
+
+void command_hold_print_stats(const CommandHold *hold)
+{
+    if (!hold)
+        return;
+
+    double period_ms = g_config.loop_delay_us / 1000.0;
+    LOG_INFO("[COMMAND HOLD STATS] interval(mean/sd)=%.1f/%.1fms window=%.1fms (min %.1f max %.1f) bursts=%llu lost=%llu max_burst=%llu "
+             "recovered(hold/decay)=%llu/%llu expired=%llu max_gap=%.1fms hold_time=%.0fms decay_time=%.0fms",
+             hold->mean_interval_ns / NSEC_PER_MSEC, sqrt(hold->var_interval_ns2) / NSEC_PER_MSEC,
+             hold->hold_window_ns / static_cast<double>(NSEC_PER_MSEC), hold->min_window_ns / static_cast<double>(NSEC_PER_MSEC),
+             hold->max_window_ns / static_cast<double>(NSEC_PER_MSEC), hold->bursts, hold->lost_packets, hold->max_burst,
+             hold->recovered_holding, hold->recovered_decaying, hold->expired,
+             hold->max_gap_ns / static_cast<double>(NSEC_PER_MSEC),
+             hold->phase_ticks[COMMAND_HOLD_HOLDING] * period_ms, hold->phase_ticks[COMMAND_HOLD_DECAYING] * period_ms);
+}
@@ -1,8 +1,12 @@
 #include "config.h"
+#include "telemetry_protocol.h" // TelemetryEncoding, TELEMETRY_ALL_FIELDS
+#include "command_hold.h"       // CommandDecayCurve
+#include "logger.h"             // LOG_*
 #include <fstream>
 #include <sstream>
 #include <algorithm> // for std::transform
 #include <cctype>    // for std::isspace
+#include <cmath>     // for std::log
 
 // グローバル設定オブジェクトの実体
 AppConfig g_config;
@@ -12,10 +16,32 @@ AppConfig::AppConfig() :
     pwm_min(1100), pwm_neutral(1500), pwm_normal_max(1500), pwm_boost_max(1900), pwm_frequency(50.0f),
     joystick_deadzone(6500),
     led_pwm_channel(9), led_pwm_on(1900), led_pwm_off(1100),
-    smoothing_factor_horizontal(0.15f), smoothing_factor_vertical(0.2f),
-    kp_roll(0.2f), kp_yaw(0.15f), yaw_threshold_dps(2.0f), yaw_gain(50.0f),
-    network_recv_port(12345), network_send_port(12346), connection_timeout_seconds(0.2),
-    sensor_send_interval(10), loop_delay_us(10000),
+    smoothing_tau_horizontal_s(0.06f), smoothing_tau_vertical_s(0.045f), slew_rate_pwm_per_s(8000.0f),
+    kp_roll(0.01f), ki_roll(0.0f), kd_roll(0.0f),
+    kp_yaw(0.0075f), yaw_threshold_dps(2.0f), yaw_gain(0.15f), ki_yaw(0.4f), kd_yaw(0.0f),
+    d_filter_tau_s(0.02f), stabilization_limit_n(20.0f),
+    alloc_thruster_count(6), alloc_bidirectional(false),
+    alloc_gain_surge(40.0f), alloc_gain_sway(20.0f), alloc_gain_heave(0.0f), alloc_gain_yaw(20.0f),
+    thrust_curve_profile("linear"), thrust_curve_linear_max_n(40.0f),
+    network_recv_port(12345), network_send_port(12346), connection_timeout_seconds(0.2), degraded_timeout_seconds(0.1), stale_packet_ms(100),
+    sensor_send_interval(10), loop_delay_us(10000), stats_report_interval_s(10), latency_measure(false), stage_profiling(true), log_level(LOG_LEVEL_INFO),
+    telemetry_binary(true), telemetry_encoding(TELEMETRY_ENCODING_FLOAT16), telemetry_field_mask(TELEMETRY_ALL_FIELDS),
+    telemetry_subscriptions(true), telemetry_subscriber_lease_s(10),
+    sensor_gyro_rate_hz(200.0f), sensor_accel_rate_hz(100.0f), sensor_mag_rate_hz(25.0f),
+    sensor_env_rate_hz(10.0f), sensor_leak_rate_hz(5.0f), sensor_adc_rate_hz(10.0f),
+    ahrs_enabled(true), ahrs_kp(1.0f), ahrs_ki(0.05f), ahrs_use_mag(true),
+    hal_backend(""), hal_sim_seed(1), hal_sim_gyro_noise_dps(0.05f), hal_sim_accel_noise(0.02f), hal_sim_mag_noise(0.5f),
+    hal_sim_i2c_latency_us(150.0f), hal_sim_i2c_jitter_us(30.0f),
+    hal_replay_file("sensors.csv"), hal_replay_speed(1.0f), hal_replay_loop(true),
+    sim_mass_kg(11.5f), sim_bg_m(0.02f), sim_motor_tau_s(0.05f), sim_physics_dt_s(0.001f), sim_plant_curve(""),
+    blackbox_enabled(true), blackbox_file("blackbox.bin"), blackbox_records(65536),
+    command_hold_enabled(true), command_hold_min_ms(40), command_hold_max_ms(100), command_hold_jitter_k(4.0f),
+    command_hold_decay_ms(80), command_hold_decay_curve(COMMAND_DECAY_COSINE),
+    clock_sync_enabled(true), clock_sync_interval_ms(1000),
+    imu_stream_enabled(false), imu_stream_rate_hz(400.0f), imu_stream_samples_per_datagram(20), imu_stream_flush_ms(50),
+    watchdog_enabled(true), watchdog_timeout_ms(50),
+    rt_enabled(false), rt_control_cpu(3), rt_control_priority(80), rt_sensor_priority(70), rt_watchdog_priority(90),
+    rt_lock_memory(true), rt_prefault_stack_kb(512), rt_isolate_gstreamer(true),
     gst1_device("/dev/video2"), gst1_port(5000), gst1_host("192.168.4.10"),
     gst1_width(1280), gst1_height(720), gst1_framerate_num(30), gst1_framerate_den(1),
     gst1_is_h264_native_source(true), gst1_rtp_payload_type(96), gst1_rtp_config_interval(1),
@@ -23,7 +49,50 @@ AppConfig::AppConfig() :
     gst2_width(1280), gst2_height(720), gst2_framerate_num(30), gst2_framerate_den(1),
     gst2_is_h264_native_source(false), gst2_rtp_payload_type(96), gst2_rtp_config_interval(1),
     gst2_x264_bitrate(5000), gst2_x264_tune("zerolatency"), gst2_x264_speed_preset("superfast")
-{}
+{
+    // 既定の配分行列: Ch0-3 水平ベクタードスラスター (FL, FR, RL, RR)、Ch4-5 前進スラスター
+    // ロール列は従来のジャイロ補正と同じ向き (水平スラスターのみのためヨーと同じ組み合わせになる)
+    static const float default_matrix[6][WRENCH_DOF] = {
+        // surge sway heave roll pitch yaw
+        {0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f},    // Ch0 前左
+        {0.0f, -1.0f, 0.0f, -1.0f, 0.0f, -1.0f}, // Ch1 前右
+        {0.0f, 1.0f, 0.0f, -1.0f, 0.0f, -1.0f},  // Ch2 後左
+        {0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f},   // Ch3 後右
+        {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f},    // Ch4 前進
+        {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}};   // Ch5 前進
+    for (int i = 0; i < ALLOC_MAX_THRUSTERS; ++i) {
+        alloc_channels[i] = i;
+        for (int axis = 0; axis < WRENCH_DOF; ++axis)
+            alloc_matrix[i][axis] = (i < 6) ? default_matrix[i][axis] : 0.0f;
+    }
+    for (int axis = 0; axis < 3; ++axis)
+        hal_sim_gyro_bias_dps[axis] = 0.0f;
+
+    // 既定の車両モデル: 小型 ROV (約 11.5 kg) の付加質量・抗力係数
+    // スラスター配置は既定の配分行列と同じ向き (水平4基は横向きで前後左右の角、前進2基は後部)
+    static const float default_added_mass[6] = {5.5f, 12.7f, 14.6f, 0.12f, 0.12f, 0.12f};
+    static const float default_linear_drag[6] = {4.0f, 6.2f, 5.2f, 0.07f, 0.07f, 0.07f};
+    static const float default_quadratic_drag[6] = {18.2f, 21.7f, 37.0f, 1.55f, 1.55f, 1.55f};
+    static const float default_geometry[6][6] = {
+        //  x      y      z     dx    dy    dz
+        {0.2f, -0.15f, 0.0f, 0.0f, 1.0f, 0.0f},   // Ch0 前左 (右舷向きに押す)
+        {0.2f, 0.15f, 0.0f, 0.0f, -1.0f, 0.0f},   // Ch1 前右 (左舷向き)
+        {-0.2f, -0.15f, 0.0f, 0.0f, 1.0f, 0.0f},  // Ch2 後左 (右舷向き)
+        {-0.2f, 0.15f, 0.0f, 0.0f, -1.0f, 0.0f},  // Ch3 後右 (左舷向き)
+        {-0.2f, -0.1f, 0.0f, 1.0f, 0.0f, 0.0f},   // Ch4 前進
+        {-0.2f, 0.1f, 0.0f, 1.0f, 0.0f, 0.0f}};   // Ch5 前進
+    sim_inertia[0] = 0.16f;
+    sim_inertia[1] = 0.16f;
+    sim_inertia[2] = 0.16f;
+    for (int axis = 0; axis < 6; ++axis) {
+        sim_added_mass[axis] = default_added_mass[axis];
+        sim_linear_drag[axis] = default_linear_drag[axis];
+        sim_quadratic_drag[axis] = default_quadratic_drag[axis];
+    }
+    for (int i = 0; i < ALLOC_MAX_THRUSTERS; ++i)
+        for (int k = 0; k < 6; ++k)
+            sim_thruster_geometry[i][k] = (i < 6) ? default_geometry[i][k] : 0.0f;
+}
 
 // ヘルパー関数: 文字列の前後の空白を削除
 static std::string trim(const std::string& str) {
@@ -33,6 +102,25 @@ static std::string trim(const std::string& str) {
     return str.substr(first, (last - first + 1));
 }
 
+// ヘルパー関数: 従来の周期ごとの平滑化係数を時定数 [s] に換算する (係数は 100Hz で調整されていた前提)
+static float smoothingFactorToTau(float factor) {
+    const float legacy_period_s = 0.01f;
+    if (factor >= 1.0f) return 0.0f; // 即座に追従
+    if (factor <= 0.0f) return 1e6f; // 変化しない
+    return -legacy_period_s / std::log(1.0f - factor);
+}
+
+// ヘルパー関数: カンマ区切りの数値列を読み取る (読み取った個数を返す。max_count を超える要素は無視する)
+static int parseFloatList(const std::string& value, float* out, int max_count) {
+    std::stringstream ss(value);
+    std::string item;
+    int count = 0;
+    while (std::getline(ss, item, ',') && count < max_count) {
+        out[count++] = std::stof(trim(item));
+    }
+    return count;
+}
+
 // ヘルパー関数: 文字列を小文字に変換
 static std::string toLower(std::string s) {
     std::transform(s.begin(), s.end(), s.begin(),
@@ -43,7 +131,7 @@ static std::string toLower(std::string s) {
 bool loadConfig(const std::string& filename) {
     std::ifstream file(filename);
     if (!file.is_open()) {
-        std::cerr << "エラー: 設定ファイル '" << filename << "' を開けません。デフォルト値を使用します。" << std::endl;
+        LOG_ERROR("エラー: 設定ファイル '%s' を開けません。デフォルト値を使用します。", filename.c_str());
         return false;
     }
 
@@ -68,7 +156,7 @@ bool loadConfig(const std::string& filename) {
 
         size_t eq_pos = line.find('=');
         if (eq_pos == std::string::npos) {
-            std::cerr << "警告: " << filename << " の " << line_num << " 行目: '=' が見つかりません。スキップします。" << std::endl;
+            LOG_WARN("警告: %s の %d 行目: '=' が見つかりません。スキップします。", filename.c_str(), line_num);
             continue;
         }
 
@@ -90,19 +178,170 @@ bool loadConfig(const std::string& filename) {
                 else if (key == "on_value") g_config.led_pwm_on = std::stoi(value);
                 else if (key == "off_value") g_config.led_pwm_off = std::stoi(value);
             } else if (current_section == "thruster_control") {
-                if (key == "smoothing_factor_horizontal") g_config.smoothing_factor_horizontal = std::stof(value);
-                else if (key == "smoothing_factor_vertical") g_config.smoothing_factor_vertical = std::stof(value);
+                if (key == "smoothing_tau_horizontal_s") g_config.smoothing_tau_horizontal_s = std::stof(value);
+                else if (key == "smoothing_tau_vertical_s") g_config.smoothing_tau_vertical_s = std::stof(value);
+                else if (key == "smoothing_factor_horizontal" || key == "smoothing_factor_vertical") {
+                    // 旧形式: 周期ごとの係数は制御周期で応答が変わるため時定数に換算する
+                    float tau = smoothingFactorToTau(std::stof(value));
+                    if (key == "smoothing_factor_horizontal") g_config.smoothing_tau_horizontal_s = tau;
+                    else g_config.smoothing_tau_vertical_s = tau;
+                    LOG_WARN("警告: %s の %d 行目: %s は廃止予定です。100Hz 相当の時定数 %.3f 秒として扱います。", filename.c_str(), line_num, key.c_str(), tau);
+                }
+                else if (key == "slew_rate_pwm_per_s") g_config.slew_rate_pwm_per_s = std::stof(value);
                 else if (key == "kp_roll") g_config.kp_roll = std::stof(value);
+                else if (key == "ki_roll") g_config.ki_roll = std::stof(value);
+                else if (key == "kd_roll") g_config.kd_roll = std::stof(value);
                 else if (key == "kp_yaw") g_config.kp_yaw = std::stof(value);
                 else if (key == "yaw_threshold_dps") g_config.yaw_threshold_dps = std::stof(value);
                 else if (key == "yaw_gain") g_config.yaw_gain = std::stof(value);
+                else if (key == "ki_yaw") g_config.ki_yaw = std::stof(value);
+                else if (key == "kd_yaw") g_config.kd_yaw = std::stof(value);
+                else if (key == "d_filter_tau_s") g_config.d_filter_tau_s = std::stof(value);
+                else if (key == "stabilization_limit_n") g_config.stabilization_limit_n = std::stof(value);
+            } else if (current_section == "allocation") {
+                if (key == "thrusters") {
+                    int count = std::stoi(value);
+                    if (count >= 1 && count <= ALLOC_MAX_THRUSTERS) g_config.alloc_thruster_count = count;
+                    else LOG_WARN("警告: %s の %d 行目: THRUSTERS は 1〜%d で指定してください。", filename.c_str(), line_num, ALLOC_MAX_THRUSTERS);
+                }
+                else if (key == "channels") {
+                    float channels[ALLOC_MAX_THRUSTERS];
+                    int count = parseFloatList(value, channels, ALLOC_MAX_THRUSTERS);
+                    for (int i = 0; i < count; ++i) g_config.alloc_channels[i] = static_cast<int>(channels[i]);
+                }
+                else if (key.size() == 2 && key[0] == 't' && key[1] >= '0' && key[1] < '0' + ALLOC_MAX_THRUSTERS) {
+                    // T<n>=surge,sway,heave,roll,pitch,yaw
+                    float row[WRENCH_DOF];
+                    if (parseFloatList(value, row, WRENCH_DOF) == WRENCH_DOF) {
+                        for (int axis = 0; axis < WRENCH_DOF; ++axis) g_config.alloc_matrix[key[1] - '0'][axis] = row[axis];
+                    } else {
+                        LOG_WARN("警告: %s の %d 行目: %s は %d 個の係数 (surge,sway,heave,roll,pitch,yaw) が必要です。", filename.c_str(), line_num, key.c_str(), WRENCH_DOF);
+                    }
+                }
+                else if (key == "bidirectional") g_config.alloc_bidirectional = (toLower(value) == "true");
+                else if (key == "gain_surge") g_config.alloc_gain_surge = std::stof(value);
+                else if (key == "gain_sway") g_config.alloc_gain_sway = std::stof(value);
+                else if (key == "gain_heave") g_config.alloc_gain_heave = std::stof(value);
+                else if (key == "gain_yaw") g_config.alloc_gain_yaw = std::stof(value);
+            } else if (current_section == "thrust_curve") {
+                if (key == "profile") g_config.thrust_curve_profile = value;
+                else if (key == "linear_max_force_n") g_config.thrust_curve_linear_max_n = std::stof(value);
+                else if (key.size() == 2 && key[0] == 't' && key[1] >= '0' && key[1] < '0' + ALLOC_MAX_THRUSTERS) {
+                    g_config.thrust_curve_overrides[key[1] - '0'] = value; // T<n>=プロファイル
+                }
             } else if (current_section == "network") {
                 if (key == "recv_port") g_config.network_recv_port = std::stoi(value);
                 else if (key == "send_port") g_config.network_send_port = std::stoi(value);
                 else if (key == "connection_timeout_seconds") g_config.connection_timeout_seconds = std::stod(value);
+                else if (key == "degraded_timeout_seconds") g_config.degraded_timeout_seconds = std::stod(value);
+                else if (key == "stale_packet_ms") g_config.stale_packet_ms = std::stoul(value);
             } else if (current_section == "application") {
                 if (key == "sensor_send_interval") g_config.sensor_send_interval = std::stoul(value);
                 else if (key == "loop_delay_us") g_config.loop_delay_us = std::stoul(value);
+                else if (key == "stats_report_interval_s") g_config.stats_report_interval_s = std::stoul(value);
+                else if (key == "latency_measure") g_config.latency_measure = (toLower(value) == "true");
+                else if (key == "stage_profiling") g_config.stage_profiling = (toLower(value) == "true");
+                else if (key == "log_level") {
+                    if (!log_parse_level(toLower(value).c_str(), &g_config.log_level))
+                        LOG_WARN("警告: %s の %d 行目: 不明なログレベル '%s'。info を使用します。", filename.c_str(), line_num, value.c_str());
+                }
+            } else if (current_section == "telemetry") {
+                if (key == "format") g_config.telemetry_binary = (toLower(value) != "text");
+                else if (key == "encoding") {
+                    std::string enc = toLower(value);
+                    if (enc == "float32") g_config.telemetry_encoding = TELEMETRY_ENCODING_FLOAT32;
+                    else if (enc == "float16") g_config.telemetry_encoding = TELEMETRY_ENCODING_FLOAT16;
+                    else if (enc == "fixed16") g_config.telemetry_encoding = TELEMETRY_ENCODING_FIXED16;
+                    else LOG_WARN("警告: %s の %d 行目: 不明なエンコーディング '%s'。float16 を使用します。", filename.c_str(), line_num, value.c_str());
+                }
+                else if (key == "field_mask") g_config.telemetry_field_mask = static_cast<unsigned int>(std::stoul(value, nullptr, 0));
+                else if (key == "subscriptions") g_config.telemetry_subscriptions = (toLower(value) == "true");
+                else if (key == "subscriber_lease_s") g_config.telemetry_subscriber_lease_s = std::stoul(value);
+            } else if (current_section == "sensors") {
+                if (key == "gyro_rate_hz") g_config.sensor_gyro_rate_hz = std::stof(value);
+                else if (key == "accel_rate_hz") g_config.sensor_accel_rate_hz = std::stof(value);
+                else if (key == "mag_rate_hz") g_config.sensor_mag_rate_hz = std::stof(value);
+                else if (key == "pressure_rate_hz") g_config.sensor_env_rate_hz = std::stof(value);
+                else if (key == "leak_rate_hz") g_config.sensor_leak_rate_hz = std::stof(value);
+                else if (key == "adc_rate_hz") g_config.sensor_adc_rate_hz = std::stof(value);
+            } else if (current_section == "ahrs") {
+                if (key == "enabled") g_config.ahrs_enabled = (toLower(value) == "true");
+                else if (key == "kp") g_config.ahrs_kp = std::stof(value);
+                else if (key == "ki") g_config.ahrs_ki = std::stof(value);
+                else if (key == "use_mag") g_config.ahrs_use_mag = (toLower(value) == "true");
+            } else if (current_section == "hal") {
+                if (key == "backend") g_config.hal_backend = toLower(value);
+                else if (key == "sim_seed") g_config.hal_sim_seed = std::stoull(value);
+                else if (key == "sim_gyro_noise_dps") g_config.hal_sim_gyro_noise_dps = std::stof(value);
+                else if (key == "sim_gyro_bias_dps") {
+                    if (parseFloatList(value, g_config.hal_sim_gyro_bias_dps, 3) != 3)
+                        LOG_WARN("警告: %s の %d 行目: SIM_GYRO_BIAS_DPS は X,Y,Z の3要素で指定してください。", filename.c_str(), line_num);
+                }
+                else if (key == "sim_accel_noise") g_config.hal_sim_accel_noise = std::stof(value);
+                else if (key == "sim_mag_noise") g_config.hal_sim_mag_noise = std::stof(value);
+                else if (key == "sim_i2c_latency_us") g_config.hal_sim_i2c_latency_us = std::stof(value);
+                else if (key == "sim_i2c_jitter_us") g_config.hal_sim_i2c_jitter_us = std::stof(value);
+                else if (key == "replay_file") g_config.hal_replay_file = value;
+                else if (key == "replay_speed") g_config.hal_replay_speed = std::stof(value);
+                else if (key == "replay_loop") g_config.hal_replay_loop = (toLower(value) == "true");
+            } else if (current_section == "vehicle_sim") {
+                if (key == "mass_kg") g_config.sim_mass_kg = std::stof(value);
+                else if (key == "inertia") {
+                    if (parseFloatList(value, g_config.sim_inertia, 3) != 3)
+                        LOG_WARN("警告: %s の %d 行目: INERTIA は Ixx,Iyy,Izz の3要素で指定してください。", filename.c_str(), line_num);
+                }
+                else if (key == "added_mass" || key == "linear_drag" || key == "quadratic_drag") {
+                    float *target = (key == "added_mass") ? g_config.sim_added_mass
+                                  : (key == "linear_drag") ? g_config.sim_linear_drag : g_config.sim_quadratic_drag;
+                    if (parseFloatList(value, target, 6) != 6)
+                        LOG_WARN("警告: %s の %d 行目: %s は surge,sway,heave,roll,pitch,yaw の6要素で指定してください。", filename.c_str(), line_num, key.c_str());
+                }
+                else if (key == "bg_m") g_config.sim_bg_m = std::stof(value);
+                else if (key == "motor_tau_s") g_config.sim_motor_tau_s = std::stof(value);
+                else if (key == "physics_dt_s") g_config.sim_physics_dt_s = std::stof(value);
+                else if (key == "plant_curve") g_config.sim_plant_curve = value;
+                else if (key.size() == 2 && key[0] == 't' && key[1] >= '0' && key[1] < '0' + ALLOC_MAX_THRUSTERS) {
+                    // T<n>=x,y,z,dx,dy,dz
+                    if (parseFloatList(value, g_config.sim_thruster_geometry[key[1] - '0'], 6) != 6)
+                        LOG_WARN("警告: %s の %d 行目: %s は x,y,z,dx,dy,dz の6要素で指定してください。", filename.c_str(), line_num, key.c_str());
+                }
+            } else if (current_section == "blackbox") {
+                if (key == "enabled") g_config.blackbox_enabled = (toLower(value) == "true");
+                else if (key == "file") g_config.blackbox_file = value;
+                else if (key == "records") g_config.blackbox_records = std::stoul(value);
+            } else if (current_section == "command_hold") {
+                if (key == "enabled") g_config.command_hold_enabled = (toLower(value) == "true");
+                else if (key == "hold_min_ms") g_config.command_hold_min_ms = std::stoul(value);
+                else if (key == "hold_max_ms") g_config.command_hold_max_ms = std::stoul(value);
+                else if (key == "jitter_k") g_config.command_hold_jitter_k = std::stof(value);
+                else if (key == "decay_ms") g_config.command_hold_decay_ms = std::stoul(value);
+                else if (key == "decay_curve") {
+                    std::string curve = toLower(value);
+                    if (curve == "linear") g_config.command_hold_decay_curve = COMMAND_DECAY_LINEAR;
+                    else if (curve == "cosine") g_config.command_hold_decay_curve = COMMAND_DECAY_COSINE;
+                    else if (curve == "quadratic") g_config.command_hold_decay_curve = COMMAND_DECAY_QUADRATIC;
+                    else LOG_WARN("警告: %s の %d 行目: 不明な減衰曲線 '%s'。cosine を使用します。", filename.c_str(), line_num, value.c_str());
+                }
+            } else if (current_section == "clock_sync") {
+                if (key == "enabled") g_config.clock_sync_enabled = (toLower(value) == "true");
+                else if (key == "interval_ms") g_config.clock_sync_interval_ms = std::stoul(value);
+            } else if (current_section == "imu_stream") {
+                if (key == "enabled") g_config.imu_stream_enabled = (toLower(value) == "true");
+                else if (key == "rate_hz") g_config.imu_stream_rate_hz = std::stof(value);
+                else if (key == "samples_per_datagram") g_config.imu_stream_samples_per_datagram = std::stoul(value);
+                else if (key == "flush_ms") g_config.imu_stream_flush_ms = std::stoul(value);
+            } else if (current_section == "watchdog") {
+                if (key == "enabled") g_config.watchdog_enabled = (toLower(value) == "true");
+                else if (key == "timeout_ms") g_config.watchdog_timeout_ms = std::stoul(value);
+            } else if (current_section == "realtime") {
+                if (key == "enabled") g_config.rt_enabled = (toLower(value) == "true");
+                else if (key == "control_cpu") g_config.rt_control_cpu = std::stoi(value);
+                else if (key == "control_priority") g_config.rt_control_priority = std::stoi(value);
+                else if (key == "sensor_priority") g_config.rt_sensor_priority = std::stoi(value);
+                else if (key == "watchdog_priority") g_config.rt_watchdog_priority = std::stoi(value);
+                else if (key == "lock_memory") g_config.rt_lock_memory = (toLower(value) == "true");
+                else if (key == "prefault_stack_kb") g_config.rt_prefault_stack_kb = std::stoul(value);
+                else if (key == "isolate_gstreamer") g_config.rt_isolate_gstreamer = (toLower(value) == "true");
             } else if (current_section == "gstreamer_camera_1") {
                 if (key == "device") g_config.gst1_device = value; else if (key == "port") g_config.gst1_port = std::stoi(value);
                 else if (key == "host") g_config.gst1_host = value; else if (key == "width") g_config.gst1_width = std::stoi(value);
@@ -118,14 +357,14 @@ bool loadConfig(const std::string& filename) {
                 else if (key == "x264_bitrate") g_config.gst2_x264_bitrate = std::stoi(value); else if (key == "x264_tune") g_config.gst2_x264_tune = value;
                 else if (key == "x264_speed_preset") g_config.gst2_x264_speed_preset = value;
             } else {
-                std::cerr << "警告: " << filename << " の " << line_num << " 行目: 不明なセクションまたはキー [" << current_section << "] " << key << "=" << value << std::endl;
+                LOG_WARN("警告: %s の %d 行目: 不明なセクションまたはキー [%s] %s=%s", filename.c_str(), line_num, current_section.c_str(), key.c_str(), value.c_str());
             }
         } catch (const std::invalid_argument& e) {
-            std::cerr << "エラー: " << filename << " の " << line_num << " 行目: 数値変換エラー (" << key << "=" << value << ") - " << e.what() << std::endl;
+            LOG_ERROR("エラー: %s の %d 行目: 数値変換エラー (%s=%s) - %s", filename.c_str(), line_num, key.c_str(), value.c_str(), e.what());
         } catch (const std::out_of_range& e) {
-            std::cerr << "エラー: " << filename << " の " << line_num << " 行目: 数値が範囲外 (" << key << "=" << value << ") - " << e.what() << std::endl;
+            LOG_ERROR("エラー: %s の %d 行目: 数値が範囲外 (%s=%s) - %s", filename.c_str(), line_num, key.c_str(), value.c_str(), e.what());
         }
     }
-    std::cout << "設定ファイル '" << filename << "' を読み込みました。" << std::endl;
+    LOG_INFO("設定ファイル '%s' を読み込みました。", filename.c_str());
     return true;
 }
@@ -0,0 +1,107 @@
+#include "controller.h"
+#include <cmath>     // std::exp
+#include <algorithm> // std::max, std::min
+
+float controller_clamp_dt(float dt_s)
+{
+    if (!(dt_s > 0.0f)) // NaN も含めて 0 にする
+        return 0.0f;
+    return std::min(dt_s, CONTROLLER_MAX_DT_S);
+}
+
+// ヘルパー関数: 時定数 tau の一次遅れで dt 秒進めるときの補間係数
+static float lowpass_alpha(float time_constant_s, float dt_s)
+{
+    if (time_constant_s <= 0.0f)
+        return 1.0f;
+    return 1.0f - std::exp(-dt_s / time_constant_s);
+}
+
+void lowpass_init(LowPassFilter *filter, float time_constant_s, float initial_value)
+{
+    if (!filter)
+        return;
+    filter->time_constant_s = time_constant_s;
+    filter->value = initial_value;
+}
+
+float lowpass_update(LowPassFilter *filter, float input, float dt_s)
+{
+    dt_s = controller_clamp_dt(dt_s);
+    filter->value += (input - filter->value) * lowpass_alpha(filter->time_constant_s, dt_s);
+    return filter->value;
+}
+
+void slew_init(SlewLimiter *limiter, float rate_per_s, float initial_value)
+{
+    if (!limiter)
+        return;
+    limiter->rate_per_s = rate_per_s;
+    limiter->value = initial_value;
+}
+
+float slew_update(SlewLimiter *limiter, float target, float dt_s)
+{
+    if (limiter->rate_per_s <= 0.0f)
+    {
+        limiter->value = target;
+        return target;
+    }
+    float max_step = limiter->rate_per_s * controller_clamp_dt(dt_s);
+    limiter->value += std::max(-max_step, std::min(target - limiter->value, max_step));
+    return limiter->value;
+}
+
+void pid_init(PidController *pid, float kp, float ki, float kd, float d_filter_tau_s, float output_min, float output_max)
+{
+    if (!pid)
+        return;
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    pid->d_filter_tau_s = d_filter_tau_s;
+    pid->output_min = output_min;
+    pid->output_max = output_max;
+    pid_reset(pid);
+}
+
+void pid_reset(PidController *pid)
+{
+    if (!pid)
+        return;
+    pid->integral = 0.0f;
+    pid->derivative = 0.0f;
+    pid->prev_measurement = 0.0f;
+    pid->has_prev = false;
+}
+
+float pid_update(PidController *pid, float setpoint, float measurement, float dt_s)
+{
+    dt_s = controller_clamp_dt(dt_s);
+    float error = setpoint - measurement;
+    float proportional = pid->kp * error;
+
+    // 微分項: 目標値の段差で出力が跳ねないよう測定値を微分し、ノイズを一次遅れで抑える
+    if (pid->has_prev && dt_s > 0.0f && pid->kd != 0.0f)
+    {
+        float raw_derivative = -pid->kd * (measurement - pid->prev_measurement) / dt_s;
+        pid->derivative += (raw_derivative - pid->derivative) * lowpass_alpha(pid->d_filter_tau_s, dt_s);
+    }
+    pid->prev_measurement = measurement;
+    pid->has_prev = true;
+
+    // 積分項: 出力が飽和している方向へはそれ以上積分しない (条件付き積分)
+    float candidate_integral = pid->integral + pid->ki * error * dt_s;
+    float unsaturated = proportional + candidate_integral + pid->derivative;
+    bool saturating_high = unsaturated > pid->output_max && error > 0.0f;
+    bool saturating_low = unsaturated < pid->output_min && error < 0.0f;
+    if (!saturating_high && !saturating_low)
+    {
+        pid->integral = candidate_integral;
+    }
+    // 積分項単独でも出力範囲を超えないようにする
+    pid->integral = std::max(pid->output_min, std::min(pid->integral, pid->output_max));
+
+    float output = proportional + pid->integral + pid->derivative;
+    return std::max(pid->output_min, std::min(output, pid->output_max));
+}
@@ -0,0 +1,191 @@
+#include "event_loop.h"
+#include "time_utils.h" // ns_to_timespec, NSEC_PER_USEC
+#include "logger.h"     // LOG_*
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+// ヘルパー関数: 周期タイマーを作成する (first_deadline_ns は CLOCK_MONOTONIC の絶対時刻)
+static int create_periodic_timer(int64_t first_deadline_ns, unsigned int period_us)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG_ERROR("timerfd 作成失敗: %s", strerror(errno));
+        return -1;
+    }
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value = ns_to_timespec(first_deadline_ns);
+    spec.it_interval = ns_to_timespec(static_cast<int64_t>(period_us > 0 ? period_us : 1) * NSEC_PER_USEC);
+    // TFD_TIMER_ABSTIME: 絶対デッドラインで満了するため、処理時間で周期がずれない
+    if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+    {
+        LOG_ERROR("timerfd 設定失敗: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// ヘルパー関数: fd を epoll に読み込み監視で登録する
+static bool add_to_epoll(int epoll_fd, int fd, uint32_t tag)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = tag;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        LOG_ERROR("epoll 登録失敗: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// ヘルパー関数: timerfd の満了回数を読み取る
+static uint64_t read_expirations(int fd)
+{
+    uint64_t expirations = 0;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+    {
+        return 0; // EAGAIN (既に読み取り済み) など
+    }
+    return expirations;
+}
+
+bool event_loop_init(EventLoop *loop, int recv_socket, int64_t first_deadline_ns,
+                     unsigned int control_period_us, unsigned int telemetry_period_us, unsigned int imu_flush_period_us)
+{
+    if (!loop || recv_socket < 0)
+        return false;
+
+    loop->epoll_fd = -1;
+    loop->recv_socket = recv_socket;
+    loop->control_timer_fd = -1;
+    loop->telemetry_timer_fd = -1;
+    loop->imu_flush_timer_fd = -1;
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0)
+    {
+        LOG_ERROR("epoll 作成失敗: %s", strerror(errno));
+        return false;
+    }
+
+    loop->control_timer_fd = create_periodic_timer(first_deadline_ns, control_period_us);
+    loop->telemetry_timer_fd = create_periodic_timer(first_deadline_ns + static_cast<int64_t>(telemetry_period_us) * NSEC_PER_USEC,
+                                                     telemetry_period_us);
+    if (loop->control_timer_fd < 0 || loop->telemetry_timer_fd < 0 ||
+        !add_to_epoll(loop->epoll_fd, recv_socket, EVENT_NETWORK_READABLE) ||
+        !add_to_epoll(loop->epoll_fd, loop->control_timer_fd, EVENT_CONTROL_TIMER) ||
+        !add_to_epoll(loop->epoll_fd, loop->telemetry_timer_fd, EVENT_TELEMETRY_TIMER))
+    {
+        event_loop_close(loop);
+        return false;
+    }
+    if (imu_flush_period_us > 0)
+    {
+        // 制御タイマーと同じ時刻に重ならないよう、最初の満了を制御周期の半分ずらす
+        loop->imu_flush_timer_fd = create_periodic_timer(first_deadline_ns + static_cast<int64_t>(control_period_us / 2) * NSEC_PER_USEC,
+                                                         imu_flush_period_us);
+        if (loop->imu_flush_timer_fd < 0 || !add_to_epoll(loop->epoll_fd, loop->imu_flush_timer_fd, EVENT_IMU_FLUSH_TIMER))
+        {
+            event_loop_close(loop);
+            return false;
+        }
+    }
+
+    LOG_INFO("イベントループ初期化完了 (制御周期: %u us, テレメトリ周期: %u us)", control_period_us, telemetry_period_us);
+    return true;
+}
+
+unsigned int event_loop_wait(EventLoop *loop, int timeout_ms, uint64_t *control_expirations, uint64_t *telemetry_expirations)
+{
+    if (control_expirations)
+        *control_expirations = 0;
+    if (telemetry_expirations)
+        *telemetry_expirations = 0;
+    if (!loop || loop->epoll_fd < 0)
+        return 0;
+
+    struct epoll_event events[4];
+    int n = epoll_wait(loop->epoll_fd, events, 4, timeout_ms);
+    if (n < 0)
+    {
+        if (errno != EINTR)
+        {
+            LOG_ERROR_EVERY(1000, "epoll_wait エラー: %s", strerror(errno));
+        }
+        return 0;
+    }
+
+    unsigned int mask = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        switch (events[i].data.u32)
+        {
+        case EVENT_NETWORK_READABLE:
+            mask |= EVENT_NETWORK_READABLE;
+            break;
+        case EVENT_CONTROL_TIMER:
+        {
+            uint64_t exp = read_expirations(loop->control_timer_fd);
+            if (exp > 0)
+            {
+                mask |= EVENT_CONTROL_TIMER;
+                if (control_expirations)
+                    *control_expirations = exp;
+            }
+            break;
+        }
+        case EVENT_TELEMETRY_TIMER:
+        {
+            uint64_t exp = read_expirations(loop->telemetry_timer_fd);
+            if (exp > 0)
+            {
+                mask |= EVENT_TELEMETRY_TIMER;
+                if (telemetry_expirations)
+                    *telemetry_expirations = exp;
+            }
+            break;
+        }
+        case EVENT_IMU_FLUSH_TIMER:
+            if (read_expirations(loop->imu_flush_timer_fd) > 0)
+                mask |= EVENT_IMU_FLUSH_TIMER;
+            break;
+        default:
+            break;
+        }
+    }
+    return mask;
+}
+
+void event_loop_close(EventLoop *loop)
+{
+    if (!loop)
+        return;
+    if (loop->control_timer_fd >= 0)
+    {
+        close(loop->control_timer_fd);
+        loop->control_timer_fd = -1;
+    }
+    if (loop->telemetry_timer_fd >= 0)
+    {
+        close(loop->telemetry_timer_fd);
+        loop->telemetry_timer_fd = -1;
+    }
+    if (loop->imu_flush_timer_fd >= 0)
+    {
+        close(loop->imu_flush_timer_fd);
+        loop->imu_flush_timer_fd = -1;
+    }
+    if (loop->epoll_fd >= 0)
+    {
+        close(loop->epoll_fd);
+        loop->epoll_fd = -1;
+    }
+}
@@ -1,78 +1,274 @@
-#include "gamepad.h" // GamepadData 構造体と GamepadButton 列挙型の定義
-#include <sstream>   // 文字列ストリーム (std::stringstream) を使用するため
-#include <iostream>  // 標準入出力 (std::cerr) を使用するため
-#include <stdexcept> // 例外クラス (std::invalid_argument, std::out_of_range) を使用するため
+#include "gamepad.h"    // GamepadData 構造体と GamepadButton 列挙型の定義
+#include "byte_order.h" // リトルエンディアン読み書きと CRC
+#include "latency_histogram.h" // デコード時間の計測
+#include "logger.h"     // LOG_*
+#include <limits.h>     // INT_MIN, INT_MAX
 
-// ヘルパー関数: 文字列の前後の空白文字 (スペース、タブ、改行など) を削除する
-std::string trim(const std::string &str)
+// --- 受信パスでは動的確保・例外を使用しない ---
+// (従来の std::stringstream / std::stoi による実装は1パケットごとに複数回ヒープ確保していた)
+
+// ヘルパー関数: 空白文字 (スペース、タブ、改行など) か判定する
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// ヘルパー関数: [begin, end) の10進整数をパースする (前後の空白は許容)
+// 空トークンは *empty = true で 0 を返す。数字以外の文字や int 範囲外は false
+static bool parse_int_token(const char *begin, const char *end, int *value, bool *empty)
 {
-    size_t first = str.find_first_not_of(" \t\n\r\f\v");
-    if (std::string::npos == first)
+    while (begin < end && is_space(*begin))
+        ++begin;
+    while (end > begin && is_space(*(end - 1)))
+        --end;
+
+    *empty = (begin == end);
+    *value = 0;
+    if (*empty)
+        return true;
+
+    bool negative = false;
+    if (*begin == '+' || *begin == '-')
+    {
+        negative = (*begin == '-');
+        ++begin;
+        if (begin == end)
+            return false; // 符号のみ
+    }
+
+    long long acc = 0;
+    for (const char *p = begin; p < end; ++p)
     {
-        return str;
+        if (*p < '0' || *p > '9')
+            return false; // 無効なデータ形式
+        acc = acc * 10 + (*p - '0');
+        if (acc > static_cast<long long>(INT_MAX) + 1)
+            return false; // 数値が範囲外
     }
-    size_t last = str.find_last_not_of(" \t\n\r\f\v");
-    return str.substr(first, (last - first + 1));
+    if (negative)
+        acc = -acc;
+    if (acc < INT_MIN || acc > INT_MAX)
+        return false;
+    *value = static_cast<int>(acc);
+    return true;
 }
 
-// 受信した文字列データを GamepadData 構造体にパースする関数
-GamepadData parseGamepadData(const std::string &data)
+// CSV 形式 "LX,LY,RX,RY,LT,RT,Buttons" をパースする関数
+bool parseGamepadCsv(const char *data, size_t len, GamepadData &out)
 {
-    GamepadData gamepad;           // パース結果を格納する構造体 (デフォルト値で初期化)
-    std::stringstream ss(data);    // 受信した文字列データから文字列ストリームを作成
-    std::string token;             // 分割された各トークン (部分文字列) を格納する変数
     int values[7] = {0};           // パースされた整数値を一時的に格納する配列 (7つの要素: LX, LY, RX, RY, LT, RT, Buttons)
     int index = 0;                 // values 配列の現在のインデックス
     const int EXPECTED_VALUES = 7; // 期待される値の総数
 
-    // 文字列ストリームからカンマ (',') 区切りでトークンを読み込むループ
-    while (std::getline(ss, token, ',') && index < EXPECTED_VALUES)
+    const char *p = data;
+    const char *end = data + len;
+    // カンマ (',') 区切りでトークンを読み込むループ (受信バッファ上で直接処理する)
+    while (index < EXPECTED_VALUES)
     {
-        try
-        {
-            std::string trimmed_token = trim(token); // トークンの前後の空白を削除
-            if (!trimmed_token.empty())
-            {
-                // 空でないトークンは整数に変換して values 配列に格納
-                values[index++] = std::stoi(trimmed_token); // string to integer
-            }
-            else
-            {
-                // 空のトークンを処理 - 0 として扱う
-                values[index++] = 0;
-                std::cerr << "警告: 空のトークンを検出。0として扱います。" << std::endl;
-            }
-        }
-        catch (const std::invalid_argument &e) // stoi が変換できない形式の場合
+        const char *token_end = p;
+        while (token_end < end && *token_end != ',')
+            ++token_end;
+        if (p == end && index > 0)
+            break; // 末尾のカンマの後には何もない
+
+        bool empty = false;
+        if (!parse_int_token(p, token_end, &values[index], &empty))
         {
-            std::cerr << "stoiエラー: 無効なデータ形式 (" << token << ") - " << e.what() << std::endl;
-            // 致命的なパースエラーが発生した場合、デフォルトのゲームパッドデータを返す
-            return GamepadData{}; // デフォルト初期化された構造体を返す
+            LOG_WARN_EVERY(1000, "CSVパースエラー: 無効なデータ形式または範囲外 (%.*s)", static_cast<int>(token_end - p), p);
+            return false;
         }
-        catch (const std::out_of_range &e) // stoi の結果が int の範囲外の場合
+        if (empty)
         {
-            std::cerr << "stoiエラー: 数値が範囲外 (" << token << ") - " << e.what() << std::endl;
-            // 致命的なパースエラーが発生した場合、デフォルトのゲームパッドデータを返す
-            return GamepadData{}; // デフォルト初期化された構造体を返す
+            // 空のトークンを処理 - 0 として扱う
+            LOG_WARN_EVERY(1000, "警告: 空のトークンを検出。0として扱います。");
         }
+        ++index;
+        if (token_end == end)
+            break;
+        p = token_end + 1;
     }
 
     // 期待される数の値を受信したかチェック
     if (index < EXPECTED_VALUES)
     {
-        std::cerr << "警告: 受信データが不足しています。項目数: " << index << " (期待値: " << EXPECTED_VALUES << ")" << std::endl;
-        // 要件によっては、ここでデフォルトデータを返すことも検討できる
+        LOG_WARN_EVERY(1000, "警告: 受信データが不足しています。項目数: %d (期待値: %d)", index, EXPECTED_VALUES);
+        // 要件によっては、ここで false を返すことも検討できる
     }
 
     // 解析した値を構造体のメンバーに割り当てる
-    gamepad.leftThumbX = values[0];
-    gamepad.leftThumbY = values[1];
-    gamepad.rightThumbX = values[2];
-    gamepad.rightThumbY = values[3];
-    gamepad.LT = values[4];
-    gamepad.RT = values[5];
+    out = GamepadData{};
+    out.leftThumbX = values[0];
+    out.leftThumbY = values[1];
+    out.rightThumbX = values[2];
+    out.rightThumbY = values[3];
+    out.LT = values[4];
+    out.RT = values[5];
     // ボタンの値を安全に uint16_t にキャスト
-    gamepad.buttons = static_cast<uint16_t>(values[6]);
+    out.buttons = static_cast<uint16_t>(values[6]);
+    return true;
+}
+
+// バイナリパケットを受信バッファ上で直接デコードする関数
+bool decodeGamepadPacket(const char *data, size_t len, GamepadData &out)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    if (len != GAMEPAD_PACKET_SIZE || p[0] != GAMEPAD_PACKET_MAGIC0 || p[1] != GAMEPAD_PACKET_MAGIC1)
+        return false;
+    if (p[2] != GAMEPAD_PACKET_VERSION)
+        return false;
+    if (read_le16(p + 30) != crc16_ccitt(p, 30))
+        return false;
+
+    out = GamepadData{};
+    out.has_sequence = true;
+    out.flags = p[3];
+    out.sequence = read_le32(p + 4);
+    out.sender_time_us = read_le64(p + 8);
+    out.leftThumbX = static_cast<int16_t>(read_le16(p + 16));
+    out.leftThumbY = static_cast<int16_t>(read_le16(p + 18));
+    out.rightThumbX = static_cast<int16_t>(read_le16(p + 20));
+    out.rightThumbY = static_cast<int16_t>(read_le16(p + 22));
+    out.LT = read_le16(p + 24);
+    out.RT = read_le16(p + 26);
+    out.buttons = read_le16(p + 28);
+    return true;
+}
+
+// GamepadData をバイナリパケットにエンコードする関数
+size_t encodeGamepadPacket(const GamepadData &data, uint32_t sequence, uint64_t sender_time_us, char *buffer, size_t buffer_size)
+{
+    if (!buffer || buffer_size < GAMEPAD_PACKET_SIZE)
+        return 0;
+
+    unsigned char *p = reinterpret_cast<unsigned char *>(buffer);
+    p[0] = GAMEPAD_PACKET_MAGIC0;
+    p[1] = GAMEPAD_PACKET_MAGIC1;
+    p[2] = GAMEPAD_PACKET_VERSION;
+    p[3] = data.flags; // フラグ (GAMEPAD_FLAG_*)
+    write_le32(p + 4, sequence);
+    write_le64(p + 8, sender_time_us);
+    write_le16(p + 16, static_cast<uint16_t>(static_cast<int16_t>(data.leftThumbX)));
+    write_le16(p + 18, static_cast<uint16_t>(static_cast<int16_t>(data.leftThumbY)));
+    write_le16(p + 20, static_cast<uint16_t>(static_cast<int16_t>(data.rightThumbX)));
+    write_le16(p + 22, static_cast<uint16_t>(static_cast<int16_t>(data.rightThumbY)));
+    write_le16(p + 24, static_cast<uint16_t>(data.LT));
+    write_le16(p + 26, static_cast<uint16_t>(data.RT));
+    write_le16(p + 28, data.buttons);
+    write_le16(p + 30, crc16_ccitt(p, 30));
+    return GAMEPAD_PACKET_SIZE;
+}
+
+// 受信データ (バイナリまたは CSV) を GamepadData 構造体にデコードする関数
+bool parseGamepadData(const char *data, size_t len, GamepadData &out)
+{
+    if (!data || len == 0)
+        return false;
+
+    // 先頭がマジックならバイナリパケット、それ以外は従来の CSV として扱う
+    if (len >= 2 && data[0] == GAMEPAD_PACKET_MAGIC0 && data[1] == GAMEPAD_PACKET_MAGIC1)
+    {
+        return decodeGamepadPacket(data, len, out);
+    }
+    return parseGamepadCsv(data, len, out);
+}
+
+// --- シーケンス番号フィルタ ---
+
+void resetGamepadSequence(GamepadSequenceFilter *filter)
+{
+    if (!filter)
+        return;
+    filter->initialized = false;
+    filter->last_sequence = 0;
+    filter->duplicates = 0;
+    filter->out_of_order = 0;
+    filter->restarts = 0;
+    filter->decode_errors = 0;
+}
+
+// ヘルパー関数: last を基準に sequence が新しいか判定する (ラップアラウンド対応、filter が NULL なら統計なし)
+static bool is_newer_sequence(GamepadSequenceFilter *filter, uint32_t last, uint32_t sequence)
+{
+    int32_t diff = static_cast<int32_t>(sequence - last);
+    if (diff > 0)
+        return true;
+    if (diff == 0)
+    {
+        if (filter)
+            filter->duplicates++;
+        return false;
+    }
+    if (diff < -GAMEPAD_SEQUENCE_RESTART_WINDOW)
+    {
+        // 大きく巻き戻った場合は送信側の再起動とみなして受け入れる
+        if (filter)
+            filter->restarts++;
+        return true;
+    }
+    if (filter)
+        filter->out_of_order++;
+    return false;
+}
+
+bool isGamepadSequenceFresh(GamepadSequenceFilter *filter, const GamepadData &data)
+{
+    // CSV 形式 (シーケンス番号なし) と最初のパケットは常に受け入れる
+    if (!filter || !data.has_sequence || !filter->initialized)
+        return true;
+    return is_newer_sequence(filter, filter->last_sequence, data.sequence);
+}
+
+void commitGamepadSequence(GamepadSequenceFilter *filter, const GamepadData &data)
+{
+    if (!filter || !data.has_sequence)
+        return;
+    filter->initialized = true;
+    filter->last_sequence = data.sequence;
+}
+
+void printGamepadStats(const GamepadSequenceFilter *filter)
+{
+    if (!filter)
+        return;
+    LOG_INFO("[GAMEPAD STATS] last_seq=%u duplicates=%llu out_of_order=%llu restarts=%llu decode_errors=%llu",
+           filter->last_sequence, filter->duplicates, filter->out_of_order, filter->restarts, filter->decode_errors);
+}
+
+// --- network_receive_latest 用の検証関数 ---
+
+void beginGamepadReceive(GamepadReceiveState *state, GamepadSequenceFilter *filter)
+{
+    if (!state)
+        return;
+    state->filter = filter;
+    state->candidate = GamepadData{};
+    state->has_candidate = false;
+}
+
+bool gamepadPacketValidator(const char *data, size_t len, void *user)
+{
+    LATENCY_SCOPE(LAT_STAGE_GAMEPAD_PARSE);
+    GamepadReceiveState *state = static_cast<GamepadReceiveState *>(user);
+    GamepadData decoded;
+    if (!parseGamepadData(data, len, decoded))
+    {
+        if (state && state->filter)
+            state->filter->decode_errors++;
+        return false;
+    }
+    if (!state)
+        return true;
+
+    // 既に候補がある場合 (後続バッチで届いたパケット) は、その候補より新しいものだけを採用する
+    bool fresh;
+    if (state->has_candidate && state->candidate.has_sequence && decoded.has_sequence)
+        fresh = is_newer_sequence(state->filter, state->candidate.sequence, decoded.sequence);
+    else
+        fresh = isGamepadSequenceFresh(state->filter, decoded);
+    if (!fresh)
+        return false;
 
-    return gamepad; // パースされたデータを返す
+    state->candidate = decoded;
+    state->has_candidate = true;
+    return true;
 }
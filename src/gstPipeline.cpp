@@ -1,8 +1,13 @@
 #include "gstPipeline.h"
-#include <iostream>
+#include "logger.h"   // LOG_*
+
+#ifdef WITH_GSTREAMER
+
+#include <gst/gst.h>
 #include <string>   // For std::string and std::to_string
 #include <thread>   // For std::thread
 #include "config.h" // g_config を使用するため
+#include "realtime.h" // GStreamer スレッドを制御用コア以外へ隔離するため
 
 // --- グローバル変数 ---
 // GStreamerパイプラインのインスタンス (カメラ1用)
@@ -21,9 +26,24 @@ static std::thread loop_thread2;
 
 // GMainLoopを指定されたスレッドで実行するための関数
 static void run_main_loop(GMainLoop* loop) {
+    realtime_confine_current_thread("gst-main-loop"); // リアルタイムモード時は制御用コア以外で実行
     g_main_loop_run(loop);
 }
 
+// バスの同期ハンドラ: ストリーミングスレッド自身の中で呼ばれるため、そのスレッドの CPU 割り当てを変更できる
+// (x264enc などが内部で生成するスレッドは、この設定を継承する)
+static GstBusSyncReply on_bus_sync_message(GstBus* /*bus*/, GstMessage* message, gpointer /*user_data*/) {
+    if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_STREAM_STATUS) {
+        GstStreamStatusType type;
+        GstElement* owner = nullptr;
+        gst_message_parse_stream_status(message, &type, &owner);
+        if (type == GST_STREAM_STATUS_TYPE_ENTER) {
+            realtime_confine_current_thread("gst-streaming");
+        }
+    }
+    return GST_BUS_PASS;
+}
+
 static bool create_pipeline(const AppConfig& app_config, int camera_idx, GstElement** pipeline_ptr, GMainLoop** loop_ptr) {
     std::string device;
     int port;
@@ -65,7 +85,7 @@ static bool create_pipeline(const AppConfig& app_config, int camera_idx, GstElem
         x264_tune = app_config.gst2_x264_tune;
         x264_speed_preset = app_config.gst2_x264_speed_preset;
     } else {
-        std::cerr << "エラー: 不明なカメラインデックス " << camera_idx << std::endl;
+        LOG_ERROR("エラー: 不明なカメラインデックス %d", camera_idx);
         return false;
     }
 
@@ -101,12 +121,17 @@ static bool create_pipeline(const AppConfig& app_config, int camera_idx, GstElem
     *pipeline_ptr = gst_parse_launch(pipeline_str.c_str(), &error);
     if (!*pipeline_ptr) {
         // パイプライン作成失敗時のエラー処理
-        std::cerr << "GStreamerパイプライン作成失敗 (カメラ" << camera_idx << " - " << device << "): " << error->message << std::endl;
+        LOG_ERROR("GStreamerパイプライン作成失敗 (カメラ%d - %s): %s", camera_idx, device.c_str(), error->message);
         g_error_free(error);
         return false;
     }
     // 作成されたパイプライン文字列をデバッグ出力
-    std::cout << "GStreamer pipeline for camera " << camera_idx << " (" << device << "): " << pipeline_str << std::endl;
+    LOG_INFO("GStreamer pipeline for camera %d (%s): %s", camera_idx, device.c_str(), pipeline_str.c_str());
+
+    // ストリーミングスレッドの開始を検知するための同期ハンドラを登録 (PLAYING に遷移する前に行う)
+    GstBus* bus = gst_element_get_bus(*pipeline_ptr);
+    gst_bus_set_sync_handler(bus, on_bus_sync_message, nullptr, nullptr);
+    gst_object_unref(bus);
 
     // パイプライン用のGMainLoopを作成
     *loop_ptr = g_main_loop_new(nullptr, FALSE);
@@ -132,12 +157,12 @@ bool start_gstreamer_pipelines() {
     loop_thread1 = std::thread(run_main_loop, main_loop1);
     loop_thread2 = std::thread(run_main_loop, main_loop2);
 
-    std::cout << "GStreamerパイプラインを非同期で起動しました。" << std::endl;
+    LOG_INFO("GStreamerパイプラインを非同期で起動しました。");
     return true;
 }
 // GStreamerパイプラインを停止し、リソースを解放する関数
 void stop_gstreamer_pipelines() {
-    std::cout << "GStreamerパイプラインを停止します..." << std::endl;
+    LOG_INFO("GStreamerパイプラインを停止します...");
 
     if (pipeline1) {
         // パイプライン1をNULL状態に遷移させて停止
@@ -173,5 +198,17 @@ void stop_gstreamer_pipelines() {
         main_loop2 = nullptr;
     }
 
-    std::cout << "GStreamerパイプラインを停止しました。" << std::endl;
+    LOG_INFO("GStreamerパイプラインを停止しました。");
 }
+
+#else // WITH_GSTREAMER
+
+bool start_gstreamer_pipelines() {
+    LOG_INFO("GStreamer なしでビルドされているため、カメラ配信は行いません。");
+    return true;
+}
+
+void stop_gstreamer_pipelines() {
+}
+
+#endif // WITH_GSTREAMER
@@ -0,0 +1,45 @@
+#include "hal.h"
+#include "logger.h" // LOG_*
+#include <string.h> // strcmp
+
+// 組み込まれているバックエンドの一覧 (先頭がビルド時の既定値)
+static const HalBackend *const backends[] = {
+#ifdef HAL_NAVIGATOR
+    &hal_navigator_backend,
+#endif
+    &hal_sim_backend,
+    &hal_replay_backend,
+};
+static const size_t BACKEND_COUNT = sizeof(backends) / sizeof(backends[0]);
+
+const HalBackend *g_hal = backends[0];
+
+const char *hal_default_backend_name()
+{
+    return backends[0]->name;
+}
+
+bool hal_select(const char *name)
+{
+    if (!name || name[0] == '\0')
+    {
+        g_hal = backends[0];
+        return true;
+    }
+    for (size_t i = 0; i < BACKEND_COUNT; ++i)
+    {
+        if (strcmp(backends[i]->name, name) == 0)
+        {
+            g_hal = backends[i];
+            return true;
+        }
+    }
+    LOG_ERROR("HAL バックエンド '%s' はこのビルドに含まれていません (既定: %s)。", name, hal_default_backend_name());
+    return false;
+}
+
+bool hal_init()
+{
+    LOG_INFO("HAL バックエンド: %s", g_hal->name);
+    return g_hal->init();
+}
@@ -0,0 +1,56 @@
+// navigator-lib (bindings.h) を呼ぶ実機用バックエンド。HAL_NAVIGATOR 定義時のみ組み込まれる
+#ifdef HAL_NAVIGATOR
+
+#include "hal.h"
+
+#ifdef NAVIGATOR_HAS_MULTI_CHANNEL_PWM
+static const char *const PWM_WRITE_MODE = "batched";
+#else
+static const char *const PWM_WRITE_MODE = "per-channel";
+#endif
+
+static bool navigator_init()
+{
+    init(); // Navigator ハードウェアライブラリの初期化
+    return true;
+}
+
+static void navigator_read_adc_all(float *adc, size_t count)
+{
+    read_adc_all(adc, static_cast<uintptr_t>(count));
+}
+
+static unsigned int navigator_set_pwm_duty_cycles(const uintptr_t *channels, const float *duty_cycles, size_t count)
+{
+    if (count == 0)
+        return 0;
+#ifdef NAVIGATOR_HAS_MULTI_CHANNEL_PWM
+    // 変更のあったチャンネルを1回のバス転送にまとめる
+    set_pwm_channels_duty_cycle_values(channels, duty_cycles, static_cast<uintptr_t>(count));
+    return 1;
+#else
+    for (size_t i = 0; i < count; ++i)
+    {
+        set_pwm_channel_duty_cycle(channels[i], duty_cycles[i]);
+    }
+    return static_cast<unsigned int>(count);
+#endif
+}
+
+const HalBackend hal_navigator_backend = {
+    "navigator",
+    PWM_WRITE_MODE,
+    navigator_init,
+    read_gyro,
+    read_accel,
+    read_mag,
+    read_temp,
+    read_pressure,
+    read_leak,
+    navigator_read_adc_all,
+    set_pwm_enable,
+    set_pwm_freq_hz,
+    navigator_set_pwm_duty_cycles,
+};
+
+#endif // HAL_NAVIGATOR
@@ -0,0 +1,184 @@
+// 再生バックエンド: 記録したセンサー値の CSV を、起動からの経過時間に合わせて返す。
+// 列: time_s,temp,pressure,leak,adc0,adc1,adc2,adc3,accx,accy,accz,gyrox,gyroy,gyroz,magx,magy,magz
+// (time_s は任意の起点からの秒。数値で始まらない行と '#' で始まる行は読み飛ばす)
+// PWM 出力は捨てる。
+#include "hal.h"
+#include "sensor_data.h" // SensorReadings
+#include "config.h"      // g_config (ファイル名・再生速度)
+#include "time_utils.h"  // monotonic_now_ns
+#include "logger.h"      // LOG_*
+#include <stdio.h>       // fopen, fgets
+#include <stdlib.h>      // strtod, strtof
+#include <vector>
+
+#define REPLAY_COLUMNS 17
+#define REPLAY_LINE_MAX 1024
+
+typedef struct
+{
+    int64_t time_ns; // 先頭サンプルからの相対時刻
+    SensorReadings readings;
+} ReplaySample;
+
+static std::vector<ReplaySample> samples; // 初期化時に全件読み込む (ループ中は確保しない)
+static size_t cursor = 0;                 // 現在のサンプル位置 (センサー取得スレッドだけが進める)
+static int64_t start_ns = 0;
+static double speed = 1.0;                // 再生速度 (1.0 で記録どおり)
+static bool end_reported = false;
+
+// ヘルパー関数: CSV の1行をパースする。列数が足りない場合は false
+static bool parse_line(const char *line, double *time_s, SensorReadings *r)
+{
+    float v[REPLAY_COLUMNS - 1];
+    char *end = NULL;
+    *time_s = strtod(line, &end);
+    if (end == line)
+        return false;
+    const char *p = end;
+    for (int i = 0; i < REPLAY_COLUMNS - 1; ++i)
+    {
+        if (*p != ',')
+            return false;
+        ++p;
+        v[i] = strtof(p, &end);
+        if (end == p)
+            return false;
+        p = end;
+    }
+    r->temperature = v[0];
+    r->pressure = v[1];
+    r->leak = v[2] != 0.0f;
+    for (int i = 0; i < 4; ++i)
+        r->adc[i] = v[3 + i];
+    r->accel.x = v[7];
+    r->accel.y = v[8];
+    r->accel.z = v[9];
+    r->gyro.x = v[10];
+    r->gyro.y = v[11];
+    r->gyro.z = v[12];
+    r->mag.x = v[13];
+    r->mag.y = v[14];
+    r->mag.z = v[15];
+    return true;
+}
+
+// ヘルパー関数: 現在時刻に対応するサンプルを返す
+static const SensorReadings &current_readings()
+{
+    int64_t elapsed_ns = static_cast<int64_t>(static_cast<double>(monotonic_now_ns() - start_ns) * speed);
+    int64_t duration_ns = samples.back().time_ns;
+    if (elapsed_ns > duration_ns)
+    {
+        if (g_config.hal_replay_loop && duration_ns > 0)
+        {
+            elapsed_ns %= duration_ns;
+            if (elapsed_ns < samples[cursor].time_ns)
+                cursor = 0; // 先頭へ巻き戻す
+        }
+        else if (!end_reported)
+        {
+            end_reported = true;
+            LOG_INFO("[HAL replay] 記録の終端に達しました。最後のサンプルを返し続けます。");
+        }
+    }
+    while (cursor + 1 < samples.size() && samples[cursor + 1].time_ns <= elapsed_ns)
+    {
+        cursor++;
+    }
+    return samples[cursor].readings;
+}
+
+static bool replay_init()
+{
+    const char *path = g_config.hal_replay_file.c_str();
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        LOG_ERROR("[HAL replay] 再生ファイル '%s' を開けません。", path);
+        return false;
+    }
+
+    samples.clear();
+    char line[REPLAY_LINE_MAX];
+    double first_time_s = 0.0;
+    unsigned long skipped = 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r' || line[0] == '\0')
+            continue;
+        ReplaySample s;
+        double time_s;
+        if (!parse_line(line, &time_s, &s.readings))
+        {
+            skipped++; // ヘッダー行や壊れた行
+            continue;
+        }
+        if (samples.empty())
+            first_time_s = time_s;
+        s.time_ns = static_cast<int64_t>((time_s - first_time_s) * 1e9);
+        if (!samples.empty() && s.time_ns < samples.back().time_ns)
+        {
+            skipped++; // 時刻が逆行する行は採用しない
+            continue;
+        }
+        samples.push_back(s);
+    }
+    fclose(fp);
+
+    if (samples.empty())
+    {
+        LOG_ERROR("[HAL replay] '%s' に有効なサンプルがありません。", path);
+        return false;
+    }
+    speed = g_config.hal_replay_speed > 0.0f ? g_config.hal_replay_speed : 1.0;
+    cursor = 0;
+    end_reported = false;
+    start_ns = monotonic_now_ns();
+    LOG_INFO("[HAL replay] '%s': %zu サンプル (%.1f 秒、読み飛ばし %lu 行) を %.2f 倍速で再生します%s。",
+             path, samples.size(), samples.back().time_ns / 1e9, skipped, speed,
+             g_config.hal_replay_loop ? " (繰り返し)" : "");
+    return true;
+}
+
+static AxisData replay_read_gyro() { return current_readings().gyro; }
+static AxisData replay_read_accel() { return current_readings().accel; }
+static AxisData replay_read_mag() { return current_readings().mag; }
+static float replay_read_temp() { return current_readings().temperature; }
+static float replay_read_pressure() { return current_readings().pressure; }
+static bool replay_read_leak() { return current_readings().leak; }
+
+static void replay_read_adc_all(float *adc, size_t count)
+{
+    const SensorReadings &r = current_readings();
+    for (size_t i = 0; i < count; ++i)
+        adc[i] = i < 4 ? r.adc[i] : 0.0f;
+}
+
+static void replay_set_pwm_enable(bool)
+{
+}
+
+static void replay_set_pwm_freq_hz(float)
+{
+}
+
+static unsigned int replay_set_pwm_duty_cycles(const uintptr_t *, const float *, size_t count)
+{
+    return count > 0 ? 1 : 0;
+}
+
+const HalBackend hal_replay_backend = {
+    "replay",
+    "discarded",
+    replay_init,
+    replay_read_gyro,
+    replay_read_accel,
+    replay_read_mag,
+    replay_read_temp,
+    replay_read_pressure,
+    replay_read_leak,
+    replay_read_adc_all,
+    replay_set_pwm_enable,
+    replay_set_pwm_freq_hz,
+    replay_set_pwm_duty_cycles,
+};
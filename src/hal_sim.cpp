@@ -0,0 +1,212 @@
+// 模擬バックエンド: 実機なしで main のループ全体を動かすため、静止した機体のセンサー値に
+// 決定的な擬似乱数のノイズを加えて返す。I2C の読み取り時間も設定値どおりに模擬する。
+// 車両シミュレータ (sim/rov_sim.cpp) は hal_sim_set_motion で運動中の真値を与え、hal_sim_pwm_us で出力を読む。
+#include "hal.h"
+#include "config.h"     // g_config (ノイズ・遅延の設定)
+#include "time_utils.h" // monotonic_now_ns, ns_to_timespec
+#include "logger.h"     // LOG_*
+#include <math.h>       // sqrtf, logf, sinf, cosf
+#include <errno.h>      // EINTR
+#include <time.h>       // clock_nanosleep
+
+#define SIM_GRAVITY 9.80665f
+#define SIM_TWO_PI 6.28318531f
+#define SIM_PWM_CHANNELS 16
+#define SIM_SPIN_THRESHOLD_NS (100 * NSEC_PER_USEC) // これ未満の遅延はスリープせずにスピンで待つ
+
+// --- 模擬環境の状態 ---
+static uint64_t sensor_rng = 1; // センサー取得スレッド用 (ノイズと読み取り遅延)
+static uint64_t pwm_rng = 2;    // 制御スレッド用 (PWM 書き込み遅延)。スレッド間で共有しない
+static bool has_spare_gaussian = false;
+static float spare_gaussian = 0.0f;
+static bool pwm_enabled = false;
+static float pwm_duty[SIM_PWM_CHANNELS];
+static float pwm_frequency_hz = 0.0f;
+static AxisData true_gyro = {0.0f, 0.0f, 0.0f};         // [deg/s]
+static AxisData true_accel = {0.0f, 0.0f, SIM_GRAVITY}; // [m/s^2]
+static AxisData true_mag = {20.0f, 0.0f, -40.0f};       // 北向き・伏角ありの地磁気 [uT]
+
+// ヘルパー関数: xorshift64* 擬似乱数 (シードが同じなら同じ列になる)
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// ヘルパー関数: (0, 1] の一様乱数
+static float uniform01(uint64_t *state)
+{
+    return static_cast<float>((next_random(state) >> 40) + 1) / 16777216.0f;
+}
+
+// ヘルパー関数: 標準正規乱数 (Box-Muller 法、2つ目の値は次回に使う)
+static float gaussian()
+{
+    if (has_spare_gaussian)
+    {
+        has_spare_gaussian = false;
+        return spare_gaussian;
+    }
+    float radius = sqrtf(-2.0f * logf(uniform01(&sensor_rng)));
+    float angle = SIM_TWO_PI * uniform01(&sensor_rng);
+    spare_gaussian = radius * sinf(angle);
+    has_spare_gaussian = true;
+    return radius * cosf(angle);
+}
+
+// ヘルパー関数: I2C 転送1回分の所要時間だけ待つ (平均 ± 一様なジッタ)
+static void simulate_i2c_transfer(uint64_t *rng)
+{
+    float latency_us = g_config.hal_sim_i2c_latency_us;
+    if (g_config.hal_sim_i2c_jitter_us > 0.0f)
+        latency_us += g_config.hal_sim_i2c_jitter_us * (2.0f * uniform01(rng) - 1.0f);
+    if (latency_us <= 0.0f)
+        return;
+
+    int64_t deadline_ns = monotonic_now_ns() + static_cast<int64_t>(latency_us * NSEC_PER_USEC);
+    if (latency_us * NSEC_PER_USEC < SIM_SPIN_THRESHOLD_NS)
+    {
+        while (monotonic_now_ns() < deadline_ns)
+        {
+        }
+        return;
+    }
+    struct timespec deadline = ns_to_timespec(deadline_ns);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+    {
+    }
+}
+
+// ヘルパー関数: 真値に軸ごとの正規ノイズを加える
+static AxisData with_noise(float x, float y, float z, float sigma)
+{
+    AxisData v = {x, y, z};
+    if (sigma > 0.0f)
+    {
+        v.x += sigma * gaussian();
+        v.y += sigma * gaussian();
+        v.z += sigma * gaussian();
+    }
+    return v;
+}
+
+static bool sim_init()
+{
+    sensor_rng = g_config.hal_sim_seed != 0 ? g_config.hal_sim_seed : 1; // 0 は xorshift の不動点
+    pwm_rng = sensor_rng ^ 0x9E3779B97F4A7C15ULL;
+    has_spare_gaussian = false;
+    pwm_enabled = false;
+    pwm_frequency_hz = 0.0f;
+    true_gyro.x = true_gyro.y = true_gyro.z = 0.0f;
+    true_accel.x = true_accel.y = 0.0f;
+    true_accel.z = SIM_GRAVITY;
+    true_mag.x = 20.0f;
+    true_mag.y = 0.0f;
+    true_mag.z = -40.0f;
+    for (int i = 0; i < SIM_PWM_CHANNELS; ++i)
+        pwm_duty[i] = 0.0f;
+    LOG_INFO("[HAL sim] seed=%llu gyro_noise=%.3fdps bias=(%.2f, %.2f, %.2f)dps i2c=%.0f±%.0fus",
+             static_cast<unsigned long long>(sensor_rng), g_config.hal_sim_gyro_noise_dps,
+             g_config.hal_sim_gyro_bias_dps[0], g_config.hal_sim_gyro_bias_dps[1], g_config.hal_sim_gyro_bias_dps[2],
+             g_config.hal_sim_i2c_latency_us, g_config.hal_sim_i2c_jitter_us);
+    return true;
+}
+
+static AxisData sim_read_gyro()
+{
+    simulate_i2c_transfer(&sensor_rng);
+    const float *bias = g_config.hal_sim_gyro_bias_dps;
+    return with_noise(true_gyro.x + bias[0], true_gyro.y + bias[1], true_gyro.z + bias[2], g_config.hal_sim_gyro_noise_dps);
+}
+
+static AxisData sim_read_accel()
+{
+    simulate_i2c_transfer(&sensor_rng);
+    return with_noise(true_accel.x, true_accel.y, true_accel.z, g_config.hal_sim_accel_noise);
+}
+
+static AxisData sim_read_mag()
+{
+    simulate_i2c_transfer(&sensor_rng);
+    return with_noise(true_mag.x, true_mag.y, true_mag.z, g_config.hal_sim_mag_noise);
+}
+
+static float sim_read_temp()
+{
+    simulate_i2c_transfer(&sensor_rng);
+    return 20.0f;
+}
+
+static float sim_read_pressure()
+{
+    simulate_i2c_transfer(&sensor_rng);
+    return 101.325f;
+}
+
+static bool sim_read_leak()
+{
+    simulate_i2c_transfer(&sensor_rng);
+    return false;
+}
+
+static void sim_read_adc_all(float *adc, size_t count)
+{
+    simulate_i2c_transfer(&sensor_rng);
+    for (size_t i = 0; i < count; ++i)
+        adc[i] = 0.0f;
+}
+
+static void sim_set_pwm_enable(bool enabled)
+{
+    pwm_enabled = enabled;
+}
+
+static void sim_set_pwm_freq_hz(float frequency_hz)
+{
+    pwm_frequency_hz = frequency_hz;
+}
+
+static unsigned int sim_set_pwm_duty_cycles(const uintptr_t *channels, const float *duty_cycles, size_t count)
+{
+    if (count == 0)
+        return 0;
+    simulate_i2c_transfer(&pwm_rng); // 実機のまとめ書き込みと同じく1回の転送とみなす
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (channels[i] < SIM_PWM_CHANNELS)
+            pwm_duty[channels[i]] = pwm_enabled ? duty_cycles[i] : 0.0f;
+    }
+    return 1;
+}
+
+void hal_sim_set_motion(const AxisData &gyro_dps, const AxisData &accel, const AxisData &mag)
+{
+    true_gyro = gyro_dps;
+    true_accel = accel;
+    true_mag = mag;
+}
+
+float hal_sim_pwm_us(int channel)
+{
+    if (channel < 0 || channel >= SIM_PWM_CHANNELS || pwm_frequency_hz <= 0.0f)
+        return 0.0f;
+    return pwm_duty[channel] * 1e6f / pwm_frequency_hz;
+}
+
+const HalBackend hal_sim_backend = {
+    "sim",
+    "simulated",
+    sim_init,
+    sim_read_gyro,
+    sim_read_accel,
+    sim_read_mag,
+    sim_read_temp,
+    sim_read_pressure,
+    sim_read_leak,
+    sim_read_adc_all,
+    sim_set_pwm_enable,
+    sim_set_pwm_freq_hz,
+    sim_set_pwm_duty_cycles,
+};
@@ -0,0 +1,207 @@
+#include "imu_stream.h"
+#include "byte_order.h"        // リトルエンディアン読み書きと CRC
+#include "config.h"            // g_config ([IMU_STREAM])
+#include "time_utils.h"        // NSEC_PER_USEC
+#include "latency_histogram.h" // LAT_STAGE_IMU_STREAM
+#include "logger.h"            // LOG_*
+#include <string.h>            // memset
+#include <atomic>
+
+// --- モジュール内部状態 ---
+// リングバッファ: 書き込みはセンサー取得スレッド (g_head)、読み取りはメインループ (g_tail) のみ
+static ImuSample g_ring[IMU_STREAM_RING_SIZE];
+static std::atomic<uint32_t> g_head(0); // 次に書き込む位置 (単調増加。添字は RING_SIZE で割った余り)
+static std::atomic<uint32_t> g_tail(0); // 次に読み取る位置
+static std::atomic<unsigned long long> g_samples(0);
+static std::atomic<unsigned long long> g_dropped(0);
+
+// メインループのみが使う状態
+static bool g_enabled = false;
+static unsigned int g_samples_per_datagram = 1;
+static unsigned int g_flush_period_us = 0;
+static uint32_t g_sequence = 0;
+static ImuStreamStats g_tx_stats;                        // sent 以降 (送信側) の統計
+static ImuSample g_chunk[IMU_STREAM_MAX_SAMPLES];        // 1データグラム分のサンプル (リングの折り返しをまたいで集める)
+static uint8_t g_packet[IMU_STREAM_MAX_PACKET_SIZE];
+
+void imu_stream_init()
+{
+    g_head.store(0);
+    g_tail.store(0);
+    g_samples.store(0);
+    g_dropped.store(0);
+    g_sequence = 0;
+    memset(&g_tx_stats, 0, sizeof(g_tx_stats));
+
+    g_enabled = g_config.imu_stream_enabled;
+    if (g_enabled && g_config.imu_stream_rate_hz <= 0.0f)
+    {
+        LOG_WARN("[IMU STREAM] RATE_HZ が 0 以下のため無効にします。");
+        g_enabled = false;
+    }
+    g_samples_per_datagram = g_config.imu_stream_samples_per_datagram;
+    if (g_samples_per_datagram < 1)
+        g_samples_per_datagram = 1;
+    if (g_samples_per_datagram > IMU_STREAM_MAX_SAMPLES)
+    {
+        LOG_WARN("[IMU STREAM] SAMPLES_PER_DATAGRAM=%u は上限を超えるため %d にします。", g_samples_per_datagram,
+                 IMU_STREAM_MAX_SAMPLES);
+        g_samples_per_datagram = IMU_STREAM_MAX_SAMPLES;
+    }
+    unsigned int flush_ms = g_config.imu_stream_flush_ms > 0 ? g_config.imu_stream_flush_ms : 1;
+    g_flush_period_us = g_enabled ? flush_ms * 1000 : 0;
+    if (!g_enabled)
+        return;
+
+    // 1回のフラッシュで溜まるサンプル数 (これが SAMPLES_PER_DATAGRAM を超えると複数のデータグラムに分かれる)
+    float per_flush = g_config.imu_stream_rate_hz * static_cast<float>(flush_ms) / 1000.0f;
+    if (per_flush > static_cast<float>(IMU_STREAM_RING_SIZE))
+    {
+        LOG_WARN("[IMU STREAM] FLUSH_MS の間に %.0f サンプル溜まり、リング (%d) に収まりません。FLUSH_MS を短くしてください。",
+                 per_flush, IMU_STREAM_RING_SIZE);
+    }
+    else if (per_flush > static_cast<float>(g_samples_per_datagram))
+    {
+        LOG_WARN("[IMU STREAM] FLUSH_MS の間に %.0f サンプル溜まるため、1回のフラッシュで複数のデータグラムを送ります "
+                 "(SAMPLES_PER_DATAGRAM=%u)。",
+                 per_flush, g_samples_per_datagram);
+    }
+    LOG_INFO("[IMU STREAM] %.0fHz のジャイロ・加速度を %u ms ごとに最大 %u サンプル/データグラムで送信します。",
+             g_config.imu_stream_rate_hz, flush_ms, g_samples_per_datagram);
+}
+
+bool imu_stream_enabled()
+{
+    return g_enabled;
+}
+
+unsigned int imu_stream_flush_period_us()
+{
+    return g_flush_period_us;
+}
+
+bool imu_stream_push(const AxisData &gyro, const AxisData &accel, int64_t time_ns)
+{
+    uint32_t head = g_head.load(std::memory_order_relaxed);
+    uint32_t tail = g_tail.load(std::memory_order_acquire);
+    if (head - tail >= IMU_STREAM_RING_SIZE)
+    {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ImuSample *slot = &g_ring[head & (IMU_STREAM_RING_SIZE - 1)];
+    slot->time_ns = time_ns;
+    slot->gyro = gyro;
+    slot->accel = accel;
+    g_head.store(head + 1, std::memory_order_release);
+    g_samples.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t imu_stream_encode_packet(uint32_t sequence, uint32_t dropped, const ImuSample *samples, unsigned int count,
+                                uint8_t *buffer, size_t buffer_size)
+{
+    size_t size = IMU_STREAM_HEADER_SIZE + IMU_STREAM_SAMPLE_SIZE * static_cast<size_t>(count) + 2;
+    if (!samples || !buffer || count < 1 || count > IMU_STREAM_MAX_SAMPLES || buffer_size < size)
+        return 0;
+
+    const int64_t base_ns = samples[0].time_ns;
+    unsigned char *p = buffer;
+    p[0] = IMU_STREAM_MAGIC0;
+    p[1] = IMU_STREAM_MAGIC1;
+    p[2] = IMU_STREAM_PACKET_VERSION;
+    p[3] = static_cast<uint8_t>(count);
+    write_le32(p + 4, sequence);
+    write_le32(p + 8, dropped);
+    write_le64(p + 12, static_cast<uint64_t>(base_ns / NSEC_PER_USEC));
+    p += IMU_STREAM_HEADER_SIZE;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const ImuSample &s = samples[i];
+        write_le32(p, static_cast<uint32_t>((s.time_ns - base_ns) / NSEC_PER_USEC));
+        write_le_float(p + 4, s.gyro.x);
+        write_le_float(p + 8, s.gyro.y);
+        write_le_float(p + 12, s.gyro.z);
+        write_le_float(p + 16, s.accel.x);
+        write_le_float(p + 20, s.accel.y);
+        write_le_float(p + 24, s.accel.z);
+        p += IMU_STREAM_SAMPLE_SIZE;
+    }
+    write_le16(p, crc16_ccitt(buffer, size - 2));
+    return size;
+}
+
+int imu_stream_flush(NetworkContext *net)
+{
+    if (!g_enabled || !net)
+        return 0;
+
+    g_tx_stats.flushes++;
+    uint32_t tail = g_tail.load(std::memory_order_relaxed);
+    const uint32_t head = g_head.load(std::memory_order_acquire);
+    uint32_t backlog = head - tail;
+    if (backlog > g_tx_stats.max_backlog)
+        g_tx_stats.max_backlog = backlog;
+    if (backlog == 0)
+        return 0;
+
+    // 送信先が決まるまでは溜めずに捨てる (接続直後に古いサンプルをまとめて送らない)
+    if (!net->client_addr_known)
+    {
+        g_tx_stats.discarded += backlog;
+        g_tail.store(head, std::memory_order_release);
+        return 0;
+    }
+
+    int datagrams = 0;
+    const uint32_t dropped = static_cast<uint32_t>(g_dropped.load(std::memory_order_relaxed));
+    while (tail != head)
+    {
+        unsigned int count = 0;
+        while (count < g_samples_per_datagram && tail != head)
+        {
+            g_chunk[count++] = g_ring[tail & (IMU_STREAM_RING_SIZE - 1)];
+            tail++;
+        }
+        g_tail.store(tail, std::memory_order_release); // コピーし終えた分をセンサー取得スレッドへ返す
+
+        int64_t pack_start_ns = latency_start();
+        size_t len = imu_stream_encode_packet(g_sequence, dropped, g_chunk, count, g_packet, sizeof(g_packet));
+        latency_stop(LAT_STAGE_IMU_STREAM, pack_start_ns);
+        g_sequence++;
+        if (len > 0 && network_send(net, reinterpret_cast<const char *>(g_packet), len))
+        {
+            g_tx_stats.sent += count;
+            g_tx_stats.datagrams++;
+            datagrams++;
+        }
+        else
+        {
+            g_tx_stats.send_errors++;
+        }
+    }
+    return datagrams;
+}
+
+void imu_stream_get_stats(ImuStreamStats *stats)
+{
+    if (!stats)
+        return;
+    *stats = g_tx_stats;
+    stats->samples = g_samples.load(std::memory_order_relaxed);
+    stats->dropped = g_dropped.load(std::memory_order_relaxed);
+}
+
+void imu_stream_print_stats()
+{
+    if (!g_enabled)
+        return;
+
+    ImuStreamStats st;
+    imu_stream_get_stats(&st);
+    double per_datagram = st.datagrams > 0 ? static_cast<double>(st.sent) / st.datagrams : 0.0;
+    LOG_INFO("[IMU STREAM] samples=%llu sent=%llu dropped=%llu discarded=%llu datagrams=%llu (%.1f samples/datagram) "
+             "send_errors=%llu flushes=%llu max_backlog=%u",
+             st.samples, st.sent, st.dropped, st.discarded, st.datagrams, per_datagram, st.send_errors, st.flushes,
+             st.max_backlog);
+}
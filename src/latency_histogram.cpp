@@ -0,0 +1,150 @@
+#include "latency_histogram.h"
+#include "logger.h" // LOG_INFO
+
+bool g_latency_profiling_enabled = true;
+
+// 全段階のヒストグラム (静的領域、ゼロ初期化)
+static LatencyHistogram g_histograms[LAT_STAGE_COUNT];
+
+static const char *const g_stage_names[LAT_STAGE_COUNT] = {
+    "net_recv",
+    "gamepad_parse",
+    "command_apply",
+    "control_tick",
+    "sensor_snapshot",
+    "thruster_update",
+    "mixer",
+    "pwm_write",
+    "telemetry_encode",
+    "telemetry_format",
+    "net_send",
+    "blackbox",
+    "sensor_read_all",
+    "i2c_gyro",
+    "i2c_accel",
+    "i2c_mag",
+    "i2c_temp_pressure",
+    "i2c_leak",
+    "adc",
+    "ahrs",
+    "imu_stream"};
+
+// ヘルパー関数: 値からバケット番号を求める
+// 値 < 2^SUB_BITS はそのまま、それ以上は (指数, 上位 SUB_BITS ビット) で分類する
+static size_t bucket_index(uint64_t value)
+{
+    if (value < LATENCY_HIST_SUB_BUCKETS)
+        return static_cast<size_t>(value);
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > LATENCY_HIST_MAX_EXPONENT)
+        return LATENCY_HIST_BUCKETS - 1;
+    size_t sub = static_cast<size_t>(value >> (exponent - LATENCY_HIST_SUB_BITS)) & (LATENCY_HIST_SUB_BUCKETS - 1);
+    return static_cast<size_t>(exponent - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_BUCKETS + sub;
+}
+
+// ヘルパー関数: バケットに入る値の上限 (このバケットの値はすべてこれ未満)
+static uint64_t bucket_upper_bound(size_t index)
+{
+    if (index < LATENCY_HIST_SUB_BUCKETS)
+        return index + 1;
+    int exponent = static_cast<int>(index / LATENCY_HIST_SUB_BUCKETS) + LATENCY_HIST_SUB_BITS - 1;
+    uint64_t sub = index % LATENCY_HIST_SUB_BUCKETS;
+    return (static_cast<uint64_t>(LATENCY_HIST_SUB_BUCKETS) + sub + 1) << (exponent - LATENCY_HIST_SUB_BITS);
+}
+
+void latency_record(LatencyStage stage, int64_t elapsed_ns)
+{
+    if (stage < 0 || stage >= LAT_STAGE_COUNT)
+        return;
+    LatencyHistogram *h = &g_histograms[stage];
+    uint64_t value = elapsed_ns > 0 ? static_cast<uint64_t>(elapsed_ns) : 0;
+
+    // 単一書き込みのため read-modify-write 命令は不要 (読み取り側が途中の値を見ても統計上問題ない)
+    std::atomic<uint32_t> &bucket = h->buckets[bucket_index(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    uint64_t count = h->count.load(std::memory_order_relaxed);
+    if (count == 0 || value < h->min_ns.load(std::memory_order_relaxed))
+        h->min_ns.store(value, std::memory_order_relaxed);
+    if (value > h->max_ns.load(std::memory_order_relaxed))
+        h->max_ns.store(value, std::memory_order_relaxed);
+    h->sum_ns.store(h->sum_ns.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    h->count.store(count + 1, std::memory_order_relaxed);
+}
+
+void latency_summarize(LatencyStage stage, LatencySummary *summary)
+{
+    if (!summary)
+        return;
+    *summary = LatencySummary();
+    if (stage < 0 || stage >= LAT_STAGE_COUNT)
+        return;
+
+    const LatencyHistogram *h = &g_histograms[stage];
+    uint64_t total = 0;
+    for (size_t i = 0; i < LATENCY_HIST_BUCKETS; ++i)
+        total += h->buckets[i].load(std::memory_order_relaxed);
+    if (total == 0)
+        return;
+
+    summary->count = total;
+    summary->min_ns = h->min_ns.load(std::memory_order_relaxed);
+    summary->max_ns = h->max_ns.load(std::memory_order_relaxed);
+    summary->mean_ns = static_cast<double>(h->sum_ns.load(std::memory_order_relaxed)) /
+                       static_cast<double>(h->count.load(std::memory_order_relaxed) > 0 ? h->count.load(std::memory_order_relaxed) : 1);
+
+    // 各パーセンタイルに達したバケットの上限を返す (最大値を超えないように丸める)
+    const double quantiles[4] = {0.50, 0.90, 0.99, 0.999};
+    uint64_t *outputs[4] = {&summary->p50_ns, &summary->p90_ns, &summary->p99_ns, &summary->p999_ns};
+    int q = 0;
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < LATENCY_HIST_BUCKETS && q < 4; ++i)
+    {
+        cumulative += h->buckets[i].load(std::memory_order_relaxed);
+        while (q < 4 && static_cast<double>(cumulative) >= quantiles[q] * static_cast<double>(total))
+        {
+            uint64_t bound = bucket_upper_bound(i);
+            *outputs[q] = bound < summary->max_ns ? bound : summary->max_ns;
+            q++;
+        }
+    }
+}
+
+const char *latency_stage_name(LatencyStage stage)
+{
+    if (stage < 0 || stage >= LAT_STAGE_COUNT)
+        return "?";
+    return g_stage_names[stage];
+}
+
+void latency_reset_all()
+{
+    for (int s = 0; s < LAT_STAGE_COUNT; ++s)
+    {
+        LatencyHistogram *h = &g_histograms[s];
+        for (size_t i = 0; i < LATENCY_HIST_BUCKETS; ++i)
+            h->buckets[i].store(0, std::memory_order_relaxed);
+        h->count.store(0, std::memory_order_relaxed);
+        h->sum_ns.store(0, std::memory_order_relaxed);
+        h->min_ns.store(0, std::memory_order_relaxed);
+        h->max_ns.store(0, std::memory_order_relaxed);
+    }
+}
+
+void latency_print_all()
+{
+    if (!g_latency_profiling_enabled)
+        return;
+    LOG_INFO("[STAGE LATENCY] %-18s %10s %9s %9s %9s %9s %9s %9s %9s (us)",
+           "stage", "count", "min", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (int s = 0; s < LAT_STAGE_COUNT; ++s)
+    {
+        LatencySummary sum;
+        latency_summarize(static_cast<LatencyStage>(s), &sum);
+        if (sum.count == 0)
+            continue;
+        LOG_INFO("[STAGE LATENCY] %-18s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f",
+               g_stage_names[s], (unsigned long long)sum.count,
+               sum.min_ns / 1000.0, sum.mean_ns / 1000.0, sum.p50_ns / 1000.0, sum.p90_ns / 1000.0,
+               sum.p99_ns / 1000.0, sum.p999_ns / 1000.0, sum.max_ns / 1000.0);
+    }
+}
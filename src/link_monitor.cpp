@@ -0,0 +1,165 @@
+#include "link_monitor.h"
+#include "config.h"     // g_config (CONNECTION_TIMEOUT_SECONDS, DEGRADED_TIMEOUT_SECONDS)
+#include "time_utils.h" // NSEC_PER_SEC, NSEC_PER_USEC
+#include "logger.h"     // LOG_INFO, LOG_WARN
+#include <string.h>     // memset
+
+static const char *const LINK_STATE_NAMES[LINK_STATE_COUNT] = {
+    "WAITING", "CONNECTED", "DEGRADED", "FAILSAFE_HOLD", "RECONNECTED"};
+
+// ヘルパー関数: 状態を遷移させて回数を数える
+static void enter_state(LinkMonitor *link, LinkState next, int64_t now_ns)
+{
+    link->state = next;
+    link->state_since_ns = now_ns;
+    link->entries[next]++;
+}
+
+void link_monitor_init(LinkMonitor *link, int64_t now_ns)
+{
+    if (!link)
+        return;
+
+    memset(link, 0, sizeof(LinkMonitor));
+    enter_state(link, LINK_WAITING, now_ns);
+}
+
+const char *link_state_name(LinkState state)
+{
+    if (state < 0 || state >= LINK_STATE_COUNT)
+        return "UNKNOWN";
+    return LINK_STATE_NAMES[state];
+}
+
+bool link_monitor_control_enabled(const LinkMonitor *link)
+{
+    return link && (link->state == LINK_CONNECTED || link->state == LINK_DEGRADED);
+}
+
+bool link_monitor_check_timeout(LinkMonitor *link, int64_t now_ns, double since_last_command_s)
+{
+    if (!link)
+        return false;
+
+    switch (link->state)
+    {
+    case LINK_CONNECTED:
+    case LINK_DEGRADED:
+        if (since_last_command_s > g_config.connection_timeout_seconds)
+        {
+            LOG_WARN("[LINK] %s -> FAILSAFE_HOLD: 最後のコマンドから %.3f 秒。スラスターを停止出力にして再接続を待ちます。",
+                     link_state_name(link->state), since_last_command_s);
+            enter_state(link, LINK_FAILSAFE_HOLD, now_ns);
+            link->hold_start_ns = now_ns;
+            link->reconnect_ns = 0;
+            return true;
+        }
+        if (link->state == LINK_CONNECTED && since_last_command_s > g_config.degraded_timeout_seconds)
+        {
+            LOG_WARN("[LINK] CONNECTED -> DEGRADED: 最後のコマンドから %.3f 秒。", since_last_command_s);
+            enter_state(link, LINK_DEGRADED, now_ns);
+        }
+        break;
+
+    case LINK_RECONNECTED:
+        // データグラムは届いたが採用できるコマンドが来ない (古いシーケンスのみ、検証失敗など)
+        if (now_ns - link->reconnect_ns > static_cast<int64_t>(g_config.connection_timeout_seconds * NSEC_PER_SEC))
+        {
+            LOG_WARN("[LINK] RECONNECTED -> FAILSAFE_HOLD: 再接続後 %.3f 秒以内に有効なコマンドがありません。",
+                     g_config.connection_timeout_seconds);
+            enter_state(link, LINK_FAILSAFE_HOLD, now_ns);
+            link->reconnect_ns = 0;
+        }
+        break;
+
+    default:
+        break;
+    }
+    return false;
+}
+
+void link_monitor_datagram_seen(LinkMonitor *link, int64_t now_ns, unsigned long long rx_total)
+{
+    if (!link)
+        return;
+
+    if (link->state == LINK_FAILSAFE_HOLD)
+    {
+        if (rx_total > link->rx_at_hold)
+        {
+            LOG_INFO("[LINK] FAILSAFE_HOLD -> RECONNECTED: データグラムを受信しました (停止から %.3f 秒)。",
+                     (now_ns - link->hold_start_ns) / 1e9);
+            enter_state(link, LINK_RECONNECTED, now_ns);
+            link->reconnect_ns = now_ns;
+        }
+    }
+    // RECONNECTED -> FAILSAFE_HOLD に戻った後は、その後に届いたものだけを再接続とみなす
+    link->rx_at_hold = rx_total;
+}
+
+bool link_monitor_command_received(LinkMonitor *link, int64_t now_ns)
+{
+    if (!link)
+        return false;
+
+    switch (link->state)
+    {
+    case LINK_WAITING:
+        LOG_INFO("[LINK] WAITING -> CONNECTED: 最初のコマンドを受信しました。");
+        enter_state(link, LINK_CONNECTED, now_ns);
+        return true;
+    case LINK_DEGRADED:
+        LOG_INFO("[LINK] DEGRADED -> CONNECTED: コマンドが再開しました (途切れていた時間 %.3f 秒)。",
+                 (now_ns - link->state_since_ns) / 1e9);
+        enter_state(link, LINK_CONNECTED, now_ns);
+        return false;
+    case LINK_FAILSAFE_HOLD:
+    case LINK_RECONNECTED:
+        // 受信処理の中で datagram_seen より先に呼ばれることはないが、念のため再接続時刻を補う
+        if (link->reconnect_ns == 0)
+            link->reconnect_ns = now_ns;
+        return true; // 状態は command_applied で CONNECTED にする
+    default:
+        return false;
+    }
+}
+
+void link_monitor_command_applied(LinkMonitor *link, int64_t now_ns)
+{
+    if (!link)
+        return;
+
+    if (link->state == LINK_FAILSAFE_HOLD || link->state == LINK_RECONNECTED)
+    {
+        int64_t resume_ns = now_ns - link->reconnect_ns;
+        int64_t outage_ns = now_ns - link->hold_start_ns;
+        link->resumes++;
+        link->last_resume_ns = resume_ns;
+        link->sum_resume_ns += static_cast<double>(resume_ns);
+        if (resume_ns > link->max_resume_ns)
+            link->max_resume_ns = resume_ns;
+        link->last_outage_ns = outage_ns;
+        if (outage_ns > link->max_outage_ns)
+            link->max_outage_ns = outage_ns;
+        LOG_INFO("[LINK] %s -> CONNECTED: 制御を再開しました (再接続から最初のコマンド反映まで %.1f us、停止時間 %.3f 秒)。",
+                 link_state_name(link->state), resume_ns / static_cast<double>(NSEC_PER_USEC), outage_ns / 1e9);
+        enter_state(link, LINK_CONNECTED, now_ns);
+        link->hold_start_ns = 0;
+        link->reconnect_ns = 0;
+    }
+}
+
+void link_monitor_print_stats(const LinkMonitor *link)
+{
+    if (!link)
+        return;
+
+    double mean_resume_us = link->resumes > 0 ? link->sum_resume_ns / link->resumes / NSEC_PER_USEC : 0.0;
+    LOG_INFO("[LINK STATS] state=%s degraded=%llu holds=%llu reconnects=%llu resumes=%llu "
+             "resume_us(last/mean/max)=%.1f/%.1f/%.1f outage_s(last/max)=%.3f/%.3f",
+             link_state_name(link->state), link->entries[LINK_DEGRADED], link->entries[LINK_FAILSAFE_HOLD],
+             link->entries[LINK_RECONNECTED], link->resumes,
+             link->last_resume_ns / static_cast<double>(NSEC_PER_USEC), mean_resume_us,
+             link->max_resume_ns / static_cast<double>(NSEC_PER_USEC),
+             link->last_outage_ns / 1e9, link->max_outage_ns / 1e9);
+}
@@ -0,0 +1,568 @@
+#include "logger.h"
+#include "time_utils.h" // monotonic_now_ns
+#include "realtime.h"   // realtime_confine_current_thread
+#include <stdio.h>
+#include <stdlib.h>     // atoi
+#include <signal.h>     // pthread_sigmask
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <system_error>
+
+int g_log_min_level = LOG_LEVEL_INFO;
+
+// --- レコードの形式 ---
+// [LogRecordHeader][引数 0][引数 1]...  引数 = 型タグ1バイト + 値 (文字列は長さ2バイト + 内容)
+// リング内では8バイト境界に切り上げて格納し、size == 0 はリング末尾までの詰め物を表す
+typedef struct
+{
+    uint16_t size;      // レコード全体のバイト数 (ヘッダーを含む)
+    uint8_t level;
+    uint8_t arg_count;
+    uint8_t overflow;   // 引数が入りきらず切り捨てた
+    uint8_t reserved[3];
+    const char *fmt;    // 書式文字列 (文字列リテラルを指す)
+    int64_t timestamp_ns; // 記録時刻 (CLOCK_MONOTONIC)
+} LogRecordHeader;
+
+// スレッドごとの SPSC リング (書き込み: 所有スレッド, 読み取り: 書き込みスレッド)
+typedef struct
+{
+    std::atomic<size_t> head;        // 書き込み位置 (単調増加)
+    std::atomic<size_t> tail;        // 読み取り位置 (単調増加)
+    std::atomic<bool> in_use;        // いずれかのスレッドに割り当て済み
+    std::atomic<bool> owner_alive;   // 所有スレッドが生存中 (終了したスレッドのリングは空になれば再利用)
+    uint8_t buffer[LOG_RING_SIZE];
+} LogRing;
+
+static LogRing g_rings[LOG_MAX_THREADS];
+static std::atomic<unsigned long long> g_dropped(0);
+static std::atomic<bool> g_async_running(false);
+static std::thread g_writer_thread;
+static std::mutex g_sync_mutex; // 同期書き込み時の行の混在を防ぐ
+
+// スレッド終了時にリングを解放するための所有者オブジェクト
+struct LogRingOwner
+{
+    LogRing *ring;
+    LogRingOwner() : ring(NULL) {}
+    ~LogRingOwner()
+    {
+        if (ring)
+            ring->owner_alive.store(false, std::memory_order_release);
+    }
+};
+static thread_local LogRingOwner t_ring_owner;
+
+// ヘルパー関数: 呼び出しスレッドのリングを取得する (初回は空きリングを割り当てる。空きがなければ NULL)
+static LogRing *acquire_thread_ring()
+{
+    if (t_ring_owner.ring)
+        return t_ring_owner.ring;
+
+    for (int i = 0; i < LOG_MAX_THREADS; ++i)
+    {
+        LogRing *ring = &g_rings[i];
+        bool expected = false;
+        if (ring->in_use.compare_exchange_strong(expected, true))
+        {
+            ring->owner_alive.store(true, std::memory_order_release);
+            t_ring_owner.ring = ring;
+            return ring;
+        }
+        // 終了したスレッドのリングは、書き込みスレッドが読み終えていれば引き継ぐ
+        expected = false;
+        if (ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_acquire) &&
+            ring->owner_alive.compare_exchange_strong(expected, true))
+        {
+            t_ring_owner.ring = ring;
+            return ring;
+        }
+    }
+    return NULL;
+}
+
+// --- レコードの組み立て ---
+
+void log_builder_begin(LogRecordBuilder *b, int level, const char *fmt)
+{
+    LogRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.level = static_cast<uint8_t>(level);
+    header.fmt = fmt;
+    header.timestamp_ns = monotonic_now_ns();
+    memcpy(b->data, &header, sizeof(header));
+    b->used = sizeof(header);
+    b->arg_count = 0;
+    b->overflow = false;
+}
+
+void log_builder_put(LogRecordBuilder *b, uint8_t type, const void *value, size_t size)
+{
+    if (b->overflow || b->arg_count >= LOG_MAX_ARGS || b->used + 1 + size > LOG_MAX_RECORD_SIZE)
+    {
+        b->overflow = true;
+        return;
+    }
+    b->data[b->used++] = type;
+    memcpy(b->data + b->used, value, size);
+    b->used += size;
+    b->arg_count++;
+}
+
+void log_builder_put_string(LogRecordBuilder *b, const char *s)
+{
+    if (!s)
+        s = "(null)";
+    size_t len = strlen(s);
+    if (len > LOG_MAX_STRING_LEN)
+        len = LOG_MAX_STRING_LEN;
+    if (b->overflow || b->arg_count >= LOG_MAX_ARGS || b->used + 3 > LOG_MAX_RECORD_SIZE)
+    {
+        b->overflow = true;
+        return;
+    }
+    // 残り容量に合わせて切り詰める
+    if (b->used + 3 + len > LOG_MAX_RECORD_SIZE)
+        len = LOG_MAX_RECORD_SIZE - b->used - 3;
+    uint16_t len16 = static_cast<uint16_t>(len);
+    b->data[b->used++] = LOG_ARG_STRING;
+    memcpy(b->data + b->used, &len16, sizeof(len16));
+    b->used += sizeof(len16);
+    memcpy(b->data + b->used, s, len);
+    b->used += len;
+    b->arg_count++;
+}
+
+// --- 書式化 (書き込みスレッド、または同期書き込み時の呼び出しスレッドで実行) ---
+
+// 取り出した引数
+typedef struct
+{
+    uint8_t type;
+    long long i;
+    unsigned long long u;
+    double d;
+    const void *p;
+    const char *s; // 長さ付き (NUL 終端なし)
+    uint16_t len;
+} LogArg;
+
+// ヘルパー関数: 次の引数を読み取る (なければ false)
+static bool next_arg(const uint8_t *rec, size_t size, size_t *offset, LogArg *arg)
+{
+    if (*offset >= size)
+        return false;
+    memset(arg, 0, sizeof(LogArg));
+    arg->type = rec[(*offset)++];
+    switch (arg->type)
+    {
+    case LOG_ARG_INT:
+        memcpy(&arg->i, rec + *offset, sizeof(long long));
+        *offset += sizeof(long long);
+        break;
+    case LOG_ARG_UINT:
+        memcpy(&arg->u, rec + *offset, sizeof(unsigned long long));
+        *offset += sizeof(unsigned long long);
+        break;
+    case LOG_ARG_DOUBLE:
+        memcpy(&arg->d, rec + *offset, sizeof(double));
+        *offset += sizeof(double);
+        break;
+    case LOG_ARG_POINTER:
+        memcpy(&arg->p, rec + *offset, sizeof(const void *));
+        *offset += sizeof(const void *);
+        break;
+    case LOG_ARG_STRING:
+        memcpy(&arg->len, rec + *offset, sizeof(uint16_t));
+        *offset += sizeof(uint16_t);
+        arg->s = reinterpret_cast<const char *>(rec + *offset);
+        *offset += arg->len;
+        break;
+    default:
+        return false;
+    }
+    return *offset <= size;
+}
+
+// ヘルパー関数: 整数として取り出す (%*d の幅指定や型の食い違いに使う)
+static long long arg_as_int(const LogArg &arg)
+{
+    switch (arg.type)
+    {
+    case LOG_ARG_INT:
+        return arg.i;
+    case LOG_ARG_UINT:
+        return static_cast<long long>(arg.u);
+    case LOG_ARG_DOUBLE:
+        return static_cast<long long>(arg.d);
+    default:
+        return 0;
+    }
+}
+
+// ヘルパー関数: 変換指定1つを書式化する (spec は長さ修飾子を除いた "%-8.3" の部分、conv は変換文字)
+static int format_one(char *out, size_t out_size, const char *spec, char conv, int star_count, const int stars[2], const LogArg &arg)
+{
+    char fmt[32];
+    // 整数は記録時に long long に拡張しているため長さ修飾子を ll に置き換える
+    if (conv == 'd' || conv == 'i' || conv == 'u' || conv == 'x' || conv == 'X' || conv == 'o')
+        snprintf(fmt, sizeof(fmt), "%sll%c", spec, conv);
+    else
+        snprintf(fmt, sizeof(fmt), "%s%c", spec, conv);
+
+#define LOG_FORMAT_WITH_STARS(value)                                             \
+    (star_count == 2 ? snprintf(out, out_size, fmt, stars[0], stars[1], value) : \
+     star_count == 1 ? snprintf(out, out_size, fmt, stars[0], value) :           \
+                       snprintf(out, out_size, fmt, value))
+
+    switch (conv)
+    {
+    case 'd':
+    case 'i':
+        return LOG_FORMAT_WITH_STARS(arg_as_int(arg));
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        return LOG_FORMAT_WITH_STARS(arg.type == LOG_ARG_UINT ? arg.u : static_cast<unsigned long long>(arg_as_int(arg)));
+    case 'c':
+        return LOG_FORMAT_WITH_STARS(static_cast<int>(arg_as_int(arg)));
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        return LOG_FORMAT_WITH_STARS(arg.type == LOG_ARG_DOUBLE ? arg.d : static_cast<double>(arg_as_int(arg)));
+    case 'p':
+        return LOG_FORMAT_WITH_STARS(arg.p);
+    case 's':
+    {
+        if (arg.type != LOG_ARG_STRING)
+            return snprintf(out, out_size, "(?)");
+        // 長さ付き文字列を精度指定で出力する ("%-10s" の幅指定も維持)
+        char sfmt[40];
+        const char *dot = strchr(spec, '.');
+        if (dot)
+        {
+            // 記録時の精度指定は長さ付き文字列にそのまま適用できないため、短い方を使う
+            int precision = (star_count > 0 && dot[1] == '*') ? stars[star_count - 1] : atoi(dot + 1);
+            int len = precision < arg.len ? precision : arg.len;
+            snprintf(sfmt, sizeof(sfmt), "%.*s.*s", static_cast<int>(dot - spec), spec);
+            if (star_count == 2 || (star_count == 1 && dot[1] != '*'))
+                return snprintf(out, out_size, sfmt, stars[0], len, arg.s);
+            return snprintf(out, out_size, sfmt, len, arg.s);
+        }
+        snprintf(sfmt, sizeof(sfmt), "%s.*s", spec);
+        if (star_count == 1)
+            return snprintf(out, out_size, sfmt, stars[0], static_cast<int>(arg.len), arg.s);
+        return snprintf(out, out_size, sfmt, static_cast<int>(arg.len), arg.s);
+    }
+    default:
+        return 0;
+    }
+#undef LOG_FORMAT_WITH_STARS
+}
+
+// レコードを1行の文字列に変換する (改行を付加する)。書き込んだバイト数を返す
+static size_t format_record(const uint8_t *rec, size_t size, char *out, size_t out_size)
+{
+    LogRecordHeader header;
+    memcpy(&header, rec, sizeof(header));
+    size_t offset = sizeof(header);
+    size_t pos = 0;
+    const size_t limit = out_size - 2; // 改行と NUL 用
+
+    for (const char *f = header.fmt; *f && pos < limit; ++f)
+    {
+        if (*f != '%')
+        {
+            out[pos++] = *f;
+            continue;
+        }
+        if (f[1] == '%')
+        {
+            out[pos++] = '%';
+            ++f;
+            continue;
+        }
+
+        // 変換指定を解析: フラグ, 幅, 精度, 長さ修飾子, 変換文字
+        const char *start = f;
+        char spec[24];
+        size_t spec_len = 0;
+        int stars[2] = {0, 0};
+        int star_count = 0;
+        spec[spec_len++] = '%';
+        ++f;
+        while (*f && strchr("-+ #0123456789.*", *f))
+        {
+            if (*f == '*' && star_count < 2)
+            {
+                LogArg star_arg;
+                stars[star_count++] = next_arg(rec, size, &offset, &star_arg) ? static_cast<int>(arg_as_int(star_arg)) : 0;
+            }
+            if (spec_len < sizeof(spec) - 1)
+                spec[spec_len++] = *f;
+            ++f;
+        }
+        while (*f && strchr("hlLqjzt", *f))
+            ++f; // 長さ修飾子は捨てる (記録時に拡張済み)
+        spec[spec_len] = '\0';
+        if (!*f)
+            break;
+
+        LogArg arg;
+        if (!next_arg(rec, size, &offset, &arg))
+        {
+            // 引数が足りない場合は変換指定をそのまま出力する
+            size_t n = static_cast<size_t>(f - start + 1);
+            if (n > limit - pos)
+                n = limit - pos;
+            memcpy(out + pos, start, n);
+            pos += n;
+            continue;
+        }
+        int written = format_one(out + pos, limit - pos + 1, spec, *f, star_count, stars, arg);
+        if (written > 0)
+        {
+            pos += static_cast<size_t>(written);
+            if (pos > limit)
+                pos = limit;
+        }
+    }
+    if (header.overflow && pos + 4 < limit)
+    {
+        memcpy(out + pos, " ...", 4);
+        pos += 4;
+    }
+    out[pos++] = '\n';
+    out[pos] = '\0';
+    return pos;
+}
+
+// ヘルパー関数: レベルに応じた出力先
+static FILE *stream_for_level(int level)
+{
+    return level >= LOG_LEVEL_WARN ? stderr : stdout;
+}
+
+// ヘルパー関数: 呼び出しスレッドで直接書き込む (ロガー未起動時、またはリングが割り当てられない場合)
+static void write_sync(const uint8_t *rec, size_t size)
+{
+    char line[1024];
+    size_t len = format_record(rec, size, line, sizeof(line));
+    LogRecordHeader header;
+    memcpy(&header, rec, sizeof(header));
+    std::lock_guard<std::mutex> lock(g_sync_mutex);
+    FILE *stream = stream_for_level(header.level);
+    fwrite(line, 1, len, stream);
+    fflush(stream);
+}
+
+void log_builder_commit(LogRecordBuilder *b)
+{
+    LogRecordHeader header;
+    memcpy(&header, b->data, sizeof(header));
+    header.size = static_cast<uint16_t>(b->used);
+    header.arg_count = b->arg_count;
+    header.overflow = b->overflow ? 1 : 0;
+    memcpy(b->data, &header, sizeof(header));
+
+    if (!g_async_running.load(std::memory_order_acquire))
+    {
+        write_sync(b->data, b->used);
+        return;
+    }
+
+    LogRing *ring = acquire_thread_ring();
+    if (!ring)
+    {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // 8バイト境界に切り上げ、末尾に収まらない場合は詰め物を置いて先頭から書く
+    size_t record_size = (b->used + 7) & ~static_cast<size_t>(7);
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t tail = ring->tail.load(std::memory_order_acquire);
+    size_t pos = head & (LOG_RING_SIZE - 1);
+    size_t to_end = LOG_RING_SIZE - pos;
+    size_t needed = record_size + (to_end < record_size ? to_end : 0);
+    if (LOG_RING_SIZE - (head - tail) < needed)
+    {
+        g_dropped.fetch_add(1, std::memory_order_relaxed); // 満杯: 呼び出し側をブロックせずに捨てる
+        return;
+    }
+    if (to_end < record_size)
+    {
+        uint16_t pad = 0;
+        memcpy(ring->buffer + pos, &pad, sizeof(pad));
+        head += to_end;
+        pos = 0;
+    }
+    memcpy(ring->buffer + pos, b->data, b->used);
+    ring->head.store(head + record_size, std::memory_order_release);
+}
+
+bool log_rate_allow(LogRateLimiter *limiter, int level, unsigned int interval_ms)
+{
+    int64_t now = monotonic_now_ns();
+    if (limiter->last_ns != 0 && now - limiter->last_ns < static_cast<int64_t>(interval_ms) * NSEC_PER_MSEC)
+    {
+        limiter->suppressed++;
+        return false;
+    }
+    if (limiter->suppressed > 0)
+    {
+        log_write(level, "(同じメッセージを %lu 件抑制しました)", limiter->suppressed);
+        limiter->suppressed = 0;
+    }
+    limiter->last_ns = now;
+    return true;
+}
+
+// --- 書き込みスレッド ---
+
+// ヘルパー関数: 1つのリングを空になるまで書き出す。書き出したレコード数を返す
+static size_t drain_ring(LogRing *ring, bool *wrote_stdout, bool *wrote_stderr)
+{
+    size_t count = 0;
+    char line[1024];
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    size_t head = ring->head.load(std::memory_order_acquire);
+    while (tail != head)
+    {
+        size_t pos = tail & (LOG_RING_SIZE - 1);
+        uint16_t size;
+        memcpy(&size, ring->buffer + pos, sizeof(size));
+        if (size == 0)
+        {
+            tail += LOG_RING_SIZE - pos; // 詰め物: 先頭へ戻る
+            continue;
+        }
+        LogRecordHeader header;
+        memcpy(&header, ring->buffer + pos, sizeof(header));
+        size_t len = format_record(ring->buffer + pos, size, line, sizeof(line));
+        FILE *stream = stream_for_level(header.level);
+        fwrite(line, 1, len, stream);
+        if (stream == stderr)
+            *wrote_stderr = true;
+        else
+            *wrote_stdout = true;
+        tail += (static_cast<size_t>(size) + 7) & ~static_cast<size_t>(7);
+        count++;
+    }
+    ring->tail.store(tail, std::memory_order_release);
+    return count;
+}
+
+// ヘルパー関数: すべてのリングを一巡して書き出す
+static size_t drain_all()
+{
+    bool wrote_stdout = false;
+    bool wrote_stderr = false;
+    size_t count = 0;
+    for (int i = 0; i < LOG_MAX_THREADS; ++i)
+    {
+        if (g_rings[i].in_use.load(std::memory_order_acquire))
+            count += drain_ring(&g_rings[i], &wrote_stdout, &wrote_stderr);
+    }
+    // フラッシュは一巡ごとに1回だけ行う
+    if (wrote_stdout)
+        fflush(stdout);
+    if (wrote_stderr)
+        fflush(stderr);
+    return count;
+}
+
+static std::atomic<bool> g_writer_stop(false);
+
+static void writer_thread_main()
+{
+    realtime_confine_current_thread("logger"); // リアルタイムモード時は制御用コア以外で実行
+    unsigned long long reported_drops = 0;
+    const struct timespec idle = {0, 2 * NSEC_PER_MSEC};
+
+    while (!g_writer_stop.load(std::memory_order_acquire))
+    {
+        size_t count = drain_all();
+        unsigned long long drops = g_dropped.load(std::memory_order_relaxed);
+        if (drops != reported_drops)
+        {
+            fprintf(stderr, "[LOG] リングバッファ満杯のため %llu 件のログを破棄しました (累計 %llu)\n",
+                    drops - reported_drops, drops);
+            reported_drops = drops;
+        }
+        if (count == 0)
+            nanosleep(&idle, NULL);
+    }
+    drain_all(); // 停止前に残りを書き出す
+}
+
+bool logger_start()
+{
+    if (g_async_running.load())
+        return true;
+
+    // シグナルはメインスレッドで受け取るため、書き込みスレッドではブロックしておく
+    sigset_t block_set, old_set;
+    sigemptyset(&block_set);
+    sigaddset(&block_set, SIGINT);
+    sigaddset(&block_set, SIGTERM);
+    sigaddset(&block_set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &block_set, &old_set);
+    bool started = true;
+    g_writer_stop.store(false);
+    try
+    {
+        g_writer_thread = std::thread(writer_thread_main);
+    }
+    catch (const std::system_error &e)
+    {
+        fprintf(stderr, "ログ書き込みスレッドの起動に失敗 (同期出力で続行): %s\n", e.what());
+        started = false;
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    if (started)
+        g_async_running.store(true, std::memory_order_release);
+    return started;
+}
+
+void logger_stop()
+{
+    if (!g_async_running.exchange(false))
+        return;
+    // 以降の記録は同期書き込みになる。既にリングへ積まれた分は書き込みスレッドが書き出してから終了する
+    g_writer_stop.store(true, std::memory_order_release);
+    if (g_writer_thread.joinable())
+        g_writer_thread.join();
+    unsigned long long drops = g_dropped.load();
+    if (drops > 0)
+        fprintf(stderr, "[LOG] 破棄したログ: 累計 %llu 件\n", drops);
+}
+
+unsigned long long logger_dropped_count()
+{
+    return g_dropped.load(std::memory_order_relaxed);
+}
+
+bool log_parse_level(const char *name, int *level)
+{
+    if (!name || !level)
+        return false;
+    if (strcmp(name, "debug") == 0)
+        *level = LOG_LEVEL_DEBUG;
+    else if (strcmp(name, "info") == 0)
+        *level = LOG_LEVEL_INFO;
+    else if (strcmp(name, "warn") == 0)
+        *level = LOG_LEVEL_WARN;
+    else if (strcmp(name, "error") == 0)
+        *level = LOG_LEVEL_ERROR;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,154 @@
+#include "loop_scheduler.h"
+#include "time_utils.h" // monotonic_now_ns, NSEC_PER_USEC
+#include <string.h>     // memset, memcpy
+#include "logger.h"     // LOG_INFO
+#include <algorithm>    // std::nth_element
+
+// ヘルパー関数: リングバッファにサンプルを追加する
+static void push_sample(int64_t *samples, size_t *index, size_t *count, int64_t value)
+{
+    samples[*index] = value;
+    *index = (*index + 1) % LOOP_SCHED_SAMPLE_WINDOW;
+    if (*count < LOOP_SCHED_SAMPLE_WINDOW)
+    {
+        (*count)++;
+    }
+}
+
+// ヘルパー関数: サンプル列の99パーセンタイルを求める (元のバッファは変更しない)
+static int64_t percentile99(const int64_t *samples, size_t count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    int64_t work[LOOP_SCHED_SAMPLE_WINDOW];
+    memcpy(work, samples, count * sizeof(int64_t));
+    size_t rank = (count * 99) / 100;
+    if (rank >= count)
+    {
+        rank = count - 1;
+    }
+    std::nth_element(work, work + rank, work + count);
+    return work[rank];
+}
+
+void loop_scheduler_init(LoopScheduler *sched, unsigned int period_us)
+{
+    if (!sched)
+        return;
+
+    memset(sched, 0, sizeof(LoopScheduler));
+    sched->period_ns = static_cast<int64_t>(period_us > 0 ? period_us : 1) * NSEC_PER_USEC;
+    sched->next_deadline_ns = monotonic_now_ns() + sched->period_ns;
+    loop_scheduler_reset_stats(sched);
+}
+
+void loop_scheduler_record_wakeup(LoopScheduler *sched, int64_t wakeup_ns)
+{
+    if (!sched)
+        return;
+
+    sched->ticks++;
+
+    // ジッタ: デッドラインからの起床の遅れ
+    int64_t jitter = wakeup_ns - sched->next_deadline_ns;
+    sched->jitter_min_ns = std::min(sched->jitter_min_ns, jitter);
+    sched->jitter_max_ns = std::max(sched->jitter_max_ns, jitter);
+    sched->jitter_sum_ns += static_cast<double>(jitter);
+    push_sample(sched->jitter_samples, &sched->jitter_sample_index, &sched->jitter_sample_count, jitter);
+
+    // 周期: 前回の起床からの経過時間
+    if (sched->last_wakeup_ns != 0)
+    {
+        int64_t period = wakeup_ns - sched->last_wakeup_ns;
+        sched->period_min_ns = std::min(sched->period_min_ns, period);
+        sched->period_max_ns = std::max(sched->period_max_ns, period);
+        sched->period_sum_ns += static_cast<double>(period);
+        sched->period_count++;
+        push_sample(sched->period_samples, &sched->period_sample_index, &sched->period_sample_count, period);
+    }
+    sched->last_wakeup_ns = wakeup_ns;
+
+    // 次のデッドラインへ進める。周期ごと遅れた場合は追いつこうとせずに飛ばす
+    sched->next_deadline_ns += sched->period_ns;
+    if (sched->next_deadline_ns <= wakeup_ns)
+    {
+        int64_t missed = (wakeup_ns - sched->next_deadline_ns) / sched->period_ns + 1;
+        sched->next_deadline_ns += missed * sched->period_ns;
+        sched->missed_periods += static_cast<uint64_t>(missed);
+    }
+}
+
+void loop_scheduler_record_timer_tick(LoopScheduler *sched, int64_t wakeup_ns, uint64_t expirations)
+{
+    if (!sched)
+        return;
+
+    // timerfd は処理中に満了した回数をまとめて返すため、2回以上なら前周期の処理が周期を超過している
+    if (expirations > 1)
+    {
+        sched->overruns++;
+    }
+    loop_scheduler_record_wakeup(sched, wakeup_ns);
+}
+
+void loop_scheduler_get_stats(const LoopScheduler *sched, LoopSchedulerStats *stats)
+{
+    if (!sched || !stats)
+        return;
+
+    memset(stats, 0, sizeof(LoopSchedulerStats));
+    stats->ticks = sched->ticks;
+    stats->overruns = sched->overruns;
+    stats->missed_periods = sched->missed_periods;
+    if (sched->period_count > 0)
+    {
+        stats->period_min_ns = sched->period_min_ns;
+        stats->period_max_ns = sched->period_max_ns;
+        stats->period_mean_ns = sched->period_sum_ns / static_cast<double>(sched->period_count);
+        stats->period_p99_ns = percentile99(sched->period_samples, sched->period_sample_count);
+    }
+    if (sched->ticks > 0)
+    {
+        stats->jitter_min_ns = sched->jitter_min_ns;
+        stats->jitter_max_ns = sched->jitter_max_ns;
+        stats->jitter_mean_ns = sched->jitter_sum_ns / static_cast<double>(sched->ticks);
+        stats->jitter_p99_ns = percentile99(sched->jitter_samples, sched->jitter_sample_count);
+    }
+}
+
+void loop_scheduler_reset_stats(LoopScheduler *sched)
+{
+    if (!sched)
+        return;
+
+    sched->ticks = 0;
+    sched->overruns = 0;
+    sched->missed_periods = 0;
+    sched->period_min_ns = INT64_MAX;
+    sched->period_max_ns = INT64_MIN;
+    sched->period_sum_ns = 0.0;
+    sched->period_count = 0;
+    sched->jitter_min_ns = INT64_MAX;
+    sched->jitter_max_ns = INT64_MIN;
+    sched->jitter_sum_ns = 0.0;
+    sched->period_sample_index = 0;
+    sched->period_sample_count = 0;
+    sched->jitter_sample_index = 0;
+    sched->jitter_sample_count = 0;
+    sched->last_wakeup_ns = 0; // 次回の起床から周期計測をやり直す
+}
+
+void loop_scheduler_print_stats(const LoopScheduler *sched)
+{
+    LoopSchedulerStats s;
+    loop_scheduler_get_stats(sched, &s);
+    LOG_INFO("[LOOP STATS] target=%.1fHz ticks=%llu overruns=%llu missed=%llu",
+           1e9 / static_cast<double>(sched->period_ns),
+           (unsigned long long)s.ticks, (unsigned long long)s.overruns, (unsigned long long)s.missed_periods);
+    LOG_INFO("[LOOP STATS] period[us] min=%.1f mean=%.1f max=%.1f p99=%.1f",
+           s.period_min_ns / 1000.0, s.period_mean_ns / 1000.0, s.period_max_ns / 1000.0, s.period_p99_ns / 1000.0);
+    LOG_INFO("[LOOP STATS] jitter[us] min=%.1f mean=%.1f max=%.1f p99=%.1f",
+           s.jitter_min_ns / 1000.0, s.jitter_mean_ns / 1000.0, s.jitter_max_ns / 1000.0, s.jitter_p99_ns / 1000.0);
+}
@@ -5,41 +5,182 @@
 #include "sensor_data.h"      // センサーデータ読み取り・フォーマット関連
 #include "gstPipeline.h"      // GStreamerパイプライン起動用
 #include "config.h"           // 設定ファイル読み込みとグローバル設定オブジェクト
+#include "loop_scheduler.h"   // 絶対デッドラインによる周期実行とジッタ統計
+#include "time_utils.h"       // monotonic_now_ns
+#include "event_loop.h"       // epoll による受信ソケットとタイマーの待ち受け
+#include "telemetry.h"        // バイナリテレメトリフレームのエンコード
+#include "sensor_thread.h"    // センサー取得スレッドと最新値スナップショット
+#include "realtime.h"         // SCHED_FIFO・CPU固定・メモリロック
+#include "latency_histogram.h" // 処理段階ごとのレイテンシヒストグラム
+#include "logger.h"           // 非同期ロガー (LOG_*)
+#include "pwm_output.h"       // PWM 書き込み統計
+#include "hal.h"              // ハードウェア抽象化層 (navigator / sim / replay)
+#include "blackbox.h"         // フライトレコーダー (制御周期ごとの記録)
+#include "watchdog.h"         // 制御ループの停止を監視する独立スレッド
+#include "link_monitor.h"     // 接続状態 (CONNECTED / DEGRADED / FAILSAFE_HOLD / RECONNECTED)
+#include "command_hold.h"     // 短いパケット欠落時のコマンド保持と減衰
+#include "clock_sync.h"       // 地上局との時刻同期とコマンドの片道遅延
+#include "telemetry_fanout.h" // テレメトリの複数購読者への配信
+#include "imu_stream.h"       // 高レートの IMU ストリーム (複数サンプルを1データグラムに)
 
-#include <iostream> // 標準入出力 (std::cout, std::cerr)
-#include <unistd.h> // POSIX API (usleep)
-#include <string.h> // strlen
-#include <sys/time.h> // gettimeofday
+#include <string.h> // memset
+#include <signal.h> // sigaction, SIGUSR1, SIGINT, SIGTERM
 
+// --- シグナルハンドラから操作するフラグ ---
+static volatile sig_atomic_t g_stop_requested = 0;  // SIGINT/SIGTERM で終了要求
+static volatile sig_atomic_t g_stats_requested = 0; // SIGUSR1 でループ統計の表示要求
 
+// --- 受信ポートに届く制御パケット (ゲームパッド以外) の振り分け ---
+typedef struct
+{
+    ClockSync *clock_sync;
+    TelemetryFanout *telemetry_fanout;
+} ControlPacketHandlers;
+
+// NetworkControlHandler: 時刻同期 ('S','Y') と購読 ('S','B') を処理し、それ以外はゲームパッドの検証へ回す
+static bool control_packet_handler(const char *data, size_t len, const struct sockaddr_in *from, int64_t rx_realtime_ns,
+                                   void *user)
+{
+    ControlPacketHandlers *handlers = static_cast<ControlPacketHandlers *>(user);
+    if (g_config.clock_sync_enabled && clock_sync_packet_handler(handlers->clock_sync, data, len, rx_realtime_ns))
+        return true;
+    if (g_config.telemetry_subscriptions &&
+        telemetry_fanout_packet_handler(handlers->telemetry_fanout, data, len, from, monotonic_now_ns()))
+        return true;
+    return false;
+}
+
+// --- パケット到着からPWM出力までの遅延計測 (LATENCY_MEASURE=true の場合のみ) ---
+#define LATENCY_REPORT_EVERY 100 // この回数ごとに集計結果を表示する
+
+typedef struct
+{
+    unsigned int count;
+    int64_t min_ns;
+    int64_t max_ns;
+    int64_t sum_ns;
+} LatencyAccumulator;
+
+// 受信時刻 (カーネルタイムスタンプ、なければユーザー空間での受信時刻) からPWM出力完了までの遅延を記録する
+static void record_command_latency(LatencyAccumulator *acc, int64_t rx_realtime_ns)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now); // カーネルタイムスタンプと同じ時計で比較する
+    int64_t latency = timespec_to_ns(now) - rx_realtime_ns;
+
+    if (acc->count == 0 || latency < acc->min_ns)
+        acc->min_ns = latency;
+    if (acc->count == 0 || latency > acc->max_ns)
+        acc->max_ns = latency;
+    acc->sum_ns += latency;
+    acc->count++;
+
+    if (acc->count >= LATENCY_REPORT_EVERY)
+    {
+        LOG_INFO("[LATENCY] packet->PWM [us] min=%.1f mean=%.1f max=%.1f (n=%u)",
+               acc->min_ns / 1000.0, acc->sum_ns / 1000.0 / acc->count, acc->max_ns / 1000.0, acc->count);
+        memset(acc, 0, sizeof(LatencyAccumulator));
+    }
+}
+
+// 前回のスラスター更新からの実測経過時間 [s] を返す (初回は制御周期とみなす)
+static float elapsed_since_last_update(int64_t *last_update_ns)
+{
+    int64_t now_ns = monotonic_now_ns();
+    float dt_s = (*last_update_ns != 0) ? static_cast<float>(now_ns - *last_update_ns) / 1e9f
+                                        : static_cast<float>(g_config.loop_delay_us) / 1e6f;
+    *last_update_ns = now_ns;
+    return dt_s;
+}
+
+static void handle_stop_signal(int)
+{
+    g_stop_requested = 1;
+}
+
+static void handle_stats_signal(int)
+{
+    g_stats_requested = 1;
+}
+
+// シグナルハンドラを登録する
+static void install_signal_handlers()
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+
+    sa.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    sa.sa_handler = handle_stats_signal;
+    sigaction(SIGUSR1, &sa, NULL);
+}
 
 // --- メイン関数 ---
 int main()
 {
-    printf("Navigator C++ Control Application\n");
+    LOG_INFO("Navigator C++ Control Application");
     // --- 設定ファイルの読み込み ---
     // config.ini が見つからない場合、またはパースエラーが発生した場合は、
     // AppConfig 構造体のデフォルト値が使用されます。
     loadConfig("config.ini");
+    realtime_apply_process_profile(); // リアルタイムモード時はスレッド生成前にメモリをロックする
+    g_latency_profiling_enabled = g_config.stage_profiling;
+    g_log_min_level = g_config.log_level;
+    logger_start(); // 以降のログは書き込みスレッドが出力する (制御ループは書き込みでブロックしない)
 
     // --- 初期化 ---
-    printf("Initiating navigator module.\n");
-    init(); // Navigator ハードウェアライブラリの初期化 (bindings.h 経由)
+    // config.ini の [HAL] BACKEND で選んだバックエンド (未指定ならビルド時の既定値) を初期化する
+    if (!hal_select(g_config.hal_backend.c_str()) || !hal_init())
+    {
+        LOG_ERROR("ハードウェア (HAL) の初期化に失敗しました。終了します。");
+        logger_stop();
+        return -1;
+    }
 
     // ネットワークポートは設定ファイルから取得
     // ネットワークコンテキストの初期化
-    NetworkContext net_ctx; // ネットワークコンテキスト
+    static NetworkContext net_ctx; // ネットワークコンテキスト (受信リングを含むため静的領域に確保)
     if (!network_init(&net_ctx))
     {
-        std::cerr << "ネットワーク初期化失敗。終了します。" << std::endl;
+        LOG_ERROR("ネットワーク初期化失敗。終了します。");
+        logger_stop();
         return -1;
     }
+    // 時刻同期・テレメトリ購読のパケットは受信ポートでゲームパッドパケットより先に処理する
+    static ClockSync clock_sync;             // 片道遅延のサンプルバッファを含むため静的領域に確保
+    clock_sync_init(&clock_sync, &net_ctx);
+    static TelemetryFanout telemetry_fanout; // 購読者ごとのフレームと sendmmsg の領域を含むため静的領域に確保
+    telemetry_fanout_init(&telemetry_fanout, &net_ctx);
+    static ControlPacketHandlers control_handlers = {&clock_sync, &telemetry_fanout};
+    network_set_control_handler(&net_ctx, control_packet_handler, &control_handlers);
 
     // スラスター制御の初期化
     if (!thruster_init())
     {
-        std::cerr << "スラスター初期化失敗。終了します。" << std::endl;
+        LOG_ERROR("スラスター初期化失敗。終了します。");
         network_close(&net_ctx); // ネットワークリソースを解放
+        logger_stop();
+        return -1;
+    }
+
+    // フライトレコーダーの準備 (ファイルの確保とプリフォールトはここで済ませ、ループ中は書き込みのみ)
+    if (g_config.blackbox_enabled && !blackbox_open(g_config.blackbox_file.c_str(), g_config.blackbox_records))
+    {
+        LOG_WARN("フライトレコーダーを開けませんでした。記録せずに続行します...");
+    }
+
+    // センサー取得スレッドの起動 (以降、I2C の読み取りはこのスレッドだけが行う)
+    // IMU ストリームのリングはスレッドが書き込みを始める前に準備する
+    imu_stream_init();
+    if (!sensor_thread_start())
+    {
+        LOG_ERROR("センサー取得スレッドの起動に失敗しました。終了します。");
+        thruster_disable();
+        network_close(&net_ctx);
+        logger_stop();
         return -1;
     }
 
@@ -47,129 +188,306 @@ int main()
     // GStreamerパイプラインの起動
     if (!start_gstreamer_pipelines())
     {
-        std::cerr << "GStreamerパイプラインの起動に失敗しました。処理を続行します..." << std::endl;
+        LOG_WARN("GStreamerパイプラインの起動に失敗しました。処理を続行します...");
         // パイプライン起動失敗は致命的ではないかもしれないので、ここでは続行
     }
 
     // --- メインループ ---
     GamepadData latest_gamepad_data;                 // 最後に受信した有効なゲームパッドデータを保持
-    char recv_buffer[NET_BUFFER_SIZE];               // UDP受信バッファ
-    AxisData current_gyro_data = {0.0f, 0.0f, 0.0f}; // 最新のジャイロデータを保持
-    char sensor_buffer[SENSOR_BUFFER_SIZE];          // センサーデータ送信用文字列バッファ (sensor_data.h で定義)
-    unsigned int loop_counter = 0;                   // センサーデータ送信間隔制御用カウンター (configから取得)
-    bool running = true;                             // メインループの実行フラグ
+    AxisData current_gyro_data = {0.0f, 0.0f, 0.0f}; // 最新のジャイロデータを保持 (制御タイマーごとにスナップショットから更新)
+    int64_t last_thruster_update_ns = 0;            // 平滑化・PID の dt 計測用
+    SensorSnapshot sensor_snapshot;                  // センサー取得スレッドから読み取った最新値
+    memset(&sensor_snapshot, 0, sizeof(sensor_snapshot));
+    char sensor_buffer[SENSOR_BUFFER_SIZE];          // テキスト形式テレメトリ用の文字列バッファ (sensor_data.h で定義)
+    TelemetryEncoder telemetry_encoder;              // バイナリテレメトリのエンコーディングと FIELD_MASK
+    telemetry_encoder_init(&telemetry_encoder, static_cast<uint8_t>(g_config.telemetry_encoding), g_config.telemetry_field_mask);
+
+    LinkMonitor link;                  // 接続状態。初期状態は WAITING (最初の接続を待つ、スラスター停止)
+    link_monitor_init(&link, monotonic_now_ns());
+    CommandHold command_hold;          // 欠落中に制御周期へ渡すコマンドの保持・減衰と到着間隔の統計
+    command_hold_init(&command_hold);
+    GamepadSequenceFilter gamepad_sequence; // 重複・順序逆転パケット除外用のシーケンス番号状態
+    resetGamepadSequence(&gamepad_sequence);
 
-    bool currently_in_failsafe = true; // 初期状態はフェイルセーフ (最初の接続を待つ)
+    // 制御周期スケジューラ (絶対デッドラインで起床するため処理時間で周期がずれない)
+    static LoopScheduler scheduler; // サンプルバッファが大きいため静的領域に確保
+    install_signal_handlers();
+    int64_t stats_report_interval_ns = static_cast<int64_t>(g_config.stats_report_interval_s) * NSEC_PER_SEC;
+    int64_t last_stats_report_ns = monotonic_now_ns();
+    LatencyAccumulator latency_acc;
+    memset(&latency_acc, 0, sizeof(latency_acc));
 
-    std::cout << "メインループ開始。" << std::endl;
-    std::cout << "クライアントからの最初のデータ受信を待機しています... (スラスターはPWM: " << g_config.pwm_min << ")" << std::endl;
-    thruster_set_all_pwm(g_config.pwm_min); // プログラム開始時にスラスターを安全な状態に設定
+    LOG_INFO("メインループ開始。");
+    LOG_INFO("クライアントからの最初のデータ受信を待機しています... (スラスターは停止出力)");
+    thruster_set_all_stop(); // プログラム開始時にスラスターを推力曲線の停止出力に設定
 
-    // running フラグが true の間、ループを継続
-    while (running)
+    // ウォッチドッグの起動 (制御ループが止まっても TIMEOUT_MS 以内にスラスターを停止出力にする)
+    if (g_config.watchdog_enabled && !watchdog_start())
     {
-        struct timeval current_time_tv;
-        gettimeofday(&current_time_tv, NULL);
+        LOG_WARN("ウォッチドッグを起動できませんでした。処理を続行します...");
+    }
 
-        // 1. ネットワーク接続状態チェック (最後にパケットを受信してからの時間)
-        double time_since_last_packet = 0.0;
-        // net_ctx.client_addr_known は、network_receive内で最初の有効なパケット受信時にtrueになる
-        if (net_ctx.client_addr_known)
-        {
-            time_since_last_packet = (current_time_tv.tv_sec - net_ctx.last_successful_recv_time.tv_sec) +
-                                     (current_time_tv.tv_usec - net_ctx.last_successful_recv_time.tv_usec) / 1000000.0; // 秒単位
-        }
+    // 制御スレッド (このスレッド) を SCHED_FIFO にして専用コアへ固定する
+    // 以降に生成されるスレッドへ継承させないよう、他のスレッドをすべて起動した後に行う
+    realtime_apply_control_thread();
+    realtime_print_report();
 
-        // 2. ゲームパッドデータ受信 (network_receive は net_ctx.last_successful_recv_time を更新)
-        ssize_t recv_len = network_receive(&net_ctx, recv_buffer, sizeof(recv_buffer));
-        bool just_received_packet = (recv_len > 0);
+    // イベントループ: 受信ソケット、制御タイマー、テレメトリタイマー (と IMU ストリームのフラッシュタイマー) を epoll で待ち受ける
+    // テレメトリ周期は従来通り制御周期の sensor_send_interval 倍
+    // 最初のデッドラインはウォッチドッグ起動・メモリロックなどの準備がすべて済んでから決める (初回がオーバーランにならないように)
+    unsigned int telemetry_period_us = g_config.loop_delay_us * (g_config.sensor_send_interval > 0 ? g_config.sensor_send_interval : 1);
+    loop_scheduler_init(&scheduler, g_config.loop_delay_us);
+    LOG_INFO("制御周期: %u us (%g Hz)", g_config.loop_delay_us, 1000000.0 / g_config.loop_delay_us);
+    EventLoop event_loop;
+    if (!event_loop_init(&event_loop, net_ctx.recv_socket, scheduler.next_deadline_ns, g_config.loop_delay_us, telemetry_period_us,
+                         imu_stream_flush_period_us()))
+    {
+        LOG_ERROR("イベントループ初期化失敗。終了します。");
+        watchdog_stop();
+        thruster_disable();
+        network_close(&net_ctx);
+        stop_gstreamer_pipelines();
+        logger_stop();
+        return -1;
+    }
+    if (g_config.latency_measure)
+    {
+        LOG_INFO("遅延計測モード: パケット到着からPWM出力までの遅延を %d パケットごとに表示します。", LATENCY_REPORT_EVERY);
+    }
 
+    // 終了要求 (SIGINT/SIGTERM) があるまでループを継続
+    while (!g_stop_requested)
+    {
+        uint64_t control_expirations = 0;
+        uint64_t telemetry_expirations = 0;
+        unsigned int events = event_loop_wait(&event_loop, -1, &control_expirations, &telemetry_expirations);
+        int64_t current_time_ns = monotonic_now_ns();
 
-        if (just_received_packet)
+        // 1. ゲームパッドデータ受信: 到着したらタイマーを待たずに即座にパースしてPWMへ反映する
+        //    キューに溜まったデータグラムはすべて取り出し、最新の1つだけを採用する (古いコマンドは実行しない)
+        //    (network_receive_latest は net_ctx.last_successful_recv_time を更新)
+        if (events & EVENT_NETWORK_READABLE)
         {
-            if (currently_in_failsafe) // フェイルセーフ状態からの復帰
+            // 検証関数でデコードとシーケンス番号の確認を行い、重複・順序逆転パケットは採用しない
+            const char *packet = NULL;
+            GamepadReceiveState rx_state;
+            beginGamepadReceive(&rx_state, &gamepad_sequence);
+            ssize_t recv_len = network_receive_latest(&net_ctx, &packet, gamepadPacketValidator, &rx_state);
+            // 停止中は採用されなかったデータグラムも再接続として扱う (RECONNECTED)
+            link_monitor_datagram_seen(&link, current_time_ns, net_ctx.rx_stats.received);
+            if (recv_len > 0)
             {
-                std::cout << "接続確立/再確立。通常動作を再開します。" << std::endl;
-                currently_in_failsafe = false;
-                // 必要であれば、ここで thruster_init() を呼び出すなど復帰処理を追加
-            }
-            std::string received_str(recv_buffer, recv_len); // 受信した長さで文字列を作成
+                // 検証関数がシーケンス番号を確認済みなので、停止前と同じか古いコマンドで再開することはない
+                bool resuming = link_monitor_command_received(&link, current_time_ns);
+                if (resuming)
+                {
+                    // 停止中の経過時間を平滑化・PID の dt に含めない
+                    last_thruster_update_ns = 0;
+                }
+                // 受信バッファ上でデコード済みのコマンドを採用する (文字列コピーなし)
+                // 統計表示フラグは立ち上がりのみ反応する (押し続けても1回)
+                if ((rx_state.candidate.flags & GAMEPAD_FLAG_DUMP_STATS) && !(latest_gamepad_data.flags & GAMEPAD_FLAG_DUMP_STATS))
+                {
+                    g_stats_requested = 1;
+                }
+                latest_gamepad_data = rx_state.candidate;
+                commitGamepadSequence(&gamepad_sequence, latest_gamepad_data);
+                command_hold_command_received(&command_hold, current_time_ns);
+                watchdog_command_received(current_time_ns);
+                if (watchdog_tripped() && watchdog_rearm(current_time_ns))
+                {
+                    // 平滑化の状態を推力曲線の停止出力に揃え、停止からなめらかに再開する
+                    // (session_replay が同じ位置で出力をリセットできるよう記録する)
+                    thruster_set_all_stop();
+                    blackbox_record_tick(BLACKBOX_EVENT_REARM, GamepadData{}, &sensor_snapshot, current_gyro_data, 0.0f);
+                }
+                LOG_DEBUG("受信: %zd バイト (seq=%u)", recv_len, latest_gamepad_data.sequence);
 
-            latest_gamepad_data = parseGamepadData(received_str); // 受信文字列をパース
-            // std::cout << "受信: " << received_str << std::endl; // Debug
-        }
-        else // 今回のループではパケット受信なし
-        {
-            // 接続が一度確立された後でタイムアウトした場合
-            if (net_ctx.client_addr_known && time_since_last_packet > g_config.connection_timeout_seconds)
-            {
-                if (!currently_in_failsafe)
+                // 直近の制御周期で取得したジャイロ値を使用し、I2C読み取りを待たずに出力する
+                float dt_s = elapsed_since_last_update(&last_thruster_update_ns);
+                {
+                    LATENCY_SCOPE(LAT_STAGE_COMMAND_APPLY);
+                    thruster_update(latest_gamepad_data, current_gyro_data, dt_s);
+                }
+
+                if (g_config.latency_measure)
                 {
-                    std::cout << "接続がタイムアウトしました。フェイルセーフモード (スラスターPWM: " << g_config.pwm_min << ") に移行します。" << std::endl;
-                    thruster_set_all_pwm(g_config.pwm_min);
-                    latest_gamepad_data = GamepadData{}; // 古いコマンドをクリア
-                    currently_in_failsafe = true;
-                    // フェイルセーフ起動（接続タイムアウト後）のためプログラムを終了
-                    std::cout << "フェイルセーフ起動のためプログラムを終了します。" << std::endl;
-                    running = false;
+                    int64_t rx_ns = net_ctx.last_rx_kernel_ns;
+                    if (rx_ns == 0) // カーネルタイムスタンプが無い場合は受信直後の時刻で代用
+                    {
+                        struct timespec rx_ts;
+                        clock_gettime(CLOCK_REALTIME, &rx_ts);
+                        rx_ns = timespec_to_ns(rx_ts);
+                    }
+                    record_command_latency(&latency_acc, rx_ns);
                 }
+                if (g_config.clock_sync_enabled)
+                {
+                    // 地上局での送信から PWM 書き込み完了までの片道遅延
+                    struct timespec applied_ts;
+                    clock_gettime(CLOCK_REALTIME, &applied_ts);
+                    clock_sync_record_command(&clock_sync, latest_gamepad_data, timespec_to_ns(applied_ts));
+                }
+                if (resuming)
+                {
+                    // 再接続から最初のコマンドを PWM へ反映するまでの時間を記録し、CONNECTED へ戻す
+                    link_monitor_command_applied(&link, monotonic_now_ns());
+                }
+                // PWM 出力後に記録する (記録の時間を packet->PWM の遅延に含めない)
+                blackbox_record_tick(BLACKBOX_EVENT_COMMAND, latest_gamepad_data, &sensor_snapshot, current_gyro_data, dt_s);
             }
-            // recv_len < 0 かつ EAGAIN/EWOULDBLOCK 以外の場合は受信エラー
-            if (recv_len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            // recv_len < 0 は受信エラー (キューが空の場合は 0 が返る)
+            else if (recv_len < 0)
             {
-                std::cerr << "致命的な受信エラー。ループを継続します..." << std::endl;
+                LOG_ERROR_EVERY(1000, "致命的な受信エラー。ループを継続します...");
             }
         }
 
-        // 3. 制御ロジック (フェイルセーフ中でない場合のみ実行)
-        if (!currently_in_failsafe && running) // プログラムが実行中の場合のみ制御ロジックを実行
+        // 2. 制御周期タイマー: 接続状態の確認と、ジャイロによる安定化制御
+        if (events & EVENT_CONTROL_TIMER)
         {
-            current_gyro_data = read_gyro();
-            thruster_update(latest_gamepad_data, current_gyro_data);
+            LATENCY_SCOPE(LAT_STAGE_CONTROL_TICK);
+            loop_scheduler_record_timer_tick(&scheduler, current_time_ns, control_expirations);
+            watchdog_heartbeat(current_time_ns);
 
-            // センサーデータ処理 (読み取り、フォーマット、送信) - 一定間隔で実行
-            if (loop_counter >= g_config.sensor_send_interval)
+            // ネットワーク接続状態チェック (最後にコマンドを採用してからの時間)
+            double time_since_last_packet = 0.0;
+            // net_ctx.client_addr_known は、network_receive_latest 内で最初の有効なパケット受信時にtrueになる
+            if (net_ctx.client_addr_known)
             {
-                std::cout << "[SENSOR LOG] " << sensor_buffer << std::endl; // ログは送信時のみ表示
+                time_since_last_packet = (current_time_ns - timespec_to_ns(net_ctx.last_successful_recv_time)) / 1e9; // 秒単位
+            }
 
-                loop_counter = 0; // カウンターリセット
-                if (read_and_format_sensor_data(sensor_buffer, sizeof(sensor_buffer)))
-                {
-                    std::cout << "[SENSOR LOG] " << sensor_buffer << std::endl;
-                    network_send(&net_ctx, sensor_buffer, strlen(sensor_buffer)); // フォーマットされたセンサーデータを送信
-                }
-                else
+            // 接続が一度確立された後でタイムアウトした場合は、スラスターだけを停止して再接続を待つ
+            // (センサー取得・映像・ソケット・テレメトリは動かし続ける)
+            if (link_monitor_check_timeout(&link, current_time_ns, time_since_last_packet))
+            {
+                thruster_set_all_stop(); // 推力曲線の停止出力 (thruster_get_stop_pwm_us)
+                watchdog_command_idle(); // メインループ自身が停止させたので、次のコマンドまで監視しない
+                command_hold_link_lost(&command_hold);
+                latest_gamepad_data = GamepadData{}; // 古いコマンドをクリア
+                blackbox_record_tick(BLACKBOX_EVENT_FAILSAFE, latest_gamepad_data, &sensor_snapshot, current_gyro_data, 0.0f);
+            }
+
+            // 制御ロジック (CONNECTED / DEGRADED の場合のみ実行)
+            if (link_monitor_control_enabled(&link))
+            {
+                // I2C を直接読まず、センサー取得スレッドの最新値を使う (ブロックしない)
+                int64_t snapshot_start_ns = latency_start();
+                bool snapshot_ok = sensor_snapshot_read(&sensor_snapshot);
+                latency_stop(LAT_STAGE_SENSOR_SNAPSHOT, snapshot_start_ns);
+                if (snapshot_ok)
                 {
-                    std::cerr << "センサーデータの読み取り/フォーマットに失敗。" << std::endl;
+                    // 姿勢推定が有効ならバイアス補正後の角速度を使う
+                    current_gyro_data = sensor_snapshot.attitude_valid ? sensor_snapshot.attitude.rate_dps
+                                                                       : sensor_snapshot.readings.gyro;
                 }
+                // パケットが途切れている間は最後のコマンドを保持し、その後 0 へ減衰させる
+                // (記録も減衰後のコマンドで行い、session_replay で同じ出力を再現できるようにする)
+                GamepadData command;
+                command_hold_apply(&command_hold, current_time_ns, latest_gamepad_data, &command);
+                float dt_s = elapsed_since_last_update(&last_thruster_update_ns);
+                thruster_update(command, current_gyro_data, dt_s);
+                blackbox_record_tick(BLACKBOX_EVENT_CONTROL, command, &sensor_snapshot, current_gyro_data, dt_s);
+            }
+        }
+
+        // 3. テレメトリタイマー: センサーデータ処理 (スナップショット取得、エンコード、送信)
+        //    停止中 (FAILSAFE_HOLD / RECONNECTED) も地上局が状態を確認できるよう送信を続ける
+        //    送信先は操縦者と購読者 (操縦者のゲームパッドが届く前でも購読者には送る)
+        if ((events & EVENT_TELEMETRY_TIMER) && telemetry_fanout_has_destinations(&telemetry_fanout))
+        {
+            clock_sync_poll(&clock_sync, current_time_ns);
+            if (!sensor_snapshot_read(&sensor_snapshot))
+            {
+                LOG_WARN_EVERY(1000, "センサーデータの取得に失敗。");
+            }
+            else if (g_config.telemetry_binary)
+            {
+                // バイナリフレーム: 浮動小数点の文字列変換を行わず、固定長の値を詰めて送信する
+                // タイムスタンプは送信時刻ではなくスナップショットを公開した時刻
+                // エンコードは購読者のフィールドの組み合わせごとに1回、送信は sendmmsg で1回 (telemetry_fanout.h)
+                const SensorReadings &readings = sensor_snapshot.readings;
+                float values[TELEMETRY_MAX_FIELDS] = {0.0f};
+                uint32_t available = telemetry_fill_values(readings, values);
+                if (sensor_snapshot.attitude_valid)
+                    available |= telemetry_fill_attitude(sensor_snapshot.attitude, values);
+                float latency_p50_ms, latency_p99_ms;
+                if (clock_sync_latency_percentiles(&clock_sync, &latency_p50_ms, &latency_p99_ms))
+                    available |= telemetry_fill_link(latency_p50_ms, latency_p99_ms,
+                                                     static_cast<float>(clock_sync.rtt_us) / 1000.0f, values);
+                telemetry_fanout_send_frames(&telemetry_fanout, &telemetry_encoder, values, available,
+                                             static_cast<uint64_t>(sensor_snapshot.timestamp_ns / NSEC_PER_USEC),
+                                             current_time_ns);
             }
             else
             {
-                loop_counter++; // カウンターインクリメント
+                // 従来のテキスト形式 (既存の地上局ツール向け)
+                size_t text_len = format_sensor_data_text(sensor_snapshot.readings, sensor_buffer, sizeof(sensor_buffer));
+                if (text_len > 0)
+                {
+                    LOG_INFO("[SENSOR LOG] %s", sensor_buffer);
+                    telemetry_fanout_send_text(&telemetry_fanout, sensor_buffer, text_len, current_time_ns); // フォーマットされたセンサーデータを送信
+                }
+                else
+                {
+                    LOG_WARN_EVERY(1000, "センサーデータのフォーマットに失敗。");
+                }
             }
         }
-        else
+
+        // 4. IMU ストリーム: センサー取得スレッドが溜めたサンプルを FLUSH_MS ごとにまとめて送る
+        //    制御タイマーと同時に満了した場合も、制御・テレメトリの処理の後に行う
+        if (events & EVENT_IMU_FLUSH_TIMER)
         {
-            // フェイルセーフ中または最初の接続待機中。スラスターは既に設定済み。
-            loop_counter = 0; // 再接続時にセンサーデータが即座に送信されるのを防ぐ
+            imu_stream_flush(&net_ctx);
         }
 
-        // // 4. 終了条件チェック (データ受信時のみ Start ボタンを評価)
-        // if (just_received_packet && (latest_gamepad_data.buttons & GamepadButton::Start))
-        // {
-        //     std::cout << "Startボタン検出。終了します。" << std::endl;
-        //     running = false;
-        // }
-
-        // 5. ループ待機 (CPU負荷軽減とループ頻度調整)
-        usleep(g_config.loop_delay_us); // 設定ファイルから取得した値で待機
+        // 5. ループ統計の表示 (SIGUSR1 受信時、または設定された間隔ごと)
+        if (g_stats_requested ||
+            (stats_report_interval_ns > 0 && current_time_ns - last_stats_report_ns >= stats_report_interval_ns))
+        {
+            g_stats_requested = 0;
+            last_stats_report_ns = current_time_ns;
+            loop_scheduler_print_stats(&scheduler);
+            network_print_stats(&net_ctx);
+            printGamepadStats(&gamepad_sequence);
+            sensor_thread_print_stats();
+            pwm_output_print_stats();
+            blackbox_print_stats();
+            watchdog_print_stats();
+            link_monitor_print_stats(&link);
+            command_hold_print_stats(&command_hold);
+            clock_sync_print_stats(&clock_sync);
+            telemetry_fanout_print_stats(&telemetry_fanout);
+            imu_stream_print_stats();
+            latency_print_all();
+        }
     }
 
     // --- クリーンアップ ---
-    std::cout << "クリーンアップ処理を開始します..." << std::endl;
+    LOG_INFO("クリーンアップ処理を開始します...");
+    loop_scheduler_print_stats(&scheduler); // 最終的なループ統計を表示
+    network_print_stats(&net_ctx);          // 最終的な受信統計を表示
+    printGamepadStats(&gamepad_sequence);
+    sensor_thread_print_stats();
+    pwm_output_print_stats();
+    blackbox_print_stats();
+    watchdog_stop();               // ラッチを解除してから停止処理の PWM を書き込む
+    watchdog_print_stats();
+    link_monitor_print_stats(&link);
+    command_hold_print_stats(&command_hold);
+    clock_sync_print_stats(&clock_sync);
+    telemetry_fanout_print_stats(&telemetry_fanout);
+    imu_stream_print_stats();
+    sensor_thread_stop();          // センサー取得スレッドを停止 (PWM停止前に I2C アクセスを終わらせる)
+    latency_print_all();           // 最終的な処理段階レイテンシを表示
+    event_loop_close(&event_loop); // タイマーと epoll を解放
     thruster_disable();      // スラスターへのPWM出力を停止
+    blackbox_close();        // 記録をファイルへ書き出してから解放する
     network_close(&net_ctx); // ネットワークソケットをクローズ
     stop_gstreamer_pipelines(); // GStreamerパイプラインを停止
-    std::cout << "プログラム終了。" << std::endl;
+    LOG_INFO("プログラム終了。");
+    logger_stop(); // 残りのログを書き出してから終了する
     return 0;
 }
@@ -1,5 +1,4 @@
 #include "network.h"
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -7,7 +6,26 @@
 #include <fcntl.h>
 #include <errno.h>
 #include "config.h" // g_config を使用するため
-#include <sys/time.h> // gettimeofday のため
+#include "time_utils.h" // timespec_to_ns のため
+#include "latency_histogram.h" // 受信・送信時間の計測
+#include "logger.h"     // LOG_*
+#include <time.h>     // clock_gettime のため
+#include <sys/socket.h> // recvmsg, SO_TIMESTAMPNS のため
+
+// ヘルパー関数: 補助データからカーネル受信タイムスタンプ (CLOCK_REALTIME) を取り出す。なければ 0
+static int64_t extract_kernel_timestamp(struct msghdr *msg)
+{
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            return timespec_to_ns(ts);
+        }
+    }
+    return 0;
+}
 
 // ネットワーク送受信コンテキストを初期化する関数
 bool network_init(NetworkContext *ctx)
@@ -25,13 +43,13 @@ bool network_init(NetworkContext *ctx)
     ctx->send_socket = -1;
     ctx->client_addr_len = sizeof(ctx->client_addr_recv);
     ctx->client_addr_known = false;
-    gettimeofday(&ctx->last_successful_recv_time, NULL); // 現在時刻で初期化
+    clock_gettime(CLOCK_MONOTONIC, &ctx->last_successful_recv_time); // 現在時刻で初期化
 
     // --- 受信ソケット設定 ---
     ctx->recv_socket = socket(AF_INET, SOCK_DGRAM, 0);
     if (ctx->recv_socket < 0)
     {
-        perror("受信ソケット作成失敗");
+        LOG_ERROR("受信ソケット作成失敗: %s", strerror(errno));
         return false;
     }
 
@@ -39,12 +57,19 @@ bool network_init(NetworkContext *ctx)
     int flags = fcntl(ctx->recv_socket, F_GETFL, 0);
     if (flags == -1 || fcntl(ctx->recv_socket, F_SETFL, flags | O_NONBLOCK) == -1) // 現在のフラグを取得し、O_NONBLOCK を追加
     {
-        perror("受信ソケットのノンブロッキング設定失敗");
+        LOG_ERROR("受信ソケットのノンブロッキング設定失敗: %s", strerror(errno));
         close(ctx->recv_socket);
         ctx->recv_socket = -1;
         return false;
     }
 
+    // カーネル受信タイムスタンプを有効化 (パケット到着からPWM出力までの遅延計測用、失敗しても続行)
+    int enable_timestamp = 1;
+    if (setsockopt(ctx->recv_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable_timestamp, sizeof(enable_timestamp)) < 0)
+    {
+        LOG_ERROR("SO_TIMESTAMPNS 設定失敗 (受信時刻はユーザー空間で計測します): %s", strerror(errno));
+    }
+
     // サーバー（このプログラム）のアドレス情報を設定
     memset(&ctx->server_addr, 0, sizeof(ctx->server_addr));
     ctx->server_addr.sin_family = AF_INET;
@@ -54,18 +79,18 @@ bool network_init(NetworkContext *ctx)
     // ソケットにアドレス情報を割り当て (バインド)
     if (bind(ctx->recv_socket, (const struct sockaddr *)&ctx->server_addr, sizeof(ctx->server_addr)) < 0)
     {
-        perror("受信ソケットのバインド失敗");
+        LOG_ERROR("受信ソケットのバインド失敗: %s", strerror(errno));
         close(ctx->recv_socket);
         ctx->recv_socket = -1;
         return false;
     }
-    printf("UDPサーバー起動 (受信ポート: %d)\n", recv_port);
+    LOG_INFO("UDPサーバー起動 (受信ポート: %d)", recv_port);
 
     // --- 送信ソケット設定 ---
     ctx->send_socket = socket(AF_INET, SOCK_DGRAM, 0);
     if (ctx->send_socket < 0)
     {
-        perror("送信ソケット作成失敗");
+        LOG_ERROR("送信ソケット作成失敗: %s", strerror(errno));
         close(ctx->recv_socket); // 受信ソケットも閉じる
         ctx->recv_socket = -1;
         return false;
@@ -77,7 +102,7 @@ bool network_init(NetworkContext *ctx)
     ctx->client_addr_send.sin_port = htons(send_port); // 送信ポート番号を設定 (ネットワークバイトオーダーに変換)
     // 送信先IPアドレスは最初の受信時に設定される
 
-    printf("UDP送信準備完了 (送信先ポート: %d)\n", send_port);
+    LOG_INFO("UDP送信準備完了 (送信先ポート: %d)", send_port);
     return true;
 }
 
@@ -96,45 +121,156 @@ void network_close(NetworkContext *ctx)
             close(ctx->send_socket);
             ctx->send_socket = -1;
         }
-        printf("ソケットをクローズしました。\n");
+        LOG_INFO("ソケットをクローズしました。");
     }
 }
 
-// UDPデータを受信する関数 (ノンブロッキング)
-ssize_t network_receive(NetworkContext *ctx, char *buffer, size_t buffer_size)
+// 受信キューを空になるまで recvmmsg で取り出し、有効な最新のデータグラムだけを採用する関数
+ssize_t network_receive_latest(NetworkContext *ctx, const char **data, NetworkPacketValidator validator, void *user)
 {
-    if (!ctx || ctx->recv_socket < 0 || !buffer || buffer_size == 0)
+    if (!ctx || ctx->recv_socket < 0 || !data)
     {
         return -1; // 引数が無効ならエラー
     }
+    *data = NULL;
 
-    // 受信する前にアドレス長をリセット
-    ctx->client_addr_len = sizeof(ctx->client_addr_recv);
-    ssize_t recv_len = recvfrom(ctx->recv_socket, buffer, buffer_size - 1, 0,
-                                (struct sockaddr *)&ctx->client_addr_recv, &ctx->client_addr_len);
+    struct timespec now_ts;
+    clock_gettime(CLOCK_REALTIME, &now_ts); // カーネルタイムスタンプと同じ時計で鮮度を判定する
+    const int64_t now_realtime_ns = timespec_to_ns(now_ts);
+    const int64_t stale_ns = static_cast<int64_t>(g_config.stale_packet_ms) * NSEC_PER_MSEC;
 
-    if (recv_len > 0)
+    ssize_t selected_len = 0;
+    for (;;)
     {
-        buffer[recv_len] = '\0'; // Null終端
-        gettimeofday(&ctx->last_successful_recv_time, NULL); // 最終受信時刻を更新
-        // 新しいクライアントか、IPが変わったかチェック
-        if (!ctx->client_addr_known || ctx->client_addr_send.sin_addr.s_addr != ctx->client_addr_recv.sin_addr.s_addr)
+        // 事前確保したリングに recvmmsg 用のヘッダーを毎回設定し直す (長さ・アドレス長は受信で書き換わるため)
+        for (int i = 0; i < NET_RECV_BATCH; ++i)
         {
-            network_update_send_address(ctx);
+            ctx->rx_iov[i].iov_base = ctx->rx_ring[i];
+            ctx->rx_iov[i].iov_len = NET_BUFFER_SIZE - 1; // Null終端用に1バイト残す
+            memset(&ctx->rx_msgs[i], 0, sizeof(struct mmsghdr));
+            ctx->rx_msgs[i].msg_hdr.msg_name = &ctx->rx_addr[i];
+            ctx->rx_msgs[i].msg_hdr.msg_namelen = sizeof(ctx->rx_addr[i]);
+            ctx->rx_msgs[i].msg_hdr.msg_iov = &ctx->rx_iov[i];
+            ctx->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+            ctx->rx_msgs[i].msg_hdr.msg_control = ctx->rx_control[i];
+            ctx->rx_msgs[i].msg_hdr.msg_controllen = NET_CMSG_SIZE;
+        }
+
+        int64_t recv_start_ns = latency_start();
+        int count = recvmmsg(ctx->recv_socket, ctx->rx_msgs, NET_RECV_BATCH, MSG_DONTWAIT, NULL);
+        latency_stop(LAT_STAGE_NET_RECV, recv_start_ns);
+        if (count < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                LOG_ERROR_EVERY(1000, "受信エラー (recvmmsg): %s", strerror(errno));
+                return selected_len > 0 ? selected_len : -1;
+            }
+            break; // キューが空になった
+        }
+        if (count == 0)
+        {
+            break;
+        }
+        ctx->rx_stats.batches++;
+        ctx->rx_stats.received += count;
+
+        // 新しい順に走査し、最初に見つかった有効なデータグラムを採用候補にする
+        bool found_in_batch = false;
+        for (int i = count - 1; i >= 0; --i)
+        {
+            struct mmsghdr *m = &ctx->rx_msgs[i];
+            size_t len = m->msg_len;
+            if (len == 0 || (m->msg_hdr.msg_flags & MSG_TRUNC))
+            {
+                ctx->rx_stats.dropped++;
+                continue;
+            }
+            int64_t rx_kernel_ns = extract_kernel_timestamp(&m->msg_hdr);
+            // 時刻同期・購読などは順序や鮮度に関係なくすべて処理する (受信時刻はパケットごとに必要)
+            if (ctx->control_handler)
+            {
+                int64_t rx_realtime_ns = rx_kernel_ns;
+                if (rx_realtime_ns == 0)
+                {
+                    struct timespec rx_ts;
+                    clock_gettime(CLOCK_REALTIME, &rx_ts);
+                    rx_realtime_ns = timespec_to_ns(rx_ts);
+                }
+                ctx->rx_ring[i][len] = '\0';
+                if (ctx->control_handler(ctx->rx_ring[i], len, &ctx->rx_addr[i], rx_realtime_ns, ctx->control_user))
+                {
+                    ctx->rx_stats.control++;
+                    continue;
+                }
+            }
+            if (stale_ns > 0 && rx_kernel_ns != 0 && now_realtime_ns - rx_kernel_ns > stale_ns)
+            {
+                ctx->rx_stats.late++;
+                continue;
+            }
+            ctx->rx_ring[i][len] = '\0'; // Null終端
+            if (found_in_batch)
+            {
+                ctx->rx_stats.superseded++;
+                continue;
+            }
+            if (validator && !validator(ctx->rx_ring[i], len, user))
+            {
+                ctx->rx_stats.dropped++;
+                continue;
+            }
+
+            // 前のバッチで採用した候補はより古いので置き換える
+            if (selected_len > 0)
+            {
+                ctx->rx_stats.superseded++;
+            }
+            found_in_batch = true;
+            memcpy(ctx->latest_packet, ctx->rx_ring[i], len + 1);
+            selected_len = static_cast<ssize_t>(len);
+            ctx->last_rx_kernel_ns = rx_kernel_ns;
+            ctx->client_addr_recv = ctx->rx_addr[i];
+            ctx->client_addr_len = m->msg_hdr.msg_namelen;
+        }
+
+        if (count < NET_RECV_BATCH)
+        {
+            break; // リングに収まったのでキューは空
         }
     }
-    else if (recv_len < 0)
+
+    if (selected_len > 0)
     {
-        // EAGAIN/EWOULDBLOCK はデータがないだけなのでエラーではない
-        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        ctx->rx_stats.accepted++;
+        *data = ctx->latest_packet;
+        clock_gettime(CLOCK_MONOTONIC, &ctx->last_successful_recv_time); // 最終受信時刻を更新
+        // 新しいクライアントか、IPが変わったかチェック
+        if (!ctx->client_addr_known || ctx->client_addr_send.sin_addr.s_addr != ctx->client_addr_recv.sin_addr.s_addr)
         {
-            perror("受信エラー");
+            network_update_send_address(ctx);
         }
-        // エラーまたはデータなしの場合は -1 または 0 を返す recvfrom の仕様に合わせる
     }
-    // recv_len が 0 の場合はそのまま 0 を返す (UDPでは通常起こらない)
+    return selected_len;
+}
 
-    return recv_len;
+// 制御コマンド以外のデータグラムの処理関数を登録する関数
+void network_set_control_handler(NetworkContext *ctx, NetworkControlHandler handler, void *user)
+{
+    if (!ctx)
+        return;
+    ctx->control_handler = handler;
+    ctx->control_user = user;
+}
+
+// 受信統計を表示する関数
+void network_print_stats(const NetworkContext *ctx)
+{
+    if (!ctx)
+        return;
+    const NetworkRxStats *st = &ctx->rx_stats;
+    LOG_INFO("[NET STATS] received=%llu accepted=%llu superseded=%llu late=%llu dropped=%llu control=%llu batches=%llu",
+           st->received, st->accepted, st->superseded, st->late, st->dropped, st->control, st->batches);
 }
 
 // UDPデータを送信する関数
@@ -147,18 +283,20 @@ bool network_send(NetworkContext *ctx, const char *data, size_t data_len)
     }
 
     // データ送信試行
+    int64_t send_start_ns = latency_start();
     ssize_t sent_len = sendto(ctx->send_socket, data, data_len, 0,
                               (const struct sockaddr *)&ctx->client_addr_send, sizeof(ctx->client_addr_send));
+    latency_stop(LAT_STAGE_NET_SEND, send_start_ns);
 
     if (sent_len < 0)
     {
         // クライアント切断時などにログが溢れるのを避けるため、頻繁なエラー出力は避ける
-        // perror("送信エラー");
+        // LOG_ERROR("送信エラー: %s", strerror(errno));
         return false;
     }
     else if ((size_t)sent_len < data_len)
     {
-        fprintf(stderr, "警告: データが部分的にしか送信されませんでした。\n");
+        LOG_WARN_EVERY(1000, "警告: データが部分的にしか送信されませんでした。");
         return false; // 部分送信もエラー扱いとするか、状況による
     }
 
@@ -170,7 +308,7 @@ bool network_update_send_address(NetworkContext *ctx)
 {
     if (!ctx)
         return false;
-    printf("センサーデータ送信先を設定/更新: %s:%d\n",
+    LOG_INFO("センサーデータ送信先を設定/更新: %s:%d",
            inet_ntoa(ctx->client_addr_recv.sin_addr),
            ntohs(ctx->client_addr_send.sin_port));                   // ポートは固定
     ctx->client_addr_send.sin_addr = ctx->client_addr_recv.sin_addr; // IPアドレスを更新
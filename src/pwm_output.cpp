@@ -0,0 +1,109 @@
+#include "pwm_output.h"
+#include "hal.h"               // hal_set_pwm_duty_cycles
+#include "latency_histogram.h" // LAT_STAGE_PWM_WRITE
+#include "logger.h"            // LOG_*
+#include "watchdog.h"          // watchdog_tripped
+#include <string.h>            // memset
+
+static float pwm_period_us = 20000.0f;                 // 1周期のマイクロ秒 (50Hz)
+static int shadow_us[PWM_OUTPUT_MAX_CHANNELS];         // 最後に書き込んだパルス幅 (-1 は未書き込み)
+static int pending_us[PWM_OUTPUT_MAX_CHANNELS];        // 次の flush で出力する値 (-1 は予約なし)
+static PwmOutputStats stats;
+
+void pwm_output_init(float frequency_hz)
+{
+    pwm_period_us = 1000000.0f / (frequency_hz > 0.0f ? frequency_hz : 50.0f);
+    for (int i = 0; i < PWM_OUTPUT_MAX_CHANNELS; ++i)
+    {
+        shadow_us[i] = -1;
+        pending_us[i] = -1;
+    }
+    memset(&stats, 0, sizeof(stats));
+}
+
+void pwm_output_set_us(int channel, int pulse_width_us)
+{
+    if (channel < 0 || channel >= PWM_OUTPUT_MAX_CHANNELS)
+    {
+        LOG_WARN_EVERY(1000, "PWM チャンネル %d は範囲外です (0〜%d)", channel, PWM_OUTPUT_MAX_CHANNELS - 1);
+        return;
+    }
+    pending_us[channel] = pulse_width_us;
+}
+
+int pwm_output_flush()
+{
+    LATENCY_SCOPE(LAT_STAGE_PWM_WRITE);
+
+    // ウォッチドッグが停止出力を書き込んだ後は上書きしない (解除後に全チャンネルを書き直す)
+    if (watchdog_tripped())
+    {
+        for (int i = 0; i < PWM_OUTPUT_MAX_CHANNELS; ++i)
+        {
+            shadow_us[i] = -1;
+            pending_us[i] = -1;
+        }
+        stats.flushes++;
+        stats.blocked_flushes++;
+        stats.last_flush_writes = 0;
+        return 0;
+    }
+
+    uintptr_t channels[PWM_OUTPUT_MAX_CHANNELS];
+    float duty_cycles[PWM_OUTPUT_MAX_CHANNELS];
+    int count = 0;
+    int skipped = 0;
+    for (int i = 0; i < PWM_OUTPUT_MAX_CHANNELS; ++i)
+    {
+        if (pending_us[i] < 0)
+            continue;
+        if (pending_us[i] == shadow_us[i])
+        {
+            skipped++;
+        }
+        else
+        {
+            channels[count] = static_cast<uintptr_t>(i);
+            duty_cycles[count] = static_cast<float>(pending_us[i]) / pwm_period_us;
+            shadow_us[i] = pending_us[i];
+            count++;
+        }
+        pending_us[i] = -1;
+    }
+
+    if (count > 0)
+    {
+        stats.bus_transactions += hal_set_pwm_duty_cycles(channels, duty_cycles, static_cast<size_t>(count));
+    }
+
+    stats.flushes++;
+    stats.channel_writes += static_cast<unsigned long long>(count);
+    stats.skipped_writes += static_cast<unsigned long long>(skipped);
+    stats.last_flush_writes = static_cast<unsigned int>(count);
+    if (stats.last_flush_writes > stats.max_flush_writes)
+        stats.max_flush_writes = stats.last_flush_writes;
+    return count;
+}
+
+void pwm_output_invalidate()
+{
+    for (int i = 0; i < PWM_OUTPUT_MAX_CHANNELS; ++i)
+    {
+        shadow_us[i] = -1;
+    }
+}
+
+void pwm_output_get_stats(PwmOutputStats *out)
+{
+    if (out)
+        *out = stats;
+}
+
+void pwm_output_print_stats()
+{
+    double per_flush = stats.flushes > 0 ? static_cast<double>(stats.channel_writes) / static_cast<double>(stats.flushes) : 0.0;
+    double bus_per_flush = stats.flushes > 0 ? static_cast<double>(stats.bus_transactions) / static_cast<double>(stats.flushes) : 0.0;
+    LOG_INFO("[PWM STATS] flushes=%llu writes=%llu skipped=%llu writes/tick=%.2f (max %u) bus_tx/tick=%.2f blocked=%llu mode=%s (%s)",
+             stats.flushes, stats.channel_writes, stats.skipped_writes, per_flush, stats.max_flush_writes, bus_per_flush,
+             stats.blocked_flushes, g_hal->pwm_write_mode, g_hal->name);
+}
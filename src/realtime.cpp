@@ -0,0 +1,279 @@
+#include "realtime.h"
+#include "config.h" // g_config
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>     // mlockall
+#include <sys/resource.h> // getrlimit
+#include <malloc.h>       // mallopt
+#include <alloca.h>
+#include <unistd.h>       // sysconf
+#include <string.h>
+#include <errno.h>
+#include "logger.h"       // LOG_*
+#include <atomic>
+
+// 適用結果 (起動時の表示用。メインスレッドだけが読み書きする)
+typedef struct
+{
+    int memory_locked;       // RealtimeItemState
+    int stack_prefaulted;
+    size_t stack_prefault_bytes;
+    int control_fifo;
+    int control_pinned;
+    int sensor_fifo;
+    int sensor_confined;
+    int watchdog_fifo;
+    int watchdog_confined;
+    int control_errno;       // 失敗時の errno (表示用)
+    int memory_errno;
+} RealtimeReport;
+
+static RealtimeReport g_report;
+static std::atomic<int> g_confined_threads(0);      // 制御用コア以外へ移した GStreamer スレッド数
+static std::atomic<int> g_confine_failures(0);
+
+static const char *state_to_string(int state)
+{
+    switch (state)
+    {
+    case RT_APPLIED:
+        return "OK";
+    case RT_FAILED:
+        return "失敗";
+    default:
+        return "未設定";
+    }
+}
+
+// ヘルパー関数: 制御用コアが有効な CPU 番号か
+static bool control_cpu_valid()
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return g_config.rt_control_cpu >= 0 && g_config.rt_control_cpu < cpus;
+}
+
+// ヘルパー関数: 制御用コアを除くオンライン CPU の集合を作る (制御用コアしか無い場合は false)
+static bool build_non_control_cpuset(cpu_set_t *set)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    CPU_ZERO(set);
+    for (long cpu = 0; cpu < cpus && cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (cpu != g_config.rt_control_cpu)
+            CPU_SET(cpu, set);
+    }
+    return CPU_COUNT(set) > 0;
+}
+
+// ヘルパー関数: 呼び出しスレッドのスケジューリングポリシーを設定する (失敗時は errno 相当を返す)
+static int set_current_thread_policy(int policy, int priority)
+{
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), policy, &param);
+}
+
+// ヘルパー関数: スタックを指定サイズだけ触ってページフォールトを起動時に済ませる
+static size_t prefault_stack(size_t bytes)
+{
+    // スタック上限の半分を超えないようにする
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && bytes > limit.rlim_cur / 2)
+    {
+        bytes = limit.rlim_cur / 2;
+    }
+    if (bytes == 0)
+        return 0;
+
+    volatile unsigned char *area = static_cast<volatile unsigned char *>(alloca(bytes));
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0)
+        page = 4096;
+    for (size_t i = 0; i < bytes; i += static_cast<size_t>(page))
+    {
+        area[i] = 0;
+    }
+    return bytes;
+}
+
+void realtime_apply_process_profile()
+{
+    memset(&g_report, 0, sizeof(g_report));
+    if (!g_config.rt_enabled)
+        return;
+
+    if (g_config.rt_lock_memory)
+    {
+        // 以降に確保されるページ (スレッドのスタックを含む) もロックし、実行中のページフォールトを防ぐ
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+        {
+            g_report.memory_locked = RT_APPLIED;
+            // 解放したメモリを OS へ返さず、mmap による確保も行わない (再確保時のページフォールト防止)
+            mallopt(M_TRIM_THRESHOLD, -1);
+            mallopt(M_MMAP_MAX, 0);
+        }
+        else
+        {
+            g_report.memory_locked = RT_FAILED;
+            g_report.memory_errno = errno;
+            LOG_WARN("[REALTIME] mlockall 失敗: %s (LimitMEMLOCK または CAP_IPC_LOCK を確認)", strerror(errno));
+        }
+    }
+
+    if (g_config.rt_prefault_stack_kb > 0)
+    {
+        g_report.stack_prefault_bytes = prefault_stack(static_cast<size_t>(g_config.rt_prefault_stack_kb) * 1024);
+        g_report.stack_prefaulted = g_report.stack_prefault_bytes > 0 ? RT_APPLIED : RT_FAILED;
+    }
+}
+
+RealtimeThreadResult realtime_configure_sensor_thread()
+{
+    RealtimeThreadResult result;
+    memset(&result, 0, sizeof(result));
+    if (!g_config.rt_enabled)
+        return result;
+
+    if (g_config.rt_isolate_gstreamer && control_cpu_valid())
+    {
+        cpu_set_t set;
+        bool ok = build_non_control_cpuset(&set) &&
+                  pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        result.confined = ok ? RT_APPLIED : RT_FAILED;
+    }
+    if (g_config.rt_sensor_priority > 0)
+    {
+        int err = set_current_thread_policy(SCHED_FIFO, g_config.rt_sensor_priority);
+        result.fifo = (err == 0) ? RT_APPLIED : RT_FAILED;
+        if (err != 0)
+        {
+            LOG_WARN("[REALTIME] センサースレッドの SCHED_FIFO 設定失敗: %s", strerror(err));
+        }
+    }
+    return result;
+}
+
+RealtimeThreadResult realtime_configure_watchdog_thread()
+{
+    RealtimeThreadResult result;
+    memset(&result, 0, sizeof(result));
+    if (!g_config.rt_enabled)
+        return result;
+
+    // 制御スレッドが制御用コアを占有したまま止まっても動けるよう、制御用コア以外で動かす
+    if (control_cpu_valid())
+    {
+        cpu_set_t set;
+        bool ok = build_non_control_cpuset(&set) &&
+                  pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        result.confined = ok ? RT_APPLIED : RT_FAILED;
+    }
+    if (g_config.rt_watchdog_priority > 0)
+    {
+        int err = set_current_thread_policy(SCHED_FIFO, g_config.rt_watchdog_priority);
+        result.fifo = (err == 0) ? RT_APPLIED : RT_FAILED;
+        if (err != 0)
+        {
+            LOG_WARN("[REALTIME] ウォッチドッグスレッドの SCHED_FIFO 設定失敗: %s", strerror(err));
+        }
+    }
+    return result;
+}
+
+void realtime_record_sensor_thread(const RealtimeThreadResult &result)
+{
+    g_report.sensor_fifo = result.fifo;
+    g_report.sensor_confined = result.confined;
+}
+
+void realtime_record_watchdog_thread(const RealtimeThreadResult &result)
+{
+    g_report.watchdog_fifo = result.fifo;
+    g_report.watchdog_confined = result.confined;
+}
+
+bool realtime_confine_current_thread(const char *name)
+{
+    if (!g_config.rt_enabled || !g_config.rt_isolate_gstreamer || !control_cpu_valid())
+        return false;
+
+    // 制御スレッドから生成された場合に継承される SCHED_FIFO を通常優先度へ戻す
+    set_current_thread_policy(SCHED_OTHER, 0);
+
+    cpu_set_t set;
+    if (!build_non_control_cpuset(&set) || pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        if (g_confine_failures.fetch_add(1) == 0)
+        {
+            LOG_WARN("[REALTIME] スレッド %s を制御用コア以外へ移せませんでした。", name ? name : "?");
+        }
+        return false;
+    }
+    g_confined_threads.fetch_add(1);
+    return true;
+}
+
+void realtime_apply_control_thread()
+{
+    if (!g_config.rt_enabled)
+        return;
+
+    if (g_config.rt_control_cpu >= 0)
+    {
+        if (control_cpu_valid())
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(g_config.rt_control_cpu, &set);
+            int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            g_report.control_pinned = (err == 0) ? RT_APPLIED : RT_FAILED;
+            if (err != 0)
+            {
+                LOG_WARN("[REALTIME] 制御スレッドの CPU%d 固定失敗: %s", g_config.rt_control_cpu, strerror(err));
+            }
+        }
+        else
+        {
+            g_report.control_pinned = RT_FAILED;
+            LOG_WARN("[REALTIME] CONTROL_CPU=%d はオンライン CPU の範囲外です。", g_config.rt_control_cpu);
+        }
+    }
+
+    if (g_config.rt_control_priority > 0)
+    {
+        int err = set_current_thread_policy(SCHED_FIFO, g_config.rt_control_priority);
+        g_report.control_fifo = (err == 0) ? RT_APPLIED : RT_FAILED;
+        g_report.control_errno = err;
+        if (err != 0)
+        {
+            LOG_WARN("[REALTIME] 制御スレッドの SCHED_FIFO 設定失敗: %s (root または CAP_SYS_NICE が必要)", strerror(err));
+        }
+    }
+}
+
+void realtime_print_report()
+{
+    if (!g_config.rt_enabled)
+    {
+        LOG_INFO("[REALTIME] 無効 (config.ini の [REALTIME] ENABLED=true で有効化)");
+        return;
+    }
+    LOG_INFO("[REALTIME] メモリロック (mlockall): %s", state_to_string(g_report.memory_locked));
+    LOG_INFO("[REALTIME] スタックのプリフォールト: %s (%zu KB)", state_to_string(g_report.stack_prefaulted),
+           g_report.stack_prefault_bytes / 1024);
+    LOG_INFO("[REALTIME] 制御スレッド SCHED_FIFO 優先度 %d: %s", g_config.rt_control_priority, state_to_string(g_report.control_fifo));
+    LOG_INFO("[REALTIME] 制御スレッド CPU%d 固定: %s", g_config.rt_control_cpu, state_to_string(g_report.control_pinned));
+    LOG_INFO("[REALTIME] センサースレッド SCHED_FIFO 優先度 %d: %s, 制御用コア以外へ移動: %s", g_config.rt_sensor_priority,
+           state_to_string(g_report.sensor_fifo), state_to_string(g_report.sensor_confined));
+    if (g_config.watchdog_enabled)
+    {
+        LOG_INFO("[REALTIME] ウォッチドッグスレッド SCHED_FIFO 優先度 %d: %s, 制御用コア以外へ移動: %s", g_config.rt_watchdog_priority,
+               state_to_string(g_report.watchdog_fifo), state_to_string(g_report.watchdog_confined));
+    }
+    if (g_config.rt_isolate_gstreamer)
+    {
+        LOG_INFO("[REALTIME] GStreamer スレッドの隔離: %d スレッド成功, %d スレッド失敗",
+               g_confined_threads.load(), g_confine_failures.load());
+    }
+}
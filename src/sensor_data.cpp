@@ -1,27 +1,39 @@
 // --- インクルード ---
 #include "sensor_data.h" // このモジュールのヘッダーファイル
-#include "bindings.h"    // ハードウェア読み取り関数 (read_*) を使用するため
+#include "hal.h"         // ハードウェア読み取り関数 (hal_read_*) を使用するため
+#include "latency_histogram.h" // 読み取り・フォーマット時間の計測
 #include <stdio.h>       // 標準入出力関数 (snprintf) を使用するため
-#include <iostream>      // 標準エラー出力 (std::cerr) を使用するため
+#include "logger.h"      // LOG_*
 
-// 関連するすべてのセンサーを読み取り、指定されたバッファに文字列としてフォーマットする関数
-bool read_and_format_sensor_data(char *buffer, size_t buffer_size)
+// 関連するすべてのセンサーを読み取る関数
+bool read_sensor_data(SensorReadings *readings)
 {
-    // 引数チェック: バッファポインタが NULL またはバッファサイズが 0 の場合は失敗
-    if (!buffer || buffer_size == 0)
+    if (!readings)
     {
         return false;
     }
+    LATENCY_SCOPE(LAT_STAGE_SENSOR_READ_ALL);
 
     // --- センサーデータの取得 ---
-    float temperature = read_temp();  // 温度センサーの値を読み取る
-    float pressure = read_pressure(); // 圧力センサーの値を読み取る
-    bool leak = read_leak();          // リークセンサーの状態を読み取る (true: 漏れあり, false: 漏れなし)
-    float adc[4];                     // ADC (アナログ-デジタル変換器) の値を格納する配列
-    read_adc_all(adc, 4);             // すべてのADCチャンネルの値を読み取る (read_adc_all が効率的であると仮定)
-    AxisData accel = read_accel();    // 加速度センサーの値を読み取る (X, Y, Z軸)
-    AxisData gyro = read_gyro();      // ジャイロセンサーの値を読み取る (X, Y, Z軸)
-    AxisData mag = read_mag();        // 磁力センサーの値を読み取る (X, Y, Z軸)
+    readings->temperature = hal_read_temp();  // 温度センサーの値を読み取る
+    readings->pressure = hal_read_pressure(); // 圧力センサーの値を読み取る
+    readings->leak = hal_read_leak();       // リークセンサーの状態を読み取る (true: 漏れあり, false: 漏れなし)
+    hal_read_adc_all(readings->adc, 4);   // すべてのADCチャンネルの値を読み取る (read_adc_all が効率的であると仮定)
+    readings->accel = hal_read_accel();       // 加速度センサーの値を読み取る (X, Y, Z軸)
+    readings->gyro = hal_read_gyro();       // ジャイロセンサーの値を読み取る (X, Y, Z軸)
+    readings->mag = hal_read_mag();         // 磁力センサーの値を読み取る (X, Y, Z軸)
+    return true;
+}
+
+// 読み取り結果を従来のテキスト形式にフォーマットする関数 (TELEMETRY FORMAT=text 用)
+size_t format_sensor_data_text(const SensorReadings &r, char *buffer, size_t buffer_size)
+{
+    // 引数チェック: バッファポインタが NULL またはバッファサイズが 0 の場合は失敗
+    if (!buffer || buffer_size == 0)
+    {
+        return 0;
+    }
+    LATENCY_SCOPE(LAT_STAGE_TELEMETRY_FORMAT);
 
     // --- 文字列へのフォーマット ---
     // snprintf を使用して、取得したセンサーデータをカンマ区切りの文字列にフォーマットする
@@ -32,29 +44,39 @@ bool read_and_format_sensor_data(char *buffer, size_t buffer_size)
                            "ACCX:%.6f,ACCY:%.6f,ACCZ:%.6f,"
                            "GYROX:%.6f,GYROY:%.6f,GYROZ:%.6f,"
                            "MAGX:%.6f,MAGY:%.6f,MAGZ:%.6f",
-                           temperature, pressure, leak ? 1 : 0,
-                           adc[0], adc[1], adc[2], adc[3],
-                           accel.x, accel.y, accel.z,
-                           gyro.x, gyro.y, gyro.z,
-                           mag.x, mag.y, mag.z);
+                           r.temperature, r.pressure, r.leak ? 1 : 0,
+                           r.adc[0], r.adc[1], r.adc[2], r.adc[3],
+                           r.accel.x, r.accel.y, r.accel.z,
+                           r.gyro.x, r.gyro.y, r.gyro.z,
+                           r.mag.x, r.mag.y, r.mag.z);
 
     // --- エラーチェック ---
     // snprintf の戻り値を確認
     if (written < 0)
     {
         // snprintf がエラーを返した場合 (負の値)
-        std::cerr << "エラー: センサーデータ文字列のフォーマットに失敗しました (snprintf)。" << std::endl;
+        LOG_ERROR("エラー: センサーデータ文字列のフォーマットに失敗しました (snprintf)。");
         buffer[0] = '\0'; // エラー時にはバッファを空文字列にする
-        return false;
+        return 0;
     }
     else if ((size_t)written >= buffer_size)
     {
         // 書き込まれた文字数 (written) がバッファサイズ以上の場合、データが切り捨てられたことを意味する
-        std::cerr << "警告: センサーデータ文字列がバッファサイズを超えました。切り捨てられました。" << std::endl;
+        LOG_WARN_EVERY(1000, "警告: センサーデータ文字列がバッファサイズを超えました。切り捨てられました。");
         // データは切り捨てられたが、受信側によってはまだ利用可能かもしれない
-        // 切り捨てが致命的な場合は false を返すか、より深刻なログを記録することを検討する
-        return true; // 現在は切り捨てられても成功として扱う (要件に応じて false に変更)
+        return buffer_size - 1; // 現在は切り捨てられても成功として扱う (要件に応じて 0 に変更)
     }
 
-    return true; // フォーマット成功
+    return static_cast<size_t>(written); // フォーマット成功
+}
+
+// 関連するすべてのセンサーを読み取り、指定されたバッファに文字列としてフォーマットする関数
+bool read_and_format_sensor_data(char *buffer, size_t buffer_size)
+{
+    SensorReadings readings;
+    if (!read_sensor_data(&readings))
+    {
+        return false;
+    }
+    return format_sensor_data_text(readings, buffer, buffer_size) > 0;
 }
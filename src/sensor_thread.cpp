@@ -0,0 +1,288 @@
+#include "sensor_thread.h"
+#include "seqlock.h"    // SeqLock
+#include "time_utils.h" // monotonic_now_ns, ns_to_timespec
+#include "config.h"     // g_config (各デバイスの取得周期)
+#include "hal.h"        // hal_read_* (ハードウェア読み取り)
+#include "realtime.h"   // realtime_configure_sensor_thread, realtime_record_sensor_thread
+#include "latency_histogram.h" // デバイスごとの読み取り時間の計測
+#include "logger.h"     // LOG_*
+#include "ahrs.h"       // 姿勢推定
+#include "imu_stream.h" // 高レートの IMU ストリーム (imu_stream_push)
+#include <thread>
+#include <atomic>
+#include <future>       // 起動時のハンドシェイク (リアルタイム設定の結果を返す)
+#include <system_error>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+
+// --- モジュール内部状態 ---
+static SeqLock<SensorSnapshot> g_snapshot;            // 制御ループ・テレメトリへ公開するスナップショット
+static std::thread g_thread;                           // センサー取得スレッド
+static std::atomic<bool> g_running(false);             // スレッドの実行フラグ
+static std::atomic<unsigned long long> g_read_failures(0);
+static SensorThreadStats g_stats;                      // スレッド内で更新し、SeqLock で公開する
+static SeqLock<SensorThreadStats> g_stats_published;
+
+// デバイスの種類 (個別の取得周期を持つ)。並びは LAT_STAGE_I2C_* と同じにすること
+enum SensorDevice
+{
+    DEVICE_GYRO = 0,
+    DEVICE_ACCEL,
+    DEVICE_MAG,
+    DEVICE_ENV, // 温度・圧力
+    DEVICE_LEAK,
+    DEVICE_ADC,
+    DEVICE_COUNT
+};
+
+// ヘルパー関数: 周波数 [Hz] を周期 [ns] に変換する (0 以下は無効)
+static int64_t rate_to_period_ns(float rate_hz)
+{
+    if (rate_hz <= 0.0f)
+        return 0;
+    return static_cast<int64_t>(1e9 / rate_hz);
+}
+
+// ヘルパー関数: デバイスを1つ読み取り、スナップショットを更新する
+static void read_device(int device, SensorSnapshot *snap, int64_t now_ns)
+{
+    SensorReadings *r = &snap->readings;
+    int64_t start_ns = latency_start();
+    switch (device)
+    {
+    case DEVICE_GYRO:
+        r->gyro = hal_read_gyro();
+        snap->gyro_time_ns = now_ns;
+        snap->gyro_samples++;
+        break;
+    case DEVICE_ACCEL:
+        r->accel = hal_read_accel();
+        snap->accel_time_ns = now_ns;
+        break;
+    case DEVICE_MAG:
+        r->mag = hal_read_mag();
+        snap->mag_time_ns = now_ns;
+        break;
+    case DEVICE_ENV:
+        r->temperature = hal_read_temp();
+        r->pressure = hal_read_pressure();
+        snap->env_time_ns = now_ns;
+        break;
+    case DEVICE_LEAK:
+        r->leak = hal_read_leak();
+        snap->leak_time_ns = now_ns;
+        break;
+    case DEVICE_ADC:
+        hal_read_adc_all(r->adc, 4);
+        snap->adc_time_ns = now_ns;
+        break;
+    default:
+        return;
+    }
+    latency_stop(static_cast<LatencyStage>(LAT_STAGE_I2C_GYRO + device), start_ns);
+}
+
+// ヘルパー関数: 新しいジャイロ値で姿勢推定を1回進め、結果をスナップショットへ書き込む
+static void update_attitude(AhrsState *ahrs, SensorSnapshot *snap, int64_t *prev_gyro_time_ns)
+{
+    LATENCY_SCOPE(LAT_STAGE_AHRS);
+    float dt_s = (*prev_gyro_time_ns != 0) ? static_cast<float>(snap->gyro_time_ns - *prev_gyro_time_ns) / 1e9f : 0.0f;
+    *prev_gyro_time_ns = snap->gyro_time_ns;
+
+    const SensorReadings &r = snap->readings;
+    const AxisData *accel = snap->accel_time_ns != 0 ? &r.accel : NULL;
+    const AxisData *mag = (g_config.ahrs_use_mag && snap->mag_time_ns != 0) ? &r.mag : NULL;
+    ahrs_update(ahrs, r.gyro, accel, mag, dt_s);
+    ahrs_get_estimate(ahrs, &snap->attitude);
+    snap->attitude_valid = ahrs->initialized;
+    g_stats.ahrs_updates = ahrs->updates;
+    g_stats.ahrs_accel_rejected = ahrs->accel_rejected;
+}
+
+// センサー取得スレッド本体: 各デバイスの次回予定時刻のうち最も早いものまで絶対時刻で眠る
+static void sensor_thread_main(std::promise<RealtimeThreadResult> *ready)
+{
+    // リアルタイムモード時は SCHED_FIFO と CPU 割り当てを設定し、結果を起動側へ返す (以降 ready は使わない)
+    ready->set_value(realtime_configure_sensor_thread());
+
+    int64_t period_ns[DEVICE_COUNT];
+    period_ns[DEVICE_GYRO] = rate_to_period_ns(g_config.sensor_gyro_rate_hz);
+    period_ns[DEVICE_ACCEL] = rate_to_period_ns(g_config.sensor_accel_rate_hz);
+    period_ns[DEVICE_MAG] = rate_to_period_ns(g_config.sensor_mag_rate_hz);
+    period_ns[DEVICE_ENV] = rate_to_period_ns(g_config.sensor_env_rate_hz);
+    period_ns[DEVICE_LEAK] = rate_to_period_ns(g_config.sensor_leak_rate_hz);
+    period_ns[DEVICE_ADC] = rate_to_period_ns(g_config.sensor_adc_rate_hz);
+    // IMU ストリームはスナップショットとは別の周期で読み取り、リングへ積むだけ (制御ループのジャイロは変えない)
+    const int64_t stream_period_ns = imu_stream_enabled() ? rate_to_period_ns(g_config.imu_stream_rate_hz) : 0;
+
+    SensorSnapshot snap;
+    memset(&snap, 0, sizeof(snap));
+
+    // 姿勢推定はジャイロを読み取るたびに (IMU レートで) このスレッド内で更新する
+    AhrsState ahrs;
+    ahrs_init(&ahrs, g_config.ahrs_kp, g_config.ahrs_ki);
+    int64_t prev_gyro_time_ns = 0;
+
+    // 起動直後に全デバイスを1回読み取り、以降は各周期で読み取る
+    int64_t next_due_ns[DEVICE_COUNT];
+    int64_t start_ns = monotonic_now_ns();
+    for (int d = 0; d < DEVICE_COUNT; ++d)
+    {
+        read_device(d, &snap, start_ns);
+        next_due_ns[d] = start_ns + period_ns[d];
+    }
+    int64_t stream_next_due_ns = start_ns;
+    if (g_config.ahrs_enabled)
+        update_attitude(&ahrs, &snap, &prev_gyro_time_ns);
+    snap.timestamp_ns = monotonic_now_ns();
+    snap.publish_count++;
+    g_snapshot.store(snap);
+
+    while (g_running.load(std::memory_order_relaxed))
+    {
+        // 次に読み取りが必要なデバイスの予定時刻まで待機
+        int64_t wake_ns = INT64_MAX;
+        for (int d = 0; d < DEVICE_COUNT; ++d)
+        {
+            if (period_ns[d] > 0 && next_due_ns[d] < wake_ns)
+                wake_ns = next_due_ns[d];
+        }
+        if (stream_period_ns > 0 && stream_next_due_ns < wake_ns)
+            wake_ns = stream_next_due_ns;
+        if (wake_ns == INT64_MAX)
+            wake_ns = monotonic_now_ns() + 100 * NSEC_PER_MSEC; // すべて無効の場合は停止要求だけ確認する
+        struct timespec deadline = ns_to_timespec(wake_ns);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        {
+        }
+
+        int64_t now_ns = monotonic_now_ns();
+        g_stats.cycles++;
+        bool updated = false;
+        bool gyro_updated = false;
+        bool accel_updated = false;
+        for (int d = 0; d < DEVICE_COUNT; ++d)
+        {
+            if (period_ns[d] <= 0 || now_ns < next_due_ns[d])
+                continue;
+            read_device(d, &snap, monotonic_now_ns());
+            updated = true;
+            gyro_updated |= (d == DEVICE_GYRO);
+            accel_updated |= (d == DEVICE_ACCEL);
+
+            // 次回予定時刻へ進める。1周期以上遅れた場合は追いつこうとせずに現在時刻から数え直す
+            next_due_ns[d] += period_ns[d];
+            if (next_due_ns[d] <= now_ns)
+            {
+                next_due_ns[d] = now_ns + period_ns[d];
+                g_stats.late_cycles++;
+            }
+        }
+        if (stream_period_ns > 0 && now_ns >= stream_next_due_ns)
+        {
+            // 同じ起床でスナップショット用に読んだデバイスは I2C を読み直さずにその値を使う
+            int64_t sample_ns = monotonic_now_ns();
+            AxisData gyro = gyro_updated ? snap.readings.gyro : hal_read_gyro();
+            AxisData accel = accel_updated ? snap.readings.accel : hal_read_accel();
+            imu_stream_push(gyro, accel, sample_ns);
+            stream_next_due_ns += stream_period_ns;
+            if (stream_next_due_ns <= now_ns)
+            {
+                stream_next_due_ns = now_ns + stream_period_ns;
+                g_stats.late_cycles++;
+            }
+        }
+        // 加速度・磁力は同じ起床で読んだ値も含めて最新のものを使う
+        if (gyro_updated && g_config.ahrs_enabled)
+            update_attitude(&ahrs, &snap, &prev_gyro_time_ns);
+        int64_t read_ns = monotonic_now_ns() - now_ns;
+        if (read_ns > g_stats.max_read_ns)
+            g_stats.max_read_ns = read_ns;
+
+        if (updated)
+        {
+            snap.timestamp_ns = monotonic_now_ns();
+            snap.publish_count++;
+            g_snapshot.store(snap);
+        }
+        g_stats_published.store(g_stats);
+    }
+}
+
+bool sensor_thread_start()
+{
+    if (g_running.load())
+        return true;
+
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_running.store(true);
+
+    // シグナルはメインスレッド (イベントループ) で受け取るため、生成するスレッドではブロックしておく
+    sigset_t block_set, old_set;
+    sigemptyset(&block_set);
+    sigaddset(&block_set, SIGINT);
+    sigaddset(&block_set, SIGTERM);
+    sigaddset(&block_set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &block_set, &old_set);
+    bool started = true;
+    std::promise<RealtimeThreadResult> ready;
+    try
+    {
+        g_thread = std::thread(sensor_thread_main, &ready);
+    }
+    catch (const std::system_error &e)
+    {
+        LOG_ERROR("センサー取得スレッドの起動に失敗: %s", e.what());
+        started = false;
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    if (!started)
+    {
+        g_running.store(false);
+        return false;
+    }
+    realtime_record_sensor_thread(ready.get_future().get()); // 設定が終わるまで待つ (realtime_print_report が読む)
+    LOG_INFO("センサー取得スレッド起動 (gyro %.0fHz, accel %.0fHz, mag %.0fHz, temp/pressure %.0fHz, leak %.0fHz, adc %.0fHz)",
+           g_config.sensor_gyro_rate_hz, g_config.sensor_accel_rate_hz, g_config.sensor_mag_rate_hz,
+           g_config.sensor_env_rate_hz, g_config.sensor_leak_rate_hz, g_config.sensor_adc_rate_hz);
+    return true;
+}
+
+void sensor_thread_stop()
+{
+    if (!g_running.exchange(false))
+        return;
+    if (g_thread.joinable())
+        g_thread.join();
+    LOG_INFO("センサー取得スレッドを停止しました。");
+}
+
+bool sensor_snapshot_read(SensorSnapshot *snapshot)
+{
+    if (!snapshot || g_snapshot.version() == 0)
+        return false;
+    if (!g_snapshot.load(snapshot))
+    {
+        g_read_failures.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void sensor_thread_get_stats(SensorThreadStats *stats)
+{
+    if (!stats)
+        return;
+    memset(stats, 0, sizeof(SensorThreadStats));
+    g_stats_published.load(stats);
+    stats->read_failures = g_read_failures.load(std::memory_order_relaxed);
+}
+
+void sensor_thread_print_stats()
+{
+    SensorThreadStats st;
+    sensor_thread_get_stats(&st);
+    LOG_INFO("[SENSOR STATS] cycles=%llu late=%llu read_failures=%llu max_read=%.1fus ahrs_updates=%llu accel_rejected=%llu",
+           st.cycles, st.late_cycles, st.read_failures, st.max_read_ns / 1000.0, st.ahrs_updates, st.ahrs_accel_rejected);
+}
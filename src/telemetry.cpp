@@ -0,0 +1,147 @@
+#include "telemetry.h"
+#include "byte_order.h" // write_le16, write_le32, write_le64, write_le_float
+#include <string.h>     // memcpy
+#include <math.h>       // lrintf
+
+void telemetry_encoder_init(TelemetryEncoder *enc, uint8_t encoding, uint32_t field_mask)
+{
+    if (!enc)
+        return;
+    enc->sequence = 0;
+    enc->encoding = encoding <= TELEMETRY_ENCODING_FIXED16 ? encoding : static_cast<uint8_t>(TELEMETRY_ENCODING_FLOAT32);
+    enc->field_mask = field_mask;
+}
+
+uint32_t telemetry_fill_values(const SensorReadings &r, float values[TELEMETRY_MAX_FIELDS])
+{
+    values[TELEMETRY_FIELD_TEMP] = r.temperature;
+    values[TELEMETRY_FIELD_PRESSURE] = r.pressure;
+    values[TELEMETRY_FIELD_LEAK] = r.leak ? 1.0f : 0.0f;
+    values[TELEMETRY_FIELD_ADC0] = r.adc[0];
+    values[TELEMETRY_FIELD_ADC1] = r.adc[1];
+    values[TELEMETRY_FIELD_ADC2] = r.adc[2];
+    values[TELEMETRY_FIELD_ADC3] = r.adc[3];
+    values[TELEMETRY_FIELD_ACCX] = r.accel.x;
+    values[TELEMETRY_FIELD_ACCY] = r.accel.y;
+    values[TELEMETRY_FIELD_ACCZ] = r.accel.z;
+    values[TELEMETRY_FIELD_GYROX] = r.gyro.x;
+    values[TELEMETRY_FIELD_GYROY] = r.gyro.y;
+    values[TELEMETRY_FIELD_GYROZ] = r.gyro.z;
+    values[TELEMETRY_FIELD_MAGX] = r.mag.x;
+    values[TELEMETRY_FIELD_MAGY] = r.mag.y;
+    values[TELEMETRY_FIELD_MAGZ] = r.mag.z;
+    return (1u << (TELEMETRY_FIELD_MAGZ + 1)) - 1; // TEMP〜MAGZ
+}
+
+uint32_t telemetry_fill_attitude(const AttitudeEstimate &attitude, float values[TELEMETRY_MAX_FIELDS])
+{
+    values[TELEMETRY_FIELD_ROLL] = attitude.roll_deg;
+    values[TELEMETRY_FIELD_PITCH] = attitude.pitch_deg;
+    values[TELEMETRY_FIELD_HEADING] = attitude.heading_deg;
+    return (1u << TELEMETRY_FIELD_ROLL) | (1u << TELEMETRY_FIELD_PITCH) | (1u << TELEMETRY_FIELD_HEADING);
+}
+
+uint32_t telemetry_fill_link(float latency_p50_ms, float latency_p99_ms, float rtt_ms, float values[TELEMETRY_MAX_FIELDS])
+{
+    values[TELEMETRY_FIELD_CMD_LATENCY_P50] = latency_p50_ms;
+    values[TELEMETRY_FIELD_CMD_LATENCY_P99] = latency_p99_ms;
+    values[TELEMETRY_FIELD_LINK_RTT] = rtt_ms;
+    return (1u << TELEMETRY_FIELD_CMD_LATENCY_P50) | (1u << TELEMETRY_FIELD_CMD_LATENCY_P99) | (1u << TELEMETRY_FIELD_LINK_RTT);
+}
+
+uint16_t telemetry_float_to_half(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x007FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF)
+    {
+        // Inf / NaN (NaN は仮数部の上位ビットを立てて保持)
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x0200 : 0));
+    }
+    if (exponent >= 0x1F)
+    {
+        return static_cast<uint16_t>(sign | 0x7C00); // 範囲外は ±Inf
+    }
+    if (exponent <= 0)
+    {
+        // 非正規化数 (またはアンダーフローして ±0)
+        if (exponent < -10)
+            return sign;
+        mantissa |= 0x00800000; // 暗黙の1を付加
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half_mantissa = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half_mantissa & 1)))
+            half_mantissa++;
+        return static_cast<uint16_t>(sign | half_mantissa);
+    }
+
+    uint16_t half = static_cast<uint16_t>(sign | (exponent << 10) | (mantissa >> 13));
+    uint32_t remainder = mantissa & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        half++; // 繰り上がりで指数部に溢れても正しく次の値 (または Inf) になる
+    return half;
+}
+
+// ヘルパー関数: FIXED16 へ量子化する (範囲外は飽和)
+static int16_t quantize_fixed16(float value, float scale)
+{
+    float scaled = value / scale;
+    if (scaled >= 32767.0f)
+        return 32767;
+    if (scaled <= -32767.0f)
+        return -32767;
+    if (scaled != scaled)
+        return 0; // NaN
+    return static_cast<int16_t>(lrintf(scaled));
+}
+
+size_t telemetry_encode_frame(TelemetryEncoder *enc, const float values[TELEMETRY_MAX_FIELDS], uint32_t available_mask,
+                              uint64_t timestamp_us, uint8_t *buffer, size_t buffer_size)
+{
+    if (!enc || !values || !buffer)
+        return 0;
+
+    uint32_t mask = enc->field_mask & available_mask;
+    size_t frame_size = telemetry_frame_size(mask, enc->encoding);
+    if (buffer_size < frame_size)
+        return 0;
+
+    buffer[0] = TELEMETRY_MAGIC0;
+    buffer[1] = TELEMETRY_MAGIC1;
+    buffer[2] = TELEMETRY_PROTOCOL_VERSION;
+    buffer[3] = enc->encoding;
+    write_le32(buffer + 4, enc->sequence);
+    write_le64(buffer + 8, timestamp_us);
+    write_le32(buffer + 16, mask);
+
+    uint8_t *p = buffer + TELEMETRY_HEADER_SIZE;
+    for (int i = 0; i < TELEMETRY_MAX_FIELDS; ++i)
+    {
+        if (!(mask & (1u << i)))
+            continue;
+        switch (enc->encoding)
+        {
+        case TELEMETRY_ENCODING_FLOAT16:
+            write_le16(p, telemetry_float_to_half(values[i]));
+            p += 2;
+            break;
+        case TELEMETRY_ENCODING_FIXED16:
+            write_le16(p, static_cast<uint16_t>(quantize_fixed16(values[i], i < TELEMETRY_FIELD_COUNT ? telemetry_fixed16_scale[i] : 1.0f)));
+            p += 2;
+            break;
+        default:
+            write_le_float(p, values[i]);
+            p += 4;
+            break;
+        }
+    }
+
+    enc->sequence++;
+    return frame_size;
+}
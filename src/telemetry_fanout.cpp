@@ -0,0 +1,334 @@
+#include "telemetry_fanout.h"
+#include "byte_order.h"        // リトルエンディアン読み書きと CRC
+#include "config.h"            // g_config
+#include "time_utils.h"        // NSEC_PER_SEC
+#include "latency_histogram.h" // LAT_STAGE_NET_SEND
+#include "logger.h"            // LOG_INFO, LOG_WARN_EVERY
+#include <string.h>            // memset, strerror
+#include <errno.h>             // errno
+#include <arpa/inet.h>         // inet_ntoa, htons, ntohs
+
+// ヘルパー関数: 同じアドレス・ポートか
+static bool same_endpoint(const struct sockaddr_in *a, const struct sockaddr_in *b)
+{
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+// ヘルパー関数: 購読者のアドレスを探す (なければ -1)
+static int find_subscriber(const TelemetryFanout *fanout, const struct sockaddr_in *addr)
+{
+    for (int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS; ++i)
+    {
+        if (fanout->subscribers[i].active && same_endpoint(&fanout->subscribers[i].addr, addr))
+            return i;
+    }
+    return -1;
+}
+
+// ヘルパー関数: 購読者を解除する
+static void remove_subscriber(TelemetryFanout *fanout, int index, const char *reason)
+{
+    TelemetrySubscriber *sub = &fanout->subscribers[index];
+    LOG_INFO("[TELEMETRY] 購読者 %s:%d を解除しました (%s、送信 %llu フレーム)。", inet_ntoa(sub->addr.sin_addr),
+             ntohs(sub->addr.sin_port), reason, sub->frames_sent);
+    sub->active = false;
+    fanout->subscriber_count--;
+}
+
+// ヘルパー関数: ACK / NACK を購読者のテレメトリ受信ポートへ返す
+static void send_reply(TelemetryFanout *fanout, uint8_t type, const struct sockaddr_in *dest, uint16_t divider,
+                       uint32_t field_mask, uint16_t lease_s)
+{
+    char reply[TELEMETRY_SUBSCRIBE_SIZE];
+    telemetry_encode_subscribe(type, ntohs(dest->sin_port), divider, field_mask, lease_s, reply, sizeof(reply));
+    sendto(fanout->net->send_socket, reply, sizeof(reply), 0, reinterpret_cast<const struct sockaddr *>(dest), sizeof(*dest));
+}
+
+// ヘルパー関数: 期限切れの購読者を解除する
+static void prune_expired(TelemetryFanout *fanout, int64_t now_ns)
+{
+    for (int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS; ++i)
+    {
+        if (fanout->subscribers[i].active && now_ns >= fanout->subscribers[i].expiry_ns)
+        {
+            remove_subscriber(fanout, i, "期限切れ");
+            fanout->expired++;
+        }
+    }
+}
+
+// ヘルパー関数: 操縦者に送るか (同じアドレス・ポートの購読があればそちらの設定で送る)
+static bool pilot_destination(const TelemetryFanout *fanout)
+{
+    const NetworkContext *net = fanout->net;
+    return net->client_addr_known && find_subscriber(fanout, &net->client_addr_send) < 0;
+}
+
+// ヘルパー関数: 今回の周期に送る購読者か
+static bool subscriber_due(const TelemetryFanout *fanout, const TelemetrySubscriber *sub)
+{
+    return sub->active && (fanout->tick - sub->phase) % sub->divider == 0;
+}
+
+// ヘルパー関数: 送信先を1つ追加する (data/len を指すだけで、コピーはしない)
+static void add_destination(TelemetryFanout *fanout, int slot, const struct sockaddr_in *addr, const void *data, size_t len,
+                            int subscriber)
+{
+    fanout->tx_addr[slot] = *addr;
+    fanout->tx_iov[slot].iov_base = const_cast<void *>(data);
+    fanout->tx_iov[slot].iov_len = len;
+    memset(&fanout->tx_msgs[slot], 0, sizeof(struct mmsghdr));
+    fanout->tx_msgs[slot].msg_hdr.msg_name = &fanout->tx_addr[slot];
+    fanout->tx_msgs[slot].msg_hdr.msg_namelen = sizeof(fanout->tx_addr[slot]);
+    fanout->tx_msgs[slot].msg_hdr.msg_iov = &fanout->tx_iov[slot];
+    fanout->tx_msgs[slot].msg_hdr.msg_iovlen = 1;
+    fanout->tx_subscriber[slot] = subscriber;
+}
+
+// ヘルパー関数: 用意した送信先へ sendmmsg でまとめて送る。送信できた数を返す
+static int flush_destinations(TelemetryFanout *fanout, int count)
+{
+    int sent_total = 0;
+    int next = 0;
+    int64_t send_start_ns = latency_start();
+    while (next < count)
+    {
+        int sent = sendmmsg(fanout->net->send_socket, &fanout->tx_msgs[next], count - next, 0);
+        fanout->batches++;
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // sendmmsg は先頭の送信先で失敗した場合だけ -1 を返す (到達不能など)。その1件を飛ばして残りを送る
+            LOG_WARN_EVERY(1000, "[TELEMETRY] sendmmsg 失敗: %s", strerror(errno));
+            int failed = fanout->tx_subscriber[next];
+            if (failed >= 0)
+                fanout->subscribers[failed].send_errors++;
+            fanout->send_errors++;
+            next++;
+            continue;
+        }
+        for (int k = next; k < next + sent; ++k)
+        {
+            if (fanout->tx_subscriber[k] >= 0)
+                fanout->subscribers[fanout->tx_subscriber[k]].frames_sent++;
+        }
+        sent_total += sent;
+        next += sent;
+    }
+    latency_stop(LAT_STAGE_NET_SEND, send_start_ns);
+    fanout->datagrams_sent += static_cast<unsigned long long>(sent_total);
+    return sent_total;
+}
+
+void telemetry_fanout_init(TelemetryFanout *fanout, NetworkContext *net)
+{
+    if (!fanout)
+        return;
+
+    memset(fanout, 0, sizeof(TelemetryFanout));
+    fanout->net = net;
+}
+
+size_t telemetry_encode_subscribe(uint8_t type, uint16_t port, uint16_t divider, uint32_t field_mask, uint16_t lease_s,
+                                  char *buffer, size_t buffer_size)
+{
+    if (!buffer || buffer_size < TELEMETRY_SUBSCRIBE_SIZE)
+        return 0;
+
+    unsigned char *p = reinterpret_cast<unsigned char *>(buffer);
+    p[0] = TELEMETRY_SUBSCRIBE_MAGIC0;
+    p[1] = TELEMETRY_SUBSCRIBE_MAGIC1;
+    p[2] = TELEMETRY_SUBSCRIBE_VERSION;
+    p[3] = type;
+    write_le16(p + 4, port);
+    write_le16(p + 6, divider);
+    write_le32(p + 8, field_mask);
+    write_le16(p + 12, lease_s);
+    write_le16(p + 14, crc16_ccitt(p, 14));
+    return TELEMETRY_SUBSCRIBE_SIZE;
+}
+
+bool telemetry_fanout_packet_handler(TelemetryFanout *fanout, const char *data, size_t len, const struct sockaddr_in *from,
+                                     int64_t now_ns)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    if (!fanout || len < 2 || p[0] != TELEMETRY_SUBSCRIBE_MAGIC0 || p[1] != TELEMETRY_SUBSCRIBE_MAGIC1)
+        return false; // 購読パケットではない
+
+    if (len != TELEMETRY_SUBSCRIBE_SIZE || p[2] != TELEMETRY_SUBSCRIBE_VERSION || read_le16(p + 14) != crc16_ccitt(p, 14) || !from)
+    {
+        fanout->rejected++;
+        return true;
+    }
+
+    struct sockaddr_in dest = *from;
+    uint16_t port = read_le16(p + 4);
+    if (port != 0)
+        dest.sin_port = htons(port);
+    const uint8_t type = p[3];
+    int index = find_subscriber(fanout, &dest);
+
+    if (type == TELEMETRY_UNSUBSCRIBE)
+    {
+        if (index >= 0)
+        {
+            remove_subscriber(fanout, index, "解除要求");
+            fanout->unsubscribes++;
+        }
+        return true;
+    }
+    if (type != TELEMETRY_SUBSCRIBE)
+    {
+        fanout->rejected++;
+        return true;
+    }
+
+    uint16_t divider = read_le16(p + 6);
+    uint32_t field_mask = read_le32(p + 8);
+    unsigned int lease_s = read_le16(p + 12);
+    if (divider == 0)
+        divider = 1;
+    if (field_mask == 0)
+        field_mask = g_config.telemetry_field_mask;
+    if (lease_s == 0)
+        lease_s = g_config.telemetry_subscriber_lease_s;
+    if (lease_s > TELEMETRY_MAX_LEASE_S)
+        lease_s = TELEMETRY_MAX_LEASE_S;
+
+    bool renewal = index >= 0;
+    if (!renewal)
+    {
+        for (int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS && index < 0; ++i)
+        {
+            if (!fanout->subscribers[i].active)
+                index = i;
+        }
+        if (index < 0)
+        {
+            LOG_WARN_EVERY(1000, "[TELEMETRY] 購読者が上限 (%d) に達しているため %s:%d を登録できません。",
+                           TELEMETRY_MAX_SUBSCRIBERS, inet_ntoa(dest.sin_addr), ntohs(dest.sin_port));
+            fanout->rejected++;
+            send_reply(fanout, TELEMETRY_SUBSCRIBE_NACK, &dest, divider, field_mask, 0);
+            return true;
+        }
+        memset(&fanout->subscribers[index], 0, sizeof(TelemetrySubscriber));
+        fanout->subscribers[index].active = true;
+        fanout->subscribers[index].addr = dest;
+        fanout->subscribers[index].phase = fanout->tick; // 次の周期から送る
+        fanout->subscriber_count++;
+        fanout->subscribes++;
+    }
+    else
+    {
+        fanout->renewals++;
+    }
+
+    TelemetrySubscriber *sub = &fanout->subscribers[index];
+    bool changed = !renewal || sub->divider != divider || sub->field_mask != field_mask;
+    sub->divider = divider;
+    sub->field_mask = field_mask;
+    sub->expiry_ns = now_ns + static_cast<int64_t>(lease_s) * NSEC_PER_SEC;
+    if (changed)
+    {
+        LOG_INFO("[TELEMETRY] 購読者 %s:%d を%s (1/%u 周期、フィールド 0x%X、期限 %u 秒)。", inet_ntoa(dest.sin_addr),
+                 ntohs(dest.sin_port), renewal ? "更新しました" : "登録しました", divider, field_mask, lease_s);
+    }
+    send_reply(fanout, TELEMETRY_SUBSCRIBE_ACK, &dest, divider, field_mask, static_cast<uint16_t>(lease_s));
+    return true;
+}
+
+bool telemetry_fanout_has_destinations(const TelemetryFanout *fanout)
+{
+    return fanout && (fanout->net->client_addr_known || fanout->subscriber_count > 0);
+}
+
+int telemetry_fanout_send_frames(TelemetryFanout *fanout, const TelemetryEncoder *encoder, const float values[TELEMETRY_MAX_FIELDS],
+                                 uint32_t available_mask, uint64_t timestamp_us, int64_t now_ns)
+{
+    if (!fanout || !encoder)
+        return 0;
+
+    prune_expired(fanout, now_ns);
+    int64_t encode_start_ns = latency_start();
+    int frame_count = 0;
+    int count = 0;
+    for (int s = -1; s < TELEMETRY_MAX_SUBSCRIBERS; ++s)
+    {
+        const struct sockaddr_in *addr;
+        uint32_t mask;
+        if (s < 0)
+        {
+            if (!pilot_destination(fanout))
+                continue;
+            addr = &fanout->net->client_addr_send;
+            mask = encoder->field_mask;
+        }
+        else
+        {
+            if (!subscriber_due(fanout, &fanout->subscribers[s]))
+                continue;
+            addr = &fanout->subscribers[s].addr;
+            mask = encoder->field_mask & fanout->subscribers[s].field_mask;
+        }
+
+        // 同じフィールドの組み合わせは1回だけエンコードする
+        int frame = 0;
+        while (frame < frame_count && fanout->frame_masks[frame] != mask)
+            frame++;
+        if (frame == frame_count)
+        {
+            TelemetryEncoder frame_encoder = *encoder;
+            frame_encoder.field_mask = mask;
+            frame_encoder.sequence = fanout->tick;
+            fanout->frame_lengths[frame] = telemetry_encode_frame(&frame_encoder, values, available_mask, timestamp_us,
+                                                                  fanout->frames[frame], TELEMETRY_MAX_FRAME_SIZE);
+            fanout->frame_masks[frame] = mask;
+            frame_count++;
+            fanout->frames_encoded++;
+        }
+        if (fanout->frame_lengths[frame] == 0)
+            continue;
+        add_destination(fanout, count++, addr, fanout->frames[frame], fanout->frame_lengths[frame], s);
+    }
+    latency_stop(LAT_STAGE_TELEMETRY_ENCODE, encode_start_ns);
+    fanout->tick++;
+    return count > 0 ? flush_destinations(fanout, count) : 0;
+}
+
+int telemetry_fanout_send_text(TelemetryFanout *fanout, const char *text, size_t text_len, int64_t now_ns)
+{
+    if (!fanout || !text || text_len == 0)
+        return 0;
+
+    prune_expired(fanout, now_ns);
+    int count = 0;
+    if (pilot_destination(fanout))
+        add_destination(fanout, count++, &fanout->net->client_addr_send, text, text_len, -1);
+    for (int s = 0; s < TELEMETRY_MAX_SUBSCRIBERS; ++s)
+    {
+        if (subscriber_due(fanout, &fanout->subscribers[s]))
+            add_destination(fanout, count++, &fanout->subscribers[s].addr, text, text_len, s);
+    }
+    fanout->tick++;
+    return count > 0 ? flush_destinations(fanout, count) : 0;
+}
+
+void telemetry_fanout_print_stats(const TelemetryFanout *fanout)
+{
+    if (!fanout)
+        return;
+
+    LOG_INFO("[TELEMETRY STATS] subscribers=%u frames_encoded=%llu datagrams=%llu batches=%llu send_errors=%llu "
+             "subscribes=%llu renewals=%llu unsubscribes=%llu expired=%llu rejected=%llu",
+             fanout->subscriber_count, fanout->frames_encoded, fanout->datagrams_sent, fanout->batches, fanout->send_errors,
+             fanout->subscribes, fanout->renewals, fanout->unsubscribes, fanout->expired, fanout->rejected);
+    for (int i = 0; i < TELEMETRY_MAX_SUBSCRIBERS; ++i)
+    {
+        const TelemetrySubscriber *sub = &fanout->subscribers[i];
+        if (!sub->active)
+            continue;
+        LOG_INFO("[TELEMETRY STATS]   %s:%d 1/%u mask=0x%X frames=%llu errors=%llu", inet_ntoa(sub->addr.sin_addr),
+                 ntohs(sub->addr.sin_port), sub->divider, sub->field_mask, sub->frames_sent, sub->send_errors);
+    }
+}
@@ -0,0 +1,84 @@
+#include "thrust_allocation.h"
+#include "logger.h" // LOG_*
+#include <string.h> // memset
+
+bool thrust_allocator_init(ThrustAllocator *alloc, int thruster_count, const float matrix[][WRENCH_DOF],
+                           const int channels[], const float force_min[], const float force_max[])
+{
+    if (!alloc || !matrix || !channels || !force_min || !force_max || thruster_count <= 0 || thruster_count > ALLOC_MAX_THRUSTERS)
+    {
+        LOG_ERROR("推力配分の初期化失敗: スラスター数 %d (1〜%d)", thruster_count, ALLOC_MAX_THRUSTERS);
+        return false;
+    }
+
+    memset(alloc, 0, sizeof(ThrustAllocator));
+    alloc->thruster_count = thruster_count;
+    for (int i = 0; i < thruster_count; ++i)
+    {
+        if (force_max[i] <= 0.0f || force_min[i] > 0.0f)
+        {
+            LOG_ERROR("推力配分の初期化失敗: T%d の推力範囲が不正です (%.2f〜%.2f N)", i, force_min[i], force_max[i]);
+            return false;
+        }
+        alloc->channels[i] = channels[i];
+        alloc->output_min[i] = force_min[i];
+        alloc->output_max[i] = force_max[i];
+        for (int axis = 0; axis < WRENCH_DOF; ++axis)
+        {
+            alloc->matrix[axis][i] = matrix[i][axis]; // 列優先に並べ替える
+        }
+    }
+    return true;
+}
+
+bool thrust_allocate(ThrustAllocator *alloc, const float wrench[WRENCH_DOF], float output[ALLOC_MAX_THRUSTERS])
+{
+    // u = B・w (固定長ループ: 未使用のスラスターは係数 0 のため結果も 0)
+    float u[ALLOC_MAX_THRUSTERS] = {0.0f};
+    for (int axis = 0; axis < WRENCH_DOF; ++axis)
+    {
+        const float w = wrench[axis];
+        const float *column = alloc->matrix[axis];
+        for (int i = 0; i < ALLOC_MAX_THRUSTERS; ++i)
+        {
+            u[i] += column[i] * w;
+        }
+    }
+
+    // 飽和の正規化: 範囲を最も超えたスラスターに合わせて全体を縮小する (個別にクリップすると方向が変わるため)
+    // 単方向スラスターの負の出力は、対向するスラスターが受け持つ成分なので縮小の判定には含めない
+    // (未使用のスラスターは範囲も出力も 0 のため判定に影響しない)
+    float scale = 1.0f;
+    for (int i = 0; i < ALLOC_MAX_THRUSTERS; ++i)
+    {
+        if (u[i] > alloc->output_max[i] && alloc->output_max[i] / u[i] < scale)
+            scale = alloc->output_max[i] / u[i];
+        if (alloc->output_min[i] < 0.0f && u[i] < alloc->output_min[i] && alloc->output_min[i] / u[i] < scale)
+            scale = alloc->output_min[i] / u[i];
+    }
+    bool saturated = scale < 1.0f;
+    if (saturated)
+        alloc->saturations++;
+
+    for (int i = 0; i < ALLOC_MAX_THRUSTERS; ++i)
+    {
+        float v = u[i] * scale;
+        v = v < alloc->output_min[i] ? alloc->output_min[i] : v; // 単方向スラスターは逆推力を出せないため 0 で打ち切る
+        output[i] = v > alloc->output_max[i] ? alloc->output_max[i] : v;
+    }
+    return saturated;
+}
+
+void thrust_allocator_print(const ThrustAllocator *alloc)
+{
+    if (!alloc)
+        return;
+    LOG_INFO("推力配分行列 (%d スラスター): surge sway heave roll pitch yaw / 推力範囲 [N]", alloc->thruster_count);
+    for (int i = 0; i < alloc->thruster_count; ++i)
+    {
+        LOG_INFO("  T%d (Ch%d): %5.2f %5.2f %5.2f %5.2f %5.2f %5.2f / %.1f〜%.1f", i, alloc->channels[i],
+                 alloc->matrix[WRENCH_SURGE][i], alloc->matrix[WRENCH_SWAY][i], alloc->matrix[WRENCH_HEAVE][i],
+                 alloc->matrix[WRENCH_ROLL][i], alloc->matrix[WRENCH_PITCH][i], alloc->matrix[WRENCH_YAW][i],
+                 alloc->output_min[i], alloc->output_max[i]);
+    }
+}
@@ -0,0 +1,248 @@
+#include "thrust_curve.h"
+#include "logger.h" // LOG_*
+#include <stdio.h>  // fopen, fgets
+#include <stdlib.h> // strtof
+#include <string.h> // strcmp, strchr, strerror
+#include <errno.h>  // errno
+
+// --- 組み込みプロファイル ---
+// BlueRobotics T200 (16V) の公開性能データ (kgf) を N に換算した値
+static constexpr ThrustCurvePoint T200_16V[] = {
+    {1100.0f, -39.91f}, {1150.0f, -34.81f}, {1200.0f, -29.22f}, {1250.0f, -23.54f}, {1300.0f, -18.04f},
+    {1350.0f, -12.55f}, {1400.0f, -7.45f}, {1450.0f, -2.75f}, {1464.0f, 0.00f}, {1536.0f, 0.00f},
+    {1550.0f, 3.04f}, {1600.0f, 9.12f}, {1650.0f, 15.89f}, {1700.0f, 23.34f}, {1750.0f, 31.09f},
+    {1800.0f, 39.13f}, {1850.0f, 46.78f}, {1900.0f, 51.48f}};
+
+// 同じ T200 を前進専用 (1100us で停止、1900us で最大) に設定した ESC で使う場合
+static constexpr ThrustCurvePoint T200_16V_FORWARD[] = {
+    {1100.0f, 0.00f}, {1172.0f, 0.00f}, {1200.0f, 3.04f}, {1300.0f, 9.12f}, {1400.0f, 15.89f},
+    {1500.0f, 23.34f}, {1600.0f, 31.09f}, {1700.0f, 39.13f}, {1800.0f, 46.78f}, {1900.0f, 51.48f}};
+
+typedef struct
+{
+    const char *name;
+    const ThrustCurvePoint *points;
+    int count;
+} BuiltinThrustCurve;
+
+static const BuiltinThrustCurve BUILTIN_CURVES[] = {
+    {"t200_16v", T200_16V, static_cast<int>(sizeof(T200_16V) / sizeof(T200_16V[0]))},
+    {"t200_16v_forward", T200_16V_FORWARD, static_cast<int>(sizeof(T200_16V_FORWARD) / sizeof(T200_16V_FORWARD[0]))}};
+
+// ヘルパー関数: 推力 force_from〜force_to を等分した各点の PWM を求める
+// forward_side が true の場合は推力が force を超え始める区間 (不感帯の先)、false の場合は force に達する区間 (不感帯の手前) を使う
+static void fill_half_lut(float *table, const ThrustCurvePoint *points, int count, float force_from, float force_to, bool forward_side)
+{
+    const float step = (force_to - force_from) / (THRUST_CURVE_LUT_SIZE - 1);
+    int segment = 1;
+    for (int k = 0; k < THRUST_CURVE_LUT_SIZE; ++k)
+    {
+        float force = force_from + step * static_cast<float>(k);
+        while (segment < count - 1 && (forward_side ? points[segment].force_n <= force : points[segment].force_n < force))
+            segment++;
+        const ThrustCurvePoint &a = points[segment - 1], &b = points[segment];
+        float pwm;
+        if (b.force_n <= a.force_n)
+        {
+            pwm = forward_side ? b.pwm_us : a.pwm_us;
+        }
+        else
+        {
+            float t = (force - a.force_n) / (b.force_n - a.force_n);
+            t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+            pwm = a.pwm_us + (b.pwm_us - a.pwm_us) * t;
+        }
+        table[k] = pwm;
+    }
+}
+
+bool thrust_curve_build_lut(ThrustCurveLut *lut, const ThrustCurvePoint *points, int count)
+{
+    if (!lut || !points || count < 2 || count > THRUST_CURVE_MAX_POINTS)
+    {
+        LOG_ERROR("推力曲線の測定点数が不正です (%d、2〜%d)", count, THRUST_CURVE_MAX_POINTS);
+        return false;
+    }
+    for (int i = 1; i < count; ++i)
+    {
+        if (points[i].pwm_us <= points[i - 1].pwm_us || points[i].force_n < points[i - 1].force_n)
+        {
+            LOG_ERROR("推力曲線は PWM の昇順かつ推力が単調非減少である必要があります (%d 点目: %.0fus %.2fN)",
+                      i, points[i].pwm_us, points[i].force_n);
+            return false;
+        }
+    }
+    if (points[count - 1].force_n <= points[0].force_n)
+    {
+        LOG_ERROR("推力曲線の推力が変化しません");
+        return false;
+    }
+
+    lut->force_min_n = points[0].force_n;
+    lut->force_max_n = points[count - 1].force_n;
+
+    // 停止のパルス幅: 先頭が推力 0 以上なら先頭 (単方向)、そうでなければ推力 0 の区間の中央 (双方向の不感帯)
+    if (points[0].force_n >= 0.0f)
+    {
+        lut->zero_pwm_us = points[0].pwm_us;
+    }
+    else
+    {
+        float zero_begin = points[count - 1].pwm_us, zero_end = points[0].pwm_us;
+        for (int i = 1; i < count; ++i)
+        {
+            const ThrustCurvePoint &a = points[i - 1], &b = points[i];
+            if (a.force_n <= 0.0f && b.force_n >= 0.0f)
+            {
+                float cross = (b.force_n == a.force_n) ? a.pwm_us
+                                                       : a.pwm_us + (0.0f - a.force_n) * (b.pwm_us - a.pwm_us) / (b.force_n - a.force_n);
+                zero_begin = cross < zero_begin ? cross : zero_begin;
+                float end = (b.force_n == 0.0f) ? b.pwm_us : cross;
+                zero_end = end > zero_end ? end : zero_end;
+            }
+        }
+        lut->zero_pwm_us = (zero_begin <= zero_end) ? 0.5f * (zero_begin + zero_end) : points[0].pwm_us;
+    }
+
+    // 推力を等間隔に区切り、各推力を出す PWM を区分線形補間で逆算する
+    // 推力 0 の点は、後退側は不感帯の手前、前進側は不感帯の先の PWM になる
+    if (lut->force_min_n < 0.0f)
+    {
+        fill_half_lut(lut->reverse_lut, points, count, lut->force_min_n, 0.0f, false);
+        lut->inv_step_reverse = (THRUST_CURVE_LUT_SIZE - 1) / (0.0f - lut->force_min_n);
+    }
+    else
+    {
+        for (int k = 0; k < THRUST_CURVE_LUT_SIZE; ++k)
+            lut->reverse_lut[k] = lut->zero_pwm_us;
+        lut->inv_step_reverse = 0.0f;
+    }
+    if (lut->force_max_n > 0.0f)
+    {
+        fill_half_lut(lut->forward_lut, points, count, 0.0f, lut->force_max_n, true);
+        lut->inv_step_forward = (THRUST_CURVE_LUT_SIZE - 1) / lut->force_max_n;
+    }
+    else
+    {
+        for (int k = 0; k < THRUST_CURVE_LUT_SIZE; ++k)
+            lut->forward_lut[k] = lut->zero_pwm_us;
+        lut->inv_step_forward = 0.0f;
+    }
+    return true;
+}
+
+bool thrust_curve_load_builtin(ThrustCurveLut *lut, const char *name)
+{
+    for (size_t i = 0; i < sizeof(BUILTIN_CURVES) / sizeof(BUILTIN_CURVES[0]); ++i)
+    {
+        if (strcmp(BUILTIN_CURVES[i].name, name) == 0)
+            return thrust_curve_build_lut(lut, BUILTIN_CURVES[i].points, BUILTIN_CURVES[i].count);
+    }
+    return false;
+}
+
+bool thrust_curve_build_linear(ThrustCurveLut *lut, float min_us, float neutral_us, float max_us, float max_force_n, bool bidirectional)
+{
+    if (bidirectional)
+    {
+        ThrustCurvePoint points[3] = {{min_us, -max_force_n}, {neutral_us, 0.0f}, {max_us, max_force_n}};
+        return thrust_curve_build_lut(lut, points, 3);
+    }
+    ThrustCurvePoint points[2] = {{min_us, 0.0f}, {max_us, max_force_n}};
+    return thrust_curve_build_lut(lut, points, 2);
+}
+
+bool thrust_curve_load_csv(ThrustCurveLut *lut, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        LOG_ERROR("推力曲線ファイル '%s' を開けません: %s", path, strerror(errno));
+        return false;
+    }
+
+    ThrustCurvePoint points[THRUST_CURVE_MAX_POINTS];
+    int count = 0;
+    int line_num = 0;
+    char line[256];
+    bool ok = true;
+    while (fgets(line, sizeof(line), file))
+    {
+        line_num++;
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+        char *p = line;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (*p == '\0' || *p == '\n' || *p == '\r')
+            continue;
+
+        char *end = NULL;
+        float pwm = strtof(p, &end);
+        if (end == p || *end != ',')
+        {
+            // 先頭行の見出し (pwm_us,force_n など) は読み飛ばす
+            if (count == 0)
+                continue;
+            LOG_ERROR("推力曲線ファイル '%s' の %d 行目を解釈できません", path, line_num);
+            ok = false;
+            break;
+        }
+        char *force_begin = end + 1;
+        float force = strtof(force_begin, &end);
+        if (end == force_begin)
+        {
+            LOG_ERROR("推力曲線ファイル '%s' の %d 行目に推力がありません", path, line_num);
+            ok = false;
+            break;
+        }
+        if (count >= THRUST_CURVE_MAX_POINTS)
+        {
+            LOG_ERROR("推力曲線ファイル '%s' の測定点が多すぎます (最大 %d)", path, THRUST_CURVE_MAX_POINTS);
+            ok = false;
+            break;
+        }
+        points[count].pwm_us = pwm;
+        points[count].force_n = force;
+        count++;
+    }
+    fclose(file);
+    return ok && thrust_curve_build_lut(lut, points, count);
+}
+
+// ヘルパー関数: 昇順の表 table で pwm_us を挟む区間を二分探索し、区間番号 + 区間内の位置 (0〜LUT_SIZE-1) を返す
+static float lut_position(const float *table, float pwm_us)
+{
+    int lo = 0, hi = THRUST_CURVE_LUT_SIZE - 1;
+    while (hi - lo > 1)
+    {
+        int mid = (lo + hi) / 2;
+        if (table[mid] <= pwm_us)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    float span = table[hi] - table[lo];
+    float frac = span > 0.0f ? (pwm_us - table[lo]) / span : 0.0f;
+    return static_cast<float>(lo) + frac;
+}
+
+float thrust_curve_force(const ThrustCurveLut *lut, float pwm_us)
+{
+    const float *forward = lut->forward_lut;
+    const float *reverse = lut->reverse_lut;
+    if (lut->inv_step_forward > 0.0f && pwm_us > forward[0])
+    {
+        if (pwm_us >= forward[THRUST_CURVE_LUT_SIZE - 1])
+            return lut->force_max_n;
+        return lut_position(forward, pwm_us) / lut->inv_step_forward;
+    }
+    if (lut->inv_step_reverse > 0.0f && pwm_us < reverse[THRUST_CURVE_LUT_SIZE - 1])
+    {
+        if (pwm_us <= reverse[0])
+            return lut->force_min_n;
+        return lut->force_min_n + lut_position(reverse, pwm_us) / lut->inv_step_reverse;
+    }
+    return 0.0f; // 不感帯 (単方向スラスターでは停止出力以下)
+}
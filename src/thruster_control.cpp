@@ -1,297 +1,264 @@
 #include "thruster_control.h"
 #include <cmath>     // For std::abs
 #include <algorithm> // For std::max, std::min
-#include <stdio.h>   // For printf
+#include <stdio.h>   // snprintf (DEBUG ログの組み立て)
+#include "logger.h"  // LOG_* (非同期出力のため制御周期をブロックしない)
 #include "config.h"  // グローバル設定オブジェクト g_config を使用するため
+#include "latency_histogram.h" // 処理段階ごとの時間計測
+#include "thrust_allocation.h" // 推力配分行列
+#include "pwm_output.h"   // 書き込みスキップ付きの一括PWM出力
+#include "controller.h"   // 一次遅れフィルタ・変化率リミッタ・PID
+#include "thrust_curve.h" // 推力 [N] -> PWM の逆引き表
 
-// 現在のPWM値を保持する静的変数（実際に出力される値）
-static float current_pwm_values[NUM_THRUSTERS]; // 初期化は thruster_init で行う
+// 推力配分器 (thruster_init で config.ini の [ALLOCATION] から構築する)
+static ThrustAllocator allocator;
+// スラスターごとの推力曲線 (thruster_init で config.ini の [THRUST_CURVE] から構築する)
+static ThrustCurveLut thrust_curves[ALLOC_MAX_THRUSTERS];
+
+// スラスターごとの出力平滑化 (一次遅れ -> 変化率制限)。slew_limiters[i].value が実際に出力される値
+// 時定数は水平成分を持つスラスターは horizontal、それ以外は vertical (初期化は thruster_init で行う)
+static LowPassFilter output_filters[ALLOC_MAX_THRUSTERS];
+static SlewLimiter slew_limiters[ALLOC_MAX_THRUSTERS];
+
+// 直近の出力 (thruster_get_output_state で参照する)
+static ThrusterOutputState last_output;
+
+// ジャイロによる角速度安定化 (出力は推力 [N] の補正量。STABILIZATION_LIMIT_N で制限して build_wrench で加える)
+static PidController roll_pid;
+static PidController yaw_pid;
 
-// --- 定数 (config.h から移動) ---
 // --- ヘルパー関数 ---
 
-// 線形補正関数
-static float map_value(float x, float in_min, float in_max, float out_min, float out_max)
+// スティック入力をデッドゾーンの外側で -1.0 ~ 1.0 に正規化する (デッドゾーン内は 0)
+static float normalize_stick(int value)
+{
+    const float deadzone = static_cast<float>(g_config.joystick_deadzone);
+    const float magnitude = static_cast<float>(std::abs(value));
+    if (magnitude <= deadzone || deadzone >= 32767.0f)
+    {
+        return 0.0f;
+    }
+    float normalized = std::min(1.0f, (magnitude - deadzone) / (32767.0f - deadzone));
+    return value < 0 ? -normalized : normalized;
+}
+
+// スラスター1台分の推力曲線を設定名から構築する
+// "linear" は PWM に比例する推力 (LINEAR_MAX_FORCE_N)、組み込みプロファイル名、それ以外は CSV ファイルのパス
+static bool load_thrust_curve(ThrustCurveLut *lut, const std::string &profile)
 {
-    if (in_max == in_min)
+    if (profile == "linear")
+    {
+        return thrust_curve_build_linear(lut, g_config.pwm_min, g_config.pwm_neutral, g_config.pwm_boost_max,
+                                         g_config.thrust_curve_linear_max_n, g_config.alloc_bidirectional);
+    }
+    if (thrust_curve_load_builtin(lut, profile.c_str()))
     {
-        // ゼロ除算を回避
-        return out_min;
+        return true;
     }
-    // マッピング前に入力値を指定範囲内にクランプ
-    x = std::max(in_min, std::min(x, in_max));
-    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+    return thrust_curve_load_csv(lut, profile.c_str());
 }
 
-// 線形補間による平滑化関数
-static float smooth_interpolate(float current_value, float target_value, float smoothing_factor)
+// 平滑化の状態を推力曲線の停止出力に揃え、PID の積分・微分をリセットする
+static void reset_output_state()
 {
-    // 線形補間: current + (target - current) * factor
-    // factor = 0.0 なら変化なし、factor = 1.0 なら即座に目標値に到達
-    return current_value + (target_value - current_value) * smoothing_factor;
+    for (int i = 0; i < ALLOC_MAX_THRUSTERS; ++i)
+    {
+        output_filters[i].value = thrust_curves[i].zero_pwm_us;
+        slew_limiters[i].value = thrust_curves[i].zero_pwm_us;
+    }
+    pid_reset(&roll_pid);
+    pid_reset(&yaw_pid);
 }
 
-// PWM値を設定するヘルパー (範囲チェックとデューティサイクル計算を含む)
+// PWM値を設定するヘルパー (範囲チェックを含む)。実際の書き込みは pwm_output_flush() でまとめて行う
 static void set_thruster_pwm(int channel, int pulse_width_us)
 {
     // PWM値が有効な動作範囲内にあることを保証するためにクランプ
     // 注意: クランプの上限として PWM_BOOST_MAX を使用
     int clamped_pwm = std::max(g_config.pwm_min, std::min(pulse_width_us, g_config.pwm_boost_max));
 
-    // デューティサイクルを計算
-    float duty_cycle = static_cast<float>(clamped_pwm) / (1000000.0f / g_config.pwm_frequency); // PWM_PERIOD_US の計算をインライン化
-
-    // 指定されたチャンネルのPWMデューティサイクルを設定
-    set_pwm_channel_duty_cycle(channel, duty_cycle);
+    // 前回と同じ値なら flush 時に書き込みを省く
+    pwm_output_set_us(channel, clamped_pwm);
+}
 
-    // デバッグ出力 (オプション)
-    // printf("Ch%d: Set PWM = %d (Clamped: %d), Duty = %.4f\n", channel, pulse_width_us, clamped_pwm, duty_cycle); // NOLINT
+// ヘルパー関数: スラスターの PWM チャンネルが範囲内で、重複せず、LED チャンネルとも重ならないか
+// (重なると同じチャンネルを2つの出力が毎周期書き合うため、起動時に拒否する)
+static bool validate_thruster_channels()
+{
+    for (int i = 0; i < g_config.alloc_thruster_count; ++i)
+    {
+        const int channel = g_config.alloc_channels[i];
+        if (channel < 0 || channel >= PWM_OUTPUT_MAX_CHANNELS)
+        {
+            LOG_ERROR("[ALLOCATION] CHANNELS: T%d のチャンネル %d は範囲外です (0〜%d)", i, channel, PWM_OUTPUT_MAX_CHANNELS - 1);
+            return false;
+        }
+        if (channel == g_config.led_pwm_channel)
+        {
+            LOG_ERROR("[ALLOCATION] CHANNELS: T%d のチャンネル %d は [LED] CHANNEL と重なっています", i, channel);
+            return false;
+        }
+        for (int j = 0; j < i; ++j)
+        {
+            if (g_config.alloc_channels[j] == channel)
+            {
+                LOG_ERROR("[ALLOCATION] CHANNELS: T%d と T%d が同じチャンネル %d です", j, i, channel);
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
 // --- モジュール関数 ---
 
 bool thruster_init()
 {
-    printf("Enabling PWM\n");
-    set_pwm_enable(true); // NOLINT
-    printf("Setting PWM frequency to %.1f Hz\n", g_config.pwm_frequency);
-    set_pwm_freq_hz(g_config.pwm_frequency); // NOLINT
+    if (!validate_thruster_channels())
+        return false;
+
+    float force_min[ALLOC_MAX_THRUSTERS], force_max[ALLOC_MAX_THRUSTERS];
+    for (int i = 0; i < g_config.alloc_thruster_count; ++i)
+    {
+        const std::string &profile = g_config.thrust_curve_overrides[i].empty() ? g_config.thrust_curve_profile
+                                                                                : g_config.thrust_curve_overrides[i];
+        if (!load_thrust_curve(&thrust_curves[i], profile))
+        {
+            LOG_ERROR("T%d の推力曲線 '%s' を読み込めません", i, profile.c_str());
+            return false;
+        }
+        force_min[i] = thrust_curves[i].force_min_n;
+        force_max[i] = thrust_curves[i].force_max_n;
+        LOG_INFO("T%d 推力曲線: %s (%.1f〜%.1f N, 停止 %.0f us)", i, profile.c_str(), force_min[i], force_max[i], thrust_curves[i].zero_pwm_us);
+    }
+    if (!thrust_allocator_init(&allocator, g_config.alloc_thruster_count, g_config.alloc_matrix,
+                               g_config.alloc_channels, force_min, force_max))
+    {
+        return false;
+    }
+    thrust_allocator_print(&allocator);
+    for (int i = 0; i < ALLOC_MAX_THRUSTERS; ++i)
+    {
+        bool horizontal = allocator.matrix[WRENCH_SWAY][i] != 0.0f || allocator.matrix[WRENCH_YAW][i] != 0.0f;
+        lowpass_init(&output_filters[i], horizontal ? g_config.smoothing_tau_horizontal_s : g_config.smoothing_tau_vertical_s, 0.0f);
+        slew_init(&slew_limiters[i], g_config.slew_rate_pwm_per_s, 0.0f);
+    }
+    const float limit = g_config.stabilization_limit_n;
+    pid_init(&roll_pid, g_config.kp_roll, g_config.ki_roll, g_config.kd_roll, g_config.d_filter_tau_s, -limit, limit);
+    pid_init(&yaw_pid, g_config.yaw_gain, g_config.ki_yaw, g_config.kd_yaw, g_config.d_filter_tau_s, -limit, limit);
+
+    LOG_INFO("Enabling PWM");
+    hal_set_pwm_enable(true);
+    LOG_INFO("Setting PWM frequency to %.1f Hz", g_config.pwm_frequency);
+    hal_set_pwm_freq_hz(g_config.pwm_frequency);
+    pwm_output_init(g_config.pwm_frequency);  // シャドウを未書き込み状態にする (初回は全チャンネルを書き込む)
 
     
-    // すべてのスラスターをニュートラル/最小値に初期化
-    for (int i = 0; i < NUM_THRUSTERS; ++i)
+    // すべてのスラスターを推力曲線の停止出力に初期化
+    for (int i = 0; i < allocator.thruster_count; ++i)
     { // NOLINT
-        set_thruster_pwm(i, g_config.pwm_min);
-        current_pwm_values[i] = static_cast<float>(g_config.pwm_min); // 平滑化用の現在値も初期化
+        set_thruster_pwm(allocator.channels[i], static_cast<int>(thrust_curves[i].zero_pwm_us));
     }
+    reset_output_state(); // 平滑化用の現在値も初期化
     
     // LEDチャンネルを初期状態 (OFF) に設定
     set_thruster_pwm(g_config.led_pwm_channel, g_config.led_pwm_off);
-    printf("Thrusters initialized to PWM %d. LED on Ch%d initialized to PWM %d (OFF).\n", g_config.pwm_min, g_config.led_pwm_channel, g_config.led_pwm_off);
+    pwm_output_flush();
+    LOG_INFO("Thrusters initialized to stop PWM. LED on Ch%d initialized to PWM %d (OFF).", g_config.led_pwm_channel, g_config.led_pwm_off);
     return true;
 }
 
 void thruster_disable()
 {
-    printf("Disabling PWM\n");
-    for (int i = 0; i < NUM_THRUSTERS; ++i)
+    LOG_INFO("Disabling PWM");
+    for (int i = 0; i < allocator.thruster_count; ++i)
     { // NOLINT
-        set_thruster_pwm(i, g_config.pwm_min);
-        current_pwm_values[i] = static_cast<float>(g_config.pwm_min); // 平滑化用の現在値もリセット
+        set_thruster_pwm(allocator.channels[i], static_cast<int>(thrust_curves[i].zero_pwm_us));
     }
+    reset_output_state(); // 平滑化用の現在値もリセット
     // LEDチャンネルをOFFに設定
     set_thruster_pwm(g_config.led_pwm_channel, g_config.led_pwm_off);
-    set_pwm_enable(false); // NOLINT
+    pwm_output_flush();
+    hal_set_pwm_enable(false);
+    pwm_output_invalidate(); // 再有効化後はすべて書き直す
 }
 
-// 水平スラスター制御ロジック (updateThrustersFromSticksの内容を移植・調整)
-static void update_horizontal_thrusters(const GamepadData &data, const AxisData &gyro_data, int target_pwm_out[4])
+// ゲームパッド入力とジャイロ補正から目標レンチ [N] を組み立てる
+// スティック全開で GAIN_* [N]、安定化の PID も推力 [N] を出力する
+static void build_wrench(const GamepadData &data, const AxisData &gyro_data, float dt_s, float wrench[WRENCH_DOF])
 {
-    // Initialize target PWM array to neutral/min
-    for (int i = 0; i < 4; ++i) { // NOLINT
-        target_pwm_out[i] = g_config.pwm_min;
-    }
-
-    bool lx_active = std::abs(data.leftThumbX) > g_config.joystick_deadzone;
-    bool rx_active = std::abs(data.rightThumbX) > g_config.joystick_deadzone;
-
-    int pwm_lx[4] = {g_config.pwm_min, g_config.pwm_min, g_config.pwm_min, g_config.pwm_min}; // NOLINT
-    int pwm_rx[4] = {g_config.pwm_min, g_config.pwm_min, g_config.pwm_min, g_config.pwm_min}; // NOLINT
-
-    // Lx (回転) の寄与 (PWM_MIN - PWM_NORMAL_MAX にマッピング)
-    if (data.leftThumbX < -g_config.joystick_deadzone)
-    { // 左旋回
-        int val = static_cast<int>(map_value(data.leftThumbX, -32768, -g_config.joystick_deadzone, g_config.pwm_normal_max, g_config.pwm_min));
-        pwm_lx[1] = val; // Ch 1 (前右)
-        pwm_lx[2] = val; // Ch 2 (後左)
-    }
-    else if (data.leftThumbX > g_config.joystick_deadzone)
-    { // 右旋回
-        int val = static_cast<int>(map_value(data.leftThumbX, g_config.joystick_deadzone, 32767, g_config.pwm_min, g_config.pwm_normal_max));
-        pwm_lx[0] = val; // Ch 0 (前左)
-        pwm_lx[3] = val; // Ch 3 (後右)
-    }
-
-    // Rx (平行移動) の寄与 (PWM_MIN - PWM_NORMAL_MAX にマッピング)
-    if (data.rightThumbX < -g_config.joystick_deadzone)
-    { // 左平行移動
-        int val = static_cast<int>(map_value(data.rightThumbX, -32768, -g_config.joystick_deadzone, g_config.pwm_normal_max, g_config.pwm_min));
-        pwm_rx[1] = val; // Ch 1 (前右)
-        pwm_rx[3] = val; // Ch 3 (後右)
-    }
-    else if (data.rightThumbX > g_config.joystick_deadzone)
-    { // 右平行移動
-        int val = static_cast<int>(map_value(data.rightThumbX, g_config.joystick_deadzone, 32767, g_config.pwm_min, g_config.pwm_normal_max));
-        pwm_rx[0] = val; // Ch 0 (前左)
-        pwm_rx[2] = val; // Ch 2 (後左)
-    }
-
-    // 両方のスティックがアクティブな場合、寄与を結合してブーストを適用
-    if (lx_active && rx_active)
+    const float lx = normalize_stick(data.leftThumbX);  // 旋回
+    const float rx = normalize_stick(data.rightThumbX); // 平行移動
+    const bool lx_active = lx != 0.0f;
+    const bool rx_active = rx != 0.0f;
+
+    wrench[WRENCH_SURGE] = normalize_stick(data.rightThumbY) * g_config.alloc_gain_surge;
+    wrench[WRENCH_SWAY] = rx * g_config.alloc_gain_sway;
+    wrench[WRENCH_HEAVE] = normalize_stick(data.leftThumbY) * g_config.alloc_gain_heave;
+    wrench[WRENCH_ROLL] = 0.0f;
+    wrench[WRENCH_PITCH] = 0.0f;
+    wrench[WRENCH_YAW] = lx * g_config.alloc_gain_yaw;
+
+    // --- ロール安定化 (平行移動操作中はロールレート 0 を目標にする) ---
+    if (rx_active)
     {
-        const int boost_range = g_config.pwm_boost_max - g_config.pwm_normal_max;
-        int abs_lx = std::abs(data.leftThumbX);
-        int abs_rx = std::abs(data.rightThumbX);
-        int weaker_input_abs = std::min(abs_lx, abs_rx);
-        int boost_add = static_cast<int>(map_value(weaker_input_abs, g_config.joystick_deadzone, 32768, 0, boost_range));
-
-        // スティックの方向に基づいてブーストされるチャンネルを決定
-        if (data.leftThumbX < 0 && data.rightThumbX < 0)
-        { // 左旋回 + 左平行移動 -> Ch 1 (FR) をブースト
-            target_pwm_out[0] = std::max(pwm_lx[0], pwm_rx[0]);
-            target_pwm_out[1] = std::max(pwm_lx[1], pwm_rx[1]) + boost_add;
-            target_pwm_out[2] = std::max(pwm_lx[2], pwm_rx[2]);
-            target_pwm_out[3] = std::max(pwm_lx[3], pwm_rx[3]);
-        }
-        else if (data.leftThumbX < 0 && data.rightThumbX > 0)
-        { // 左旋回 + 右平行移動 -> Ch 2 (RL) をブースト
-            target_pwm_out[0] = std::max(pwm_lx[0], pwm_rx[0]);
-            target_pwm_out[1] = std::max(pwm_lx[1], pwm_rx[1]);
-            target_pwm_out[2] = std::max(pwm_lx[2], pwm_rx[2]) + boost_add;
-            target_pwm_out[3] = std::max(pwm_lx[3], pwm_rx[3]);
-        }
-        else if (data.leftThumbX > 0 && data.rightThumbX < 0)
-        { // 右旋回 + 左平行移動 -> Ch 3 (RR) をブースト
-            target_pwm_out[0] = std::max(pwm_lx[0], pwm_rx[0]);
-            target_pwm_out[1] = std::max(pwm_lx[1], pwm_rx[1]);
-            target_pwm_out[2] = std::max(pwm_lx[2], pwm_rx[2]);
-            target_pwm_out[3] = std::max(pwm_lx[3], pwm_rx[3]) + boost_add;
-        }
-        else
-        { // 右旋回 + 右平行移動 -> Ch 0 (FL) をブースト
-            target_pwm_out[0] = std::max(pwm_lx[0], pwm_rx[0]) + boost_add;
-            target_pwm_out[1] = std::max(pwm_lx[1], pwm_rx[1]);
-            target_pwm_out[2] = std::max(pwm_lx[2], pwm_rx[2]);
-            target_pwm_out[3] = std::max(pwm_lx[3], pwm_rx[3]);
-        }
+        wrench[WRENCH_ROLL] += pid_update(&roll_pid, 0.0f, gyro_data.x, dt_s); // X軸はロールレート
     }
     else
     {
-        // 一方のスティックのみアクティブ、またはどちらも非アクティブ: 単純な組み合わせ (最大値)
-        for (int i = 0; i < 4; ++i)
-        {
-            target_pwm_out[i] = std::max(pwm_lx[i], pwm_rx[i]);
-        }
-    }
-
-    // --- ジャイロによるロール安定化補正 (エルロン操作時) ---
-    if (rx_active) // エルロン操作中のみ安定化制御を行う
-    {
-        // --- ロール補正 ---
-        float roll_rate = gyro_data.x; // X軸はロールレート
-        const float Kp_roll = g_config.kp_roll;
-        int correction_pwm_roll = static_cast<int>(roll_rate * Kp_roll);
-
-        target_pwm_out[0] -= correction_pwm_roll;
-        target_pwm_out[1] += correction_pwm_roll;
-        target_pwm_out[2] += correction_pwm_roll;
-        target_pwm_out[3] -= correction_pwm_roll;
-
-        // --- ヨー補正 (Z軸回転の調整) ---
-        float yaw_rate = gyro_data.z; // Z軸はヨーレート
-        const float Kp_yaw = g_config.kp_yaw;
-        int correction_pwm_yaw = static_cast<int>(yaw_rate * Kp_yaw);
-
-        target_pwm_out[0] -= correction_pwm_yaw;
-        target_pwm_out[1] += correction_pwm_yaw;
-        target_pwm_out[2] += correction_pwm_yaw;
-        target_pwm_out[3] -= correction_pwm_yaw;
+        pid_reset(&roll_pid);
     }
 
-    // --- GyroによるYaw補正 (Rx入力時にZ軸回転しないよう補正) ---
+    // --- ヨー保持 (旋回操作をしていない間はヨーレート 0 を目標にする) ---
+    // 平行移動中は KP_YAW を比例ゲインに上乗せする。YAW_THRESHOLD_DPS 以下のヨーレートは不感帯として扱う
     if (!lx_active)
     {
-        const float yaw_threshold_dps = g_config.yaw_threshold_dps;
-        const float yaw_gain = g_config.yaw_gain;
-        float yaw_rate = -gyro_data.z;
-
-        if (std::abs(yaw_rate) > yaw_threshold_dps)
-        {
-            int yaw_pwm = static_cast<int>(yaw_rate * -yaw_gain);
-            yaw_pwm = std::max(-400, std::min(400, yaw_pwm)); // 補正の最大値をクランプ
-
-            if (yaw_pwm < 0)
-            {
-                target_pwm_out[0] = std::min(g_config.pwm_boost_max, target_pwm_out[0] + std::abs(yaw_pwm));
-                target_pwm_out[3] = std::min(g_config.pwm_boost_max, target_pwm_out[3] + std::abs(yaw_pwm));
-            }
-            else
-            {
-                target_pwm_out[1] = std::min(g_config.pwm_boost_max, target_pwm_out[1] + yaw_pwm);
-                target_pwm_out[2] = std::min(g_config.pwm_boost_max, target_pwm_out[2] + yaw_pwm);
-            }
-        }
-    }
-}
-
-// 前進/後退スラスター制御ロジック
-static int calculate_forward_reverse_pwm(int value)
-{
-    int pulse_width;
-    const int current_max_pwm = g_config.pwm_boost_max;
-    const int current_min_pwm = g_config.pwm_min;
-
-    if (value <= g_config.joystick_deadzone)
-    {
-        pulse_width = g_config.pwm_min;
+        yaw_pid.kp = g_config.yaw_gain + (rx_active ? g_config.kp_yaw : 0.0f);
+        float yaw_rate = (std::abs(gyro_data.z) > g_config.yaw_threshold_dps) ? gyro_data.z : 0.0f; // Z軸はヨーレート
+        wrench[WRENCH_YAW] += pid_update(&yaw_pid, 0.0f, yaw_rate, dt_s);
     }
     else
     {
-        pulse_width = static_cast<int>(map_value(value, g_config.joystick_deadzone, 32767, g_config.pwm_min, current_max_pwm));
+        pid_reset(&yaw_pid);
+        if (rx_active)
+        {
+            wrench[WRENCH_YAW] -= gyro_data.z * g_config.kp_yaw;
+        }
     }
-    return pulse_width;
 }
 
 // メインの更新関数（平滑化機能付き）
-void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data)
+void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data, float dt_s)
 {
-    // --- 目標PWM値の計算 ---
-    int target_horizontal_pwm[4];
-    update_horizontal_thrusters(gamepad_data, gyro_data, target_horizontal_pwm);
+    LATENCY_SCOPE(LAT_STAGE_THRUSTER_UPDATE);
 
-    // 前進/後退の目標PWM値
-    int target_forward_pwm = calculate_forward_reverse_pwm(gamepad_data.rightThumbY);
-
-    // --- 平滑化処理：現在値を目標値に向けて線形補間 ---
-    
-    // 水平スラスター (Ch0-3) の平滑化
-    for (int i = 0; i < 4; ++i)
+    // --- 目標PWM値の計算: 目標レンチ -> 配分行列 -> スラスター出力 ---
+    float target_pwm[ALLOC_MAX_THRUSTERS] = {0.0f};
+    bool saturated;
     {
-        current_pwm_values[i] = smooth_interpolate(
-            current_pwm_values[i], 
-            static_cast<float>(target_horizontal_pwm[i]),
-            g_config.smoothing_factor_horizontal
-        );
+        LATENCY_SCOPE(LAT_STAGE_MIXER);
+        float wrench[WRENCH_DOF];
+        float output[ALLOC_MAX_THRUSTERS];
+        build_wrench(gamepad_data, gyro_data, dt_s, wrench);
+        saturated = thrust_allocate(&allocator, wrench, output);
+        for (int i = 0; i < allocator.thruster_count; ++i)
+        {
+            target_pwm[i] = thrust_curve_pwm(&thrust_curves[i], output[i]); // 推力 [N] -> PWM (表引き)
+        }
     }
-    
-    // 前進/後退スラスター (Ch4, Ch5) の平滑化
-    current_pwm_values[4] = smooth_interpolate(
-        current_pwm_values[4], 
-        static_cast<float>(target_forward_pwm),
-        g_config.smoothing_factor_vertical
-    );
-    current_pwm_values[5] = smooth_interpolate(
-        current_pwm_values[5], 
-        static_cast<float>(target_forward_pwm),
-        g_config.smoothing_factor_vertical
-    );
-
-    // --- PWM信号をスラスターに送信 ---
-    printf("--- Thruster and LED PWM (Smoothed) ---\n");
-    
-    // 水平スラスター
-    for (int i = 0; i < 4; ++i)
+
+    // --- 平滑化処理：一次遅れフィルタと変化率制限を実測の dt で進め、PWM信号をスラスターに送信 ---
+    int smoothed_pwm[ALLOC_MAX_THRUSTERS] = {0};
+    for (int i = 0; i < allocator.thruster_count; ++i)
     {
-        int smoothed_pwm = static_cast<int>(current_pwm_values[i]);
-        set_thruster_pwm(i, smoothed_pwm);
-        printf("Ch%d: Target=%d, Smoothed=%d\n", i, target_horizontal_pwm[i], smoothed_pwm);
+        float filtered = lowpass_update(&output_filters[i], target_pwm[i], dt_s);
+        smoothed_pwm[i] = static_cast<int>(slew_update(&slew_limiters[i], filtered, dt_s));
+        set_thruster_pwm(allocator.channels[i], smoothed_pwm[i]);
+        last_output.target_pwm[i] = target_pwm[i];
+        last_output.smoothed_pwm[i] = smoothed_pwm[i];
     }
-    
-    // 前進/後退スラスター
-    int smoothed_forward_pwm = static_cast<int>(current_pwm_values[4]);
-    set_thruster_pwm(4, smoothed_forward_pwm);
-    set_thruster_pwm(5, smoothed_forward_pwm);
-    printf("Ch4&5: Target=%d, Smoothed=%d\n", target_forward_pwm, smoothed_forward_pwm);
+    last_output.thruster_count = allocator.thruster_count;
+    last_output.saturated = saturated;
 
     // --- LED制御 (平滑化なし) ---
     static int current_led_pwm = g_config.led_pwm_off;
@@ -313,25 +280,63 @@ void thruster_update(const GamepadData &gamepad_data, const AxisData &gyro_data)
     y_button_previously_pressed = y_button_currently_pressed;
 
     set_thruster_pwm(g_config.led_pwm_channel, current_led_pwm);
-    printf("Ch%d: LED PWM = %d (%s)\n", g_config.led_pwm_channel, current_led_pwm, (current_led_pwm == g_config.led_pwm_on ? "ON" : "OFF"));
 
-    printf("--------------------\n");
+    // 値が変わったチャンネルだけをまとめて書き込む
+    int channels_written = pwm_output_flush();
+
+    // 周期ごとの出力値は DEBUG レベル (LOG_LEVEL=debug) でのみ記録する (1周期1レコード)
+    // スラスター数は THRUSTERS で変わるため、有効なスラスターの分だけ文字列に組み立てる
+    if (g_log_min_level <= LOG_LEVEL_DEBUG)
+    {
+        char outputs[ALLOC_MAX_THRUSTERS * 16];
+        size_t used = 0;
+        outputs[0] = '\0';
+        for (int i = 0; i < allocator.thruster_count && used < sizeof(outputs); ++i)
+        {
+            int n = snprintf(outputs + used, sizeof(outputs) - used, "%sT%d=%d/%d", (i > 0 ? " " : ""), i,
+                             static_cast<int>(target_pwm[i]), smoothed_pwm[i]);
+            if (n < 0)
+                break;
+            used += static_cast<size_t>(n);
+        }
+        LOG_DEBUG("PWM target/smoothed %s%s LED(Ch%d)=%d %s writes=%d", outputs, (saturated ? " (saturated)" : ""),
+                  g_config.led_pwm_channel, current_led_pwm, (current_led_pwm == g_config.led_pwm_on ? "ON" : "OFF"),
+                  channels_written);
+    }
 }
 
-// すべてのスラスターを指定されたPWM値に設定し、LEDをオフにする関数
-void thruster_set_all_pwm(int pwm_value)
+// すべてのスラスターを推力曲線の停止出力にし、LEDをオフにする関数
+void thruster_set_all_stop()
 {
-    for (int i = 0; i < NUM_THRUSTERS; ++i)
+    for (int i = 0; i < allocator.thruster_count; ++i)
     {
-        set_thruster_pwm(i, pwm_value);
-        current_pwm_values[i] = static_cast<float>(pwm_value); // 平滑化用の現在値も更新
+        int value = static_cast<int>(thrust_curves[i].zero_pwm_us);
+        set_thruster_pwm(allocator.channels[i], value);
+        last_output.target_pwm[i] = static_cast<float>(value);
+        last_output.smoothed_pwm[i] = value;
     }
+    last_output.thruster_count = allocator.thruster_count;
+    last_output.saturated = false;
+    reset_output_state(); // 平滑化用の現在値も更新
     set_thruster_pwm(g_config.led_pwm_channel, g_config.led_pwm_off);
+    pwm_output_flush();
+}
+
+float thruster_get_stop_pwm_us(int thruster)
+{
+    if (thruster < 0 || thruster >= ALLOC_MAX_THRUSTERS)
+        return static_cast<float>(g_config.pwm_min);
+    return thrust_curves[thruster].zero_pwm_us;
+}
+
+void thruster_get_output_state(ThrusterOutputState *state)
+{
+    *state = last_output;
 }
 
 // 平滑化係数を動的に変更する関数（オプション）
 void thruster_set_smoothing_factors(float horizontal_factor, float vertical_factor)
 {
     // この関数を使用する場合は、定数を変数に変更する必要があります
-    printf("平滑化係数変更は config.ini を介して行われます。\n"); // NOLINT
+    LOG_INFO("平滑化係数変更は config.ini を介して行われます。"); // NOLINT
 }
\ No newline at end of file
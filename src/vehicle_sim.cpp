@@ -0,0 +1,184 @@
+#include "vehicle_sim.h"
+#include "config.h" // g_config ([VEHICLE_SIM])
+#include <math.h>   // sqrtf, fabsf, expf, atan2f, asinf
+#include <string.h> // memset
+
+#define VEHICLE_GRAVITY 9.80665f
+#define VEHICLE_RAD_TO_DEG 57.29577951308232f
+
+// 静止時に磁力計が返す地磁気 (NED、hal_sim.cpp の静止値と同じ) [uT]
+static const float EARTH_FIELD[3] = {20.0f, 0.0f, -40.0f};
+
+// ヘルパー関数: 外積 out = a x b
+static void cross3(const float *a, const float *b, float *out)
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// ヘルパー関数: 機体座標のベクトルを NED へ回す (rotate_to_body はその逆)
+static void rotate_to_ned(const VehicleState *s, const float *v, float *out)
+{
+    const float q0 = s->q0, q1 = s->q1, q2 = s->q2, q3 = s->q3;
+    out[0] = (1.0f - 2.0f * (q2 * q2 + q3 * q3)) * v[0] + 2.0f * (q1 * q2 - q0 * q3) * v[1] + 2.0f * (q1 * q3 + q0 * q2) * v[2];
+    out[1] = 2.0f * (q1 * q2 + q0 * q3) * v[0] + (1.0f - 2.0f * (q1 * q1 + q3 * q3)) * v[1] + 2.0f * (q2 * q3 - q0 * q1) * v[2];
+    out[2] = 2.0f * (q1 * q3 - q0 * q2) * v[0] + 2.0f * (q2 * q3 + q0 * q1) * v[1] + (1.0f - 2.0f * (q1 * q1 + q2 * q2)) * v[2];
+}
+
+static void rotate_to_body(const VehicleState *s, const float *v, float *out)
+{
+    const float q0 = s->q0, q1 = s->q1, q2 = s->q2, q3 = s->q3;
+    out[0] = (1.0f - 2.0f * (q2 * q2 + q3 * q3)) * v[0] + 2.0f * (q1 * q2 + q0 * q3) * v[1] + 2.0f * (q1 * q3 - q0 * q2) * v[2];
+    out[1] = 2.0f * (q1 * q2 - q0 * q3) * v[0] + (1.0f - 2.0f * (q1 * q1 + q3 * q3)) * v[1] + 2.0f * (q2 * q3 + q0 * q1) * v[2];
+    out[2] = 2.0f * (q1 * q3 + q0 * q2) * v[0] + 2.0f * (q2 * q3 - q0 * q1) * v[1] + (1.0f - 2.0f * (q1 * q1 + q2 * q2)) * v[2];
+}
+
+void vehicle_params_from_config(VehicleParams *params)
+{
+    memset(params, 0, sizeof(*params));
+    params->rigid_mass_kg = g_config.sim_mass_kg;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        params->inertia[axis] = g_config.sim_inertia[axis];
+        params->mass[axis] = g_config.sim_mass_kg + g_config.sim_added_mass[axis];
+        params->mass[3 + axis] = g_config.sim_inertia[axis] + g_config.sim_added_mass[3 + axis];
+    }
+    for (int axis = 0; axis < WRENCH_DOF; ++axis)
+    {
+        params->linear_drag[axis] = g_config.sim_linear_drag[axis];
+        params->quadratic_drag[axis] = g_config.sim_quadratic_drag[axis];
+    }
+    params->bg_m = g_config.sim_bg_m;
+    params->motor_tau_s = g_config.sim_motor_tau_s;
+    params->thruster_count = g_config.alloc_thruster_count;
+    for (int i = 0; i < params->thruster_count; ++i)
+    {
+        const float *g = g_config.sim_thruster_geometry[i];
+        float norm = sqrtf(g[3] * g[3] + g[4] * g[4] + g[5] * g[5]);
+        for (int k = 0; k < 3; ++k)
+        {
+            params->thruster_position[i][k] = g[k];
+            params->thruster_direction[i][k] = norm > 0.0f ? g[3 + k] / norm : 0.0f; // 向きが 0 のスラスターは推力を出さない
+        }
+    }
+}
+
+void vehicle_reset(VehicleState *state)
+{
+    memset(state, 0, sizeof(*state));
+    state->q0 = 1.0f;
+}
+
+void vehicle_step(const VehicleParams *params, VehicleState *state, const float *thrust_command_n,
+                  const float *disturbance, float dt_s)
+{
+    if (dt_s <= 0.0f)
+        return;
+
+    // --- スラスター推力 (一次遅れ) と、それによる力・モーメント ---
+    float force[WRENCH_DOF] = {0.0f};
+    const float alpha = params->motor_tau_s > 0.0f ? 1.0f - expf(-dt_s / params->motor_tau_s) : 1.0f;
+    for (int i = 0; i < params->thruster_count; ++i)
+    {
+        state->thrust_n[i] += (thrust_command_n[i] - state->thrust_n[i]) * alpha;
+        float f[3], moment[3];
+        for (int k = 0; k < 3; ++k)
+            f[k] = params->thruster_direction[i][k] * state->thrust_n[i];
+        cross3(params->thruster_position[i], f, moment);
+        for (int k = 0; k < 3; ++k)
+        {
+            force[k] += f[k];
+            force[3 + k] += moment[k];
+        }
+    }
+    if (disturbance)
+    {
+        for (int axis = 0; axis < WRENCH_DOF; ++axis)
+            force[axis] += disturbance[axis];
+    }
+
+    // --- 剛体のコリオリ力: -m (w x v)、-(w x Iw) ---
+    float *nu = state->velocity;
+    const float *linear = nu, *angular = nu + 3;
+    float coriolis[3];
+    cross3(angular, linear, coriolis);
+    float inertia_w[3] = {params->inertia[0] * angular[0], params->inertia[1] * angular[1], params->inertia[2] * angular[2]};
+    float gyroscopic[3];
+    cross3(angular, inertia_w, gyroscopic);
+    for (int k = 0; k < 3; ++k)
+    {
+        force[k] -= params->rigid_mass_kg * coriolis[k];
+        force[3 + k] -= gyroscopic[k];
+    }
+
+    // --- 復元モーメント: 浮心 (重心の bg_m 上) にかかる浮力による ---
+    const float down_ned[3] = {0.0f, 0.0f, 1.0f};
+    float down_body[3];
+    rotate_to_body(state, down_ned, down_body);
+    const float weight_moment = params->bg_m * params->rigid_mass_kg * VEHICLE_GRAVITY;
+    force[3] -= weight_moment * down_body[1];
+    force[4] += weight_moment * down_body[0];
+
+    // --- 抗力と加速度 (半陰的オイラー法: 速度を先に更新し、新しい速度で位置・姿勢を進める) ---
+    for (int axis = 0; axis < WRENCH_DOF; ++axis)
+    {
+        float drag = (params->linear_drag[axis] + params->quadratic_drag[axis] * fabsf(nu[axis])) * nu[axis];
+        float accel = (force[axis] - drag) / params->mass[axis];
+        if (axis < 3)
+            state->acceleration[axis] = accel;
+        nu[axis] += accel * dt_s;
+    }
+
+    float velocity_ned[3];
+    rotate_to_ned(state, nu, velocity_ned);
+    for (int k = 0; k < 3; ++k)
+        state->position[k] += velocity_ned[k] * dt_s;
+
+    // q += 0.5 * q ⊗ (0, p, q, r) * dt
+    const float p = nu[3] * 0.5f * dt_s, q = nu[4] * 0.5f * dt_s, r = nu[5] * 0.5f * dt_s;
+    const float q0 = state->q0, q1 = state->q1, q2 = state->q2, q3 = state->q3;
+    state->q0 = q0 - q1 * p - q2 * q - q3 * r;
+    state->q1 = q1 + q0 * p + q2 * r - q3 * q;
+    state->q2 = q2 + q0 * q - q1 * r + q3 * p;
+    state->q3 = q3 + q0 * r + q1 * q - q2 * p;
+    float inv_norm = 1.0f / sqrtf(state->q0 * state->q0 + state->q1 * state->q1 + state->q2 * state->q2 + state->q3 * state->q3);
+    state->q0 *= inv_norm;
+    state->q1 *= inv_norm;
+    state->q2 *= inv_norm;
+    state->q3 *= inv_norm;
+    state->time_s += dt_s;
+}
+
+void vehicle_euler_deg(const VehicleState *state, float *roll_deg, float *pitch_deg, float *yaw_deg)
+{
+    const float q0 = state->q0, q1 = state->q1, q2 = state->q2, q3 = state->q3;
+    float sin_pitch = 2.0f * (q0 * q2 - q3 * q1);
+    sin_pitch = sin_pitch > 1.0f ? 1.0f : (sin_pitch < -1.0f ? -1.0f : sin_pitch);
+    *roll_deg = atan2f(2.0f * (q0 * q1 + q2 * q3), 1.0f - 2.0f * (q1 * q1 + q2 * q2)) * VEHICLE_RAD_TO_DEG;
+    *pitch_deg = asinf(sin_pitch) * VEHICLE_RAD_TO_DEG;
+    *yaw_deg = atan2f(2.0f * (q0 * q3 + q1 * q2), 1.0f - 2.0f * (q2 * q2 + q3 * q3)) * VEHICLE_RAD_TO_DEG;
+}
+
+void vehicle_imu(const VehicleState *state, AxisData *gyro_dps, AxisData *accel, AxisData *mag)
+{
+    const float *nu = state->velocity;
+    gyro_dps->x = nu[3] * VEHICLE_RAD_TO_DEG;
+    gyro_dps->y = nu[4] * VEHICLE_RAD_TO_DEG;
+    gyro_dps->z = nu[5] * VEHICLE_RAD_TO_DEG;
+
+    // 比力の符号を反転した値: 重力方向 (機体座標) * G - (dv/dt + w x v)
+    const float down_ned[3] = {0.0f, 0.0f, 1.0f};
+    float down_body[3], coriolis[3];
+    rotate_to_body(state, down_ned, down_body);
+    cross3(nu + 3, nu, coriolis);
+    accel->x = down_body[0] * VEHICLE_GRAVITY - (state->acceleration[0] + coriolis[0]);
+    accel->y = down_body[1] * VEHICLE_GRAVITY - (state->acceleration[1] + coriolis[1]);
+    accel->z = down_body[2] * VEHICLE_GRAVITY - (state->acceleration[2] + coriolis[2]);
+
+    float field[3];
+    rotate_to_body(state, EARTH_FIELD, field);
+    mag->x = field[0];
+    mag->y = field[1];
+    mag->z = field[2];
+}
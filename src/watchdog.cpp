@@ -0,0 +1,278 @@
+#include "watchdog.h"
+#include "seqlock.h"    // SeqLock (統計の公開)
+#include "time_utils.h" // monotonic_now_ns, ns_to_timespec
+#include "config.h"     // g_config ([WATCHDOG], チャンネル)
+#include "thruster_control.h" // thruster_get_stop_pwm_us (推力曲線の停止出力)
+#include "hal.h"        // hal_set_pwm_duty_cycles
+#include "realtime.h"   // realtime_configure_watchdog_thread, realtime_record_watchdog_thread
+#include "logger.h"     // LOG_*
+#include <thread>
+#include <atomic>
+#include <future>       // 起動時のハンドシェイク (リアルタイム設定の結果を返す)
+#include <system_error>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+
+// --- モジュール内部状態 ---
+static std::thread g_thread;                      // 監視スレッド
+static std::atomic<bool> g_running(false);
+static std::atomic<bool> g_tripped(false);        // ラッチ (pwm_output_flush が参照する)
+static std::atomic<int64_t> g_last_heartbeat_ns(0);
+static std::atomic<int64_t> g_last_command_ns(0); // 0 はコマンド監視なし
+static std::atomic<unsigned long long> g_rearms(0);
+static WatchdogStats g_stats;                     // スレッド内で更新し、SeqLock で公開する
+static SeqLock<WatchdogStats> g_stats_published;
+
+// 起動時に用意しておく停止出力の書き込み内容 (発動時はこれをそのまま HAL へ渡す)
+// スラスターごとの推力曲線の停止出力 (thruster_get_stop_pwm_us)
+static uintptr_t armed_channels[ALLOC_MAX_THRUSTERS];
+static float armed_duty_cycles[ALLOC_MAX_THRUSTERS];
+static size_t armed_count = 0;
+static int armed_pwm_min_us = 0; // ログ用: 停止出力の最小・最大
+static int armed_pwm_max_us = 0;
+
+static int64_t check_period_ns = 0;     // 監視周期
+static int64_t heartbeat_limit_ns = 0;  // ハートビートが途切れたとみなす経過時間 (TIMEOUT_MS - 監視周期)
+static int64_t command_limit_ns = 0;    // コマンドが途切れたとみなす経過時間
+
+static const char *reason_name(int reason)
+{
+    return reason == WATCHDOG_REASON_HEARTBEAT ? "heartbeat" : "command";
+}
+
+// ヘルパー関数: 用意しておいた停止出力を書き込み、かかった時間を返す
+static int64_t write_armed_pwm()
+{
+    int64_t start_ns = monotonic_now_ns();
+    hal_set_pwm_duty_cycles(armed_channels, armed_duty_cycles, armed_count);
+    return monotonic_now_ns() - start_ns;
+}
+
+// ヘルパー関数: 発動を記録する (ログは非同期ロガーへ積むだけでブロックしない)
+static void record_trip(int reason, int64_t now_ns, int64_t stale_ns, int64_t write_ns, int64_t last_event_ns)
+{
+    struct timespec realtime;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    WatchdogTrip trip;
+    trip.time_ns = now_ns;
+    trip.realtime_ns = timespec_to_ns(realtime);
+    trip.stale_ns = stale_ns;
+    trip.write_ns = write_ns;
+    trip.reason = reason;
+
+    g_stats.trips[reason]++;
+    if (g_stats.trip_log_count == WATCHDOG_MAX_TRIP_LOG)
+    {
+        memmove(&g_stats.trip_log[0], &g_stats.trip_log[1], sizeof(WatchdogTrip) * (WATCHDOG_MAX_TRIP_LOG - 1));
+        g_stats.trip_log_count--;
+    }
+    g_stats.trip_log[g_stats.trip_log_count++] = trip;
+    int64_t detect_ns = now_ns + write_ns - last_event_ns;
+    if (reason == WATCHDOG_REASON_HEARTBEAT && detect_ns > g_stats.max_detect_ns)
+        g_stats.max_detect_ns = detect_ns;
+
+    LOG_WARN("[WATCHDOG] 発動 (%s): 最後の%sから %.1f ms。全スラスターを停止出力 (%d〜%d us) にしました (書き込み %.1f us、realtime %lld.%09lld)",
+             reason_name(reason), reason == WATCHDOG_REASON_HEARTBEAT ? "ハートビート" : "コマンド", stale_ns / 1e6,
+             armed_pwm_min_us, armed_pwm_max_us, write_ns / 1e3, static_cast<long long>(trip.realtime_ns / NSEC_PER_SEC),
+             static_cast<long long>(trip.realtime_ns % NSEC_PER_SEC));
+}
+
+static void watchdog_thread_main(std::promise<RealtimeThreadResult> *ready)
+{
+    ready->set_value(realtime_configure_watchdog_thread()); // 結果を起動側へ返す (以降 ready は使わない)
+
+    int rewrites_pending = 0; // ハートビートが戻った後にあと何回書き直すか
+    int64_t next_ns = monotonic_now_ns() + check_period_ns;
+    while (g_running.load(std::memory_order_relaxed))
+    {
+        struct timespec deadline = ns_to_timespec(next_ns);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        {
+        }
+        int64_t now_ns = monotonic_now_ns();
+        if (now_ns - next_ns > g_stats.max_check_late_ns)
+            g_stats.max_check_late_ns = now_ns - next_ns;
+        next_ns += check_period_ns;
+        if (next_ns < now_ns)
+            next_ns = now_ns + check_period_ns; // 大きく遅れた場合は追いつこうとしない
+        g_stats.checks++;
+
+        const int64_t heartbeat_ns = g_last_heartbeat_ns.load(std::memory_order_acquire);
+        const int64_t command_ns = g_last_command_ns.load(std::memory_order_acquire);
+        const int64_t heartbeat_age = now_ns - heartbeat_ns;
+        const bool heartbeat_stale = heartbeat_ns != 0 && heartbeat_age > heartbeat_limit_ns;
+        const bool command_stale = command_ns != 0 && now_ns - command_ns > command_limit_ns;
+
+        if (!g_tripped.load(std::memory_order_acquire))
+        {
+            if (heartbeat_stale || command_stale)
+            {
+                // 先にラッチしてから書き込む (以降の pwm_output_flush は書き込まない)
+                g_tripped.store(true, std::memory_order_release);
+                int64_t write_ns = write_armed_pwm();
+                if (heartbeat_stale)
+                    record_trip(WATCHDOG_REASON_HEARTBEAT, now_ns, heartbeat_age, write_ns, heartbeat_ns);
+                else
+                    record_trip(WATCHDOG_REASON_COMMAND, now_ns, now_ns - command_ns, write_ns, command_ns);
+                rewrites_pending = 2; // 発動時に書き込み中だった制御側の値を上書きするため
+            }
+        }
+        else
+        {
+            // 制御スレッドが書き込みの途中で固まっている間は毎周期書き直し、戻った後も2周期書き直す
+            if (heartbeat_stale)
+                rewrites_pending = 2;
+            if (rewrites_pending > 0)
+            {
+                write_armed_pwm();
+                g_stats.rewrites++;
+                rewrites_pending--;
+            }
+        }
+        g_stats_published.store(g_stats);
+    }
+}
+
+bool watchdog_start()
+{
+    if (g_running.load())
+        return true;
+
+    // 監視周期は上限時間の 1/5 (1ms 以上)。ハートビートは (上限 - 監視周期) で途切れたとみなすため、
+    // 最後のハートビートから上限時間以内に検出して書き込める
+    const int64_t timeout_ns = static_cast<int64_t>(g_config.watchdog_timeout_ms) * NSEC_PER_MSEC;
+    check_period_ns = timeout_ns / 5 > NSEC_PER_MSEC ? timeout_ns / 5 : NSEC_PER_MSEC;
+    heartbeat_limit_ns = timeout_ns - check_period_ns;
+    const int64_t loop_period_ns = static_cast<int64_t>(g_config.loop_delay_us) * NSEC_PER_USEC;
+    if (heartbeat_limit_ns < 2 * loop_period_ns)
+    {
+        LOG_WARN("[WATCHDOG] TIMEOUT_MS=%u は制御周期 (%u us) に対して短すぎます。制御周期の2倍 + 監視周期に広げます。",
+                 g_config.watchdog_timeout_ms, g_config.loop_delay_us);
+        heartbeat_limit_ns = 2 * loop_period_ns;
+    }
+    command_limit_ns = static_cast<int64_t>(g_config.connection_timeout_seconds * 1e9) + timeout_ns;
+
+    const float period_us = 1000000.0f / (g_config.pwm_frequency > 0.0f ? g_config.pwm_frequency : 50.0f);
+    armed_count = 0;
+    for (int i = 0; i < g_config.alloc_thruster_count; ++i)
+    {
+        const int stop_us = static_cast<int>(thruster_get_stop_pwm_us(i));
+        armed_channels[armed_count] = static_cast<uintptr_t>(g_config.alloc_channels[i]);
+        armed_duty_cycles[armed_count] = static_cast<float>(stop_us) / period_us;
+        if (armed_count == 0 || stop_us < armed_pwm_min_us)
+            armed_pwm_min_us = stop_us;
+        if (armed_count == 0 || stop_us > armed_pwm_max_us)
+            armed_pwm_max_us = stop_us;
+        armed_count++;
+    }
+
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_stats_published.store(g_stats);
+    g_tripped.store(false);
+    g_rearms.store(0);
+    g_last_heartbeat_ns.store(0);
+    g_last_command_ns.store(0);
+    g_running.store(true);
+
+    // シグナルはメインスレッド (イベントループ) で受け取るため、生成するスレッドではブロックしておく
+    sigset_t block_set, old_set;
+    sigemptyset(&block_set);
+    sigaddset(&block_set, SIGINT);
+    sigaddset(&block_set, SIGTERM);
+    sigaddset(&block_set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &block_set, &old_set);
+    bool started = true;
+    std::promise<RealtimeThreadResult> ready;
+    try
+    {
+        g_thread = std::thread(watchdog_thread_main, &ready);
+    }
+    catch (const std::system_error &e)
+    {
+        LOG_ERROR("ウォッチドッグスレッドの起動に失敗: %s", e.what());
+        started = false;
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    if (!started)
+    {
+        g_running.store(false);
+        return false;
+    }
+    realtime_record_watchdog_thread(ready.get_future().get()); // 設定が終わるまで待つ (realtime_print_report が読む)
+    LOG_INFO("ウォッチドッグ起動 (上限 %u ms、監視周期 %.1f ms、ハートビート %.1f ms、コマンド %.0f ms で停止出力 %d〜%d us)",
+             g_config.watchdog_timeout_ms, check_period_ns / 1e6, heartbeat_limit_ns / 1e6, command_limit_ns / 1e6,
+             armed_pwm_min_us, armed_pwm_max_us);
+    return true;
+}
+
+void watchdog_stop()
+{
+    if (!g_running.exchange(false))
+        return;
+    if (g_thread.joinable())
+        g_thread.join();
+    g_tripped.store(false); // 終了処理 (thruster_disable) の書き込みを止めないように解除する
+    LOG_INFO("ウォッチドッグを停止しました。");
+}
+
+void watchdog_heartbeat(int64_t now_ns)
+{
+    g_last_heartbeat_ns.store(now_ns, std::memory_order_release);
+}
+
+void watchdog_command_received(int64_t now_ns)
+{
+    g_last_command_ns.store(now_ns, std::memory_order_release);
+}
+
+void watchdog_command_idle()
+{
+    g_last_command_ns.store(0, std::memory_order_release);
+}
+
+bool watchdog_tripped()
+{
+    return g_tripped.load(std::memory_order_acquire);
+}
+
+bool watchdog_rearm(int64_t now_ns)
+{
+    if (!g_tripped.load(std::memory_order_acquire))
+        return false;
+    // ハートビートが戻っていない (制御ループがまだ止まっている) 間は解除しない
+    if (now_ns - g_last_heartbeat_ns.load(std::memory_order_acquire) > heartbeat_limit_ns)
+        return false;
+    g_tripped.store(false, std::memory_order_release);
+    g_rearms.fetch_add(1, std::memory_order_relaxed);
+    LOG_INFO("[WATCHDOG] 解除しました。制御側の出力を再開します。");
+    return true;
+}
+
+void watchdog_get_stats(WatchdogStats *stats)
+{
+    if (!stats)
+        return;
+    memset(stats, 0, sizeof(WatchdogStats));
+    g_stats_published.load(stats);
+    stats->rearms = g_rearms.load(std::memory_order_relaxed);
+}
+
+void watchdog_print_stats()
+{
+    if (!g_config.watchdog_enabled)
+        return;
+    WatchdogStats st;
+    watchdog_get_stats(&st);
+    LOG_INFO("[WATCHDOG STATS] checks=%llu trips(heartbeat=%llu command=%llu) rewrites=%llu rearms=%llu tripped=%s "
+             "max_detect=%.1fms max_check_late=%.1fus",
+             st.checks, st.trips[WATCHDOG_REASON_HEARTBEAT], st.trips[WATCHDOG_REASON_COMMAND], st.rewrites, st.rearms,
+             watchdog_tripped() ? "yes" : "no", st.max_detect_ns / 1e6, st.max_check_late_ns / 1e3);
+    for (unsigned int i = 0; i < st.trip_log_count; ++i)
+    {
+        const WatchdogTrip &t = st.trip_log[i];
+        LOG_INFO("[WATCHDOG STATS]   #%u %s realtime=%lld.%09lld stale=%.1fms write=%.1fus", i, reason_name(t.reason),
+                 static_cast<long long>(t.realtime_ns / NSEC_PER_SEC), static_cast<long long>(t.realtime_ns % NSEC_PER_SEC),
+                 t.stale_ns / 1e6, t.write_ns / 1e3);
+    }
+}
@@ -0,0 +1,312 @@
+// フライトレコーダー (blackbox.h) のデコーダー: リングファイルを sequence 順に並べ直して CSV か列ごとのファイルへ出力する。
+// 書き込み途中で止まったスロット (sequence が 0、または置き場所と番号が合わない) は読み飛ばして件数だけ表示する。
+//   make -f Makefile.mk tools
+//   ./bin/blackbox_decode blackbox.bin                        # CSV を標準出力へ
+//   ./bin/blackbox_decode blackbox.bin --csv blackbox.csv
+//   ./bin/blackbox_decode blackbox.bin --columns blackbox_cols # 列ごとにリトルエンディアンの生配列 + schema.csv
+//   ./bin/blackbox_decode blackbox.bin --last 1000            # 末尾 (異常終了の直前) の 1000 件だけ
+#include "blackbox.h"
+#include <stdio.h>
+#include <stdlib.h>   // strtoul
+#include <string.h>   // strcmp, memcmp, memcpy
+#include <stddef.h>   // offsetof
+#include <errno.h>
+#include <sys/stat.h> // mkdir
+#include <algorithm>  // std::sort
+#include <vector>
+
+// 列の型
+enum ColumnType
+{
+    COL_U8,
+    COL_U16,
+    COL_I16,
+    COL_U32,
+    COL_U64,
+    COL_I64,
+    COL_F32
+};
+
+typedef struct
+{
+    const char *name;
+    size_t offset; // BlackboxRecord 内の位置
+    ColumnType type;
+    int count;     // 配列の要素数 (1 ならスカラー)
+} ColumnSpec;
+
+#define COLUMN(field, type, count) {#field, offsetof(BlackboxRecord, field), type, count}
+
+// ファイル形式の列 (BlackboxRecord の宣言順)。target_pwm / smoothed_pwm はヘッダーのスラスター数だけ出力する
+static const ColumnSpec COLUMNS[] = {
+    COLUMN(sequence, COL_U64, 1),
+    COLUMN(time_ns, COL_I64, 1),
+    COLUMN(event, COL_U8, 1),
+    COLUMN(stick, COL_I16, 4),
+    COLUMN(trigger, COL_U16, 2),
+    COLUMN(buttons, COL_U16, 1),
+    COLUMN(gamepad_flags, COL_U8, 1),
+    COLUMN(gamepad_sequence, COL_U32, 1),
+    COLUMN(dt_s, COL_F32, 1),
+    COLUMN(temperature, COL_F32, 1),
+    COLUMN(pressure, COL_F32, 1),
+    COLUMN(adc, COL_F32, 4),
+    COLUMN(accel, COL_F32, 3),
+    COLUMN(gyro, COL_F32, 3),
+    COLUMN(mag, COL_F32, 3),
+    COLUMN(roll_deg, COL_F32, 1),
+    COLUMN(pitch_deg, COL_F32, 1),
+    COLUMN(heading_deg, COL_F32, 1),
+    COLUMN(control_rate_dps, COL_F32, 3),
+    COLUMN(leak, COL_U8, 1),
+    COLUMN(attitude_valid, COL_U8, 1),
+    COLUMN(snapshot_count, COL_U32, 1),
+    COLUMN(saturated, COL_U8, 1),
+    COLUMN(target_pwm, COL_F32, BLACKBOX_MAX_THRUSTERS),
+    COLUMN(smoothed_pwm, COL_U16, BLACKBOX_MAX_THRUSTERS),
+};
+static const int COLUMN_COUNT = sizeof(COLUMNS) / sizeof(COLUMNS[0]);
+
+static size_t column_type_size(ColumnType type)
+{
+    switch (type)
+    {
+    case COL_U8: return 1;
+    case COL_U16: case COL_I16: return 2;
+    case COL_U32: case COL_F32: return 4;
+    default: return 8;
+    }
+}
+
+static const char *column_type_name(ColumnType type)
+{
+    switch (type)
+    {
+    case COL_U8: return "u8";
+    case COL_U16: return "u16";
+    case COL_I16: return "i16";
+    case COL_U32: return "u32";
+    case COL_U64: return "u64";
+    case COL_I64: return "i64";
+    default: return "f32";
+    }
+}
+
+// 配列列はスラスター数で切り詰める
+static int column_element_count(const ColumnSpec &column, uint32_t thruster_count)
+{
+    if (column.count == BLACKBOX_MAX_THRUSTERS)
+        return static_cast<int>(thruster_count);
+    return column.count;
+}
+
+static void print_value(FILE *out, const uint8_t *p, ColumnType type)
+{
+    switch (type)
+    {
+    case COL_U8: fprintf(out, "%u", *p); break;
+    case COL_U16: { uint16_t v; memcpy(&v, p, 2); fprintf(out, "%u", v); break; }
+    case COL_I16: { int16_t v; memcpy(&v, p, 2); fprintf(out, "%d", v); break; }
+    case COL_U32: { uint32_t v; memcpy(&v, p, 4); fprintf(out, "%u", v); break; }
+    case COL_U64: { unsigned long long v; memcpy(&v, p, 8); fprintf(out, "%llu", v); break; }
+    case COL_I64: { long long v; memcpy(&v, p, 8); fprintf(out, "%lld", v); break; }
+    case COL_F32: { float v; memcpy(&v, p, 4); fprintf(out, "%g", v); break; }
+    }
+}
+
+static bool write_csv(const char *path, const BlackboxHeader &header, const std::vector<const BlackboxRecord *> &ordered)
+{
+    FILE *out = path ? fopen(path, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "'%s' を作成できません: %s\n", path, strerror(errno));
+        return false;
+    }
+    // 先頭列は記録開始からの秒数 (time_ns から計算した派生列)
+    fprintf(out, "time_s");
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+    {
+        int n = column_element_count(COLUMNS[c], header.thruster_count);
+        for (int i = 0; i < n; ++i)
+        {
+            if (COLUMNS[c].count == 1)
+                fprintf(out, ",%s", COLUMNS[c].name);
+            else
+                fprintf(out, ",%s%d", COLUMNS[c].name, i);
+        }
+    }
+    fprintf(out, "\n");
+    for (size_t r = 0; r < ordered.size(); ++r)
+    {
+        const uint8_t *base = reinterpret_cast<const uint8_t *>(ordered[r]);
+        fprintf(out, "%.6f", (ordered[r]->time_ns - header.start_monotonic_ns) / 1e9);
+        for (int c = 0; c < COLUMN_COUNT; ++c)
+        {
+            int n = column_element_count(COLUMNS[c], header.thruster_count);
+            size_t size = column_type_size(COLUMNS[c].type);
+            for (int i = 0; i < n; ++i)
+            {
+                fputc(',', out);
+                print_value(out, base + COLUMNS[c].offset + i * size, COLUMNS[c].type);
+            }
+        }
+        fputc('\n', out);
+    }
+    if (path)
+        fclose(out);
+    return true;
+}
+
+// 列ごとに1ファイル (<dir>/<列名>.bin、要素を行数分並べた生配列) と、列の一覧 schema.csv を書く
+static bool write_columns(const char *dir, const BlackboxHeader &header, const std::vector<const BlackboxRecord *> &ordered)
+{
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "ディレクトリ '%s' を作成できません: %s\n", dir, strerror(errno));
+        return false;
+    }
+    char path[512];
+    snprintf(path, sizeof(path), "%s/schema.csv", dir);
+    FILE *schema = fopen(path, "w");
+    if (!schema)
+    {
+        fprintf(stderr, "'%s' を作成できません: %s\n", path, strerror(errno));
+        return false;
+    }
+    fprintf(schema, "file,type,rows\n");
+    std::vector<uint8_t> buffer;
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+    {
+        int n = column_element_count(COLUMNS[c], header.thruster_count);
+        size_t size = column_type_size(COLUMNS[c].type);
+        for (int i = 0; i < n; ++i)
+        {
+            char name[64];
+            if (COLUMNS[c].count == 1)
+                snprintf(name, sizeof(name), "%s", COLUMNS[c].name);
+            else
+                snprintf(name, sizeof(name), "%s%d", COLUMNS[c].name, i);
+            buffer.resize(ordered.size() * size);
+            for (size_t r = 0; r < ordered.size(); ++r)
+                memcpy(&buffer[r * size], reinterpret_cast<const uint8_t *>(ordered[r]) + COLUMNS[c].offset + i * size, size);
+
+            snprintf(path, sizeof(path), "%s/%s.bin", dir, name);
+            FILE *out = fopen(path, "wb");
+            if (!out || (!buffer.empty() && fwrite(&buffer[0], 1, buffer.size(), out) != buffer.size()))
+            {
+                fprintf(stderr, "'%s' に書き込めません: %s\n", path, strerror(errno));
+                if (out)
+                    fclose(out);
+                fclose(schema);
+                return false;
+            }
+            fclose(out);
+            fprintf(schema, "%s.bin,%s,%zu\n", name, column_type_name(COLUMNS[c].type), ordered.size());
+        }
+    }
+    fclose(schema);
+    return true;
+}
+
+static void print_usage(const char *prog)
+{
+    fprintf(stderr, "使い方: %s ファイル [--csv 出力.csv | --columns ディレクトリ] [--last 件数]\n", prog);
+}
+
+static bool sequence_less(const BlackboxRecord *a, const BlackboxRecord *b)
+{
+    return a->sequence < b->sequence;
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    const char *csv_path = NULL;
+    const char *columns_dir = NULL;
+    unsigned long last = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+            csv_path = argv[++i];
+        else if (strcmp(argv[i], "--columns") == 0 && i + 1 < argc)
+            columns_dir = argv[++i];
+        else if (strcmp(argv[i], "--last") == 0 && i + 1 < argc)
+            last = strtoul(argv[++i], NULL, 10);
+        else if (argv[i][0] != '-' && !input)
+            input = argv[i];
+        else
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!input)
+    {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    FILE *in = fopen(input, "rb");
+    if (!in)
+    {
+        fprintf(stderr, "'%s' を開けません: %s\n", input, strerror(errno));
+        return 1;
+    }
+    BlackboxHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, BLACKBOX_MAGIC, sizeof(BLACKBOX_MAGIC)) != 0)
+    {
+        fprintf(stderr, "'%s' はフライトレコーダーのファイルではありません。\n", input);
+        fclose(in);
+        return 1;
+    }
+    if (header.version != BLACKBOX_VERSION || header.record_size != sizeof(BlackboxRecord) ||
+        header.header_size != BLACKBOX_HEADER_SIZE || header.thruster_count > BLACKBOX_MAX_THRUSTERS)
+    {
+        fprintf(stderr, "未対応の形式です (version=%u record_size=%u header_size=%u)。\n", header.version,
+                header.record_size, header.header_size);
+        fclose(in);
+        return 1;
+    }
+
+    // レコード領域を読み込む (記録中のファイルでも読めるよう、ファイルが短ければ読めた分だけ使う)
+    std::vector<BlackboxRecord> slots(header.capacity);
+    size_t read_count = 0;
+    if (fseek(in, BLACKBOX_HEADER_SIZE, SEEK_SET) == 0 && header.capacity > 0)
+        read_count = fread(&slots[0], sizeof(BlackboxRecord), header.capacity, in);
+    fclose(in);
+
+    std::vector<const BlackboxRecord *> ordered;
+    ordered.reserve(read_count);
+    size_t empty = 0, torn = 0;
+    for (size_t i = 0; i < read_count; ++i)
+    {
+        uint64_t sequence = slots[i].sequence;
+        if (sequence == 0)
+            empty++; // 未使用、または書き込み途中
+        else if ((sequence - 1) % header.capacity != i)
+            torn++;  // 置き場所と番号が合わない (壊れたスロット)
+        else
+            ordered.push_back(&slots[i]);
+    }
+    std::sort(ordered.begin(), ordered.end(), sequence_less);
+    if (last > 0 && ordered.size() > last)
+        ordered.erase(ordered.begin(), ordered.end() - last);
+
+    // 番号の抜け (異常終了時の書き込み途中のスロットなど) を数える
+    unsigned long long gaps = 0;
+    for (size_t r = 1; r < ordered.size(); ++r)
+        gaps += ordered[r]->sequence - ordered[r - 1]->sequence - 1;
+
+    fprintf(stderr, "%s: %zu 件 (容量 %u、未使用/書き込み途中 %zu、不整合 %zu、番号の抜け %llu)", input, ordered.size(),
+            header.capacity, empty, torn, gaps);
+    if (!ordered.empty())
+    {
+        fprintf(stderr, "、seq %llu〜%llu、%.3f 秒分", static_cast<unsigned long long>(ordered.front()->sequence),
+                static_cast<unsigned long long>(ordered.back()->sequence),
+                (ordered.back()->time_ns - ordered.front()->time_ns) / 1e9);
+    }
+    fprintf(stderr, "\n");
+
+    bool ok = columns_dir ? write_columns(columns_dir, header, ordered) : write_csv(csv_path, header, ordered);
+    return ok ? 0 : 1;
+}